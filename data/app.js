@@ -0,0 +1,155 @@
+let autoRefreshEnabled = true;
+let refreshInterval = 1000;
+let streamSource = null;
+let streamSeq = null;
+let streamText = '';
+const streamDecoder = new TextDecoder();
+const MAX_DISPLAY_CHARS = 16384;
+
+function updateTimestamp() {
+    const now = new Date();
+    document.getElementById('last-update').textContent = 
+        `Последнее обновление: ${now.toLocaleTimeString()}`;
+}
+
+function appendData(chunk) {
+    streamText = (streamText + chunk).slice(-MAX_DISPLAY_CHARS);
+    const display = document.getElementById('data-display');
+    display.textContent = streamText.length > 0 ? streamText : 'Нет данных';
+    display.scrollTop = display.scrollHeight;
+    updateTimestamp();
+}
+
+// Последние данные и курсор, с которого продолжит поток событий
+function refreshData() {
+    return fetch(streamSeq === null ? '/api/data' : `/api/data?since=${streamSeq}`)
+        .then(response => response.json())
+        .then(data => {
+            streamSeq = data.seq;
+            appendData(data.data || '');
+        })
+        .catch(error => {
+            console.error('Ошибка получения данных:', error);
+            document.getElementById('data-display').textContent = 
+                'Ошибка получения данных';
+        });
+}
+
+function showStatus(status) {
+    if (status.ip) {
+        document.getElementById('ip-address').textContent = status.ip;
+    }
+    if (status.uptime !== undefined) {
+        document.getElementById('uptime').textContent = formatUptime(status.uptime);
+    }
+    if (status.wifi) {
+        const wifi = document.getElementById('wifi-status');
+        const online = status.wifi === 'connected';
+        wifi.textContent = online ? 'Подключено' : status.wifi;
+        wifi.className = 'status-value ' + (online ? 'status-online' : 'status-offline');
+    }
+    updateTimestamp();
+}
+
+// Поток событий /api/events: данные (id - курсор следующего байта) и
+// состояние устройства одним соединением. После обрыва EventSource сам
+// переподключается с заголовком Last-Event-ID и продолжает с того же места
+function connectStream() {
+    const interval = parseFloat(document.getElementById('refresh-interval').value) * 1000;
+    const params = [`status=${Math.round(interval)}`];
+    if (streamSeq !== null) {
+        params.push(`since=${streamSeq}`);
+    }
+    streamSource = new EventSource(`/api/events?${params.join('&')}`);
+
+    streamSource.onmessage = event => {
+        // Строка JSON: код символа равен значению байта
+        const text = JSON.parse(event.data);
+        const bytes = new Uint8Array(text.length);
+        for (let i = 0; i < text.length; i++) {
+            bytes[i] = text.charCodeAt(i);
+        }
+        streamSeq = parseInt(event.lastEventId, 10);
+        appendData(streamDecoder.decode(bytes, {stream: true}));
+    };
+
+    streamSource.addEventListener('gap', event => {
+        const notice = JSON.parse(event.data);
+        streamSeq = notice.seq;
+        appendData(`\n[потеряно ${notice.gap} байт]\n`);
+    });
+
+    streamSource.addEventListener('status', event => showStatus(JSON.parse(event.data)));
+
+    streamSource.onerror = () => {
+        // CLOSED - сервер отказал (например, 503), переподключаемся сами
+        if (streamSource.readyState === EventSource.CLOSED) {
+            streamSource = null;
+            if (autoRefreshEnabled) {
+                setTimeout(connectStream, 1000);
+            }
+        }
+    };
+}
+
+function clearData() {
+    streamText = '';
+    document.getElementById('data-display').textContent = 'Данные очищены';
+    updateTimestamp();
+}
+
+function toggleAutoRefresh() {
+    autoRefreshEnabled = !autoRefreshEnabled;
+    const btn = document.getElementById('auto-refresh-btn');
+    
+    if (autoRefreshEnabled) {
+        btn.textContent = '⏸️ Автообновление';
+        startAutoRefresh();
+    } else {
+        btn.textContent = '▶️ Автообновление';
+        stopAutoRefresh();
+    }
+}
+
+function startAutoRefresh() {
+    stopAutoRefresh();
+    connectStream();
+}
+
+function stopAutoRefresh() {
+    if (streamSource) {
+        streamSource.close();
+        streamSource = null;
+    }
+}
+
+function formatUptime(seconds) {
+    const days = Math.floor(seconds / 86400);
+    const hours = Math.floor((seconds % 86400) / 3600);
+    const minutes = Math.floor((seconds % 3600) / 60);
+    const secs = seconds % 60;
+    
+    if (days > 0) {
+        return `${days}д ${hours}ч ${minutes}м`;
+    } else if (hours > 0) {
+        return `${hours}ч ${minutes}м ${secs}с`;
+    } else if (minutes > 0) {
+        return `${minutes}м ${secs}с`;
+    } else {
+        return `${secs}с`;
+    }
+}
+
+// Инициализация
+document.getElementById('refresh-interval').addEventListener('change', function() {
+    if (autoRefreshEnabled) {
+        startAutoRefresh();
+    }
+});
+
+// Первоначальная загрузка: последние данные и курсор, затем поток событий
+refreshData().then(() => {
+    if (autoRefreshEnabled) {
+        startAutoRefresh();
+    }
+});
@@ -0,0 +1,847 @@
+/**
+ * @file bench_bridge.cpp
+ * @brief Нагрузочный замер моста под Linux: синтетический поток RS-232 и N клиентов
+ *
+ * В одном процессе запускается ядро прошивки (прием UART, буфер моста,
+ * журналы, HTTP сервер). Генератор подает в имитацию порта записи
+ * фиксированной длины с меткой времени со скоростью линии (8N1: 10 бит
+ * на байт). Клиенты читают поток по сети через loopback:
+ *   - HTTP: опрос GET /api/data?since=<seq>&encoding=base64 (с --wait-ms -
+ *     долгий опрос &wait=<мс>: ответ приходит при появлении данных)
+ *   - WebSocket: /ws/stream
+ *   - TCP: прозрачный порт TCP_SERIAL_RAW_PORT (--tcp)
+ *   - SSE: GET /api/events?encoding=base64 (--sse)
+ * и по меткам считают задержку от "линии" до клиента.
+ *
+ * Для каждой скорости (и каждого режима --batch) выводится: принято байт
+ * в секунду на клиента, p50/p99/max задержки, потери по отчетам сервера
+ * (lost в /api/data, {"gap":N} в WebSocket и SSE), переполнения буфера приема
+ * UART и отправок с данными в секунду (ответов, кадров WebSocket, send()) -
+ * цена меньшей задержки в пакетах радио.
+ * Код возврата 1, если какой-то вид клиентов не получил ни одной записи.
+ *
+ * Использование:
+ *   comtoair_bench [--baud 115200,921600,3000000] [--seconds 5] [--http 2]
+ *                  [--ws 2] [--tcp 0] [--sse 0] [--poll-ms 20] [--wait-ms 0] [--port 18080]
+ *                  [--batch immediate,fixed,adaptive,nagle] [--batch-bytes N]
+ *                  [--batch-delay-us US] [--csv] [--verbose]
+ *
+ * --batch задает режим пакетирования всем транспортам (по умолчанию -
+ * BATCH_* из config.h); --batch-bytes и --batch-delay-us меняют пороги.
+ *
+ * Ограничения прошивки сохраняются: HTTP сервер держит не больше 7 сессий
+ * (лишние вытесняют старые), WebSocket клиентов не больше WS_STREAM_MAX_CLIENTS,
+ * ожидающих запросов не больше API_DATA_MAX_WAITERS (остальным ответ сразу),
+ * SSE клиентов не больше SSE_MAX_CLIENTS.
+ */
+
+#include "config.h"
+#include "rs232_handler.h"
+#include "rs232_host.h"
+#include "uart_rx.h"
+#include "web_server.h"
+#include "tcp_server.h"
+#include "flash_log.h"
+#include "batch_policy.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "esp_log.h"
+
+// Запись генератора: A5 5A, номер (4), время отправки нс (8), сумма, '\n'
+#define REC_SIZE        16
+#define REC_MAGIC0      0xa5
+#define REC_MAGIC1      0x5a
+
+#define GEN_BATCH       64          // Записей за одну подачу в порт
+#define DRAIN_MS        300         // Ожидание хвоста после остановки генератора
+#define CONNECT_MS      5000        // Предельное ожидание подключения клиентов
+
+typedef std::chrono::steady_clock bench_clock;
+
+static const auto bench_start = bench_clock::now();
+
+static uint64_t now_ns(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() -
+                                                                bench_start).count();
+}
+
+/**
+ * @brief Результат одного клиента
+ */
+typedef struct {
+    uint64_t bytes;                 // Принято байт потока
+    uint64_t records;               // Разобрано записей
+    uint64_t lost;                  // Потеряно по отчету сервера
+    uint64_t resync;                // Байт, пропущенных при поиске начала записи
+    bool connected;
+    std::vector<uint32_t> latency_us;
+} client_result_t;
+
+/**
+ * @brief Параметры прогона
+ */
+typedef struct {
+    uint32_t baud;
+    int seconds;
+    int http_clients;
+    int ws_clients;
+    int tcp_clients;
+    int sse_clients;
+    int poll_ms;
+    int wait_ms;                    // Долгий опрос /api/data, 0 - обычный опрос
+    uint16_t port;
+} bench_params_t;
+
+static std::atomic<bool> clients_stop(false);
+static std::atomic<int> clients_ready(0);
+
+// ---------------------------------------------------------------------------
+// Разбор записей из потока
+
+typedef struct {
+    std::vector<uint8_t> buf;
+} record_parser_t;
+
+static uint8_t record_sum(const uint8_t *rec)
+{
+    uint8_t sum = 0;
+    for (int i = 2; i < 14; i++) {
+        sum += rec[i];
+    }
+    return sum;
+}
+
+static void parser_feed(record_parser_t *parser, const uint8_t *data, size_t length,
+                        client_result_t *result)
+{
+    uint64_t now = now_ns();
+    result->bytes += length;
+    parser->buf.insert(parser->buf.end(), data, data + length);
+
+    size_t pos = 0;
+    const uint8_t *p = parser->buf.data();
+    while (parser->buf.size() - pos >= REC_SIZE) {
+        const uint8_t *rec = p + pos;
+        if (rec[0] != REC_MAGIC0 || rec[1] != REC_MAGIC1 || rec[15] != '\n' ||
+            rec[14] != record_sum(rec)) {
+            // Начало потока или место потери - ищем следующую запись
+            pos++;
+            result->resync++;
+            continue;
+        }
+        uint64_t sent = 0;
+        memcpy(&sent, rec + 6, sizeof(sent));
+        result->latency_us.push_back((uint32_t)((now - sent) / 1000));
+        result->records++;
+        pos += REC_SIZE;
+    }
+    parser->buf.erase(parser->buf.begin(), parser->buf.begin() + pos);
+}
+
+// ---------------------------------------------------------------------------
+// Соединение с буферизованным чтением
+
+typedef struct {
+    int fd;
+    std::string in;
+} bench_conn_t;
+
+static bool conn_open(bench_conn_t *conn, uint16_t port)
+{
+    conn->fd = socket(AF_INET, SOCK_STREAM, 0);
+    conn->in.clear();
+    if (conn->fd < 0) {
+        return false;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(conn->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(conn->fd);
+        conn->fd = -1;
+        return false;
+    }
+    // Таймаут чтения: клиенты периодически проверяют флаг остановки
+    struct timeval tv = { 0, 100 * 1000 };
+    int opt = 1;
+    setsockopt(conn->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    return true;
+}
+
+static void conn_close(bench_conn_t *conn)
+{
+    if (conn->fd >= 0) {
+        close(conn->fd);
+        conn->fd = -1;
+    }
+}
+
+/**
+ * Дочитать в conn->in не меньше length байт; false при закрытии или остановке
+ */
+static bool conn_fill(bench_conn_t *conn, size_t length)
+{
+    char buf[16384];
+    while (conn->in.size() < length) {
+        ssize_t n = recv(conn->fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            conn->in.append(buf, n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) &&
+            !clients_stop.load()) {
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+static bool conn_read_line(bench_conn_t *conn, std::string *line)
+{
+    size_t end;
+    while ((end = conn->in.find("\r\n")) == std::string::npos) {
+        if (!conn_fill(conn, conn->in.size() + 1)) {
+            return false;
+        }
+    }
+    line->assign(conn->in, 0, end);
+    conn->in.erase(0, end + 2);
+    return true;
+}
+
+static bool conn_read(bench_conn_t *conn, size_t length, std::string *out)
+{
+    if (!conn_fill(conn, length)) {
+        return false;
+    }
+    out->assign(conn->in, 0, length);
+    conn->in.erase(0, length);
+    return true;
+}
+
+static bool send_str(int fd, const std::string &data)
+{
+    return send(fd, data.data(), data.size(), MSG_NOSIGNAL) == (ssize_t)data.size();
+}
+
+// ---------------------------------------------------------------------------
+// HTTP клиент
+
+/**
+ * GET с разбором Content-Length и chunked ответа
+ */
+static bool http_get(bench_conn_t *conn, const char *path, std::string *body)
+{
+    std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    if (!send_str(conn->fd, request)) {
+        return false;
+    }
+
+    std::string line;
+    if (!conn_read_line(conn, &line) || line.compare(0, 12, "HTTP/1.1 200") != 0) {
+        return false;
+    }
+    bool chunked = false;
+    size_t content_length = 0;
+    while (conn_read_line(conn, &line) && !line.empty()) {
+        if (strncasecmp(line.c_str(), "Transfer-Encoding: chunked", 26) == 0) {
+            chunked = true;
+        } else if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0) {
+            content_length = strtoul(line.c_str() + 15, NULL, 10);
+        }
+    }
+    if (!line.empty()) {
+        return false;
+    }
+
+    body->clear();
+    if (!chunked) {
+        return conn_read(conn, content_length, body);
+    }
+    std::string chunk;
+    while (conn_read_line(conn, &line)) {
+        size_t size = strtoul(line.c_str(), NULL, 16);
+        if (!conn_read(conn, size + 2, &chunk)) {
+            return false;
+        }
+        if (size == 0) {
+            return true;
+        }
+        body->append(chunk, 0, size);
+    }
+    return false;
+}
+
+static uint32_t json_field_uint(const std::string &json, const char *key)
+{
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t pos = json.find(pattern);
+    return pos == std::string::npos ? 0 :
+           (uint32_t)strtoul(json.c_str() + pos + pattern.size(), NULL, 10);
+}
+
+static size_t base64_decode(const char *in, size_t length, uint8_t *out)
+{
+    // Таблица строится один раз (инициализация локального static потокобезопасна)
+    static const std::array<int8_t, 256> table = [] {
+        std::array<int8_t, 256> t;
+        t.fill(-1);
+        const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (int i = 0; i < 64; i++) {
+            t[(uint8_t)alphabet[i]] = (int8_t)i;
+        }
+        return t;
+    }();
+
+    size_t n = 0;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (size_t i = 0; i < length; i++) {
+        int8_t v = table[(uint8_t)in[i]];
+        if (v < 0) {
+            continue;
+        }
+        acc = (acc << 6) | (uint32_t)v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out[n++] = (uint8_t)(acc >> bits);
+        }
+    }
+    return n;
+}
+
+static void http_client(const bench_params_t *params, client_result_t *result)
+{
+    bench_conn_t conn;
+    if (!conn_open(&conn, params->port)) {
+        return;
+    }
+    result->connected = true;
+    clients_ready.fetch_add(1);
+
+    record_parser_t parser;
+    std::string body;
+    std::vector<uint8_t> data(DATA_BUFFER_SIZE);
+    uint32_t seq = web_server_data_seq();
+    char path[128];
+
+    while (!clients_stop.load()) {
+        snprintf(path, sizeof(path), "/api/data?since=%lu&max=%u&encoding=base64&wait=%d",
+                 (unsigned long)seq, DATA_BUFFER_SIZE, params->wait_ms);
+        if (!http_get(&conn, path, &body)) {
+            break;
+        }
+
+        size_t start = body.find("\"data\":\"");
+        if (start != std::string::npos) {
+            start += 8;
+            size_t end = body.find('"', start);
+            size_t n = base64_decode(body.data() + start, end - start, data.data());
+            parser_feed(&parser, data.data(), n, result);
+        }
+        result->lost += json_field_uint(body, "lost");
+        seq = json_field_uint(body, "seq");
+
+        if (params->wait_ms == 0 && json_field_uint(body, "pending") == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(params->poll_ms));
+        }
+    }
+    conn_close(&conn);
+}
+
+// ---------------------------------------------------------------------------
+// WebSocket клиент
+
+static void ws_client(const bench_params_t *params, client_result_t *result)
+{
+    bench_conn_t conn;
+    if (!conn_open(&conn, params->port)) {
+        return;
+    }
+    std::string request =
+        "GET /ws/stream HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\n"
+        "Connection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n\r\n";
+    std::string line;
+    if (!send_str(conn.fd, request) || !conn_read_line(&conn, &line) ||
+        line.compare(0, 12, "HTTP/1.1 101") != 0) {
+        conn_close(&conn);
+        return;
+    }
+    while (conn_read_line(&conn, &line) && !line.empty()) {
+    }
+    result->connected = true;
+    clients_ready.fetch_add(1);
+
+    record_parser_t parser;
+    std::string hdr;
+    std::string payload;
+    while (!clients_stop.load()) {
+        if (!conn_read(&conn, 2, &hdr)) {
+            break;
+        }
+        uint8_t opcode = (uint8_t)hdr[0] & 0x0f;
+        uint64_t len = (uint8_t)hdr[1] & 0x7f;
+        if (len >= 126) {
+            size_t ext = len == 126 ? 2 : 8;
+            if (!conn_read(&conn, ext, &hdr)) {
+                break;
+            }
+            len = 0;
+            for (size_t i = 0; i < ext; i++) {
+                len = (len << 8) | (uint8_t)hdr[i];
+            }
+        }
+        if (!conn_read(&conn, (size_t)len, &payload)) {
+            break;
+        }
+
+        if (opcode == 0x2) {
+            parser_feed(&parser, (const uint8_t *)payload.data(), payload.size(), result);
+        } else if (opcode == 0x1) {
+            result->lost += json_field_uint(payload, "gap");
+        } else if (opcode == 0x8) {
+            break;
+        }
+    }
+    conn_close(&conn);
+}
+
+// ---------------------------------------------------------------------------
+// TCP клиент (прозрачный порт)
+
+static void tcp_client(const bench_params_t *params, client_result_t *result)
+{
+    bench_conn_t conn;
+    if (!conn_open(&conn, TCP_SERIAL_RAW_PORT)) {
+        return;
+    }
+    result->connected = true;
+    clients_ready.fetch_add(1);
+
+    record_parser_t parser;
+    uint8_t buf[16384];
+    while (!clients_stop.load()) {
+        ssize_t n = recv(conn.fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            parser_feed(&parser, buf, (size_t)n, result);
+        } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            break;
+        }
+    }
+    conn_close(&conn);
+}
+
+// ---------------------------------------------------------------------------
+// SSE клиент
+
+static void sse_client(const bench_params_t *params, client_result_t *result)
+{
+    bench_conn_t conn;
+    if (!conn_open(&conn, params->port)) {
+        return;
+    }
+    std::string line;
+    if (!send_str(conn.fd, "GET /api/events?encoding=base64 HTTP/1.1\r\nHost: localhost\r\n"
+                           "Accept: text/event-stream\r\n\r\n") ||
+        !conn_read_line(&conn, &line) || line.compare(0, 12, "HTTP/1.1 200") != 0) {
+        conn_close(&conn);
+        return;
+    }
+    while (conn_read_line(&conn, &line) && !line.empty()) {
+    }
+    result->connected = true;
+    clients_ready.fetch_add(1);
+
+    record_parser_t parser;
+    std::string chunk;
+    std::string events;
+    std::vector<uint8_t> data(SSE_EVENT_MAX_DATA);
+    while (!clients_stop.load() && conn_read_line(&conn, &line)) {
+        size_t size = strtoul(line.c_str(), NULL, 16);
+        if (size == 0 || !conn_read(&conn, size + 2, &chunk)) {
+            break;
+        }
+        events.append(chunk, 0, size);
+
+        // Событие заканчивается пустой строкой
+        size_t end;
+        while ((end = events.find("\n\n")) != std::string::npos) {
+            std::string event(events, 0, end + 1);
+            events.erase(0, end + 2);
+            if (event.compare(0, 11, "event: gap\n") == 0) {
+                result->lost += json_field_uint(event, "gap");
+                continue;
+            }
+            size_t start = event.find("data: \"");
+            if (event.compare(0, 4, "id: ") != 0 || start == std::string::npos) {
+                continue;
+            }
+            start += 7;
+            size_t stop = event.find('"', start);
+            size_t n = base64_decode(event.data() + start, stop - start, data.data());
+            parser_feed(&parser, data.data(), n, result);
+        }
+    }
+    conn_close(&conn);
+}
+
+// ---------------------------------------------------------------------------
+// Генератор линии
+
+typedef struct {
+    uint64_t sent;                  // Байт подано в порт
+    uint64_t overrun;               // Из них не поместилось в буфер приема
+} generator_result_t;
+
+static void generator(uint32_t baud, int seconds, generator_result_t *result)
+{
+    double bytes_per_ns = (double)baud / 10.0 / 1e9;
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)seconds * 1000000000ull;
+    uint32_t seq = 0;
+    uint8_t batch[GEN_BATCH * REC_SIZE];
+
+    result->sent = 0;
+    result->overrun = 0;
+
+    while (true) {
+        uint64_t now = now_ns();
+        if (now >= end) {
+            break;
+        }
+        uint64_t due = (uint64_t)((double)(now - start) * bytes_per_ns);
+        uint64_t records = due > result->sent ? (due - result->sent) / REC_SIZE : 0;
+        if (records == 0) {
+            // Следующая запись "дойдет по линии" не раньше чем через это время
+            uint64_t next = start + (uint64_t)((double)(result->sent + REC_SIZE) / bytes_per_ns);
+            uint64_t wait_ns = next > now ? next - now : 0;
+            std::this_thread::sleep_for(std::chrono::nanoseconds(
+                std::min<uint64_t>(wait_ns, 1000000)));
+            continue;
+        }
+        if (records > GEN_BATCH) {
+            records = GEN_BATCH;
+        }
+
+        for (uint64_t i = 0; i < records; i++) {
+            uint8_t *rec = batch + i * REC_SIZE;
+            rec[0] = REC_MAGIC0;
+            rec[1] = REC_MAGIC1;
+            memcpy(rec + 2, &seq, sizeof(seq));
+            memcpy(rec + 6, &now, sizeof(now));
+            rec[14] = record_sum(rec);
+            rec[15] = '\n';
+            seq++;
+        }
+        size_t length = (size_t)records * REC_SIZE;
+        size_t accepted = rs232_host_inject(batch, length);
+        result->overrun += length - accepted;
+        result->sent += length;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Прогон и отчет
+
+typedef struct {
+    const char *name;
+    int clients;
+    double kbps_per_client;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+    uint64_t lost;
+    uint64_t records;
+    double packets_per_s;           // Отправок с данными в секунду (всем клиентам)
+} transport_summary_t;
+
+static transport_summary_t summarize(const char *name, std::vector<client_result_t> &results,
+                                     double seconds)
+{
+    transport_summary_t s;
+    memset(&s, 0, sizeof(s));
+    s.name = name;
+
+    std::vector<uint32_t> latency;
+    uint64_t bytes = 0;
+    for (auto &r : results) {
+        if (!r.connected) {
+            continue;
+        }
+        s.clients++;
+        bytes += r.bytes;
+        s.lost += r.lost;
+        s.records += r.records;
+        latency.insert(latency.end(), r.latency_us.begin(), r.latency_us.end());
+    }
+    if (s.clients > 0) {
+        s.kbps_per_client = (double)bytes / s.clients / seconds / 1000.0;
+    }
+    if (!latency.empty()) {
+        std::sort(latency.begin(), latency.end());
+        s.p50_us = latency[(latency.size() - 1) / 2];
+        s.p99_us = latency[(latency.size() - 1) * 99 / 100];
+        s.max_us = latency.back();
+    }
+    return s;
+}
+
+static bool run(const bench_params_t *params, bool csv)
+{
+    std::vector<client_result_t> http_results(params->http_clients);
+    std::vector<client_result_t> ws_results(params->ws_clients);
+    std::vector<client_result_t> tcp_results(params->tcp_clients);
+    std::vector<client_result_t> sse_results(params->sse_clients);
+    std::vector<std::thread> threads;
+
+    clients_stop.store(false);
+    clients_ready.store(0);
+    for (auto &r : http_results) {
+        threads.emplace_back(http_client, params, &r);
+    }
+    for (auto &r : ws_results) {
+        threads.emplace_back(ws_client, params, &r);
+    }
+    for (auto &r : tcp_results) {
+        threads.emplace_back(tcp_client, params, &r);
+    }
+    for (auto &r : sse_results) {
+        threads.emplace_back(sse_client, params, &r);
+    }
+    // Одновременные подключения могут не поместиться в очередь listen()
+    // (backlog_conn): генератор запускается, когда подключились все
+    int total = params->http_clients + params->ws_clients + params->tcp_clients +
+                params->sse_clients;
+    for (int waited = 0; clients_ready.load() < total && waited < CONNECT_MS; waited += 10) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    batch_stats_t before[FANOUT_TRANSPORT_COUNT];
+    for (int t = 0; t < FANOUT_TRANSPORT_COUNT; t++) {
+        batch_get_stats((fanout_transport_t)t, &before[t]);
+    }
+
+    generator_result_t gen;
+    generator(params->baud, params->seconds, &gen);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(DRAIN_MS));
+    clients_stop.store(true);
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    double line_kbps = (double)gen.sent / params->seconds / 1000.0;
+    transport_summary_t summaries[FANOUT_TRANSPORT_COUNT] = {
+        summarize("http", http_results, params->seconds),
+        summarize("ws", ws_results, params->seconds),
+        summarize("tcp", tcp_results, params->seconds),
+        summarize("sse", sse_results, params->seconds),
+    };
+    const int expected_clients[FANOUT_TRANSPORT_COUNT] = {
+        params->http_clients, params->ws_clients, params->tcp_clients, params->sse_clients,
+    };
+
+    bool ok = true;
+    for (int t = 0; t < FANOUT_TRANSPORT_COUNT; t++) {
+        transport_summary_t &s = summaries[t];
+        int expected = expected_clients[t];
+        if (expected == 0) {
+            continue;
+        }
+        if (s.clients < expected || s.records == 0) {
+            ok = false;
+        }
+        batch_stats_t after;
+        batch_config_t batch;
+        batch_get_stats((fanout_transport_t)t, &after);
+        batch_get_config((fanout_transport_t)t, &batch);
+        s.packets_per_s = (double)(after.packets - before[t].packets) / params->seconds;
+        const char *mode = batch_mode_name(batch.mode);
+
+        if (csv) {
+            printf("%lu,%s,%s,%d,%.1f,%.1f,%.3f,%.3f,%.3f,%llu,%llu,%.1f\n",
+                   (unsigned long)params->baud, s.name, mode, s.clients, line_kbps,
+                   s.kbps_per_client, s.p50_us / 1000.0, s.p99_us / 1000.0, s.max_us / 1000.0,
+                   (unsigned long long)s.lost, (unsigned long long)gen.overrun,
+                   s.packets_per_s);
+        } else {
+            printf("%9lu  %-4s  %-9s  %2d/%-2d  %9.1f  %9.1f  %8.3f  %8.3f  %8.3f  %9llu  "
+                   "%9llu  %8.1f\n",
+                   (unsigned long)params->baud, s.name, mode, s.clients, expected, line_kbps,
+                   s.kbps_per_client, s.p50_us / 1000.0, s.p99_us / 1000.0, s.max_us / 1000.0,
+                   (unsigned long long)s.lost, (unsigned long long)gen.overrun,
+                   s.packets_per_s);
+        }
+    }
+    fflush(stdout);
+    return ok;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [--baud B[,B...]] [--seconds S] [--http N] [--ws N] [--tcp N]\n"
+            "          [--sse N] [--poll-ms MS] [--wait-ms MS] [--port P] [--batch MODE[,MODE...]]\n"
+            "          [--batch-bytes N] [--batch-delay-us US] [--csv] [--verbose]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    bench_params_t params = { 0, 5, 2, 2, 0, 0, 20, 0, 18080 };
+    std::vector<uint32_t> bauds;
+    std::vector<batch_mode_t> batch_modes;
+    uint32_t batch_bytes = 0;
+    uint32_t batch_delay_us = 0;
+    bool batch_delay_set = false;
+    bool csv = false;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--csv") == 0) {
+            csv = true;
+        } else if (strcmp(arg, "--verbose") == 0) {
+            verbose = true;
+        } else if (value == NULL) {
+            usage(argv[0]);
+            return 2;
+        } else if (strcmp(arg, "--baud") == 0) {
+            for (char *p = argv[++i]; *p != '\0'; ) {
+                char *end;
+                bauds.push_back((uint32_t)strtoul(p, &end, 10));
+                p = *end == ',' ? end + 1 : end;
+                if (end == p && *p != '\0') {
+                    usage(argv[0]);
+                    return 2;
+                }
+            }
+        } else if (strcmp(arg, "--seconds") == 0) {
+            params.seconds = atoi(argv[++i]);
+        } else if (strcmp(arg, "--http") == 0) {
+            params.http_clients = atoi(argv[++i]);
+        } else if (strcmp(arg, "--ws") == 0) {
+            params.ws_clients = atoi(argv[++i]);
+        } else if (strcmp(arg, "--tcp") == 0) {
+            params.tcp_clients = atoi(argv[++i]);
+        } else if (strcmp(arg, "--sse") == 0) {
+            params.sse_clients = atoi(argv[++i]);
+        } else if (strcmp(arg, "--batch") == 0) {
+            char *list = argv[++i];
+            for (char *name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+                batch_mode_t mode;
+                if (!batch_parse_mode(name, &mode)) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                batch_modes.push_back(mode);
+            }
+        } else if (strcmp(arg, "--batch-bytes") == 0) {
+            batch_bytes = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--batch-delay-us") == 0) {
+            batch_delay_us = (uint32_t)strtoul(argv[++i], NULL, 10);
+            batch_delay_set = true;
+        } else if (strcmp(arg, "--poll-ms") == 0) {
+            params.poll_ms = atoi(argv[++i]);
+        } else if (strcmp(arg, "--wait-ms") == 0) {
+            params.wait_ms = atoi(argv[++i]);
+        } else if (strcmp(arg, "--port") == 0) {
+            params.port = (uint16_t)atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (bauds.empty()) {
+        bauds = { 115200, 921600, 3000000 };
+    }
+    if (params.seconds <= 0) {
+        params.seconds = 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    esp_log_level_set("*", verbose ? ESP_LOG_INFO : ESP_LOG_WARN);
+
+    rs232_config_t config = {
+        UART_BAUD_RATE, UART_DATA_8_BITS, UART_PARITY_DISABLE, UART_STOP_BITS_1,
+    };
+    if (!rs232_init(&config) || !uart_rx_start(UART_NUM, rs232_get_event_queue()) ||
+        !web_server_start(params.port)) {
+        fprintf(stderr, "Failed to start bridge core\n");
+        return 1;
+    }
+    if (params.tcp_clients > 0 && !tcp_server_start()) {
+        fprintf(stderr, "Failed to start TCP server\n");
+        return 1;
+    }
+    flash_log_start();
+
+    if (csv) {
+        printf("baud,transport,batch,clients,line_kbps,client_kbps,p50_ms,p99_ms,max_ms,"
+               "lost_bytes,uart_overrun_bytes,packets_per_s\n");
+    } else {
+        printf("%9s  %-4s  %-9s  %5s  %9s  %9s  %8s  %8s  %8s  %9s  %9s  %8s\n",
+               "baud", "kind", "batch", "cli", "line kB/s", "cli kB/s", "p50 ms", "p99 ms",
+               "max ms", "lost B", "overrun B", "pkt/s");
+    }
+
+    // Без --batch - один прогон с параметрами по умолчанию (BATCH_MODE_COUNT)
+    if (batch_modes.empty()) {
+        batch_modes.push_back(BATCH_MODE_COUNT);
+    }
+
+    bool ok = true;
+    for (uint32_t baud : bauds) {
+        params.baud = baud;
+        config.baud_rate = baud;
+        rs232_reconfigure(&config);
+        for (batch_mode_t mode : batch_modes) {
+            for (int t = 0; t < FANOUT_TRANSPORT_COUNT; t++) {
+                batch_config_t batch;
+                batch_get_config((fanout_transport_t)t, &batch);
+                if (mode != BATCH_MODE_COUNT) {
+                    batch.mode = mode;
+                }
+                if (batch_bytes > 0) {
+                    batch.max_bytes = batch_bytes;
+                }
+                if (batch_delay_set) {
+                    batch.max_delay_us = batch_delay_us;
+                }
+                if (!batch_set_config((fanout_transport_t)t, &batch)) {
+                    fprintf(stderr, "Invalid batch parameters\n");
+                    return 2;
+                }
+            }
+            ok = run(&params, csv) && ok;
+        }
+    }
+
+    // Задачи моста, как и на устройстве, не завершаются: выходим без
+    // деструкторов статических объектов, которые они еще используют
+    fflush(stdout);
+    _exit(ok ? 0 : 1);
+}
@@ -0,0 +1,333 @@
+/**
+ * @file bench_capture.cpp
+ * @brief Замер двоичного формата выгрузки под Linux
+ *
+ * Кодирует один и тот же журнал (записи с метками времени, как в
+ * /api/history) в JSON (строка и base64), в двоичный формат и в двоичный
+ * со сжатием LZ4 (capture_format.h). Для каждого вида данных выводит
+ * объем ответа, выигрыш относительно JSON со строкой (во столько раз
+ * быстрее выгрузка по медленному каналу) и скорость кодирования в МБ/с.
+ * Сжатый поток распаковывается и сверяется с исходными записями.
+ *
+ * Сборка: цель bench_capture (host/CMakeLists.txt) или
+ *   g++ -O2 -std=gnu++17 -Iinclude host/bench_capture.cpp src/capture_format.cpp \
+ *       src/json_writer.cpp -o bench_capture
+ */
+
+#include "capture_format.h"
+#include "json_writer.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#define BENCH_RECORDS       4000
+#define BENCH_ROUNDS        20
+
+typedef struct {
+    uint32_t seq;
+    uint64_t ts;
+    std::vector<uint8_t> data;
+} bench_record_t;
+
+static std::vector<bench_record_t> records;
+static std::vector<uint8_t> output;
+static uint8_t block[CAPTURE_FORMAT_RESERVE + CAPTURE_FORMAT_BLOCK_SIZE];
+static capture_lz_state_t lz_state;
+static uint32_t rng = 12345;
+
+static uint32_t next_random(void)
+{
+    rng = rng * 1103515245u + 12345u;
+    return rng >> 16;
+}
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool collect(void *ctx, const uint8_t *data, size_t length)
+{
+    output.insert(output.end(), data, data + length);
+    return true;
+}
+
+static bool collect_text(void *ctx, const char *data, size_t length)
+{
+    return collect(ctx, (const uint8_t *)data, length);
+}
+
+static void add_record(const uint8_t *data, size_t length, uint32_t interval_us)
+{
+    bench_record_t r;
+    r.seq = records.empty() ? 1000 : records.back().seq + 1;
+    r.ts = records.empty() ? 5000000 : records.back().ts + interval_us + next_random() % 50;
+    r.data.assign(data, data + length);
+    records.push_back(r);
+}
+
+/**
+ * Строки NMEA: GPS приемник на 9600 бод
+ */
+static void make_nmea(void)
+{
+    char line[128];
+    records.clear();
+    for (int i = 0; i < BENCH_RECORDS; i++) {
+        uint32_t t = 120000 + i / 4;
+        int n;
+        if (i % 4 == 0) {
+            n = snprintf(line, sizeof(line),
+                         "$GPGGA,%06u.00,5545.%04u,N,03737.%04u,E,1,%02u,0.9,%u.%u,M,14.4,M,,*%02X\r\n",
+                         t, 1000 + next_random() % 50, 2000 + next_random() % 50,
+                         7 + next_random() % 4, 150 + next_random() % 3, next_random() % 10,
+                         next_random() & 0xff);
+        } else if (i % 4 == 1) {
+            n = snprintf(line, sizeof(line),
+                         "$GPRMC,%06u.00,A,5545.%04u,N,03737.%04u,E,0.%02u,%u.%u,160526,,,A*%02X\r\n",
+                         t, 1000 + next_random() % 50, 2000 + next_random() % 50,
+                         next_random() % 100, next_random() % 360, next_random() % 10,
+                         next_random() & 0xff);
+        } else if (i % 4 == 2) {
+            n = snprintf(line, sizeof(line), "$GPGSA,A,3,04,05,09,12,,,,,,,,,1.%u,0.9,1.%u*%02X\r\n",
+                         next_random() % 10, next_random() % 10, next_random() & 0xff);
+        } else {
+            n = snprintf(line, sizeof(line), "$GPVTG,%u.%u,T,,M,0.%02u,N,0.%02u,K,A*%02X\r\n",
+                         next_random() % 360, next_random() % 10, next_random() % 100,
+                         next_random() % 100, next_random() & 0xff);
+        }
+        add_record((const uint8_t *)line, (size_t)n, 25000);
+    }
+}
+
+/**
+ * Кадры Modbus RTU: опрос регистров и ответы
+ */
+static void make_modbus(void)
+{
+    uint8_t frame[64];
+    records.clear();
+    for (int i = 0; i < BENCH_RECORDS; i++) {
+        size_t n = 0;
+        frame[n++] = (uint8_t)(1 + (i / 2) % 4);
+        frame[n++] = 0x03;
+        if (i % 2 == 0) {
+            frame[n++] = 0x00;
+            frame[n++] = 0x10;
+            frame[n++] = 0x00;
+            frame[n++] = 0x08;
+        } else {
+            frame[n++] = 16;
+            for (int k = 0; k < 8; k++) {
+                uint16_t v = (uint16_t)(1000 + k * 17 + next_random() % 4);
+                frame[n++] = (uint8_t)(v >> 8);
+                frame[n++] = (uint8_t)v;
+            }
+        }
+        frame[n++] = (uint8_t)next_random();
+        frame[n++] = (uint8_t)next_random();
+        add_record(frame, n, 5000);
+    }
+}
+
+/**
+ * Несжимаемые данные: худший случай для сжатия
+ */
+static void make_random(void)
+{
+    uint8_t chunk[CAPTURE_MAX_CHUNK];
+    records.clear();
+    for (int i = 0; i < BENCH_RECORDS; i++) {
+        size_t n = 32 + next_random() % (sizeof(chunk) - 32);
+        for (size_t k = 0; k < n; k++) {
+            chunk[k] = (uint8_t)next_random();
+        }
+        add_record(chunk, n, 2000);
+    }
+}
+
+static size_t encode_json(bool base64)
+{
+    json_writer_t w;
+    char buf[JSON_WRITER_CHUNK_SIZE];
+    output.clear();
+    json_writer_init(&w, buf, sizeof(buf), collect_text, NULL);
+    json_begin_object(&w);
+    json_key(&w, "chunks");
+    json_begin_array(&w);
+    for (const bench_record_t &r : records) {
+        json_begin_object(&w);
+        json_kv_uint(&w, "seq", r.seq);
+        json_kv_uint64(&w, "ts", r.ts);
+        json_kv_uint(&w, "length", (uint32_t)r.data.size());
+        json_key(&w, "data");
+        if (base64) {
+            json_base64_begin(&w);
+            json_base64_append(&w, r.data.data(), r.data.size());
+            json_base64_end(&w);
+        } else {
+            json_string_bytes(&w, r.data.data(), r.data.size());
+        }
+        json_end_object(&w);
+    }
+    json_end_array(&w);
+    json_kv_uint(&w, "next", records.back().seq + 1);
+    json_end_object(&w);
+    json_writer_finish(&w);
+    return output.size();
+}
+
+static size_t encode_binary(bool lz4)
+{
+    capture_encoder_t enc;
+    output.clear();
+    capture_encoder_init(&enc, CAPTURE_KIND_RECORDS, block, CAPTURE_FORMAT_BLOCK_SIZE,
+                         lz4 ? &lz_state : NULL, collect, NULL);
+    for (const bench_record_t &r : records) {
+        capture_encoder_record(&enc, r.seq, r.ts, 0, r.data.data(), r.data.size());
+    }
+    capture_encoder_finish(&enc, records.back().seq + 1, records.back().seq + 1, 0, 0);
+    return output.size();
+}
+
+static bool read_varint(const uint8_t **p, const uint8_t *end, uint64_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && *p < end; shift += 7) {
+        uint8_t b = *(*p)++;
+        *value |= (uint64_t)(b & 0x7f) << shift;
+        if (b < 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Распаковка потока в output и сверка записей с исходными
+ */
+static bool verify(void)
+{
+    const uint8_t *p = output.data() + 6;
+    const uint8_t *end = output.data() + output.size();
+    std::vector<uint8_t> payload;
+    uint8_t unpacked[CAPTURE_FORMAT_BLOCK_SIZE];
+
+    if (memcmp(output.data(), "CTAB", 4) != 0 || output[5] != CAPTURE_KIND_RECORDS) {
+        return false;
+    }
+    while (p < end) {
+        uint8_t codec = *p++;
+        uint64_t raw_len, packed_len;
+        if (!read_varint(&p, end, &raw_len)) {
+            return false;
+        }
+        if (codec == CAPTURE_CODEC_STORED && raw_len == 0) {
+            break;
+        }
+        if (codec == CAPTURE_CODEC_STORED) {
+            payload.insert(payload.end(), p, p + raw_len);
+            p += raw_len;
+            continue;
+        }
+        if (!read_varint(&p, end, &packed_len) ||
+            capture_lz_decompress(p, packed_len, unpacked, sizeof(unpacked)) != raw_len) {
+            return false;
+        }
+        payload.insert(payload.end(), unpacked, unpacked + raw_len);
+        p += packed_len;
+    }
+
+    const uint8_t *q = payload.data();
+    const uint8_t *qend = q + payload.size();
+    uint32_t expected = 0;
+    uint64_t ts = 0;
+    for (const bench_record_t &r : records) {
+        uint64_t seq_delta, ts_zigzag, word;
+        if (!read_varint(&q, qend, &seq_delta) || !read_varint(&q, qend, &ts_zigzag) ||
+            !read_varint(&q, qend, &word)) {
+            return false;
+        }
+        uint32_t seq = expected + (uint32_t)seq_delta;
+        ts += (uint64_t)((int64_t)(ts_zigzag >> 1) ^ -(int64_t)(ts_zigzag & 1));
+        size_t length = (size_t)(word >> 2);
+        if (seq != r.seq || ts != r.ts || length != r.data.size() ||
+            (size_t)(qend - q) < length || memcmp(q, r.data.data(), length) != 0) {
+            return false;
+        }
+        q += length;
+        expected = seq + 1;
+    }
+    return q == qend;
+}
+
+static void run(const char *name)
+{
+    size_t raw = 0;
+    for (const bench_record_t &r : records) {
+        raw += r.data.size();
+    }
+
+    struct {
+        const char *label;
+        size_t (*encode)(bool);
+        bool flag;
+    } variants[] = {
+        { "json string", encode_json, false },
+        { "json base64", encode_json, true },
+        { "binary", encode_binary, false },
+        { "binary lz4", encode_binary, true },
+    };
+
+    printf("%s: %zu records, %zu data bytes\n", name, records.size(), raw);
+    size_t json_size = 0;
+    for (auto &v : variants) {
+        size_t size = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            size = v.encode(v.flag);
+        }
+        double mbps = (double)raw * BENCH_ROUNDS / elapsed(start) / 1e6;
+        if (json_size == 0) {
+            json_size = size;
+        }
+        printf("  %-12s %8zu bytes  %5.2fx data  %5.2fx faster than json  %7.1f MB/s",
+               v.label, size, (double)size / raw, (double)json_size / size, mbps);
+        if (v.encode == encode_binary) {
+            printf("  %s", verify() ? "verified" : "MISMATCH");
+        }
+        printf("\n");
+    }
+}
+
+int main(void)
+{
+    make_nmea();
+    run("nmea text");
+    make_modbus();
+    run("modbus rtu");
+    make_random();
+    run("random");
+
+    // Распаковка: скорость для декодеров на стороне клиента
+    make_nmea();
+    std::vector<uint8_t> text;
+    for (const bench_record_t &r : records) {
+        text.insert(text.end(), r.data.begin(), r.data.end());
+    }
+    uint8_t packed[CAPTURE_LZ_BOUND(CAPTURE_FORMAT_BLOCK_SIZE)];
+    uint8_t unpacked[CAPTURE_FORMAT_BLOCK_SIZE];
+    size_t length = capture_lz_compress(text.data(), CAPTURE_FORMAT_BLOCK_SIZE, packed,
+                                        sizeof(packed), lz_state.hash);
+    auto start = std::chrono::steady_clock::now();
+    size_t out = 0;
+    for (int round = 0; round < BENCH_ROUNDS * 100; round++) {
+        out = capture_lz_decompress(packed, length, unpacked, sizeof(unpacked));
+    }
+    printf("lz4 decompress: %.1f MB/s (%zu -> %zu bytes)\n",
+           (double)out * BENCH_ROUNDS * 100 / elapsed(start) / 1e6, length, out);
+    return 0;
+}
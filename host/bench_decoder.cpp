@@ -0,0 +1,350 @@
+/**
+ * @file bench_decoder.cpp
+ * @brief Проверка и замер скорости декодеров протоколов под Linux
+ *
+ * Сначала прогоняет набор кадров Modbus RTU, NMEA 0183 и TLV: верные,
+ * с испорченной контрольной суммой, с мусором между кадрами, порциями
+ * любой длины (от одного байта). Значения полей и счетчики кадров/ошибок
+ * сравниваются с ожидаемыми; при расхождении программа завершается с
+ * кодом 1. Затем для каждого декодера замеряет скорость на потоке кадров,
+ * поданном порциями по BENCH_CHUNK байт: кадров/с и МБ/с.
+ *
+ * Сборка: цель bench_decoder (host/CMakeLists.txt)
+ */
+
+#include "decoder.h"
+#include "field_table.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+
+#define BENCH_STREAM_SIZE   (256 * 1024)
+#define BENCH_ROUNDS        20
+#define BENCH_CHUNK         120     // Порция приема (порог FIFO UART)
+#define BENCH_PORT          0
+
+static uint8_t stream[BENCH_STREAM_SIZE];
+static size_t stream_len;
+static int failures;
+static uint64_t fake_us = 1000000;
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * CRC-16/MODBUS побитно - независимо от табличной реализации декодера
+ */
+static uint16_t modbus_crc(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * Кадр Modbus с CRC в out
+ */
+static size_t modbus_frame(uint8_t *out, const uint8_t *body, size_t length)
+{
+    memcpy(out, body, length);
+    uint16_t crc = modbus_crc(body, length);
+    out[length] = (uint8_t)(crc & 0xFF);
+    out[length + 1] = (uint8_t)(crc >> 8);
+    return length + 2;
+}
+
+static size_t tlv_frame(uint8_t *out, uint8_t tag, const uint8_t *value, uint8_t length)
+{
+    out[0] = DECODER_TLV_SYNC;
+    out[1] = tag;
+    out[2] = length;
+    memcpy(out + 3, value, length);
+    uint8_t crc = 0;
+    for (size_t i = 1; i < 3u + length; i++) {
+        crc ^= out[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    out[3 + length] = crc;
+    return 4u + length;
+}
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("  FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static bool find_field(const char *key, field_t *field)
+{
+    for (size_t i = 0; i < FIELD_TABLE_SIZE; i++) {
+        if (field_table_get(i, field) && field->port == BENCH_PORT &&
+            strcmp(field->key, key) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void expect_int(const char *key, int64_t value)
+{
+    field_t field;
+    char what[80];
+    snprintf(what, sizeof(what), "%s == %lld", key, (long long)value);
+    check(find_field(key, &field) && field.type == FIELD_INT && field.value.i == value, what);
+}
+
+static void expect_float(const char *key, double value)
+{
+    field_t field;
+    char what[80];
+    snprintf(what, sizeof(what), "%s == %.6f", key, value);
+    check(find_field(key, &field) && field.type == FIELD_FLOAT &&
+          fabs(field.value.f - value) < 1e-6, what);
+}
+
+/**
+ * Подача данных порциями: chunk байт, 0 - псевдослучайные длины 1..64
+ */
+static void feed(const uint8_t *data, size_t length, size_t chunk)
+{
+    uint32_t rnd = 12345;
+    size_t pos = 0;
+    while (pos < length) {
+        size_t n = chunk;
+        if (n == 0) {
+            rnd = rnd * 1103515245u + 12345u;
+            n = 1 + (rnd >> 16) % 64;
+        }
+        if (n > length - pos) {
+            n = length - pos;
+        }
+        decoder_feed(BENCH_PORT, data + pos, n, fake_us);
+        fake_us += 10;          // Без пауз: сброс кадра по паузе не срабатывает
+        pos += n;
+    }
+}
+
+/**
+ * Прогон набора с ожидаемым числом кадров и ошибок при трех способах
+ * нарезки (целиком, по байту, случайными порциями)
+ */
+static void run_case(const char *name, const uint8_t *data, size_t length,
+                     uint32_t frames, uint32_t errors)
+{
+    static const size_t chunks[] = { BENCH_STREAM_SIZE, 1, 0 };
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        decoder_info_t before, after;
+        decoder_get_info(BENCH_PORT, &before);
+        feed(data, length, chunks[c]);
+        // Пауза сбрасывает хвост (Modbus) и отделяет прогоны друг от друга
+        fake_us += 1000000;
+        decoder_get_info(BENCH_PORT, &after);
+        uint32_t got_frames = after.frames - before.frames;
+        uint32_t got_errors = after.errors - before.errors;
+        if (got_frames != frames || got_errors != errors) {
+            printf("  FAIL: %s (chunk %zu): %u frames, %u errors; expected %u, %u\n", name,
+                   chunks[c], (unsigned)got_frames, (unsigned)got_errors, (unsigned)frames,
+                   (unsigned)errors);
+            failures++;
+        }
+    }
+}
+
+static void select_decoder(const char *name)
+{
+    decoder_set(BENCH_PORT, name);
+    // Сброс применяется писателем с очередной порцией
+    decoder_feed(BENCH_PORT, NULL, 0, fake_us);
+}
+
+static void test_modbus(void)
+{
+    printf("modbus:\n");
+    select_decoder("modbus");
+    uint8_t buf[512];
+    size_t n = 0;
+
+    // Известный кадр: чтение 10 holding registers с 0 у ведомого 1
+    static const uint8_t request[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A, 0xC5, 0xCD };
+    check(modbus_crc(request, 6) == 0xCDC5, "reference CRC of 01 03 00 00 00 0A");
+    memcpy(buf, request, sizeof(request));
+    n = sizeof(request);
+    uint8_t response[3 + 20] = { 0x01, 0x03, 20 };
+    for (int i = 0; i < 10; i++) {
+        response[3 + 2 * i] = (uint8_t)(i + 1);
+        response[4 + 2 * i] = (uint8_t)(0x10 * i);
+    }
+    n += modbus_frame(buf + n, response, sizeof(response));
+    run_case("read holding registers", buf, n, 2, 0);
+    expect_int("mb1.hr0", 0x0100);
+    expect_int("mb1.hr9", 0x0A90);
+
+    // Запись одного регистра, исключение, запись нескольких регистров
+    static const uint8_t write_single[] = { 0x11, 0x06, 0x00, 0x01, 0x00, 0x03 };
+    static const uint8_t exception[] = { 0x01, 0x83, 0x02 };
+    static const uint8_t write_multi[] = { 0x11, 0x10, 0x00, 0x20, 0x00, 0x02, 0x04,
+                                           0x12, 0x34, 0xAB, 0xCD };
+    static const uint8_t write_multi_ack[] = { 0x11, 0x10, 0x00, 0x20, 0x00, 0x02 };
+    n = modbus_frame(buf, write_single, sizeof(write_single));
+    n += modbus_frame(buf + n, exception, sizeof(exception));
+    n += modbus_frame(buf + n, write_multi, sizeof(write_multi));
+    n += modbus_frame(buf + n, write_multi_ack, sizeof(write_multi_ack));
+    run_case("write and exception", buf, n, 4, 0);
+    expect_int("mb17.hr1", 3);
+    expect_int("mb1.exc", 2);
+    expect_int("mb17.hr32", 0x1234);
+    expect_int("mb17.hr33", 0xABCD);
+
+    // Мусор перед кадром и испорченная CRC: одна ошибка на эпизод, кадр после - найден
+    static const uint8_t garbage[] = { 0xFF, 0x00, 0x55 };
+    n = 0;
+    memcpy(buf, garbage, sizeof(garbage));
+    n = sizeof(garbage);
+    n += modbus_frame(buf + n, write_single, sizeof(write_single));
+    size_t bad = n;
+    n += modbus_frame(buf + n, write_single, sizeof(write_single));
+    buf[bad + 4] ^= 0x40;
+    n += modbus_frame(buf + n, exception, sizeof(exception));
+    run_case("garbage and bad CRC", buf, n, 2, 2);
+}
+
+static void test_nmea(void)
+{
+    printf("nmea:\n");
+    select_decoder("nmea");
+    static const char good[] =
+        "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n"
+        "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n"
+        "$GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74\r\n";
+    run_case("GGA, RMC, GSV", (const uint8_t *)good, strlen(good), 3, 0);
+    expect_int("gga.time", 123519);
+    expect_float("gga.lat", 48.0 + 7.038 / 60);
+    expect_float("gga.lon", 11.0 + 31.0 / 60);
+    expect_int("gga.fix", 1);
+    expect_int("gga.sats", 8);
+    expect_float("gga.hdop", 0.9);
+    expect_float("gga.alt", 545.4);
+    expect_int("rmc.valid", 1);
+    expect_float("rmc.speed_kn", 22.4);
+    expect_float("rmc.course", 84.4);
+    expect_int("rmc.date", 230394);
+
+    static const char bad[] =
+        "noise\r\n"
+        "$GPGGA,123520,4807.038,S,01131.000,W,1,08,0.9,545.4,M,46.9,M,,*48\r\n"  // неверная сумма
+        "$GPGGA,123520,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,\r\n"     // без суммы
+        "$GPGGA,123519,48$GPGGA,123519,4807.038,S,01131.000,W,1,08,0.9,545.4,M,46.9,M,,*47\r\n";
+    run_case("bad checksum, truncated", (const uint8_t *)bad, strlen(bad), 0, 4);
+    expect_int("gga.time", 123519);
+}
+
+static void test_tlv(void)
+{
+    printf("tlv:\n");
+    select_decoder("tlv");
+    uint8_t buf[256];
+    size_t n = 0;
+    static const uint8_t v2[] = { 0x34, 0x12 };
+    static const uint8_t v4[] = { 0x78, DECODER_TLV_SYNC, 0x34, 0x12 };
+    static const uint8_t v3[] = { 1, 2, 3 };
+    n += tlv_frame(buf + n, 1, v2, sizeof(v2));
+    n += tlv_frame(buf + n, 2, v4, sizeof(v4));
+    n += tlv_frame(buf + n, 3, v3, sizeof(v3));
+    run_case("frames", buf, n, 3, 0);
+    expect_int("tlv.1", 0x1234);
+    expect_int("tlv.2", 0x12347E78);
+
+    // Мусор, испорченная CRC, затем верный кадр
+    n = 0;
+    buf[n++] = 0x00;
+    buf[n++] = 0x42;
+    size_t bad = n;
+    n += tlv_frame(buf + n, 5, v2, sizeof(v2));
+    buf[bad + 3] ^= 0x01;
+    n += tlv_frame(buf + n, 6, v2, sizeof(v2));
+    run_case("garbage and bad CRC", buf, n, 1, 2);
+    expect_int("tlv.6", 0x1234);
+    field_t field;
+    check(!find_field("tlv.5", &field), "tlv.5 rejected");
+}
+
+/**
+ * Поток кадров для замера: повторение образца до BENCH_STREAM_SIZE
+ */
+static size_t fill_stream(const uint8_t *pattern, size_t length)
+{
+    size_t count = 0;
+    stream_len = 0;
+    while (stream_len + length <= BENCH_STREAM_SIZE) {
+        memcpy(stream + stream_len, pattern, length);
+        stream_len += length;
+        count++;
+    }
+    return count;
+}
+
+static void bench(const char *name, const uint8_t *pattern, size_t length, size_t frames_per)
+{
+    select_decoder(name);
+    size_t expected = fill_stream(pattern, length) * frames_per * BENCH_ROUNDS;
+    decoder_info_t before, after;
+    decoder_get_info(BENCH_PORT, &before);
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        feed(stream, stream_len, BENCH_CHUNK);
+    }
+    double t = elapsed(start);
+    decoder_get_info(BENCH_PORT, &after);
+    uint32_t frames = after.frames - before.frames;
+    printf("  %-8s %10.0f frames/s %8.1f MB/s  (%u frames, expected %zu)\n", name,
+           frames / t, (double)stream_len * BENCH_ROUNDS / t / 1e6, (unsigned)frames, expected);
+    if (frames != expected) {
+        failures++;
+    }
+}
+
+int main(void)
+{
+    decoder_init();
+    test_modbus();
+    test_nmea();
+    test_tlv();
+    printf("corpus: %s (%d failures)\n", failures == 0 ? "ok" : "FAILED", failures);
+    if (failures != 0) {
+        return 1;
+    }
+
+    printf("throughput (%d byte chunks):\n", BENCH_CHUNK);
+    uint8_t pattern[128];
+    size_t n = 0;
+    static const uint8_t request[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A };
+    uint8_t response[3 + 20] = { 0x01, 0x03, 20 };
+    n += modbus_frame(pattern + n, request, sizeof(request));
+    n += modbus_frame(pattern + n, response, sizeof(response));
+    bench("modbus", pattern, n, 2);
+
+    static const char gga[] =
+        "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n";
+    bench("nmea", (const uint8_t *)gga, strlen(gga), 1);
+
+    static const uint8_t v4[] = { 1, 2, 3, 4 };
+    n = tlv_frame(pattern, 1, v4, sizeof(v4));
+    n += tlv_frame(pattern + n, 2, v4, 2);
+    bench("tlv", pattern, n, 2);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+/**
+ * @file bench_framer.cpp
+ * @brief Замер скорости выделения кадров под Linux
+ *
+ * Сравнивает поиск разделителя побайтным циклом, memchr и поиском по
+ * машинному слову (framer_find_byte), затем прогоняет фреймер во всех
+ * режимах по порциям, как их отдает драйвер UART. Для каждого режима
+ * выводит скорость в МБ/с и число кадров (должно совпадать с ожидаемым).
+ *
+ * Сборка: цель bench_framer (host/CMakeLists.txt) или
+ *   g++ -O2 -std=gnu++17 -Iinclude -Ihost/include host/bench_framer.cpp src/framer.cpp -o bench_framer
+ */
+
+#include "framer.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+
+#define BENCH_PAYLOAD_SIZE  (256 * 1024)
+#define BENCH_ROUNDS        50
+#define BENCH_CHUNK         120     // Порция приема (порог FIFO UART)
+#define BENCH_FRAME_LEN     60      // Длина кадра в тестовых потоках
+
+static uint8_t payload[BENCH_PAYLOAD_SIZE];
+static uint8_t encoded[BENCH_PAYLOAD_SIZE * 2];
+static size_t encoded_len;
+static volatile size_t sink;
+static framer_t framer;
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static size_t naive_find(const uint8_t *data, size_t length, uint8_t a)
+{
+    size_t i = 0;
+    while (i < length && data[i] != a) {
+        i++;
+    }
+    return i;
+}
+
+static size_t memchr_find(const uint8_t *data, size_t length, uint8_t a)
+{
+    const void *p = memchr(data, a, length);
+    return p != NULL ? (size_t)((const uint8_t *)p - data) : length;
+}
+
+/**
+ * Подсчет разделителей в encoded функцией поиска
+ */
+static void run_search(const char *name, size_t (*find)(const uint8_t *, size_t, uint8_t))
+{
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        found = 0;
+        size_t i = 0;
+        while (i < encoded_len) {
+            i += find(encoded + i, encoded_len - i, '\n') + 1;
+            found++;
+        }
+    }
+    double mbps = (double)encoded_len * BENCH_ROUNDS / elapsed(start) / 1e6;
+    sink = found;
+    printf("  %-16s %8.1f MB/s  (%zu delimiters)\n", name, mbps, found);
+}
+
+static void count_frame(void *ctx, const uint8_t *frame, size_t length, uint32_t flags,
+                        uint64_t timestamp_us, uint32_t end_seq)
+{
+    size_t *frames = (size_t *)ctx;
+    if (!(flags & FRAMER_FLAG_PARTIAL)) {
+        frames[0]++;
+    }
+    if (flags & FRAMER_FLAG_ERROR) {
+        frames[1]++;
+    }
+    sink = length ? frame[length - 1] : 0;
+}
+
+static void run_framer(const char *name, const framer_config_t *config, size_t expected)
+{
+    size_t frames[2] = { 0, 0 };
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        frames[0] = frames[1] = 0;
+        framer_init(&framer, config, count_frame, frames, 0);
+        for (size_t off = 0; off < encoded_len; off += BENCH_CHUNK) {
+            size_t n = encoded_len - off < BENCH_CHUNK ? encoded_len - off : BENCH_CHUNK;
+            framer_feed(&framer, encoded + off, n, off);
+        }
+        framer_idle(&framer);
+    }
+    double mbps = (double)encoded_len * BENCH_ROUNDS / elapsed(start) / 1e6;
+    printf("  %-16s %8.1f MB/s  (%zu frames, expected %zu, errors %zu)\n",
+           name, mbps, frames[0], expected, frames[1]);
+}
+
+static void fill_payload(bool text)
+{
+    uint32_t x = 12345;
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        x = x * 1103515245u + 12345u;
+        payload[i] = text ? (uint8_t)(' ' + (x >> 16) % 95) : (uint8_t)(x >> 16);
+    }
+}
+
+/**
+ * Кадры по BENCH_FRAME_LEN байт payload, закодированные функцией encode
+ */
+static size_t encode_frames(size_t (*encode)(const uint8_t *, size_t, uint8_t *))
+{
+    size_t frames = 0;
+    encoded_len = 0;
+    for (size_t off = 0; off + BENCH_FRAME_LEN <= sizeof(payload); off += BENCH_FRAME_LEN) {
+        encoded_len += encode(payload + off, BENCH_FRAME_LEN, encoded + encoded_len);
+        frames++;
+    }
+    return frames;
+}
+
+static size_t encode_line(const uint8_t *data, size_t length, uint8_t *out)
+{
+    memcpy(out, data, length);
+    out[length] = '\r';
+    out[length + 1] = '\n';
+    return length + 2;
+}
+
+static size_t encode_length(const uint8_t *data, size_t length, uint8_t *out)
+{
+    out[0] = (uint8_t)length;
+    memcpy(out + 1, data, length);
+    return length + 1;
+}
+
+static size_t encode_slip(const uint8_t *data, size_t length, uint8_t *out)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] == 0xC0) {
+            out[n++] = 0xDB;
+            out[n++] = 0xDC;
+        } else if (data[i] == 0xDB) {
+            out[n++] = 0xDB;
+            out[n++] = 0xDD;
+        } else {
+            out[n++] = data[i];
+        }
+    }
+    out[n++] = 0xC0;
+    return n;
+}
+
+static size_t encode_cobs(const uint8_t *data, size_t length, uint8_t *out)
+{
+    size_t code_pos = 0;
+    size_t n = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] == 0) {
+            out[code_pos] = code;
+            code_pos = n++;
+            code = 1;
+        } else {
+            out[n++] = data[i];
+            if (++code == 0xFF) {
+                out[code_pos] = code;
+                code_pos = n++;
+                code = 1;
+            }
+        }
+    }
+    out[code_pos] = code;
+    out[n++] = 0;
+    return n;
+}
+
+int main(void)
+{
+    framer_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.len_size = 1;
+
+    // Поиск разделителя: строки по BENCH_FRAME_LEN байт
+    fill_payload(true);
+    size_t lines = encode_frames(encode_line);
+    printf("delimiter search:\n");
+    run_search("byte loop", naive_find);
+    run_search("memchr", memchr_find);
+    run_search("word (SWAR)", framer_find_byte);
+
+    printf("framer (%d byte chunks):\n", BENCH_CHUNK);
+    config.mode = FRAMER_LINE;
+    config.eol = FRAMER_EOL_ANY;
+    run_framer("line crlf/any", &config, lines);
+    config.eol = FRAMER_EOL_LF;
+    run_framer("line lf", &config, lines);
+
+    config.mode = FRAMER_NONE;
+    run_framer("none", &config, (encoded_len + BENCH_CHUNK - 1) / BENCH_CHUNK);
+
+    fill_payload(false);
+    config.mode = FRAMER_FIXED;
+    config.fixed_length = BENCH_FRAME_LEN;
+    encoded_len = sizeof(payload) / BENCH_FRAME_LEN * BENCH_FRAME_LEN;
+    memcpy(encoded, payload, encoded_len);
+    run_framer("fixed", &config, encoded_len / BENCH_FRAME_LEN);
+
+    size_t frames = encode_frames(encode_length);
+    config.mode = FRAMER_LENGTH;
+    config.len_offset = 0;
+    config.len_size = 1;
+    run_framer("length", &config, frames);
+
+    frames = encode_frames(encode_slip);
+    config.mode = FRAMER_SLIP;
+    run_framer("slip", &config, frames);
+
+    frames = encode_frames(encode_cobs);
+    config.mode = FRAMER_COBS;
+    run_framer("cobs", &config, frames);
+
+    // Без пауз весь поток - один кадр, выводимый частями
+    config.mode = FRAMER_IDLE;
+    run_framer("idle", &config, 1);
+
+    return 0;
+}
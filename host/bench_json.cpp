@@ -0,0 +1,136 @@
+/**
+ * @file bench_json.cpp
+ * @brief Замер скорости кодирования данных в JSON под Linux
+ *
+ * Сравнивает прежний побайтный цикл экранирования из api_data_get_handler
+ * (с отбрасыванием непечатных байт) с json_writer: строка с \u00XX
+ * и base64. Выводит скорость в МБ/с для текстовых и двоичных данных.
+ *
+ * Сборка: цель bench_json (host/CMakeLists.txt) или
+ *   g++ -O2 -std=gnu++17 -Iinclude host/bench_json.cpp src/json_writer.cpp -o bench_json
+ */
+
+#include "json_writer.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+
+#define BENCH_PAYLOAD_SIZE  (64 * 1024)
+#define BENCH_ROUNDS        200
+
+static uint8_t payload[BENCH_PAYLOAD_SIZE];
+static volatile size_t sink;
+
+/**
+ * Прежний цикл: не более 200 байт за ответ, поэтому вход режется на куски
+ */
+static size_t legacy_escape(const uint8_t *data, size_t length)
+{
+    char escaped_data[401];
+    size_t total = 0;
+
+    for (size_t off = 0; off < length; off += 200) {
+        size_t data_len = length - off < 200 ? length - off : 200;
+        const uint8_t *safe_data = data + off;
+        int j = 0;
+        for (size_t i = 0; i < data_len && j < 400; i++) {
+            if (safe_data[i] == '"') {
+                escaped_data[j++] = '\\';
+                escaped_data[j++] = '"';
+            } else if (safe_data[i] == '\\') {
+                escaped_data[j++] = '\\';
+                escaped_data[j++] = '\\';
+            } else if (safe_data[i] == '\n') {
+                escaped_data[j++] = '\\';
+                escaped_data[j++] = 'n';
+            } else if (safe_data[i] == '\r') {
+                escaped_data[j++] = '\\';
+                escaped_data[j++] = 'r';
+            } else if (safe_data[i] >= 32 && safe_data[i] <= 126) {
+                escaped_data[j++] = safe_data[i];
+            }
+        }
+        escaped_data[j] = '\0';
+        total += j;
+        sink = escaped_data[j / 2];
+    }
+    return total;
+}
+
+static bool count_flush(void *ctx, const char *data, size_t length)
+{
+    *(size_t *)ctx += length;
+    return true;
+}
+
+static size_t writer_string(const uint8_t *data, size_t length)
+{
+    size_t total = 0;
+    json_writer_t w;
+    char buf[JSON_WRITER_CHUNK_SIZE];
+    json_writer_init(&w, buf, sizeof(buf), count_flush, &total);
+    json_string_bytes(&w, data, length);
+    json_writer_finish(&w);
+    return total;
+}
+
+static size_t writer_base64(const uint8_t *data, size_t length)
+{
+    size_t total = 0;
+    json_writer_t w;
+    char buf[JSON_WRITER_CHUNK_SIZE];
+    json_writer_init(&w, buf, sizeof(buf), count_flush, &total);
+    json_base64_begin(&w);
+    json_base64_append(&w, data, length);
+    json_base64_end(&w);
+    json_writer_finish(&w);
+    return total;
+}
+
+static void run(const char *name, size_t (*fn)(const uint8_t *, size_t))
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t out = 0;
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        out = fn(payload, sizeof(payload));
+        sink = out;
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double mbps = (double)sizeof(payload) * BENCH_ROUNDS / sec / 1e6;
+    printf("  %-16s %8.1f MB/s  (out %zu bytes per %d in)\n", name, mbps, out, BENCH_PAYLOAD_SIZE);
+}
+
+static void run_all(const char *title)
+{
+    printf("%s:\n", title);
+    run("legacy loop", legacy_escape);
+    run("json string", writer_string);
+    run("json base64", writer_base64);
+}
+
+int main(void)
+{
+    // Текстовый протокол: печатные строки с CR LF и редкими кавычками
+    uint32_t x = 12345;
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        x = x * 1103515245u + 12345u;
+        payload[i] = (uint8_t)(' ' + (x >> 16) % 95);
+        if (i % 64 == 62) {
+            payload[i] = '\r';
+        } else if (i % 64 == 63) {
+            payload[i] = '\n';
+        }
+    }
+    run_all("text");
+
+    // Двоичный протокол: равномерно распределенные байты
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        x = x * 1103515245u + 12345u;
+        payload[i] = (uint8_t)(x >> 16);
+    }
+    run_all("binary");
+
+    return 0;
+}
@@ -0,0 +1,1323 @@
+/**
+ * @file esp_http_server_host.cpp
+ * @brief HTTP/WebSocket сервер с API esp_http_server поверх сокетов POSIX
+ *
+ * Устроен как сервер ESP-IDF: один поток обслуживает прослушивающий
+ * сокет, все сессии и очередь работ (httpd_queue_work), пробуждаясь через
+ * select(). Поддерживаются постоянные соединения HTTP/1.1, ответы с
+ * Content-Length и chunked, рукопожатие и кадры WebSocket (RFC 6455).
+ * Ограничения прошивки сохраняются: max_open_sockets сессий с вытеснением
+ * давно неактивной (lru_purge_enable), max_uri_handlers обработчиков.
+ * Асинхронные обработчики (httpd_req_async_handler_begin) отвечают из
+ * других потоков; сессия не читается сервером до их завершения.
+ */
+
+#include "esp_http_server.h"
+#include "esp_log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char *TAG = "httpd";
+
+#define SESSION_BUF_SIZE    (HTTPD_MAX_REQ_HDR_LEN + HTTPD_MAX_URI_LEN)
+#define WS_GUID             "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WS_MAX_CONTROL_LEN  125
+
+/**
+ * Сессия (соединение клиента)
+ */
+struct host_session {
+    int fd;                         // -1 - слот свободен
+    bool websocket;                 // Рукопожатие WebSocket выполнено
+    bool async;                     // Запрос передан асинхронному обработчику
+    uint64_t last_used;             // Для вытеснения по LRU
+    const httpd_uri_t *ws_uri;      // Обработчик WebSocket сессии
+    void *ctx;                      // sess_ctx обработчиков
+    httpd_free_ctx_fn_t free_ctx;
+
+    // Принятые, но еще не разобранные байты (заголовки, начало тела)
+    char buf[SESSION_BUF_SIZE];
+    size_t buf_len;
+
+    // Текущий входящий кадр WebSocket
+    httpd_ws_type_t ws_type;
+    bool ws_final;
+    bool ws_masked;
+    uint8_t ws_mask[4];
+    size_t ws_len;
+    size_t ws_read;
+};
+
+struct resp_hdr {
+    const char *field;
+    const char *value;
+};
+
+/**
+ * Состояние обрабатываемого запроса (httpd_req_t::aux)
+ */
+struct host_request {
+    struct host_server *server;
+    host_session *sess;
+    const char *head;               // Копия строк заголовков запроса
+    size_t body_left;
+    const char *status;
+    const char *type;
+    std::vector<resp_hdr> hdrs;
+    bool headers_sent;
+    bool keep_alive;
+};
+
+/**
+ * Копия запроса для асинхронного обработчика
+ */
+struct host_async_req {
+    httpd_req_t req;
+    host_request hr;
+    std::string head;
+    int fd;
+};
+
+struct host_work {
+    httpd_work_fn_t fn;
+    void *arg;
+};
+
+struct host_server {
+    httpd_config_t config;
+    int listen_fd;
+    int wake_fd[2];
+    bool stopping;
+    std::thread thread;
+    std::vector<httpd_uri_t> handlers;
+    std::vector<host_session> sessions;
+    std::mutex sessions_lock;       // fd/websocket сессий (читаются из других потоков)
+    std::mutex work_lock;
+    std::deque<host_work> work;
+    uint64_t use_counter;
+};
+
+/**
+ * Асинхронная отправка кадра (выполняется в потоке сервера)
+ */
+struct ws_async {
+    host_server *server;
+    int fd;
+    httpd_ws_frame_t frame;
+    transfer_complete_cb callback;
+    void *arg;
+};
+
+struct close_request {
+    host_server *server;
+    int fd;
+};
+
+// ---------------------------------------------------------------------------
+// SHA-1 и base64 для Sec-WebSocket-Accept
+
+static inline uint32_t rol32(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static void sha1(const uint8_t *data, size_t length, uint8_t digest[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+    uint64_t bits = (uint64_t)length * 8;
+    size_t total = ((length + 8) / 64 + 1) * 64;
+
+    for (size_t block = 0; block < total; block += 64) {
+        uint8_t chunk[64];
+        for (size_t i = 0; i < 64; i++) {
+            size_t pos = block + i;
+            if (pos < length) {
+                chunk[i] = data[pos];
+            } else if (pos == length) {
+                chunk[i] = 0x80;
+            } else if (pos >= total - 8) {
+                chunk[i] = (uint8_t)(bits >> (8 * (total - 1 - pos)));
+            } else {
+                chunk[i] = 0;
+            }
+        }
+
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            w[i] = ((uint32_t)chunk[4 * i] << 24) | ((uint32_t)chunk[4 * i + 1] << 16) |
+                   ((uint32_t)chunk[4 * i + 2] << 8) | chunk[4 * i + 3];
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5a827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+            uint32_t t = rol32(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol32(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        digest[4 * i] = (uint8_t)(h[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(h[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(h[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)h[i];
+    }
+}
+
+static void base64_encode(const uint8_t *data, size_t length, char *out)
+{
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t j = 0;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < length) {
+            v |= (uint32_t)data[i + 1] << 8;
+        }
+        if (i + 2 < length) {
+            v |= data[i + 2];
+        }
+        out[j++] = alphabet[(v >> 18) & 0x3f];
+        out[j++] = alphabet[(v >> 12) & 0x3f];
+        out[j++] = i + 1 < length ? alphabet[(v >> 6) & 0x3f] : '=';
+        out[j++] = i + 2 < length ? alphabet[v & 0x3f] : '=';
+    }
+    out[j] = '\0';
+}
+
+// ---------------------------------------------------------------------------
+// Ввод-вывод сессии
+
+/**
+ * Отправка всех буферов (блокирующая, с таймаутом send_wait_timeout)
+ */
+static bool send_all(int fd, struct iovec *iov, int count)
+{
+    while (count > 0) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return true;
+}
+
+static bool send_buf(int fd, const void *data, size_t length)
+{
+    struct iovec iov = { (void *)data, length };
+    return send_all(fd, &iov, 1);
+}
+
+/**
+ * Чтение ровно length байт: сначала из буфера сессии, затем из сокета
+ */
+static bool read_exact(host_session *sess, void *dst, size_t length)
+{
+    uint8_t *out = (uint8_t *)dst;
+    size_t n = length < sess->buf_len ? length : sess->buf_len;
+    if (n > 0) {
+        memcpy(out, sess->buf, n);
+        memmove(sess->buf, sess->buf + n, sess->buf_len - n);
+        sess->buf_len -= n;
+    }
+    while (n < length) {
+        ssize_t r = recv(sess->fd, out + n, length - n, 0);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return false;
+        }
+        n += r;
+    }
+    return true;
+}
+
+static const char *find_header_end(const char *buf, size_t length)
+{
+    for (size_t i = 3; i < length; i++) {
+        if (buf[i] == '\n' && buf[i - 1] == '\r' && buf[i - 2] == '\n' && buf[i - 3] == '\r') {
+            return buf + i + 1;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Поиск значения заголовка в копии заголовков запроса
+ */
+static const char *find_header(const char *head, const char *field, size_t *value_len)
+{
+    size_t field_len = strlen(field);
+    const char *line = strstr(head, "\r\n");
+    while (line != NULL) {
+        line += 2;
+        const char *end = strstr(line, "\r\n");
+        if (end == NULL || end == line) {
+            break;
+        }
+        if ((size_t)(end - line) > field_len && line[field_len] == ':' &&
+            strncasecmp(line, field, field_len) == 0) {
+            const char *value = line + field_len + 1;
+            while (value < end && (*value == ' ' || *value == '\t')) {
+                value++;
+            }
+            const char *value_end = end;
+            while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+                value_end--;
+            }
+            *value_len = value_end - value;
+            return value;
+        }
+        line = end;
+    }
+    return NULL;
+}
+
+static host_request *request_of(httpd_req_t *r)
+{
+    return (host_request *)r->aux;
+}
+
+// ---------------------------------------------------------------------------
+// Сессии
+
+static void session_close(host_server *server, host_session *sess)
+{
+    if (sess->fd < 0) {
+        return;
+    }
+    if (sess->free_ctx != NULL && sess->ctx != NULL) {
+        sess->free_ctx(sess->ctx);
+    }
+    int fd = sess->fd;
+    {
+        std::lock_guard<std::mutex> guard(server->sessions_lock);
+        sess->fd = -1;
+        sess->websocket = false;
+    }
+    sess->async = false;
+    if (server->config.close_fn != NULL) {
+        server->config.close_fn(server, fd);
+    } else {
+        close(fd);
+    }
+}
+
+static host_session *session_by_fd(host_server *server, int fd)
+{
+    for (auto &sess : server->sessions) {
+        if (sess.fd == fd) {
+            return &sess;
+        }
+    }
+    return NULL;
+}
+
+static void session_accept(host_server *server)
+{
+    int fd = accept(server->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+
+    host_session *slot = NULL;
+    host_session *lru = NULL;
+    for (auto &sess : server->sessions) {
+        if (sess.fd < 0) {
+            slot = &sess;
+            break;
+        }
+        if (!sess.async && (lru == NULL || sess.last_used < lru->last_used)) {
+            lru = &sess;
+        }
+    }
+    if (slot == NULL && server->config.lru_purge_enable && lru != NULL) {
+        ESP_LOGW(TAG, "Session limit reached, closing LRU fd=%d", lru->fd);
+        session_close(server, lru);
+        slot = lru;
+    }
+    if (slot == NULL) {
+        ESP_LOGW(TAG, "Session limit reached, rejecting fd=%d", fd);
+        close(fd);
+        return;
+    }
+
+    struct timeval rcv = { server->config.recv_wait_timeout, 0 };
+    struct timeval snd = { server->config.send_wait_timeout, 0 };
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &rcv, sizeof(rcv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &snd, sizeof(snd));
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    if (server->config.open_fn != NULL && server->config.open_fn(server, fd) != ESP_OK) {
+        close(fd);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(server->sessions_lock);
+        slot->fd = fd;
+        slot->websocket = false;
+    }
+    slot->last_used = ++server->use_counter;
+    slot->ws_uri = NULL;
+    slot->ctx = NULL;
+    slot->free_ctx = NULL;
+    slot->buf_len = 0;
+}
+
+static void request_init(httpd_req_t *r, host_request *hr, host_server *server,
+                         host_session *sess, const char *head)
+{
+    memset(r, 0, sizeof(*r));
+    r->handle = server;
+    r->aux = hr;
+    r->sess_ctx = sess->ctx;
+    r->free_ctx = sess->free_ctx;
+
+    hr->server = server;
+    hr->sess = sess;
+    hr->head = head;
+    hr->body_left = 0;
+    hr->status = HTTPD_200;
+    hr->type = HTTPD_TYPE_TEXT;
+    hr->headers_sent = false;
+    hr->keep_alive = true;
+}
+
+static void request_done(httpd_req_t *r, host_session *sess)
+{
+    // Контекст сессии переживает запрос (как sess_ctx в ESP-IDF)
+    if (sess->ctx != r->sess_ctx && sess->ctx != NULL && sess->free_ctx != NULL) {
+        sess->free_ctx(sess->ctx);
+    }
+    sess->ctx = r->sess_ctx;
+    sess->free_ctx = r->free_ctx;
+}
+
+static bool uri_matches(host_server *server, const httpd_uri_t *h, const char *uri, size_t path_len)
+{
+    if (server->config.uri_match_fn != NULL) {
+        return server->config.uri_match_fn(h->uri, uri, path_len);
+    }
+    return strlen(h->uri) == path_len && strncmp(h->uri, uri, path_len) == 0;
+}
+
+static bool websocket_handshake(host_session *sess, const char *head)
+{
+    size_t key_len = 0;
+    const char *key = find_header(head, "Sec-WebSocket-Key", &key_len);
+    if (key == NULL || key_len == 0 || key_len > 64) {
+        return false;
+    }
+
+    char accept_src[128];
+    memcpy(accept_src, key, key_len);
+    memcpy(accept_src + key_len, WS_GUID, sizeof(WS_GUID) - 1);
+    uint8_t digest[20];
+    sha1((const uint8_t *)accept_src, key_len + sizeof(WS_GUID) - 1, digest);
+    char accept[32];
+    base64_encode(digest, sizeof(digest), accept);
+
+    char resp[192];
+    int n = snprintf(resp, sizeof(resp),
+                     "HTTP/1.1 101 Switching Protocols\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Accept: %s\r\n\r\n", accept);
+    return send_buf(sess->fd, resp, n);
+}
+
+/**
+ * Разбор и обработка одного HTTP запроса; false - закрыть сессию
+ */
+static bool process_http(host_server *server, host_session *sess)
+{
+    const char *end;
+    while ((end = find_header_end(sess->buf, sess->buf_len)) == NULL) {
+        if (sess->buf_len == sizeof(sess->buf)) {
+            const char *resp = "HTTP/1.1 431 Request Header Fields Too Large\r\n"
+                               "Content-Length: 0\r\nConnection: close\r\n\r\n";
+            send_buf(sess->fd, resp, strlen(resp));
+            return false;
+        }
+        ssize_t n = recv(sess->fd, sess->buf + sess->buf_len, sizeof(sess->buf) - sess->buf_len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sess->buf_len += n;
+    }
+
+    // Заголовки копируются: буфер сессии дальше используется для тела
+    char head[SESSION_BUF_SIZE + 1];
+    size_t head_len = end - sess->buf;
+    memcpy(head, sess->buf, head_len);
+    head[head_len] = '\0';
+    memmove(sess->buf, end, sess->buf_len - head_len);
+    sess->buf_len -= head_len;
+    sess->last_used = ++server->use_counter;
+
+    char method_str[16];
+    char version[16];
+    int uri_pos = 0;
+    int uri_end = 0;
+    if (sscanf(head, "%15s %n%*s%n %15s", method_str, &uri_pos, &uri_end, version) != 2 ||
+        uri_end <= uri_pos) {
+        return false;
+    }
+
+    httpd_req_t r;
+    host_request hr;
+    request_init(&r, &hr, server, sess, head);
+
+    static const struct { const char *name; httpd_method_t method; } methods[] = {
+        { "GET", HTTP_GET }, { "POST", HTTP_POST }, { "PUT", HTTP_PUT },
+        { "DELETE", HTTP_DELETE }, { "HEAD", HTTP_HEAD }, { "OPTIONS", HTTP_OPTIONS },
+    };
+    r.method = -1;
+    for (auto &m : methods) {
+        if (strcmp(method_str, m.name) == 0) {
+            r.method = m.method;
+        }
+    }
+
+    size_t uri_len = uri_end - uri_pos;
+    if (uri_len > HTTPD_MAX_URI_LEN) {
+        httpd_resp_send_err(&r, HTTPD_414_URI_TOO_LONG, NULL);
+        return false;
+    }
+    memcpy(r.uri, head + uri_pos, uri_len);
+    r.uri[uri_len] = '\0';
+
+    size_t value_len = 0;
+    const char *value = find_header(head, "Content-Length", &value_len);
+    if (value != NULL) {
+        r.content_len = strtoul(value, NULL, 10);
+        hr.body_left = r.content_len;
+    }
+    value = find_header(head, "Connection", &value_len);
+    if (strcmp(version, "HTTP/1.0") == 0) {
+        hr.keep_alive = value != NULL && strncasecmp(value, "keep-alive", value_len) == 0;
+    } else {
+        hr.keep_alive = value == NULL || strncasecmp(value, "close", value_len) != 0;
+    }
+
+    const char *query = strchr(r.uri, '?');
+    size_t path_len = query != NULL ? (size_t)(query - r.uri) : uri_len;
+    const httpd_uri_t *handler = NULL;
+    bool path_found = false;
+    for (auto &h : server->handlers) {
+        if (uri_matches(server, &h, r.uri, path_len)) {
+            path_found = true;
+            if ((int)h.method == r.method) {
+                handler = &h;
+                break;
+            }
+        }
+    }
+    if (handler == NULL) {
+        if (path_found) {
+            httpd_resp_send_err(&r, HTTPD_405_METHOD_NOT_ALLOWED, NULL);
+        } else {
+            httpd_resp_send_err(&r, HTTPD_404_NOT_FOUND, NULL);
+        }
+        return hr.keep_alive && hr.body_left == 0;
+    }
+    r.user_ctx = handler->user_ctx;
+
+    if (handler->is_websocket) {
+        value = find_header(head, "Upgrade", &value_len);
+        if (value == NULL || strncasecmp(value, "websocket", value_len) != 0) {
+            httpd_resp_send_err(&r, HTTPD_400_BAD_REQUEST, NULL);
+            return false;
+        }
+        if (!websocket_handshake(sess, head)) {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> guard(server->sessions_lock);
+            sess->websocket = true;
+        }
+        sess->ws_uri = handler;
+        esp_err_t ret = handler->handler(&r);
+        request_done(&r, sess);
+        return ret == ESP_OK;
+    }
+
+    esp_err_t ret = handler->handler(&r);
+    request_done(&r, sess);
+    if (sess->async && ret == ESP_OK) {
+        // Ответит асинхронный обработчик; тело запроса остается ему
+        return true;
+    }
+
+    // Непрочитанное тело запроса отбрасывается
+    while (hr.body_left > 0) {
+        char discard[256];
+        int n = httpd_req_recv(&r, discard, sizeof(discard));
+        if (n <= 0) {
+            return false;
+        }
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGD(TAG, "Handler %s failed, closing fd=%d", handler->uri, sess->fd);
+        return false;
+    }
+    return hr.keep_alive;
+}
+
+/**
+ * Прием одного кадра WebSocket; false - закрыть сессию
+ */
+static bool process_ws(host_server *server, host_session *sess)
+{
+    uint8_t hdr[2];
+    if (!read_exact(sess, hdr, sizeof(hdr))) {
+        return false;
+    }
+    sess->last_used = ++server->use_counter;
+    sess->ws_final = (hdr[0] & 0x80) != 0;
+    sess->ws_type = (httpd_ws_type_t)(hdr[0] & 0x0f);
+    sess->ws_masked = (hdr[1] & 0x80) != 0;
+    uint64_t len = hdr[1] & 0x7f;
+    if (len == 126) {
+        uint8_t ext[2];
+        if (!read_exact(sess, ext, sizeof(ext))) {
+            return false;
+        }
+        len = ((uint64_t)ext[0] << 8) | ext[1];
+    } else if (len == 127) {
+        uint8_t ext[8];
+        if (!read_exact(sess, ext, sizeof(ext))) {
+            return false;
+        }
+        len = 0;
+        for (int i = 0; i < 8; i++) {
+            len = (len << 8) | ext[i];
+        }
+    }
+    if (sess->ws_masked && !read_exact(sess, sess->ws_mask, sizeof(sess->ws_mask))) {
+        return false;
+    }
+    sess->ws_len = (size_t)len;
+    sess->ws_read = 0;
+
+    bool control = (sess->ws_type & 0x08) != 0;
+    if (control && !sess->ws_uri->handle_ws_control_frames) {
+        // PING/PONG/CLOSE обрабатывает сервер, как в ESP-IDF по умолчанию
+        uint8_t payload[WS_MAX_CONTROL_LEN];
+        if (len > WS_MAX_CONTROL_LEN || !read_exact(sess, payload, (size_t)len)) {
+            return false;
+        }
+        for (size_t i = 0; sess->ws_masked && i < len; i++) {
+            payload[i] ^= sess->ws_mask[i % 4];
+        }
+        httpd_ws_frame_t reply;
+        memset(&reply, 0, sizeof(reply));
+        reply.final = true;
+        reply.payload = payload;
+        reply.len = (size_t)len;
+        if (sess->ws_type == HTTPD_WS_TYPE_CLOSE) {
+            reply.type = HTTPD_WS_TYPE_CLOSE;
+            httpd_ws_send_frame_async(server, sess->fd, &reply);
+            return false;
+        }
+        if (sess->ws_type == HTTPD_WS_TYPE_PING) {
+            reply.type = HTTPD_WS_TYPE_PONG;
+            return httpd_ws_send_frame_async(server, sess->fd, &reply) == ESP_OK;
+        }
+        return true;
+    }
+
+    httpd_req_t r;
+    host_request hr;
+    request_init(&r, &hr, server, sess, "");
+    r.method = 0;       // Как в ESP-IDF: не HTTP_GET для кадров после рукопожатия
+    strncpy(r.uri, sess->ws_uri->uri, HTTPD_MAX_URI_LEN);
+    r.user_ctx = sess->ws_uri->user_ctx;
+
+    esp_err_t ret = sess->ws_uri->handler(&r);
+    request_done(&r, sess);
+
+    // Непрочитанная обработчиком часть кадра отбрасывается
+    while (sess->ws_read < sess->ws_len) {
+        uint8_t discard[256];
+        size_t n = sess->ws_len - sess->ws_read;
+        if (n > sizeof(discard)) {
+            n = sizeof(discard);
+        }
+        if (!read_exact(sess, discard, n)) {
+            return false;
+        }
+        sess->ws_read += n;
+    }
+    return ret == ESP_OK;
+}
+
+static void process_session(host_server *server, host_session *sess)
+{
+    bool ok;
+    do {
+        ok = sess->websocket ? process_ws(server, sess) : process_http(server, sess);
+        // Конвейерные запросы и кадры, уже лежащие в буфере сессии
+    } while (ok && !sess->async && sess->buf_len > 0 &&
+             (sess->websocket || find_header_end(sess->buf, sess->buf_len) != NULL));
+    if (!ok) {
+        session_close(server, sess);
+    }
+}
+
+static void run_work(host_server *server)
+{
+    char drain[64];
+    while (read(server->wake_fd[0], drain, sizeof(drain)) == (ssize_t)sizeof(drain)) {
+    }
+
+    std::deque<host_work> batch;
+    {
+        std::lock_guard<std::mutex> guard(server->work_lock);
+        batch.swap(server->work);
+    }
+    for (auto &item : batch) {
+        item.fn(item.arg);
+    }
+}
+
+static void server_loop(host_server *server)
+{
+    while (!server->stopping) {
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        FD_SET(server->listen_fd, &rfds);
+        FD_SET(server->wake_fd[0], &rfds);
+        int max_fd = server->listen_fd > server->wake_fd[0] ? server->listen_fd : server->wake_fd[0];
+        for (auto &sess : server->sessions) {
+            if (sess.fd >= 0 && !sess.async) {
+                FD_SET(sess.fd, &rfds);
+                if (sess.fd > max_fd) {
+                    max_fd = sess.fd;
+                }
+            }
+        }
+
+        if (select(max_fd + 1, &rfds, NULL, NULL, NULL) < 0) {
+            if (errno != EINTR) {
+                ESP_LOGE(TAG, "select failed: errno %d", errno);
+                usleep(100 * 1000);
+            }
+            continue;
+        }
+
+        if (FD_ISSET(server->wake_fd[0], &rfds)) {
+            run_work(server);
+        }
+        for (auto &sess : server->sessions) {
+            // Сессию могли закрыть работы из очереди - проверяем fd заново
+            if (sess.fd >= 0 && !sess.async && FD_ISSET(sess.fd, &rfds)) {
+                process_session(server, &sess);
+            }
+        }
+        if (FD_ISSET(server->listen_fd, &rfds)) {
+            session_accept(server);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// API сервера
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return ESP_FAIL;
+    }
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(config->server_port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, config->backlog_conn) != 0) {
+        ESP_LOGE(TAG, "Port %u: %s", config->server_port, strerror(errno));
+        close(fd);
+        return ESP_ERR_HTTPD_TASK;
+    }
+
+    host_server *server = new host_server();
+    server->config = *config;
+    server->listen_fd = fd;
+    server->stopping = false;
+    server->use_counter = 0;
+    if (pipe(server->wake_fd) != 0) {
+        close(fd);
+        delete server;
+        return ESP_FAIL;
+    }
+    // Чтение пробуждающего канала не должно блокировать поток сервера
+    int flags = fcntl(server->wake_fd[0], F_GETFL, 0);
+    fcntl(server->wake_fd[0], F_SETFL, flags | O_NONBLOCK);
+
+    // Память под обработчики выделяется сразу: сессии хранят указатели на них
+    server->handlers.reserve(config->max_uri_handlers);
+    server->sessions.resize(config->max_open_sockets);
+    for (auto &sess : server->sessions) {
+        sess.fd = -1;
+        sess.websocket = false;
+        sess.async = false;
+    }
+
+    server->thread = std::thread([server] {
+        pthread_setname_np(pthread_self(), "httpd");
+        server_loop(server);
+    });
+    *handle = server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    host_server *server = (host_server *)handle;
+    if (server == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    httpd_queue_work(handle, [](void *arg) { ((host_server *)arg)->stopping = true; }, server);
+    server->thread.join();
+
+    run_work(server);
+    for (auto &sess : server->sessions) {
+        session_close(server, &sess);
+    }
+    close(server->listen_fd);
+    close(server->wake_fd[0]);
+    close(server->wake_fd[1]);
+    delete server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    host_server *server = (host_server *)handle;
+    if (server == NULL || uri_handler == NULL || uri_handler->uri == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (auto &h : server->handlers) {
+        if (h.method == uri_handler->method && strcmp(h.uri, uri_handler->uri) == 0) {
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+        }
+    }
+    if (server->handlers.size() >= server->config.max_uri_handlers) {
+        ESP_LOGW(TAG, "No slots left for registering handler %s", uri_handler->uri);
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
+    // Регистрация из другого потока: обработчики читает только поток сервера,
+    // а прошивка регистрирует их до прихода первых запросов
+    server->handlers.push_back(*uri_handler);
+    return ESP_OK;
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg)
+{
+    host_server *server = (host_server *)handle;
+    if (server == NULL || work == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    {
+        std::lock_guard<std::mutex> guard(server->work_lock);
+        server->work.push_back({ work, arg });
+    }
+    char wake = 0;
+    return write(server->wake_fd[1], &wake, 1) == 1 ? ESP_OK : ESP_FAIL;
+}
+
+static void close_work(void *arg)
+{
+    close_request *req = (close_request *)arg;
+    host_session *sess = session_by_fd(req->server, req->fd);
+    if (sess != NULL) {
+        session_close(req->server, sess);
+    }
+    delete req;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+    close_request *req = new close_request{ (host_server *)handle, sockfd };
+    esp_err_t ret = httpd_queue_work(handle, close_work, req);
+    if (ret != ESP_OK) {
+        delete req;
+    }
+    return ret;
+}
+
+bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match,
+                              size_t match_upto)
+{
+    size_t tpl_len = strlen(uri_template);
+    // "*" в конце шаблона - любой остаток адреса
+    if (tpl_len > 0 && uri_template[tpl_len - 1] == '*') {
+        size_t prefix = tpl_len - 1;
+        return match_upto >= prefix && strncmp(uri_template, uri_to_match, prefix) == 0;
+    }
+    // "?" в конце шаблона - предыдущий символ (обычно "/") необязателен
+    if (tpl_len > 1 && uri_template[tpl_len - 1] == '?') {
+        size_t exact = tpl_len - 1;
+        if (match_upto == exact && strncmp(uri_template, uri_to_match, exact) == 0) {
+            return true;
+        }
+        return match_upto == exact - 1 && strncmp(uri_template, uri_to_match, exact - 1) == 0;
+    }
+    return tpl_len == match_upto && strncmp(uri_template, uri_to_match, match_upto) == 0;
+}
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out)
+{
+    if (r == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_request *hr = request_of(r);
+    host_async_req *async = new host_async_req();
+    async->req = *r;
+    async->hr = *hr;
+    async->head = hr->head;
+    async->hr.head = async->head.c_str();
+    async->req.aux = &async->hr;
+    async->fd = hr->sess->fd;
+    hr->sess->async = true;
+    *out = &async->req;
+    return ESP_OK;
+}
+
+static void async_complete_work(void *arg)
+{
+    host_async_req *async = (host_async_req *)arg;
+    host_session *sess = async->hr.sess;
+    // Сессию могли закрыть (httpd_sess_trigger_close) до завершения
+    if (sess->fd == async->fd && sess->async) {
+        sess->async = false;
+        if (!async->hr.keep_alive || async->hr.body_left > 0) {
+            session_close(async->hr.server, sess);
+        }
+    }
+    delete async;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r)
+{
+    if (r == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_async_req *async = (host_async_req *)((char *)r - offsetof(host_async_req, req));
+    return httpd_queue_work(async->hr.server, async_complete_work, async);
+}
+
+// ---------------------------------------------------------------------------
+// Запрос
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    return request_of(r)->sess->fd;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    host_request *hr = request_of(r);
+    host_session *sess = hr->sess;
+    size_t want = buf_len < hr->body_left ? buf_len : hr->body_left;
+    if (want == 0) {
+        return 0;
+    }
+
+    // Начало тела могло прийти вместе с заголовками
+    if (sess->buf_len > 0) {
+        size_t n = want < sess->buf_len ? want : sess->buf_len;
+        memcpy(buf, sess->buf, n);
+        memmove(sess->buf, sess->buf + n, sess->buf_len - n);
+        sess->buf_len -= n;
+        hr->body_left -= n;
+        return (int)n;
+    }
+
+    ssize_t n;
+    do {
+        n = recv(sess->fd, buf, want, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? HTTPD_SOCK_ERR_TIMEOUT
+                                                         : HTTPD_SOCK_ERR_FAIL;
+    }
+    if (n == 0) {
+        return HTTPD_SOCK_ERR_FAIL;
+    }
+    hr->body_left -= n;
+    return (int)n;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field)
+{
+    size_t len = 0;
+    return find_header(request_of(r)->head, field, &len) != NULL ? len : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val,
+                                      size_t val_size)
+{
+    size_t len = 0;
+    const char *value = find_header(request_of(r)->head, field, &len);
+    if (value == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (val_size == 0) {
+        return ESP_ERR_HTTPD_RESULT_TRUNC;
+    }
+    size_t n = len < val_size - 1 ? len : val_size - 1;
+    memcpy(val, value, n);
+    val[n] = '\0';
+    return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *r)
+{
+    const char *query = strchr(r->uri, '?');
+    return query != NULL ? strlen(query + 1) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    const char *query = strchr(r->uri, '?');
+    if (query == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (buf_len == 0) {
+        return ESP_ERR_HTTPD_RESULT_TRUNC;
+    }
+    query++;
+    size_t len = strlen(query);
+    size_t n = len < buf_len - 1 ? len : buf_len - 1;
+    memcpy(buf, query, n);
+    buf[n] = '\0';
+    return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size)
+{
+    size_t key_len = strlen(key);
+    const char *p = qry;
+    while (p != NULL && *p != '\0') {
+        const char *end = strchr(p, '&');
+        size_t pair_len = end != NULL ? (size_t)(end - p) : strlen(p);
+        if (pair_len > key_len && p[key_len] == '=' && strncmp(p, key, key_len) == 0) {
+            const char *value = p + key_len + 1;
+            size_t len = pair_len - key_len - 1;
+            if (val_size == 0) {
+                return ESP_ERR_HTTPD_RESULT_TRUNC;
+            }
+            size_t n = len < val_size - 1 ? len : val_size - 1;
+            memcpy(val, value, n);
+            val[n] = '\0';
+            return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+        }
+        p = end != NULL ? end + 1 : NULL;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+// ---------------------------------------------------------------------------
+// Ответ
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    request_of(r)->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    request_of(r)->type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    host_request *hr = request_of(r);
+    if (hr->hdrs.size() >= hr->server->config.max_resp_headers) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+    hr->hdrs.push_back({ field, value });
+    return ESP_OK;
+}
+
+/**
+ * Строка состояния и заголовки ответа; content_length < 0 - chunked
+ */
+static std::string build_headers(host_request *hr, ssize_t content_length)
+{
+    char line[64];
+    std::string head = "HTTP/1.1 ";
+    head += hr->status;
+    head += "\r\nContent-Type: ";
+    head += hr->type;
+    head += "\r\n";
+    if (content_length < 0) {
+        head += "Transfer-Encoding: chunked\r\n";
+    } else {
+        snprintf(line, sizeof(line), "Content-Length: %zd\r\n", content_length);
+        head += line;
+    }
+    for (auto &h : hr->hdrs) {
+        head += h.field;
+        head += ": ";
+        head += h.value;
+        head += "\r\n";
+    }
+    if (!hr->keep_alive) {
+        head += "Connection: close\r\n";
+    }
+    head += "\r\n";
+    return head;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    host_request *hr = request_of(r);
+    if (hr->headers_sent) {
+        return ESP_ERR_HTTPD_RESP_SEND;
+    }
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = buf != NULL ? (ssize_t)strlen(buf) : 0;
+    }
+    std::string head = build_headers(hr, buf_len);
+    hr->headers_sent = true;
+
+    struct iovec iov[2] = {
+        { (void *)head.data(), head.size() },
+        { (void *)buf, (size_t)buf_len },
+    };
+    return send_all(hr->sess->fd, iov, buf_len > 0 ? 2 : 1) ? ESP_OK : ESP_ERR_HTTPD_RESP_SEND;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    host_request *hr = request_of(r);
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = buf != NULL ? (ssize_t)strlen(buf) : 0;
+    }
+
+    // Заголовки, размер, данные и окончание куска уходят одним вызовом
+    std::string head;
+    if (!hr->headers_sent) {
+        head = build_headers(hr, -1);
+        hr->headers_sent = true;
+    }
+    char size_line[16];
+    static const char crlf[] = "\r\n";
+    static const char last[] = "0\r\n\r\n";
+    struct iovec iov[4];
+    int count = 0;
+    if (!head.empty()) {
+        iov[count++] = { (void *)head.data(), head.size() };
+    }
+    if (buf == NULL || buf_len == 0) {
+        iov[count++] = { (void *)last, sizeof(last) - 1 };
+    } else {
+        int n = snprintf(size_line, sizeof(size_line), "%zx\r\n", (size_t)buf_len);
+        iov[count++] = { size_line, (size_t)n };
+        iov[count++] = { (void *)buf, (size_t)buf_len };
+        iov[count++] = { (void *)crlf, sizeof(crlf) - 1 };
+    }
+    return send_all(hr->sess->fd, iov, count) ? ESP_OK : ESP_ERR_HTTPD_RESP_SEND;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    static const struct { const char *status; const char *msg; } errors[HTTPD_ERR_CODE_MAX] = {
+        { "500 Internal Server Error", "Server has encountered an unexpected error" },
+        { "501 Method Not Implemented", "Server does not support this method" },
+        { "505 Version Not Supported", "HTTP version not supported by server" },
+        { "400 Bad Request", "Bad request syntax" },
+        { "401 Unauthorized", "No permission -- see authorization schemes" },
+        { "403 Forbidden", "Request forbidden -- authorization will not help" },
+        { "404 Not Found", "Nothing matches the given URI" },
+        { "405 Method Not Allowed", "Specified method is invalid for this resource" },
+        { "408 Request Timeout", "Server closed this connection" },
+        { "411 Length Required", "Client must specify Content-Length" },
+        { "414 URI Too Long", "URI is too long" },
+        { "431 Request Header Fields Too Large", "Header fields are too long" },
+    };
+    if (error >= HTTPD_ERR_CODE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    httpd_resp_set_status(req, errors[error].status);
+    httpd_resp_set_type(req, HTTPD_TYPE_TEXT);
+    return httpd_resp_send(req, msg != NULL ? msg : errors[error].msg, HTTPD_RESP_USE_STRLEN);
+}
+
+// ---------------------------------------------------------------------------
+// WebSocket
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len)
+{
+    host_session *sess = request_of(req)->sess;
+    if (!sess->websocket) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    pkt->type = sess->ws_type;
+    pkt->final = sess->ws_final;
+    pkt->fragmented = !sess->ws_final || sess->ws_type == HTTPD_WS_TYPE_CONTINUE;
+    if (max_len == 0) {
+        // Только заголовок кадра: длина для выделения буфера
+        pkt->len = sess->ws_len - sess->ws_read;
+        return ESP_OK;
+    }
+    if (pkt->payload == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t n = sess->ws_len - sess->ws_read;
+    if (n > max_len) {
+        n = max_len;
+    }
+    if (!read_exact(sess, pkt->payload, n)) {
+        return ESP_FAIL;
+    }
+    for (size_t i = 0; sess->ws_masked && i < n; i++) {
+        pkt->payload[i] ^= sess->ws_mask[(sess->ws_read + i) % 4];
+    }
+    sess->ws_read += n;
+    pkt->len = n;
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *pkt)
+{
+    return httpd_ws_send_frame_async(req->handle, httpd_req_to_sockfd(req), pkt);
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    uint8_t header[10];
+    size_t header_len = 2;
+    header[0] = (uint8_t)frame->type | ((frame->final || !frame->fragmented) ? 0x80 : 0);
+    if (frame->len < 126) {
+        header[1] = (uint8_t)frame->len;
+    } else if (frame->len <= 0xffff) {
+        header[1] = 126;
+        header[2] = (uint8_t)(frame->len >> 8);
+        header[3] = (uint8_t)frame->len;
+        header_len = 4;
+    } else {
+        header[1] = 127;
+        for (int i = 0; i < 8; i++) {
+            header[2 + i] = (uint8_t)((uint64_t)frame->len >> (56 - 8 * i));
+        }
+        header_len = 10;
+    }
+
+    struct iovec iov[2] = {
+        { header, header_len },
+        { frame->payload, frame->len },
+    };
+    return send_all(fd, iov, frame->len > 0 ? 2 : 1) ? ESP_OK : ESP_FAIL;
+}
+
+static void ws_async_work(void *arg)
+{
+    ws_async *job = (ws_async *)arg;
+    esp_err_t ret = ESP_FAIL;
+    if (httpd_ws_get_fd_info(job->server, job->fd) == HTTPD_WS_CLIENT_WEBSOCKET) {
+        ret = httpd_ws_send_frame_async(job->server, job->fd, &job->frame);
+    }
+    if (job->callback != NULL) {
+        job->callback(ret, job->fd, job->arg);
+    }
+    delete job;
+}
+
+esp_err_t httpd_ws_send_data_async(httpd_handle_t handle, int socket, httpd_ws_frame_t *frame,
+                                   transfer_complete_cb callback, void *arg)
+{
+    // Данные кадра не копируются: буфер должен жить до вызова callback
+    ws_async *job = new ws_async{ (host_server *)handle, socket, *frame, callback, arg };
+    esp_err_t ret = httpd_queue_work(handle, ws_async_work, job);
+    if (ret != ESP_OK) {
+        delete job;
+    }
+    return ret;
+}
+
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd)
+{
+    host_server *server = (host_server *)hd;
+    std::lock_guard<std::mutex> guard(server->sessions_lock);
+    for (auto &sess : server->sessions) {
+        if (sess.fd == fd) {
+            return sess.websocket ? HTTPD_WS_CLIENT_WEBSOCKET : HTTPD_WS_CLIENT_HTTP;
+        }
+    }
+    return HTTPD_WS_CLIENT_INVALID;
+}
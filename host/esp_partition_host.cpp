@@ -0,0 +1,111 @@
+/**
+ * @file esp_partition_host.cpp
+ * @brief Разделы флеш-памяти в памяти процесса (сборка под Linux)
+ *
+ * Таблица повторяет разделы данных из partitions.csv. Содержимое не
+ * сохраняется между запусками: каждый запуск видит чистую (стертую) флеш.
+ */
+
+#include "esp_partition.h"
+#include "config.h"
+
+#include <string.h>
+#include <mutex>
+#include <vector>
+
+#define HOST_FLASH_SECTOR_SIZE  4096
+
+typedef struct {
+    esp_partition_t info;
+    std::vector<uint8_t> data;
+} host_partition_t;
+
+// См. partitions.csv
+static host_partition_t partitions[] = {
+    { { NULL, FLASH_LOG_PARTITION_TYPE, FLASH_LOG_PARTITION_SUBTYPE, 0x150000, 0xb0000,
+        HOST_FLASH_SECTOR_SIZE, FLASH_LOG_PARTITION_LABEL, false, false }, {} },
+};
+
+static std::mutex flash_lock;
+
+static host_partition_t *lookup(const esp_partition_t *partition)
+{
+    for (auto &p : partitions) {
+        if (&p.info == partition) {
+            return &p;
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t check_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    if (lookup(partition) == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset > partition->size || size > partition->size - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    std::lock_guard<std::mutex> guard(flash_lock);
+    for (auto &p : partitions) {
+        if (p.info.type != type ||
+            (subtype != ESP_PARTITION_SUBTYPE_ANY && p.info.subtype != subtype) ||
+            (label != NULL && strcmp(p.info.label, label) != 0)) {
+            continue;
+        }
+        if (p.data.empty()) {
+            p.data.assign(p.info.size, 0xff);
+        }
+        return &p.info;
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset,
+                             void *dst, size_t size)
+{
+    esp_err_t ret = check_range(partition, src_offset, size);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    std::lock_guard<std::mutex> guard(flash_lock);
+    memcpy(dst, lookup(partition)->data.data() + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset,
+                              const void *src, size_t size)
+{
+    esp_err_t ret = check_range(partition, dst_offset, size);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    std::lock_guard<std::mutex> guard(flash_lock);
+    uint8_t *dst = lookup(partition)->data.data() + dst_offset;
+    const uint8_t *bytes = (const uint8_t *)src;
+    for (size_t i = 0; i < size; i++) {
+        dst[i] &= bytes[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    esp_err_t ret = check_range(partition, offset, size);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (offset % HOST_FLASH_SECTOR_SIZE != 0 || size % HOST_FLASH_SECTOR_SIZE != 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    std::lock_guard<std::mutex> guard(flash_lock);
+    memset(lookup(partition)->data.data() + offset, 0xff, size);
+    return ESP_OK;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file esp_system_host.cpp
+ * @brief Журнал, время, куча, коды ошибок, CRC, задержка и хуки ESP-IDF для сборки под Linux
+ */
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "esp_rom_sys.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_freertos_hooks.h"
+
+#include <stdarg.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#define HOST_LOG_MAX_TAGS   16
+
+typedef struct {
+    char tag[24];
+    esp_log_level_t level;
+} host_log_tag_t;
+
+static const auto start_time = std::chrono::steady_clock::now();
+static std::atomic<int> log_level(ESP_LOG_INFO);
+
+// Уровни отдельных тегов (как esp_log_level_set() в ESP-IDF)
+static std::mutex log_tags_lock;
+static host_log_tag_t log_tags[HOST_LOG_MAX_TAGS];
+static std::atomic<int> log_tag_count(0);
+
+static std::atomic<uint32_t> min_free_heap(UINT32_MAX);
+
+int64_t esp_timer_get_time(void)
+{
+    auto elapsed = std::chrono::steady_clock::now() - start_time;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    // Свободные блоки внутри кучи malloc (без памяти, не взятой у системы)
+    struct mallinfo2 info = mallinfo2();
+    uint32_t free_bytes = info.fordblks > UINT32_MAX ? UINT32_MAX : (uint32_t)info.fordblks;
+
+    uint32_t min = min_free_heap.load(std::memory_order_relaxed);
+    while (free_bytes < min &&
+           !min_free_heap.compare_exchange_weak(min, free_bytes, std::memory_order_relaxed)) {
+    }
+    return free_bytes;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    uint32_t min = min_free_heap.load(std::memory_order_relaxed);
+    return min == UINT32_MAX ? esp_get_free_heap_size() : min;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    (void)caps;
+    return esp_get_free_heap_size();
+}
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return ESP_RST_POWERON;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                return "ESP_OK";
+    case ESP_FAIL:              return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:   return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:  return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:     return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:       return "ESP_ERR_TIMEOUT";
+    default:                    return "UNKNOWN ERROR";
+    }
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    std::lock_guard<std::mutex> guard(log_tags_lock);
+    if (strcmp(tag, "*") == 0) {
+        log_level.store(level, std::memory_order_relaxed);
+        log_tag_count.store(0, std::memory_order_relaxed);
+        return;
+    }
+    int count = log_tag_count.load(std::memory_order_relaxed);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(log_tags[i].tag, tag) == 0) {
+            log_tags[i].level = level;
+            return;
+        }
+    }
+    if (count < HOST_LOG_MAX_TAGS) {
+        snprintf(log_tags[count].tag, sizeof(log_tags[count].tag), "%s", tag);
+        log_tags[count].level = level;
+        log_tag_count.store(count + 1, std::memory_order_relaxed);
+    }
+}
+
+esp_log_level_t esp_log_level_get(const char *tag)
+{
+    // Без уровней отдельных тегов - без блокировки
+    if (log_tag_count.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> guard(log_tags_lock);
+        int count = log_tag_count.load(std::memory_order_relaxed);
+        for (int i = 0; i < count; i++) {
+            if (strcmp(log_tags[i].tag, tag) == 0) {
+                return log_tags[i].level;
+            }
+        }
+    }
+    return (esp_log_level_t)log_level.load(std::memory_order_relaxed);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    if (level > esp_log_level_get(tag)) {
+        return;
+    }
+
+    // Одна строка - один вызов fprintf: строки разных потоков не смешиваются
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    fprintf(stderr, "%c (%lld) %s: %s\n", letters[level],
+            (long long)(esp_timer_get_time() / 1000), tag, line);
+}
+
+/**
+ * Таблица CRC32 (строится один раз, потокобезопасно)
+ */
+struct crc32_table {
+    uint32_t entry[256];
+
+    crc32_table()
+    {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            entry[i] = c;
+        }
+    }
+};
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    static const crc32_table table;
+
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc = table.entry[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+esp_err_t esp_register_freertos_idle_hook(esp_freertos_idle_cb_t cb)
+{
+    // Задачи IDLE нет: хук не вызывается
+    return cb != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
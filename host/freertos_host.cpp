@@ -0,0 +1,367 @@
+/**
+ * @file freertos_host.cpp
+ * @brief Задачи, уведомления, семафоры и очереди FreeRTOS поверх потоков
+ *
+ * Поведение, на которое опирается код прошивки: уведомление до входа
+ * в ulTaskNotifyTake() не теряется, таймаут в тиках (1 тик = 1 мс),
+ * portMAX_DELAY - ожидание без ограничения.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct host_task {
+    TaskFunction_t fn;
+    void *param;
+    char name[16];
+    uint32_t stack_depth;
+    UBaseType_t priority;
+    UBaseType_t number;
+    pthread_t thread;
+    bool running;
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t notify_count;
+};
+
+struct host_semaphore {
+    std::mutex lock;
+    std::condition_variable available;
+    UBaseType_t count;
+    UBaseType_t max_count;
+};
+
+struct QueueDefinition {
+    std::mutex lock;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::vector<uint8_t> storage;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+static thread_local host_task *current_task = NULL;
+static const auto start_time = std::chrono::steady_clock::now();
+
+// Созданные задачи (для uxTaskGetSystemState); объекты не освобождаются
+static std::mutex tasks_lock;
+static std::vector<host_task *> tasks;
+
+/**
+ * Ожидание условия с таймаутом в тиках
+ */
+template <typename Pred>
+static bool wait_ticks(std::condition_variable &cv, std::unique_lock<std::mutex> &guard,
+                       TickType_t ticks, Pred pred)
+{
+    if (ticks == portMAX_DELAY) {
+        cv.wait(guard, pred);
+        return true;
+    }
+    return cv.wait_for(guard, std::chrono::milliseconds(ticks * portTICK_PERIOD_MS), pred);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                       void *param, UBaseType_t priority, TaskHandle_t *handle)
+{
+    host_task *task = new host_task();
+    task->fn = fn;
+    task->param = param;
+    strncpy(task->name, name != NULL ? name : "", sizeof(task->name) - 1);
+    task->stack_depth = stack_depth;
+    task->priority = priority;
+    task->running = false;
+    task->notify_count = 0;
+    if (handle != NULL) {
+        *handle = task;
+    }
+
+    // Задача попадает в снимок, когда поток уже запущен и известен
+    std::thread thread([task] {
+        current_task = task;
+        pthread_setname_np(pthread_self(), task->name);
+        {
+            std::lock_guard<std::mutex> guard(tasks_lock);
+            task->thread = pthread_self();
+            task->number = (UBaseType_t)tasks.size() + 1;
+            task->running = true;
+            tasks.push_back(task);
+        }
+        task->fn(task->param);
+        std::lock_guard<std::mutex> guard(tasks_lock);
+        task->running = false;
+    });
+    thread.detach();
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    // Объект задачи не освобождается: на него могут ссылаться уведомления
+    if (task == NULL || task == current_task) {
+        if (current_task != NULL) {
+            std::lock_guard<std::mutex> guard(tasks_lock);
+            current_task->running = false;
+        }
+        pthread_exit(NULL);
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    auto elapsed = std::chrono::steady_clock::now() - start_time;
+    return (TickType_t)(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() /
+                        portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return current_task;
+}
+
+char *pcTaskGetName(TaskHandle_t task)
+{
+    task = task != NULL ? task : current_task;
+    return task != NULL ? task->name : NULL;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    // Расход стека потока не измеряется: весь заказанный стек считается свободным
+    task = task != NULL ? task : current_task;
+    return task != NULL ? task->stack_depth : 0;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+    std::lock_guard<std::mutex> guard(tasks_lock);
+    UBaseType_t count = 0;
+    for (host_task *task : tasks) {
+        count += task->running ? 1 : 0;
+    }
+    return count;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t size,
+                                 configRUN_TIME_COUNTER_TYPE *total_run_time)
+{
+    std::lock_guard<std::mutex> guard(tasks_lock);
+    UBaseType_t count = 0;
+    for (host_task *task : tasks) {
+        count += task->running ? 1 : 0;
+    }
+    if (count > size) {
+        return 0;
+    }
+
+    count = 0;
+    for (host_task *task : tasks) {
+        if (!task->running) {
+            continue;
+        }
+        clockid_t clock;
+        struct timespec ts = {};
+        if (pthread_getcpuclockid(task->thread, &clock) == 0) {
+            clock_gettime(clock, &ts);
+        }
+        TaskStatus_t &s = status[count++];
+        s.xHandle = task;
+        s.pcTaskName = task->name;
+        s.xTaskNumber = task->number;
+        s.eCurrentState = eReady;
+        s.uxCurrentPriority = task->priority;
+        s.uxBasePriority = task->priority;
+        s.ulRunTimeCounter = (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+        s.usStackHighWaterMark = task->stack_depth;
+    }
+    if (total_run_time != NULL) {
+        auto elapsed = std::chrono::steady_clock::now() - start_time;
+        *total_run_time = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            elapsed).count();
+    }
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->notify_count++;
+    }
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskNotifyGive(task);
+    if (woken != NULL) {
+        *woken = pdFALSE;
+    }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    host_task *task = current_task;
+    if (task == NULL) {
+        // Вызов не из задачи (основной поток) - уведомлений не бывает
+        vTaskDelay(ticks == portMAX_DELAY ? 1000 : ticks);
+        return 0;
+    }
+
+    std::unique_lock<std::mutex> guard(task->lock);
+    wait_ticks(task->notified, guard, ticks, [task] { return task->notify_count > 0; });
+    uint32_t value = task->notify_count;
+    if (value > 0) {
+        task->notify_count = clear_on_exit ? 0 : value - 1;
+    }
+    return value;
+}
+
+static SemaphoreHandle_t semaphore_create(UBaseType_t max_count, UBaseType_t initial)
+{
+    host_semaphore *sem = new host_semaphore();
+    sem->count = initial;
+    sem->max_count = max_count;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return semaphore_create(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return semaphore_create(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial)
+{
+    return semaphore_create(max_count, initial);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> guard(sem->lock);
+    if (!wait_ticks(sem->available, guard, ticks, [sem] { return sem->count > 0; })) {
+        return pdFALSE;
+    }
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    {
+        std::lock_guard<std::mutex> guard(sem->lock);
+        if (sem->count >= sem->max_count) {
+            return pdFALSE;
+        }
+        sem->count++;
+    }
+    sem->available.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+    if (woken != NULL) {
+        *woken = pdFALSE;
+    }
+    return xSemaphoreGive(sem);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    delete sem;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    QueueDefinition *queue = new QueueDefinition();
+    queue->storage.resize((size_t)length * item_size);
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->head = 0;
+    queue->count = 0;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    {
+        std::unique_lock<std::mutex> guard(queue->lock);
+        if (!wait_ticks(queue->not_full, guard, ticks,
+                        [queue] { return queue->count < queue->length; })) {
+            return pdFALSE;
+        }
+        UBaseType_t tail = (queue->head + queue->count) % queue->length;
+        memcpy(&queue->storage[(size_t)tail * queue->item_size], item, queue->item_size);
+        queue->count++;
+    }
+    queue->not_empty.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken)
+{
+    if (woken != NULL) {
+        *woken = pdFALSE;
+    }
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    {
+        std::unique_lock<std::mutex> guard(queue->lock);
+        if (!wait_ticks(queue->not_empty, guard, ticks, [queue] { return queue->count > 0; })) {
+            return pdFALSE;
+        }
+        memcpy(item, &queue->storage[(size_t)queue->head * queue->item_size], queue->item_size);
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+    }
+    queue->not_full.notify_one();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return queue->count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    {
+        std::lock_guard<std::mutex> guard(queue->lock);
+        queue->head = 0;
+        queue->count = 0;
+    }
+    queue->not_full.notify_all();
+    return pdPASS;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    delete queue;
+}
@@ -0,0 +1,17 @@
+/**
+ * @file gpio.h
+ * @brief Номера выводов GPIO для сборки под Linux
+ */
+
+#ifndef HOST_DRIVER_GPIO_H
+#define HOST_DRIVER_GPIO_H
+
+typedef enum {
+    GPIO_NUM_NC = -1,
+    GPIO_NUM_0 = 0,
+    GPIO_NUM_1 = 1,
+    GPIO_NUM_16 = 16,
+    GPIO_NUM_17 = 17,
+} gpio_num_t;
+
+#endif // HOST_DRIVER_GPIO_H
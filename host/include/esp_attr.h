@@ -0,0 +1,14 @@
+/**
+ * @file esp_attr.h
+ * @brief Атрибуты размещения ESP-IDF для сборки под Linux
+ *
+ * Память процесса не переживает перезапуск: noinit - обычная статическая
+ * память (обнулена), записи прошлого запуска не проходят проверку.
+ */
+
+#ifndef HOST_ESP_ATTR_H
+#define HOST_ESP_ATTR_H
+
+#define __NOINIT_ATTR
+
+#endif // HOST_ESP_ATTR_H
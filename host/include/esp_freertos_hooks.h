@@ -0,0 +1,19 @@
+/**
+ * @file esp_freertos_hooks.h
+ * @brief Хуки задачи IDLE для сборки под Linux
+ *
+ * Задачи IDLE нет (простаивают потоки ОС): хук регистрируется, но не
+ * вызывается, пробуждения простоя остаются нулевыми.
+ */
+
+#ifndef HOST_ESP_FREERTOS_HOOKS_H
+#define HOST_ESP_FREERTOS_HOOKS_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef bool (*esp_freertos_idle_cb_t)(void);
+
+esp_err_t esp_register_freertos_idle_hook(esp_freertos_idle_cb_t cb);
+
+#endif // HOST_ESP_FREERTOS_HOOKS_H
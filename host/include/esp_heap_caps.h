@@ -0,0 +1,21 @@
+/**
+ * @file esp_heap_caps.h
+ * @brief Сведения о куче по возможностям памяти ESP-IDF для сборки под Linux
+ */
+
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_DEFAULT  (1 << 12)
+
+/**
+ * @brief Наибольший свободный блок, байт (под Linux - вся свободная память
+ *        кучи malloc: раскладка блоков недоступна)
+ */
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+#endif // HOST_ESP_HEAP_CAPS_H
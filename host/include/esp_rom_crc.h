@@ -0,0 +1,16 @@
+/**
+ * @file esp_rom_crc.h
+ * @brief CRC32 из ROM ESP32 для сборки под Linux
+ */
+
+#ifndef HOST_ESP_ROM_CRC_H
+#define HOST_ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+/**
+ * @brief CRC-32 (IEEE 802.3, отраженный), совместим с zlib crc32()
+ */
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+#endif // HOST_ESP_ROM_CRC_H
@@ -0,0 +1,16 @@
+/**
+ * @file esp_rom_sys.h
+ * @brief Задержка из ROM ESP32 для сборки под Linux
+ */
+
+#ifndef HOST_ESP_ROM_SYS_H
+#define HOST_ESP_ROM_SYS_H
+
+#include <stdint.h>
+
+/**
+ * @brief Активное ожидание заданного числа микросекунд
+ */
+void esp_rom_delay_us(uint32_t us);
+
+#endif // HOST_ESP_ROM_SYS_H
@@ -0,0 +1,43 @@
+/**
+ * @file esp_system.h
+ * @brief Сведения о куче и причина сброса ESP-IDF для сборки под Linux
+ */
+
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+#include <stdint.h>
+
+/**
+ * @brief Свободная память в куче процесса, байт
+ */
+uint32_t esp_get_free_heap_size(void);
+
+/**
+ * @brief Минимум свободной памяти с запуска, байт (по вызовам esp_get_free_heap_size)
+ */
+uint32_t esp_get_minimum_free_heap_size(void);
+
+/**
+ * @brief Причины сброса (значения как в ESP-IDF)
+ */
+typedef enum {
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+/**
+ * @brief Причина последнего сброса (процесс всегда запускается "с питания")
+ */
+esp_reset_reason_t esp_reset_reason(void);
+
+#endif // HOST_ESP_SYSTEM_H
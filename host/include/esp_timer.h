@@ -0,0 +1,16 @@
+/**
+ * @file esp_timer.h
+ * @brief Монотонное время ESP-IDF для сборки под Linux
+ */
+
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+
+/**
+ * @brief Время от запуска процесса, мкс
+ */
+int64_t esp_timer_get_time(void);
+
+#endif // HOST_ESP_TIMER_H
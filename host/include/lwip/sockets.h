@@ -0,0 +1,18 @@
+/**
+ * @file sockets.h
+ * @brief Сокеты lwIP для сборки под Linux: API BSD сокетов совпадает
+ */
+
+#ifndef HOST_LWIP_SOCKETS_H
+#define HOST_LWIP_SOCKETS_H
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#endif // HOST_LWIP_SOCKETS_H
@@ -0,0 +1,43 @@
+/**
+ * @file rs232_host.h
+ * @brief Управление имитацией порта RS-232 в сборке под Linux
+ *
+ * Вместо UART используется буфер в памяти: тест подает байты "с линии"
+ * через rs232_host_inject() и забирает переданные через rs232_host_take_tx().
+ */
+
+#ifndef RS232_HOST_H
+#define RS232_HOST_H
+
+#include "rs232_handler.h"
+
+/**
+ * @brief Подача принятых "с линии" байт (будят rs232_read)
+ *
+ * @return Количество байт, поместившихся в буфер приема
+ */
+size_t rs232_host_inject(const uint8_t *data, size_t length);
+
+/**
+ * @brief Извлечение байт, записанных через rs232_write()
+ *
+ * @return Количество скопированных байт
+ */
+size_t rs232_host_take_tx(uint8_t *buffer, size_t length);
+
+/**
+ * @brief Количество байт, ожидающих чтения
+ */
+size_t rs232_host_rx_pending(void);
+
+/**
+ * @brief Количество применений конфигурации (init + reconfigure)
+ */
+uint32_t rs232_host_reconfigure_count(void);
+
+/**
+ * @brief Сброс состояния имитации (буферы, конфигурация, счетчики)
+ */
+void rs232_host_reset(void);
+
+#endif // RS232_HOST_H
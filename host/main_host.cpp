@@ -0,0 +1,186 @@
+/**
+ * @file main_host.cpp
+ * @brief Мост ComToAir под Linux: ядро прошивки с имитацией порта RS-232
+ *
+ * Запускает те же модули, что и app_main(): прием UART, веб-сервер
+ * (HTTP API, /ws/stream, веб-интерфейс), TCP сервер порта и журнал во
+ * флеш (раздел в памяти). Источник "принятых с линии" данных:
+ *   - стандартный ввод (по умолчанию): cat capture.bin | comtoair_host
+ *   - псевдотерминал (--pty): программа печатает путь к ведомой стороне,
+ *     которую можно открыть как обычный последовательный порт; данные,
+ *     записанные в порт мостом (POST /api/send, WebSocket, TCP клиенты),
+ *     приходят обратно в терминал.
+ *
+ * Использование: comtoair_host [--http-port N] [--pty]
+ */
+
+#include "config.h"
+#include "rs232_handler.h"
+#include "rs232_host.h"
+#include "uart_rx.h"
+#include "uart_tx.h"
+#include "web_server.h"
+#include "tcp_server.h"
+#include "flash_log.h"
+#include "dlog.h"
+#include "diagnostics.h"
+#include "wifi_manager.h"
+#include "boot.h"
+#include "serial_port.h"
+#include "decoder.h"
+#include "trigger.h"
+#include "buffer_pool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <termios.h>
+#include <thread>
+#include "esp_log.h"
+
+static const char *TAG = "Host";
+
+#define HOST_HTTP_PORT_DEFAULT  8080
+#define HOST_IO_CHUNK           1024
+
+/**
+ * Подача данных из файлового дескриптора в имитацию приема UART
+ */
+static void feed_rx(int fd)
+{
+    uint8_t buf[HOST_IO_CHUNK];
+    while (true) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        // Как на линии: не успели прочитать - байты теряются
+        size_t accepted = rs232_host_inject(buf, (size_t)n);
+        if (accepted < (size_t)n) {
+            ESP_LOGW(TAG, "RX overrun: %u bytes lost", (unsigned)(n - accepted));
+        }
+    }
+}
+
+/**
+ * Вывод переданных мостом в порт данных в псевдотерминал
+ */
+static void drain_tx(int fd)
+{
+    uint8_t buf[HOST_IO_CHUNK];
+    while (true) {
+        size_t n = rs232_host_take_tx(buf, sizeof(buf));
+        if (n == 0) {
+            usleep(2000);
+            continue;
+        }
+        for (size_t done = 0; done < n; ) {
+            ssize_t w = write(fd, buf + done, n - done);
+            if (w <= 0) {
+                break;
+            }
+            done += w;
+        }
+    }
+}
+
+static int open_pty(void)
+{
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+        ESP_LOGE(TAG, "Failed to create pty: %s", strerror(errno));
+        return -1;
+    }
+    // Прозрачная передача байт без обработки строк терминалом
+    struct termios tio;
+    tcgetattr(fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+
+    printf("Serial port: %s\n", ptsname(fd));
+    fflush(stdout);
+    return fd;
+}
+
+int main(int argc, char **argv)
+{
+    uint16_t http_port = HOST_HTTP_PORT_DEFAULT;
+    bool use_pty = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--http-port") == 0 && i + 1 < argc) {
+            http_port = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pty") == 0) {
+            use_pty = true;
+        } else {
+            fprintf(stderr, "Usage: %s [--http-port N] [--pty]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Клиент, закрывший сокет, не должен завершать процесс
+    signal(SIGPIPE, SIG_IGN);
+
+    // Тот же порядок, что в app_main: прием первым, отметки /api/boot
+    boot_begin();
+    boot_set_carried(web_server_restore_data());
+    dlog_start();
+    decoder_init();
+    buffer_pool_init();
+
+    rs232_config_t config = {
+        UART_BAUD_RATE, UART_DATA_8_BITS, UART_PARITY_DISABLE, UART_STOP_BITS_1,
+    };
+    if (!rs232_init(&config) || !uart_rx_start(UART_NUM, rs232_get_event_queue())) {
+        ESP_LOGE(TAG, "Failed to start UART RX");
+        return 1;
+    }
+    boot_mark(BOOT_STAGE_UART_READY);
+    boot_mark(BOOT_STAGE_CAPTURE_STARTED);
+    flash_log_start();
+    if (!uart_tx_start()) {
+        ESP_LOGE(TAG, "Failed to start UART TX");
+        return 1;
+    }
+    if (!serial_ports_start()) {
+        ESP_LOGE(TAG, "Failed to start auxiliary ports");
+        return 1;
+    }
+    boot_mark(BOOT_STAGE_NVS_READY);
+    trigger_init();
+    wifi_manager_init();
+    boot_mark(BOOT_STAGE_WIFI_STARTED);
+    if (!web_server_start(http_port)) {
+        return 1;
+    }
+    boot_mark(BOOT_STAGE_HTTPD_STARTED);
+    tcp_server_start();
+    boot_mark(BOOT_STAGE_TCP_STARTED);
+    diag_start();
+    boot_mark(BOOT_STAGE_INIT_DONE);
+
+    if (use_pty) {
+        int fd = open_pty();
+        if (fd < 0) {
+            return 1;
+        }
+        std::thread(drain_tx, fd).detach();
+        while (true) {
+            // Пока ведомая сторона не открыта (или закрыта), чтение дает EIO
+            feed_rx(fd);
+            usleep(100 * 1000);
+        }
+    } else {
+        feed_rx(STDIN_FILENO);
+        ESP_LOGI(TAG, "Input closed, serving captured data (Ctrl+C to exit)");
+        pause();
+    }
+    return 0;
+}
@@ -0,0 +1,206 @@
+/**
+ * @file rs232_handler_host.cpp
+ * @brief Реализация rs232_handler для сборки под Linux
+ *
+ * Повторяет поведение прошивки, важное для логики верхних уровней:
+ * проверку параметров (общий rs232_config.cpp), блокирующее чтение
+ * с таймаутом и сохранение принятых байт при смене параметров.
+ */
+
+#include "rs232_handler.h"
+#include "rs232_host.h"
+#include "config.h"
+
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// Размер имитации кольцевого буфера драйвера
+#define HOST_RX_BUF_SIZE    (UART_RX_RING_SIZE * 4)
+#define HOST_TX_BUF_SIZE    (UART_RX_RING_SIZE * 4)
+
+static std::mutex lock;
+static std::condition_variable rx_ready;
+
+static uint8_t rx_buf[HOST_RX_BUF_SIZE];
+static size_t rx_head = 0;          // Позиция записи
+static size_t rx_count = 0;         // Байт в буфере
+
+static uint8_t tx_buf[HOST_TX_BUF_SIZE];
+static size_t tx_count = 0;
+
+static rs232_config_t current_config = {
+    UART_BAUD_RATE, UART_DATA_8_BITS, UART_PARITY_DISABLE, UART_STOP_BITS_1,
+};
+static uint32_t reconfigure_count = 0;
+
+bool rs232_init(const rs232_config_t *config)
+{
+    return rs232_reconfigure(config);
+}
+
+int rs232_read(uint8_t *buffer, size_t length, uint32_t timeout_ms)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    auto has_data = [] { return rx_count > 0; };
+    if (timeout_ms == RS232_WAIT_FOREVER) {
+        rx_ready.wait(guard, has_data);
+    } else if (!rx_ready.wait_for(guard, std::chrono::milliseconds(timeout_ms), has_data)) {
+        return 0;
+    }
+
+    size_t n = length < rx_count ? length : rx_count;
+    size_t tail = (rx_head + HOST_RX_BUF_SIZE - rx_count) % HOST_RX_BUF_SIZE;
+    for (size_t i = 0; i < n; i++) {
+        buffer[i] = rx_buf[(tail + i) % HOST_RX_BUF_SIZE];
+    }
+    rx_count -= n;
+    return (int)n;
+}
+
+int rs232_write(const uint8_t *data, size_t length)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    size_t n = length;
+    if (n > sizeof(tx_buf) - tx_count) {
+        n = sizeof(tx_buf) - tx_count;
+    }
+    memcpy(tx_buf + tx_count, data, n);
+    tx_count += n;
+    return (int)n;
+}
+
+bool rs232_wait_tx_done(uint32_t timeout_ms)
+{
+    // Переданные байты сразу попадают в tx_buf
+    return true;
+}
+
+bool rs232_reconfigure(const rs232_config_t *config)
+{
+    if (!rs232_config_is_valid(config)) {
+        return false;
+    }
+    // Как и в прошивке, буфер приема при смене параметров не трогаем
+    std::lock_guard<std::mutex> guard(lock);
+    current_config = *config;
+    reconfigure_count++;
+    return true;
+}
+
+void rs232_get_config(rs232_config_t *config)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    *config = current_config;
+}
+
+void rs232_flush(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    rx_count = 0;
+}
+
+QueueHandle_t rs232_get_event_queue(void)
+{
+    return NULL;
+}
+
+bool rs232_dma_enabled(void)
+{
+    return false;
+}
+
+size_t rs232_host_inject(const uint8_t *data, size_t length)
+{
+    size_t n;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        // Переполнение буфера драйвера: лишние байты теряются, как на UART
+        n = length;
+        if (n > HOST_RX_BUF_SIZE - rx_count) {
+            n = HOST_RX_BUF_SIZE - rx_count;
+        }
+        for (size_t i = 0; i < n; i++) {
+            rx_buf[rx_head] = data[i];
+            rx_head = (rx_head + 1) % HOST_RX_BUF_SIZE;
+        }
+        rx_count += n;
+    }
+    rx_ready.notify_all();
+    return n;
+}
+
+size_t rs232_host_take_tx(uint8_t *buffer, size_t length)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    size_t n = length < tx_count ? length : tx_count;
+    memcpy(buffer, tx_buf, n);
+    memmove(tx_buf, tx_buf + n, tx_count - n);
+    tx_count -= n;
+    return n;
+}
+
+size_t rs232_host_rx_pending(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return rx_count;
+}
+
+uint32_t rs232_host_reconfigure_count(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return reconfigure_count;
+}
+
+void rs232_host_reset(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    rx_head = 0;
+    rx_count = 0;
+    tx_count = 0;
+    current_config = { UART_BAUD_RATE, UART_DATA_8_BITS, UART_PARITY_DISABLE, UART_STOP_BITS_1 };
+    reconfigure_count = 0;
+}
+
+// Функции драйвера UART, которые вызывают модули прошивки, работают
+// с тем же буфером приема; настройки прерываний приема не нужны
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    return rs232_read((uint8_t *)buf, length,
+                      ticks_to_wait == portMAX_DELAY ? RS232_WAIT_FOREVER :
+                      ticks_to_wait * portTICK_PERIOD_MS);
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size)
+{
+    *size = rs232_host_rx_pending();
+    return ESP_OK;
+}
+
+esp_err_t uart_set_rx_full_threshold(uart_port_t uart_num, int threshold)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_set_rx_timeout(uart_port_t uart_num, const uint8_t tout_thresh)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_enable_pattern_det_baud_intr(uart_port_t uart_num, char pattern_chr,
+                                            uint8_t chr_num, int chr_tout, int post_idle,
+                                            int pre_idle)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_pattern_queue_reset(uart_port_t uart_num, int queue_length)
+{
+    return ESP_OK;
+}
+
+int uart_pattern_pop_pos(uart_port_t uart_num)
+{
+    return -1;
+}
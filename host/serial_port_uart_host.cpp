@@ -0,0 +1,99 @@
+/**
+ * @file serial_port_uart_host.cpp
+ * @brief Драйвер дополнительных портов для сборки под Linux
+ *
+ * Каждый порт - петля: переданные байты возвращаются как принятые, что
+ * позволяет проверить /api/ports/{n}/send и /data без устройства. Буфер
+ * приема ограничен SERIAL_PORT_RX_RING_SIZE, лишние байты теряются и
+ * считаются переполнением, как в драйвере UART.
+ */
+
+#include "serial_port_uart.h"
+#include "config.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+typedef struct {
+    bool open;
+    uint8_t rx_buf[SERIAL_PORT_RX_RING_SIZE];
+    size_t rx_head;                 // Позиция записи
+    size_t rx_count;                // Байт в буфере
+    uint32_t overruns;              // Еще не переданы задаче приема
+} host_port_t;
+
+static std::mutex lock;
+static std::condition_variable rx_ready;
+static host_port_t host_ports[SERIAL_PORT_COUNT];
+static bool pending_event = false;
+
+bool serial_port_uart_open(int port, uart_port_t uart, int tx_pin, int rx_pin,
+                           const rs232_config_t *config)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    host_ports[port].open = true;
+    return true;
+}
+
+bool serial_port_uart_set_config(int port, const rs232_config_t *config)
+{
+    return host_ports[port].open;
+}
+
+size_t serial_port_uart_buffered(int port)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return host_ports[port].rx_count;
+}
+
+size_t serial_port_uart_read(int port, uint8_t *buffer, size_t length)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    host_port_t *hp = &host_ports[port];
+    size_t n = length < hp->rx_count ? length : hp->rx_count;
+    size_t tail = (hp->rx_head + SERIAL_PORT_RX_RING_SIZE - hp->rx_count) % SERIAL_PORT_RX_RING_SIZE;
+    for (size_t i = 0; i < n; i++) {
+        buffer[i] = hp->rx_buf[(tail + i) % SERIAL_PORT_RX_RING_SIZE];
+    }
+    hp->rx_count -= n;
+    return n;
+}
+
+size_t serial_port_uart_write(int port, const uint8_t *data, size_t length)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        host_port_t *hp = &host_ports[port];
+        if (!hp->open) {
+            return 0;
+        }
+        size_t n = length;
+        if (n > SERIAL_PORT_RX_RING_SIZE - hp->rx_count) {
+            n = SERIAL_PORT_RX_RING_SIZE - hp->rx_count;
+            hp->overruns++;
+        }
+        for (size_t i = 0; i < n; i++) {
+            hp->rx_buf[hp->rx_head] = data[i];
+            hp->rx_head = (hp->rx_head + 1) % SERIAL_PORT_RX_RING_SIZE;
+        }
+        hp->rx_count += n;
+        pending_event = true;
+    }
+    rx_ready.notify_all();
+    // Передача идет со скоростью записи, как в буфер передачи драйвера
+    return length;
+}
+
+bool serial_port_uart_wait(uint32_t timeout_ms, uint32_t *overruns, uint32_t *errors)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    bool any = rx_ready.wait_for(guard, std::chrono::milliseconds(timeout_ms),
+                                 [] { return pending_event; });
+    pending_event = false;
+    for (int p = 1; p < SERIAL_PORT_COUNT; p++) {
+        overruns[p] += host_ports[p].overruns;
+        host_ports[p].overruns = 0;
+    }
+    return any;
+}
@@ -0,0 +1,187 @@
+/**
+ * @file stress_byte_ring.cpp
+ * @brief Нагрузочная проверка byte_ring под Linux: один писатель, много читателей
+ *
+ * Писатель пишет порции разной длины (в том числе длиннее буфера), байт
+ * с номером seq имеет значение pattern(seq). Читатели на своих потоках
+ * читают byte_ring_read с разным размером порции, один из них с паузами,
+ * чтобы отставать и терять данные. Каждый читатель проверяет:
+ *   - непрерывность номеров: курсор до чтения + lost + n == курсор после;
+ *   - содержимое: каждый прочитанный байт равен pattern(своего номера),
+ *     то есть перезаписанный во время копирования байт не отдан;
+ *   - точный учет потерь: прочитано + потеряно == записано, курсор в конце
+ *     равен голове буфера.
+ * Номера начинаются у 2^32, чтобы проверить переполнение.
+ *
+ * Сборка: цель stress_byte_ring (host/CMakeLists.txt). Код 1 при ошибке.
+ */
+
+#include "byte_ring.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+
+#define STRESS_RING_SIZE    4096
+#define STRESS_TOTAL_BYTES  (256u * 1024 * 1024)
+#define STRESS_RATE         (256.0 * 1024 * 1024)       // Байт/с у писателя
+#define STRESS_SEGMENT      (1024 * 1024)               // Чередование скорости
+#define STRESS_MAX_WRITE    (STRESS_RING_SIZE + 1024)   // Бывает длиннее буфера
+#define STRESS_READERS      4
+#define STRESS_START_SEQ    0xFFF00000u                 // Переполнение номера в середине
+
+static uint8_t storage[STRESS_RING_SIZE];
+static byte_ring_t ring;
+static std::atomic<bool> writer_done(false);
+
+typedef struct {
+    size_t chunk;               // Размер порции чтения
+    bool slow;                  // Пауза после каждого чтения - отставание
+    uint64_t received;
+    uint64_t lost;
+    uint64_t reads;
+    uint64_t errors;
+    uint32_t cursor;
+} reader_t;
+
+static inline uint8_t pattern(uint32_t seq)
+{
+    return (uint8_t)((seq * 2654435761u) >> 24);
+}
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void writer(void)
+{
+    static uint8_t chunk[STRESS_MAX_WRITE];
+    uint32_t seq = STRESS_START_SEQ;
+    uint32_t rnd = 1;
+    uint64_t written = 0;
+    uint64_t paced = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (written < STRESS_TOTAL_BYTES) {
+        rnd = rnd * 1103515245u + 12345u;
+        // В основном короткие порции, изредка - длиннее буфера
+        size_t n = (rnd >> 16) % 16 == 0 ? STRESS_MAX_WRITE - (rnd >> 8) % 256
+                                          : 1 + (rnd >> 16) % 300;
+        if (n > STRESS_TOTAL_BYTES - written) {
+            n = (size_t)(STRESS_TOTAL_BYTES - written);
+        }
+        for (size_t k = 0; k < n; k++) {
+            chunk[k] = pattern(seq + (uint32_t)k);
+        }
+        byte_ring_write(&ring, chunk, n);
+        seq += (uint32_t)n;
+        written += n;
+        // Сегменты чередуются: с ограниченной скоростью быстрые читатели
+        // в основном успевают (проверяется непрерывная выдача), без
+        // ограничения - обгон читателей и чтение посреди записи
+        if ((written / STRESS_SEGMENT) % 2 == 0) {
+            paced += n;
+            while ((double)paced > elapsed(start) * STRESS_RATE) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    writer_done.store(true, std::memory_order_release);
+}
+
+static bool read_once(reader_t *r, uint8_t *buf)
+{
+    uint32_t before = r->cursor;
+    uint32_t lost = 0;
+    size_t n = byte_ring_read(&ring, &r->cursor, buf, r->chunk, &lost);
+    r->reads++;
+
+    if ((uint32_t)(before + lost + (uint32_t)n) != r->cursor) {
+        if (r->errors++ < 5) {
+            printf("  FAIL: cursor %08x + lost %u + %zu != %08x\n",
+                   before, lost, n, r->cursor);
+        }
+    }
+    uint32_t first = r->cursor - (uint32_t)n;
+    for (size_t k = 0; k < n; k++) {
+        if (buf[k] != pattern(first + (uint32_t)k)) {
+            if (r->errors++ < 5) {
+                printf("  FAIL: byte %08x is %02x, expected %02x\n",
+                       first + (uint32_t)k, buf[k], pattern(first + (uint32_t)k));
+            }
+            break;
+        }
+    }
+    r->received += n;
+    r->lost += lost;
+    return n > 0 || lost > 0;
+}
+
+static void reader(reader_t *r)
+{
+    std::vector<uint8_t> buf(r->chunk);
+    while (!writer_done.load(std::memory_order_acquire)) {
+        if (!read_once(r, buf.data())) {
+            std::this_thread::yield();
+        }
+        if (r->slow) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+    // Писатель закончил - дочитываем до головы
+    while (read_once(r, buf.data())) {
+    }
+}
+
+int main(void)
+{
+    byte_ring_init(&ring, storage, sizeof(storage));
+    byte_ring_restore(&ring, STRESS_START_SEQ, STRESS_START_SEQ);
+
+    static reader_t readers[STRESS_READERS] = {
+        { 1, false, 0, 0, 0, 0, 0 },
+        { 97, false, 0, 0, 0, 0, 0 },
+        { STRESS_RING_SIZE, false, 0, 0, 0, 0, 0 },
+        { 512, true, 0, 0, 0, 0, 0 },
+    };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < STRESS_READERS; i++) {
+        readers[i].cursor = STRESS_START_SEQ;
+        threads.emplace_back(reader, &readers[i]);
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::thread write_thread(writer);
+    write_thread.join();
+    for (auto &t : threads) {
+        t.join();
+    }
+    double seconds = elapsed(start);
+
+    uint32_t head = byte_ring_head(&ring);
+    int failures = 0;
+    for (int i = 0; i < STRESS_READERS; i++) {
+        reader_t *r = &readers[i];
+        if (r->received + r->lost != STRESS_TOTAL_BYTES) {
+            printf("  FAIL: reader %d: received %llu + lost %llu != %u written\n", i,
+                   (unsigned long long)r->received, (unsigned long long)r->lost,
+                   STRESS_TOTAL_BYTES);
+            r->errors++;
+        }
+        if (r->cursor != head) {
+            printf("  FAIL: reader %d: cursor %08x, head %08x\n", i, r->cursor, head);
+            r->errors++;
+        }
+        printf("reader %d (%4zu byte chunks%s): %llu reads, received %llu, lost %llu, "
+               "errors %llu\n", i, r->chunk, r->slow ? ", slow" : "",
+               (unsigned long long)r->reads, (unsigned long long)r->received,
+               (unsigned long long)r->lost, (unsigned long long)r->errors);
+        failures += r->errors != 0;
+    }
+    printf("byte_ring: %u MB in %.2f s, %d readers: %s\n", STRESS_TOTAL_BYTES >> 20, seconds,
+           STRESS_READERS, failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,32 @@
+/**
+ * @file trigger_store_host.cpp
+ * @brief Хранение образцов триггеров для сборки под Linux
+ *
+ * NVS нет: набор живет в памяти процесса, чтобы /api/triggers можно было
+ * проверить без устройства.
+ */
+
+#include "trigger_store.h"
+
+#include <mutex>
+
+static std::mutex lock;
+static trigger_config_t stored;
+static bool has_stored = false;
+
+bool trigger_store_load(trigger_config_t *config)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (has_stored) {
+        *config = stored;
+    }
+    return has_stored;
+}
+
+bool trigger_store_save(const trigger_config_t *config)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    stored = *config;
+    has_stored = true;
+    return true;
+}
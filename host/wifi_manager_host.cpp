@@ -0,0 +1,119 @@
+/**
+ * @file wifi_manager_host.cpp
+ * @brief Реализация wifi_manager для сборки под Linux
+ *
+ * Радио нет: конфигурация хранится в памяти и проверяется общим
+ * wifi_config.cpp, станция считается подключенной сразу (адрес 127.0.0.1),
+ * чтобы /api/wifi можно было проверить без устройства.
+ */
+
+#include "wifi_manager.h"
+
+#include <string.h>
+#include <mutex>
+
+static std::mutex lock;
+static wifi_manager_config_t config;
+static wifi_manager_info_t info;
+
+/**
+ * Состояние станции по режиму (под lock)
+ */
+static void update_info(void)
+{
+    if (config.mode == WIFI_MANAGER_AP) {
+        info.status = WIFI_STATUS_DISCONNECTED;
+        info.ip[0] = '\0';
+        return;
+    }
+    if (info.status != WIFI_STATUS_CONNECTED) {
+        info.connects++;
+    }
+    info.status = WIFI_STATUS_CONNECTED;
+    strcpy(info.ip, "127.0.0.1");
+    info.channel = config.ap_channel;
+}
+
+bool wifi_manager_init(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    wifi_manager_default_config(&config);
+    update_info();
+    return true;
+}
+
+bool wifi_setup_ap(const char *ssid, const char *password)
+{
+    wifi_manager_config_t cfg;
+    wifi_manager_get_config(&cfg);
+    if (strlen(ssid) >= sizeof(cfg.ap_ssid) || strlen(password) >= sizeof(cfg.ap_password)) {
+        return false;
+    }
+    strcpy(cfg.ap_ssid, ssid);
+    strcpy(cfg.ap_password, password);
+    if (cfg.mode == WIFI_MANAGER_STA) {
+        cfg.mode = WIFI_MANAGER_APSTA;
+    }
+    return wifi_reconfigure(&cfg);
+}
+
+bool wifi_connect_station(const char *ssid, const char *password)
+{
+    wifi_manager_config_t cfg;
+    wifi_manager_get_config(&cfg);
+    if (strlen(ssid) >= sizeof(cfg.ssid) || strlen(password) >= sizeof(cfg.password)) {
+        return false;
+    }
+    strcpy(cfg.ssid, ssid);
+    strcpy(cfg.password, password);
+    if (cfg.mode == WIFI_MANAGER_AP) {
+        cfg.mode = WIFI_MANAGER_APSTA;
+    }
+    return wifi_reconfigure(&cfg);
+}
+
+wifi_status_t wifi_get_status(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return info.status;
+}
+
+bool wifi_get_ip_address(char *ip_str)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    strcpy(ip_str, info.status == WIFI_STATUS_CONNECTED ? info.ip : "127.0.0.1");
+    return true;
+}
+
+void wifi_disconnect(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (info.status == WIFI_STATUS_CONNECTED) {
+        info.disconnects++;
+    }
+    info.status = WIFI_STATUS_DISCONNECTED;
+    info.ip[0] = '\0';
+}
+
+bool wifi_reconfigure(const wifi_manager_config_t *new_config)
+{
+    if (!wifi_manager_config_valid(new_config)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    config = *new_config;
+    update_info();
+    return true;
+}
+
+void wifi_manager_get_config(wifi_manager_config_t *out)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    *out = config;
+}
+
+void wifi_manager_get_info(wifi_manager_info_t *out)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    *out = info;
+}
@@ -0,0 +1,143 @@
+/**
+ * @file batch_policy.h
+ * @brief Политика пакетирования отправки данных RS-232 клиентам
+ *
+ * Каждая мелкая порция UART, отправленная отдельным ответом HTTP, кадром
+ * WebSocket или сегментом TCP, занимает эфир радио; слишком долгое
+ * накопление добавляет задержку. Для каждого транспорта задаются режим и
+ * пороги:
+ * - BATCH_MODE_IMMEDIATE: отправлять сразу (TCP_NODELAY, малый буфер сокета);
+ * - BATCH_MODE_FIXED: копить до max_bytes байт, но не дольше max_delay_us;
+ * - BATCH_MODE_ADAPTIVE: ждать столько, сколько по наблюдаемой скорости
+ *   поступления нужно для набора max_bytes (не дольше max_delay_us); при
+ *   редких порциях (интервал больше max_delay_us) - отправлять сразу;
+ * - BATCH_MODE_NAGLE: отправлять сразу, объединение - алгоритмом Нейгла
+ *   стека TCP (TCP_NODELAY снят, большой буфер сокета).
+ * С flush_on_frame завершенный кадр (framer.h) отправляется без ожидания.
+ *
+ * Значения по умолчанию - BATCH_* в config.h, на лету - POST /api/batch.
+ */
+
+#ifndef BATCH_POLICY_H
+#define BATCH_POLICY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "fanout.h"
+
+typedef enum {
+    BATCH_MODE_IMMEDIATE = 0,
+    BATCH_MODE_FIXED,
+    BATCH_MODE_ADAPTIVE,
+    BATCH_MODE_NAGLE,
+    BATCH_MODE_COUNT,
+} batch_mode_t;
+
+/**
+ * @brief Параметры пакетирования транспорта
+ */
+typedef struct {
+    batch_mode_t mode;
+    uint32_t max_bytes;             // Отправить при накоплении стольких байт
+    uint32_t max_delay_us;          // Предельное ожидание первого неотправленного байта
+    bool flush_on_frame;            // Отправлять сразу по завершении кадра
+} batch_config_t;
+
+/**
+ * @brief Наблюдаемая скорость поступления данных с UART
+ */
+typedef struct {
+    uint32_t interval_us;           // Средний интервал между порциями
+    uint32_t chunk_bytes;           // Средний размер порции
+} batch_rate_t;
+
+/**
+ * @brief Статистика отправки транспорта
+ */
+typedef struct {
+    uint32_t packets;               // Отправок с данными (ответов, кадров, send())
+    uint32_t bytes;                 // Отправлено байт данных
+} batch_stats_t;
+
+/**
+ * @brief Инициализация параметров и метрик (повторные вызовы игнорируются)
+ */
+void batch_init(void);
+
+/**
+ * @brief Установка параметров транспорта
+ *
+ * @return false если параметры недопустимы
+ */
+bool batch_set_config(fanout_transport_t transport, const batch_config_t *config);
+
+/**
+ * @brief Текущие параметры транспорта
+ */
+void batch_get_config(fanout_transport_t transport, batch_config_t *config);
+
+/**
+ * @brief Номер версии параметров (меняется при каждой установке)
+ *
+ * Транспорт сравнивает его с запомненным, чтобы заново настроить сокеты.
+ */
+uint32_t batch_config_version(void);
+
+/**
+ * @brief Учет принятой порции (вызывается только писателем буфера)
+ *
+ * @param length Длина порции
+ * @param now_us Время приема, мкс
+ */
+void batch_observe(size_t length, int64_t now_us);
+
+/**
+ * @brief Текущая оценка скорости поступления
+ */
+void batch_get_rate(batch_rate_t *rate);
+
+/**
+ * @brief Решение об отправке накопленных данных
+ *
+ * @param transport Транспорт
+ * @param pending Неотправленных байт
+ * @param frame_ready Среди неотправленных есть завершенный кадр
+ * @param pending_since_us Время появления первого неотправленного байта
+ * @param now_us Текущее время
+ * @return 0 - отправить сейчас, иначе мкс до следующей проверки
+ */
+uint32_t batch_wait_us(fanout_transport_t transport, uint32_t pending, bool frame_ready,
+                       int64_t pending_since_us, int64_t now_us);
+
+/**
+ * @brief Учет отправки с данными (для статистики и метрик)
+ */
+void batch_sent(fanout_transport_t transport, uint32_t bytes);
+
+/**
+ * @brief Статистика отправки транспорта
+ */
+void batch_get_stats(fanout_transport_t transport, batch_stats_t *stats);
+
+/**
+ * @brief Настройка сокета клиента по режиму транспорта (TCP_NODELAY, SO_SNDBUF)
+ *
+ * @param transport Транспорт
+ * @param sock Сокет
+ */
+void batch_apply_socket(fanout_transport_t transport, int sock);
+
+/**
+ * @brief Имя режима (immediate, fixed, adaptive, nagle)
+ */
+const char *batch_mode_name(batch_mode_t mode);
+
+/**
+ * @brief Разбор имени режима
+ *
+ * @return true если имя известно
+ */
+bool batch_parse_mode(const char *name, batch_mode_t *mode);
+
+#endif // BATCH_POLICY_H
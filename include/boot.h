@@ -0,0 +1,88 @@
+/**
+ * @file boot.h
+ * @brief Отметки времени загрузки (/api/boot)
+ *
+ * Каждый этап запуска отмечается один раз временем esp_timer (мкс от
+ * старта приложения; время загрузчика не входит). Главная величина -
+ * время до первой отправки принятых данных клиенту (first_forward),
+ * ее сравнивают между версиями прошивки.
+ *
+ * Запись хранится в памяти noinit и переживает программный сброс
+ * (паника, сторожевой таймер, esp_restart): после такого сброса доступна
+ * запись предыдущего запуска вместе с причиной сброса.
+ */
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Этапы загрузки
+ */
+typedef enum {
+    BOOT_STAGE_APP_MAIN = 0,        // Вход в app_main
+    BOOT_STAGE_UART_READY,          // Драйвер UART настроен
+    BOOT_STAGE_CAPTURE_STARTED,     // Задача приема запущена: данные копятся в буфере
+    BOOT_STAGE_NVS_READY,
+    BOOT_STAGE_WIFI_STARTED,        // esp_wifi_start() выполнен
+    BOOT_STAGE_HTTPD_STARTED,
+    BOOT_STAGE_TCP_STARTED,
+    BOOT_STAGE_INIT_DONE,           // app_main завершен
+    BOOT_STAGE_NETWORK_UP,          // Станция получила адрес или к точке подключился клиент
+    BOOT_STAGE_FIRST_RX,            // Первые байты приняты с линии
+    BOOT_STAGE_FIRST_FORWARD,       // Первые данные отправлены клиенту
+    BOOT_STAGE_COUNT
+} boot_stage_t;
+
+/**
+ * @brief Запись одного запуска
+ */
+typedef struct {
+    uint32_t boot_count;            // Запусков с включения питания
+    uint32_t reset_reason;          // esp_reset_reason_t
+    uint32_t carried_bytes;         // Байт буфера моста, переживших сброс
+    uint32_t stage_us[BOOT_STAGE_COUNT];    // Время этапа, мкс (0 - не достигнут)
+} boot_record_t;
+
+/**
+ * @brief Начало записи запуска (первым в app_main)
+ *
+ * Сохраняет запись предыдущего запуска, если она пережила сброс, и
+ * отмечает BOOT_STAGE_APP_MAIN.
+ */
+void boot_begin(void);
+
+/**
+ * @brief Отметка этапа (повторные отметки игнорируются)
+ *
+ * Дешева после первой отметки: вызывается и из горячих путей.
+ */
+void boot_mark(boot_stage_t stage);
+
+/**
+ * @brief Число байт буфера моста, переживших сброс
+ */
+void boot_set_carried(uint32_t bytes);
+
+/**
+ * @brief Текущая запись и запись предыдущего запуска
+ *
+ * @param current Текущий запуск (выход)
+ * @param previous Предыдущий запуск (выход, может быть NULL)
+ * @return true если запись предыдущего запуска пережила сброс
+ */
+bool boot_get_records(boot_record_t *current, boot_record_t *previous);
+
+/**
+ * @brief Название этапа ("app_main", "first_forward", ...)
+ */
+const char *boot_stage_name(boot_stage_t stage);
+
+/**
+ * @brief Название причины сброса ("poweron", "panic", "task_wdt", ...)
+ */
+const char *boot_reset_reason_name(uint32_t reason);
+
+#endif // BOOT_H
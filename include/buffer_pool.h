@@ -0,0 +1,58 @@
+/**
+ * @file buffer_pool.h
+ * @brief Пул блоков фиксированного размера для буферов ответов (/api/memory)
+ *
+ * BUFFER_POOL_BLOCKS блоков по BUFFER_POOL_BLOCK_SIZE байт в статической
+ * памяти. Обработчик берет блок на время ответа и возвращает его по
+ * окончании, поэтому крупные буферы не лежат на стеке задачи и куча не
+ * фрагментируется. Свободные блоки - битовая маска, взятие и возврат -
+ * одна атомарная операция без блокировок (можно из любой задачи).
+ *
+ * Пул исчерпан - buffer_pool_borrow возвращает NULL и увеличивает
+ * счетчик exhausted (comtoair_buffer_pool_exhausted_total); наибольшее
+ * число занятых блоков с запуска показывает запас.
+ */
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "config.h"
+
+/**
+ * @brief Состояние пула
+ */
+typedef struct {
+    uint32_t block_size;
+    uint32_t blocks;
+    uint32_t in_use;            // Занято сейчас
+    uint32_t peak;              // Наибольшее число занятых с запуска
+    uint32_t borrows;           // Выдано блоков
+    uint32_t exhausted;         // Отказов: свободных блоков не было
+} buffer_pool_stats_t;
+
+/**
+ * @brief Регистрация метрик пула (пул работает и без нее)
+ */
+void buffer_pool_init(void);
+
+/**
+ * @brief Взять блок (BUFFER_POOL_BLOCK_SIZE байт)
+ *
+ * @return Блок или NULL, если свободных нет
+ */
+void *buffer_pool_borrow(void);
+
+/**
+ * @brief Вернуть блок, взятый buffer_pool_borrow (NULL допускается)
+ */
+void buffer_pool_return(void *block);
+
+/**
+ * @brief Состояние пула
+ */
+void buffer_pool_get_stats(buffer_pool_stats_t *stats);
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,139 @@
+/**
+ * @file byte_ring.h
+ * @brief Кольцевой буфер байтов без блокировок (один писатель, много читателей)
+ *
+ * Писатель (задача чтения UART) никогда не ждет читателей: старые данные
+ * перезаписываются. Каждый читатель хранит собственный курсор - порядковый
+ * номер следующего байта, который он хочет получить. Если курсор отстал
+ * больше чем на размер буфера, читатель узнает, сколько байт потеряно.
+ *
+ * Порядковые номера 32-битные и сравниваются по модулю 2^32, поэтому
+ * все операции остаются lock-free на RV32 (ESP32-C6).
+ */
+
+#ifndef BYTE_RING_H
+#define BYTE_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <atomic>
+
+/**
+ * @brief Состояние кольцевого буфера
+ */
+typedef struct {
+    uint8_t *storage;               // Память буфера (размер - степень двойки)
+    uint32_t size;                  // Размер буфера
+    uint32_t mask;                  // size - 1
+    uint32_t base;                  // Самый старый байт, пока буфер не заполнен (0 или восстановлен)
+    std::atomic<uint32_t> head;     // Номер следующего байта (опубликовано)
+    std::atomic<uint32_t> reserve;  // Граница записи, которая идет сейчас
+    std::atomic<bool> filled;       // Буфер хотя бы раз заполнен целиком
+} byte_ring_t;
+
+/**
+ * @brief Статическая инициализация буфера над массивом storage
+ *
+ * Позволяет пользоваться буфером до запуска задач без отдельного вызова
+ * byte_ring_init(). Размер массива должен быть степенью двойки.
+ */
+#define BYTE_RING_STATIC_INIT(storage) \
+    { (storage), sizeof(storage), sizeof(storage) - 1, 0, {0}, {0}, {false} }
+
+/**
+ * @brief Инициализация буфера
+ *
+ * @param ring Буфер
+ * @param storage Память под данные
+ * @param size Размер памяти (должен быть степенью двойки)
+ * @return true при успешной инициализации, false если размер не степень двойки
+ */
+bool byte_ring_init(byte_ring_t *ring, uint8_t *storage, size_t size);
+
+/**
+ * @brief Восстановление буфера над памятью, сохранившей данные
+ *
+ * Память storage пережила перезапуск (секция noinit): байты [oldest, head)
+ * снова доступны читателям под прежними номерами. Вызывается до первой
+ * записи и до запуска читателей.
+ *
+ * @param ring Буфер (инициализирован над той же памятью)
+ * @param oldest Номер самого старого сохранившегося байта
+ * @param head Номер следующего байта
+ * @return false если диапазон больше размера буфера
+ */
+bool byte_ring_restore(byte_ring_t *ring, uint32_t oldest, uint32_t head);
+
+/**
+ * @brief Запись данных (вызывается только одним писателем)
+ *
+ * Если length больше размера буфера, сохраняются последние size байт,
+ * но порядковый номер продвигается на полную длину.
+ *
+ * @param ring Буфер
+ * @param data Данные
+ * @param length Длина данных
+ */
+void byte_ring_write(byte_ring_t *ring, const uint8_t *data, size_t length);
+
+/**
+ * @brief Чтение данных начиная с курсора
+ *
+ * Курсор продвигается на количество прочитанных и потерянных байт.
+ * Курсор "из будущего" (например, сохраненный клиентом до перезагрузки)
+ * переводится на самый старый доступный байт.
+ *
+ * @param ring Буфер
+ * @param cursor Порядковый номер следующего байта для этого читателя
+ * @param buffer Буфер для данных
+ * @param length Размер буфера
+ * @param lost Количество байт, перезаписанных до чтения (может быть NULL)
+ * @return Количество прочитанных байт
+ */
+size_t byte_ring_read(const byte_ring_t *ring, uint32_t *cursor,
+                      uint8_t *buffer, size_t length, uint32_t *lost);
+
+/**
+ * @brief Чтение ровно length байт с позиции seq
+ *
+ * @return true если все байты были доступны и не перезаписаны во время чтения
+ */
+bool byte_ring_read_at(const byte_ring_t *ring, uint32_t seq,
+                       uint8_t *buffer, size_t length);
+
+/**
+ * @brief Доступ к данным без копирования
+ *
+ * Возвращает указатель на непрерывный участок памяти буфера, начиная с seq
+ * (до головы или до конца памяти буфера). После использования данных
+ * нужно проверить byte_ring_still_valid(): писатель мог их перезаписать.
+ *
+ * @param ring Буфер
+ * @param seq Порядковый номер первого байта
+ * @param data Указатель на данные (выход)
+ * @return Длина участка, 0 если данных нет или seq уже перезаписан
+ */
+size_t byte_ring_peek(const byte_ring_t *ring, uint32_t seq, const uint8_t **data);
+
+/**
+ * @brief Проверка, что байты начиная с seq еще не перезаписаны
+ */
+bool byte_ring_still_valid(const byte_ring_t *ring, uint32_t seq);
+
+/**
+ * @brief Порядковый номер следующего записываемого байта
+ */
+uint32_t byte_ring_head(const byte_ring_t *ring);
+
+/**
+ * @brief Порядковый номер самого старого доступного байта
+ */
+uint32_t byte_ring_oldest(const byte_ring_t *ring);
+
+/**
+ * @brief Количество байт между курсором и головой буфера
+ */
+uint32_t byte_ring_pending(const byte_ring_t *ring, uint32_t cursor);
+
+#endif // BYTE_RING_H
@@ -0,0 +1,146 @@
+/**
+ * @file capture_format.h
+ * @brief Двоичный формат выгрузки принятых данных (application/octet-stream)
+ *
+ * JSON со строкой примерно вдвое раздувает текстовые данные, а двоичные
+ * требует кодировать в base64. Двоичный поток несет записи как есть:
+ *
+ *   Поток:   "CTAB" | версия u8 (1) | вид u8 | блоки... | конец | хвост
+ *   Блок:    кодек u8 | varint длина данных | [varint длина сжатых] | байты
+ *   Конец:   кодек 0, длина 0
+ *   Хвост:   varint next | varint head | varint lost | varint now_us
+ *
+ * Кодек 0 - данные блока как есть, 1 - сжатие LZ4 (формат блока LZ4,
+ * каждый блок независим, окно - только сам блок). Блок, который не
+ * сжимается, всегда хранится как есть. Распакованные блоки подряд дают
+ * содержимое потока:
+ * - CAPTURE_KIND_RECORDS, CAPTURE_KIND_BYTES - записи:
+ *     varint seq_delta | zigzag varint ts_delta | varint (length << 2 | flags) | данные
+ *   seq_delta - отличие номера от ожидаемого (предыдущий + 1 для записей
+ *   журнала, предыдущий + длина для байтов буфера; для первой записи
+ *   ожидается 0), ненулевое значение - пропуск. ts_delta - время приема
+ *   (мкс от запуска) относительно предыдущей записи. flags - FRAMER_FLAG_*.
+ *   Запись не пересекает границу блока.
+ * - CAPTURE_KIND_RAW - байты без разметки (выгрузка из флеш).
+ *
+ * Хвост: next - номер для продолжения (since), head - номер следующей
+ * записи/байта на устройстве, lost - пропущено байт (для /api/data),
+ * now_us - время устройства; для CAPTURE_KIND_RAW next - длина потока.
+ * Обрыв до хвоста означает неполный ответ.
+ *
+ * Модуль не зависит от ESP-IDF и собирается также под Linux (host/).
+ * Эталонный декодер - tools/capture_decode.py.
+ */
+
+#ifndef CAPTURE_FORMAT_H
+#define CAPTURE_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "config.h"
+
+#define CAPTURE_FORMAT_VERSION      1
+
+// Место перед данными блока под заголовок потока и блока
+#define CAPTURE_FORMAT_RESERVE      20
+
+// Наибольший размер сжатого блока (LZ4: на 255 байт - байт длины)
+#define CAPTURE_LZ_BOUND(n)         ((n) + (n) / 255 + 16)
+
+#define CAPTURE_CODEC_STORED        0
+#define CAPTURE_CODEC_LZ4           1
+
+typedef enum {
+    CAPTURE_KIND_RECORDS = 0,       // Записи журнала (номер - номер записи)
+    CAPTURE_KIND_BYTES,             // Участки буфера (номер - номер первого байта)
+    CAPTURE_KIND_RAW,               // Байты без разметки
+} capture_kind_t;
+
+/**
+ * @brief Функция вывода готового фрагмента
+ *
+ * @return true при успехе; после false кодировщик перестает выводить данные
+ */
+typedef bool (*capture_flush_fn)(void *ctx, const uint8_t *data, size_t length);
+
+/**
+ * @brief Рабочая память сжатия (CAPTURE_FORMAT_BLOCK_SIZE блок)
+ */
+typedef struct {
+    uint16_t hash[1 << CAPTURE_LZ_HASH_BITS];
+    uint8_t out[CAPTURE_FORMAT_RESERVE + CAPTURE_LZ_BOUND(CAPTURE_FORMAT_BLOCK_SIZE)];
+} capture_lz_state_t;
+
+/**
+ * @brief Состояние кодировщика
+ */
+typedef struct {
+    uint8_t *buf;                   // CAPTURE_FORMAT_RESERVE + размер блока
+    size_t block_size;
+    size_t block_len;               // Заполнено байт блока
+    capture_lz_state_t *lz;         // NULL - без сжатия
+    capture_flush_fn flush;
+    void *ctx;
+    capture_kind_t kind;
+    uint32_t next_seq;              // Ожидаемый номер следующей записи
+    uint64_t last_ts;
+    bool header_sent;
+    bool failed;
+    uint32_t raw_bytes;             // Байт до сжатия (с разметкой записей)
+    uint32_t out_bytes;             // Байт выведено
+} capture_encoder_t;
+
+/**
+ * @brief Инициализация кодировщика
+ *
+ * @param enc Кодировщик
+ * @param kind Вид содержимого
+ * @param buf Буфер блока: CAPTURE_FORMAT_RESERVE + block_size байт
+ * @param block_size Размер блока, не больше CAPTURE_FORMAT_BLOCK_SIZE при сжатии
+ * @param lz Память сжатия или NULL
+ * @param flush Функция вывода
+ * @param ctx Контекст функции вывода
+ */
+void capture_encoder_init(capture_encoder_t *enc, capture_kind_t kind, uint8_t *buf,
+                          size_t block_size, capture_lz_state_t *lz,
+                          capture_flush_fn flush, void *ctx);
+
+/**
+ * @brief Запись (CAPTURE_KIND_RECORDS, CAPTURE_KIND_BYTES)
+ *
+ * @param length Не больше block_size - 20
+ */
+void capture_encoder_record(capture_encoder_t *enc, uint32_t seq, uint64_t timestamp_us,
+                            uint32_t flags, const uint8_t *data, size_t length);
+
+/**
+ * @brief Байты без разметки (CAPTURE_KIND_RAW), любой длины
+ */
+void capture_encoder_write(capture_encoder_t *enc, const uint8_t *data, size_t length);
+
+/**
+ * @brief Вывод последнего блока, конца потока и хвоста
+ *
+ * @return false если при выводе была ошибка
+ */
+bool capture_encoder_finish(capture_encoder_t *enc, uint32_t next, uint32_t head,
+                            uint32_t lost, uint64_t now_us);
+
+/**
+ * @brief Сжатие блока в формат блока LZ4
+ *
+ * @param hash Таблица 1 << CAPTURE_LZ_HASH_BITS элементов
+ * @return Длина сжатых данных, 0 если не помещаются в capacity
+ */
+size_t capture_lz_compress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity,
+                           uint16_t *hash);
+
+/**
+ * @brief Распаковка блока LZ4
+ *
+ * @return Длина распакованных данных, SIZE_MAX при ошибке формата
+ */
+size_t capture_lz_decompress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity);
+
+#endif // CAPTURE_FORMAT_H
@@ -0,0 +1,105 @@
+/**
+ * @file capture_journal.h
+ * @brief Журнал принятых порций данных с метками времени
+ *
+ * Каждая порция, принятая с RS-232, сохраняется отдельной записью:
+ * порядковый номер записи, время приема (мкс, esp_timer) и длина.
+ * Данные записей лежат в кольцевой арене фиксированного размера
+ * (CAPTURE_ARENA_SIZE), заголовки - в кольце CAPTURE_MAX_RECORDS записей,
+ * поэтому при записи память не выделяется, а расход ограничен при сборке.
+ *
+ * При включенном выделении кадров (framer.h) запись - один кадр со временем
+ * приема его первого байта.
+ *
+ * Один писатель (web_server_set_data), читатели без блокировок: запись,
+ * перезаписанная во время чтения, отдается как пропуск (gap).
+ */
+
+#ifndef CAPTURE_JOURNAL_H
+#define CAPTURE_JOURNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "config.h"
+
+/**
+ * @brief Заголовок записи журнала
+ */
+typedef struct {
+    uint32_t seq;               // Порядковый номер записи
+    uint32_t length;            // Длина данных (не больше CAPTURE_MAX_CHUNK)
+    uint32_t flags;             // FRAMER_FLAG_* для кадров, 0 для порций
+    uint64_t timestamp_us;      // Время приема (первого байта кадра), мкс от запуска
+} capture_record_t;
+
+/**
+ * @brief Результат чтения записи
+ */
+typedef enum {
+    CAPTURE_READ_OK = 0,        // Запись прочитана
+    CAPTURE_READ_END,           // Записи с таким номером еще нет
+    CAPTURE_READ_GAP,           // Запись уже перезаписана
+} capture_read_result_t;
+
+/**
+ * @brief Статистика журнала
+ */
+typedef struct {
+    uint32_t head;              // Номер следующей записи
+    uint32_t oldest;            // Номер самой старой доступной записи
+    uint32_t bytes_total;       // Всего записано байт данных
+    uint32_t arena_size;        // Размер арены данных
+    uint32_t max_records;       // Емкость кольца заголовков
+} capture_journal_stats_t;
+
+/**
+ * @brief Добавление принятых данных (вызывается только одним писателем)
+ *
+ * Порции длиннее CAPTURE_MAX_CHUNK делятся на несколько записей
+ * с одинаковым временем.
+ *
+ * @param data Данные
+ * @param length Длина данных
+ * @param timestamp_us Время приема, мкс
+ */
+void capture_journal_append(const uint8_t *data, size_t length, uint64_t timestamp_us);
+
+/**
+ * @brief Добавление кадра одной записью (вызывается только одним писателем)
+ *
+ * @param data Данные кадра, не больше CAPTURE_MAX_CHUNK байт
+ * @param length Длина данных
+ * @param timestamp_us Время приема первого байта кадра, мкс
+ * @param flags FRAMER_FLAG_*
+ */
+void capture_journal_append_frame(const uint8_t *data, size_t length, uint64_t timestamp_us,
+                                  uint32_t flags);
+
+/**
+ * @brief Чтение записи по номеру
+ *
+ * @param seq Номер записи
+ * @param record Заголовок записи (выход)
+ * @param buffer Буфер для данных, не меньше CAPTURE_MAX_CHUNK байт
+ * @return Результат чтения
+ */
+capture_read_result_t capture_journal_read(uint32_t seq, capture_record_t *record,
+                                           uint8_t *buffer);
+
+/**
+ * @brief Номер следующей записи
+ */
+uint32_t capture_journal_head(void);
+
+/**
+ * @brief Номер самой старой записи, данные которой еще не перезаписаны
+ */
+uint32_t capture_journal_oldest(void);
+
+/**
+ * @brief Получение статистики журнала
+ */
+void capture_journal_get_stats(capture_journal_stats_t *stats);
+
+#endif // CAPTURE_JOURNAL_H
@@ -20,23 +20,250 @@
 #define UART_BUF_SIZE       1024
 #define UART_BAUD_RATE      115200
 
-// Конфигурация WiFi
-#define WIFI_SSID_DEFAULT   "ComToAir_AP"
+// Приемный тракт UART (по событиям драйвера)
+#define UART_RX_RING_SIZE       (UART_BUF_SIZE * 4)  // Кольцевой буфер драйвера
+#define UART_EVENT_QUEUE_LEN    32      // Длина очереди событий драйвера
+#define UART_RX_FULL_THRESH     64      // Прерывание при заполнении FIFO (байт)
+#define UART_RX_TIMEOUT_SYMBOLS 2       // Прерывание после паузы в линии (символов)
+// #define UART_RX_PATTERN_CHR  '\n'    // Детектор шаблона (UART_PATTERN_DET)
+
+// Передача в UART (uart_tx.h, POST /api/send). Память очереди:
+// UART_TX_QUEUE_LEN * UART_TX_MAX_PAYLOAD байт
+#define UART_TX_RING_SIZE           1024    // Кольцевой буфер передачи драйвера (больше FIFO, 128)
+#define UART_TX_QUEUE_LEN           8       // Посылок в очереди
+#define UART_TX_MAX_PAYLOAD         512     // Наибольшая посылка (байт)
+#define UART_TX_RESULTS             16      // Хранимых результатов посылок (степень двойки)
+#define UART_TX_RESPONSE_IDLE_MS    20      // Пауза на линии, завершающая ответ (без кадров)
+#define UART_TX_MAX_TIMEOUT_MS      10000   // Наибольшее ожидание ответа
+#define UART_TX_MAX_CHAR_GAP_US     100000  // Наибольшая пауза между байтами
+#define UART_TX_MAX_FRAME_GAP_MS    10000   // Наибольшая пауза после посылки
+#define UART_TX_SPIN_MAX_US         500     // Паузы не длиннее - без отдачи процессора
+
+// Допустимые параметры RS-232 (смена на лету через API и RFC 2217)
+#define RS232_MIN_BAUD_RATE     300
+#define RS232_MAX_BAUD_RATE     5000000
+
+// Прием через UHCI/GDMA вместо драйвера UART (для скоростей 2-5 Мбод)
+#define RS232_USE_UHCI_DMA      0
+#define RS232_DMA_BUF_SIZE      4096    // Размер каждого из двух буферов приема DMA
+#define RS232_DMA_TX_SIZE       512     // Буфер передачи DMA
+#define RS232_DMA_QUEUE_LEN     16      // Очередь принятых порций из прерывания
+
+// Дополнительные порты (serial_port.h, /api/ports/{n}). Порт 0 - основной
+// UART выше со всеми транспортами; порты 1..SERIAL_PORT_COUNT-1 - только HTTP.
+// UART0 свободен: консоль прошивки на USB-Serial-JTAG (sdkconfig)
+#define SERIAL_PORT_COUNT           2       // Всего портов, включая основной (1..3)
+#define SERIAL_PORT1_UART           UART_NUM_0
+#define SERIAL_PORT1_TX_PIN         GPIO_NUM_16     // D6
+#define SERIAL_PORT1_RX_PIN         GPIO_NUM_17     // D7
+#define SERIAL_PORT2_UART           2               // LP_UART_NUM_0 (выводы LP IO)
+#define SERIAL_PORT2_TX_PIN         5               // GPIO 5 (LP_UART TXD)
+#define SERIAL_PORT2_RX_PIN         4               // GPIO 4 (LP_UART RXD)
+#define SERIAL_PORT_BUFFER_SIZE     8192    // Буфер данных дополнительного порта (степень двойки)
+#define SERIAL_PORT_RX_RING_SIZE    2048    // Кольцевой буфер драйвера дополнительного порта
+#define SERIAL_PORT_TX_RING_SIZE    512
+#define SERIAL_PORT_EVENT_QUEUE_LEN 16
+#define SERIAL_PORT_READ_CHUNK      256     // Байт с порта за проход по кругу
+#define SERIAL_PORT_BUDGET_DEFAULT  0       // Бюджет приема, байт/с (0 - без ограничения)
+#define SERIAL_PORT_BUDGET_BURST_MS 100     // Запас бюджета: прием за столько мс сразу
+#define SERIAL_PORT_THROTTLE_MS     10      // Опрос ограниченного порта
+#define SERIAL_PORT_IDLE_MS         1000    // Ожидание событий без данных
+
+// Конфигурация WiFi по умолчанию (рабочая хранится в NVS, меняется через /api/wifi)
+#define WIFI_SSID_DEFAULT   "ComToAir_AP"   // Точка доступа
 #define WIFI_PASS_DEFAULT   "12345678"
 #define WIFI_MAX_CONN       4
 #define WIFI_CHANNEL        1
+#define WIFI_MODE_DEFAULT       WIFI_MANAGER_AP
+#define WIFI_STA_SSID_DEFAULT   ""              // Сеть для режима станции
+#define WIFI_STA_PASS_DEFAULT   ""
+#define WIFI_PS_DEFAULT         WIFI_MANAGER_PS_NONE    // Без сна радио: наименьшая задержка
+#define WIFI_TX_POWER_DEFAULT   0               // дБм, 0 - по умолчанию драйвера (20)
+#define WIFI_NVS_NAMESPACE      "wifi_mgr"
+
+// Переподключение станции (wifi_manager.h)
+#define WIFI_BACKOFF_MIN_MS         250     // Пауза перед второй попыткой, далее вдвое больше
+#define WIFI_BACKOFF_MAX_MS         30000   // Наибольшая пауза (отказы в подключении)
+#define WIFI_BACKOFF_ABSENT_MAX_MS  500     // Наибольшая пауза, пока точка доступа не видна
+#define WIFI_FULL_SCAN_EVERY        8       // Каждая N-я неудачная попытка - по всем каналам
+#define WIFI_BEACON_TIMEOUT_S       3       // Потеря маяков до отключения (не меньше 3)
+#define WIFI_CONNECT_TIMEOUT_MS     15000   // Ожидание подключения в wifi_connect_station()
 
 // Конфигурация веб-сервера
 #define WEB_SERVER_PORT     80
 #define WEB_SERVER_MAX_URI_LEN 512
+#define WEB_SERVER_MAX_URI_HANDLERS 36  // Обработчиков URI (API + статические файлы)
+
+// WebSocket поток /ws/stream
+#define WS_STREAM_MAX_CLIENTS   4       // Одновременных WebSocket клиентов
+#define WS_FRAME_MAX_SIZE       1024    // Максимальный размер бинарного кадра
+#define WS_BATCH_FRAMES         16      // Режим кадров: отправить сразу при накоплении стольких кадров
+
+// Поток Server-Sent Events /api/events
+#define SSE_MAX_CLIENTS         2       // Одновременных SSE клиентов (каждый держит сокет httpd)
+#define SSE_EVENT_MAX_DATA      512     // Байт данных в одном событии
+#define SSE_RETRY_MS            1000    // Пауза переподключения браузера (поле retry)
+#define SSE_STATUS_DEFAULT_MS   5000    // Период события status (оно же проверка связи)
+#define SSE_STATUS_MIN_MS       500
+#define SSE_STATUS_MAX_MS       60000
+
+// TCP сервер последовательного порта (0 - режим отключен)
+#define TCP_SERIAL_RAW_PORT     4001    // Прозрачный TCP (как ser2net raw)
+#define TCP_SERIAL_RFC2217_PORT 2217    // Telnet с управлением портом (RFC 2217)
+#define TCP_SERIAL_MAX_CLIENTS  2       // Одновременных TCP клиентов
+#define TCP_SERIAL_TX_CHUNK     512     // Копия данных для отправки клиенту (байт на клиента)
+#define TCP_SERIAL_RX_CHUNK     512     // Прием от клиента, ждущий места в очереди передачи (байт на клиента)
+
+// Раздача данных потоковым клиентам (fanout): бюджет отставания, байт, и
+// действие при его превышении - FANOUT_POLICY_GAP или FANOUT_POLICY_DISCONNECT
+#define FANOUT_LAG_MARGIN       1024    // Запас до перезаписи буфера при копировании порции
+#define FANOUT_MIN_LAG_BUDGET   1024
+#define FANOUT_HTTP_LAG_BUDGET  (DATA_BUFFER_SIZE - FANOUT_LAG_MARGIN)
+#define FANOUT_HTTP_LAG_POLICY  FANOUT_POLICY_GAP
+#define FANOUT_WS_LAG_BUDGET    8192
+#define FANOUT_WS_LAG_POLICY    FANOUT_POLICY_GAP
+#define FANOUT_TCP_LAG_BUDGET   (DATA_BUFFER_SIZE - FANOUT_LAG_MARGIN)
+#define FANOUT_TCP_LAG_POLICY   FANOUT_POLICY_GAP
+#define FANOUT_SSE_LAG_BUDGET   8192
+#define FANOUT_SSE_LAG_POLICY   FANOUT_POLICY_GAP
+
+// Пакетирование отправки клиентам (batch_policy.h, /api/batch): режим
+// BATCH_MODE_IMMEDIATE/FIXED/ADAPTIVE/NAGLE, порог объема и предельная задержка
+#define BATCH_HTTP_MODE             BATCH_MODE_ADAPTIVE     // Ожидающие запросы /api/data?wait=
+#define BATCH_HTTP_MAX_BYTES        1024
+#define BATCH_HTTP_MAX_DELAY_US     10000
+#define BATCH_WS_MODE               BATCH_MODE_FIXED
+#define BATCH_WS_MAX_BYTES          256
+#define BATCH_WS_MAX_DELAY_US       20000
+#define BATCH_TCP_MODE              BATCH_MODE_IMMEDIATE
+#define BATCH_TCP_MAX_BYTES         1460    // Один сегмент TCP (MSS)
+#define BATCH_TCP_MAX_DELAY_US      5000
+#define BATCH_SSE_MODE              BATCH_MODE_FIXED
+#define BATCH_SSE_MAX_BYTES         SSE_EVENT_MAX_DATA
+#define BATCH_SSE_MAX_DELAY_US      20000
+#define BATCH_FLUSH_ON_FRAME        true    // Завершенный кадр (framer.h) - без ожидания
+#define BATCH_MAX_DELAY_LIMIT_US    1000000 // Наибольшая задержка, допустимая в /api/batch
+#define BATCH_SNDBUF_LOW_LATENCY    2920    // SO_SNDBUF для immediate/adaptive
+#define BATCH_SNDBUF_THROUGHPUT     11680   // SO_SNDBUF для fixed/nagle
 
 // Размеры буферов
-#define DATA_BUFFER_SIZE    2048
-#define JSON_BUFFER_SIZE    512
+#define DATA_BUFFER_SIZE    16384   // Кольцевой буфер данных RS-232 (степень двойки)
+#define JSON_BUFFER_SIZE    512     // Буфер потоковой записи JSON ответов
+#define API_DATA_DEFAULT_MAX 4096   // Байт данных в ответе /api/data по умолчанию
+#define API_DATA_MAX_WAITERS 2      // Одновременных ожидающих запросов /api/data?wait=
+#define API_DATA_MAX_WAIT_MS 30000  // Наибольшее время ожидания данных запросом
+#define API_SEND_MAX_WAITERS 2      // Одновременных запросов /api/send, ждущих ответа
+#define API_BODY_RECV_RETRIES 3     // Повторов чтения тела запроса после таймаута сокета
+
+// Пул блоков (buffer_pool.h): буферы вывода JSON и порции данных обработчиков
+// HTTP вместо стека задач httpd и http_wait. Каждая занимает до двух блоков
+#define BUFFER_POOL_BLOCK_SIZE  JSON_BUFFER_SIZE    // Байт в блоке
+#define BUFFER_POOL_BLOCKS      6                   // Блоков (не больше 32)
+
+// Журнал принятых порций (/api/history). Память: арена + 24 байта на запись
+#define CAPTURE_ARENA_SIZE  32768   // Данные журнала (степень двойки)
+#define CAPTURE_MAX_RECORDS 512     // Заголовков записей (степень двойки)
+#define CAPTURE_MAX_CHUNK   256     // Максимальная длина одной записи
+#define HISTORY_DEFAULT_MAX 4096    // Байт данных в ответе /api/history по умолчанию
+
+// Двоичная выгрузка (capture_format.h): блок сжимается независимо.
+// Память сжатия: блок + 2^HASH_BITS * 2 байт таблицы + выходной блок
+#define CAPTURE_FORMAT_BLOCK_SIZE   4096    // Несжатых байт в блоке (не больше 65535)
+#define CAPTURE_LZ_HASH_BITS        10      // Размер таблицы поиска совпадений
+#define API_DATA_BINARY_BLOCK       492     // Блок двоичного ответа /api/data (без сжатия; с заголовком - блок пула)
+
+// Выделение кадров из потока (framer.h, /api/framer). Кадр длиннее
+// FRAMER_MAX_FRAME выводится частями; кадры хранятся записями журнала
+#define FRAMER_MAX_FRAME            CAPTURE_MAX_CHUNK
+#define FRAMER_DEFAULT_MODE         FRAMER_NONE
+#define FRAMER_DEFAULT_EOL          FRAMER_EOL_ANY
+#define FRAMER_DEFAULT_FIXED_LENGTH 16
+#define FRAMER_DEFAULT_LEN_OFFSET   0
+#define FRAMER_DEFAULT_LEN_SIZE     1
+#define FRAMER_DEFAULT_LEN_BE       true
+#define FRAMER_DEFAULT_LEN_ADJUST   0
+
+// Декодеры протоколов на пути приема (decoder.h, /api/fields). Последнее
+// значение каждого поля - в таблице FIELD_TABLE_SIZE записей. Пауза сброса
+// кадра больше времени приема UART_RX_FULL_THRESH байт на 9600 бод
+#define DECODER_DEFAULT             "none"  // none, modbus, nmea, tlv - для всех портов
+#define DECODER_STATE_SIZE          320     // Память состояния декодера на порт
+#define DECODER_FRAME_TIMEOUT_MS    100     // Пауза между порциями, сбрасывающая кадр Modbus
+#define DECODER_TLV_SYNC            0x7E    // Первый байт кадра TLV
+#define FIELD_TABLE_SIZE            64      // Полей в таблице (степень двойки)
+#define FIELD_KEY_SIZE              20      // Длина имени поля с нулем
+
+// Триггеры: поиск образцов в принятом потоке (trigger.h, /api/triggers).
+// Таблица автомата - TRIGGER_MAX_STATES x TRIGGER_MAX_CLASSES байт, две копии
+#define TRIGGER_MAX_PATTERNS        8       // Образцов (маска совпадений - 8 бит)
+#define TRIGGER_PATTERN_MAX         32      // Длина образца, байт
+#define TRIGGER_NAME_SIZE           16      // Длина имени образца с нулем
+#define TRIGGER_MAX_STATES          160     // Состояний автомата (сумма длин образцов + 1), до 255
+#define TRIGGER_MAX_CLASSES         48      // Классов байт (различных байт в образцах + 1)
+#define TRIGGER_CONTEXT_BEFORE      64      // Контекст события до конца совпадения, байт
+#define TRIGGER_CONTEXT_AFTER       64      // Контекст события после совпадения, байт
+#define TRIGGER_EVENTS              16      // Последних событий в памяти
+#define TRIGGER_HOLDOFF_MS          1000    // Событий образца не чаще (совпадения считаются все)
+#define TRIGGER_NVS_NAMESPACE       "triggers"
+
+// Журнал принятых данных во флеш (раздел caplog в partitions.csv)
+#define FLASH_LOG_ENABLE            1
+#define FLASH_LOG_PARTITION_LABEL   "caplog"
+#define FLASH_LOG_PARTITION_TYPE    0x40
+#define FLASH_LOG_PARTITION_SUBTYPE 0x01
+#define FLASH_LOG_FLUSH_MS          10000   // Неполный сегмент записывается через это время
+
+// Отложенный журнал горячего пути (dlog): события без форматирования строк
+#define DLOG_RING_SIZE          128     // Событий в кольце (степень двойки), 20 байт каждое
+#define DLOG_FLUSH_MS           50      // Период вывода событий задачей журнала
+#define DLOG_RATE_PER_SEC       20      // Строк в секунду на тег, остальные подавляются
+#define DLOG_DEFAULT_LEVEL      ESP_LOG_INFO
+
+// Метрики (/api/metrics)
+#define METRICS_MAX_TASKS       12      // Задач с выводом запаса стека
+#define DATA_RX_TIME_SLOTS      64      // Время приема последних порций (задержка UART -> клиент)
+
+// Раскладка задач: приоритет и стек (байт). Системные задачи для сравнения:
+// Wi-Fi 23, esp_timer 22, lwIP tcpip 18 (CONFIG_LWIP_TCPIP_TASK_PRIO),
+// Tmr Svc 1, IDLE 0. Все задачи моста ниже tcpip: прием из FIFO в кольцевой
+// буфер драйвера идет в прерывании, задаче приема достаточно успевать за
+// UART_RX_RING_SIZE байт, а отправка клиентам все равно ждет стек сети
+#define TASK_PRIO_TCPIP         18      // Справочно, задается в sdkconfig
+#define TASK_PRIO_UART_RX       12      // uart_read_task: выше всех задач моста
+#define TASK_STACK_UART_RX      4096
+#define TASK_PRIO_PORT_RX       11      // port_rx: прием всех дополнительных портов
+#define TASK_STACK_PORT_RX      3072
+#define TASK_PRIO_UART_TX       10      // uart_tx: точность пауз между байтами
+#define TASK_STACK_UART_TX      3072
+#define TASK_PRIO_TCP_FORWARD   9       // tcp_forward: отправка TCP клиентам
+#define TASK_STACK_TCP_FORWARD  3072
+#define TASK_PRIO_WS_STREAM     9       // ws_stream: отправка WebSocket клиентам
+#define TASK_STACK_WS_STREAM    3072
+#define TASK_PRIO_SSE_STREAM    9       // sse_stream: отправка SSE клиентам
+#define TASK_STACK_SSE_STREAM   3072
+#define TASK_PRIO_TCP_SERIAL    8       // tcp_serial: подключения и прием от TCP клиентов
+#define TASK_STACK_TCP_SERIAL   4096
+#define TASK_PRIO_HTTP_WAIT     7       // http_wait: ответы ожидающим запросам, выше httpd
+#define TASK_STACK_HTTP_WAIT    4096
+#define TASK_PRIO_HTTPD         5       // httpd: обработчики API (как HTTPD_DEFAULT_CONFIG)
+#define TASK_STACK_HTTPD        4096
+#define TASK_PRIO_FLASH_LOG     3       // flash_log: запись сегментов во флеш
+#define TASK_STACK_FLASH_LOG    3072
+#define TASK_PRIO_DLOG          1       // dlog: форматирование отложенного журнала
+#define TASK_STACK_DLOG         3072
+
+// Диагностическая сборка: счетчик фронтов на выводе RX по прерыванию,
+// проверка подключения и отладочный вывод уровней выводов при запуске.
+// В рабочей сборке не компилируется (-DCOMTOAIR_DIAGNOSTICS=1 для включения)
+#ifndef COMTOAIR_DIAGNOSTICS
+#define COMTOAIR_DIAGNOSTICS    0
+#endif
+#define DIAG_MAX_TASKS          24      // Задач в снимке /api/tasks (все задачи системы)
+#define DIAG_RX_EDGE_REPORT_MS  1000    // Период сводки по фронтам RX (диагностика)
+#define DIAG_RX_EDGE_LIMIT      2000    // Фронтов за период, после - прерывание до конца периода
 
 // Таймауты (в миллисекундах)
 #define UART_READ_TIMEOUT   20
-#define WIFI_RETRY_TIMEOUT  5000
 
 #endif // CONFIG_H
 
@@ -0,0 +1,121 @@
+/**
+ * @file decoder.h
+ * @brief Декодеры протоколов на пути приема (Modbus RTU, NMEA 0183, TLV)
+ *
+ * Декодер порта получает те же порции байт, что и буфер порта, сам
+ * выделяет в них кадры своего протокола, проверяет CRC/контрольную сумму
+ * и записывает значения полей в таблицу field_table (/api/fields).
+ * Клиентам не нужно разбирать сырой поток: последние значения доступны
+ * снимком фиксированного размера.
+ *
+ * Декодер - набор функций decoder_ops_t и состояние не больше
+ * DECODER_STATE_SIZE байт; у каждого порта свой экземпляр состояния.
+ * Память не выделяется. Декодер вызывается только писателем порта
+ * (задачей приема), поэтому его состояние не защищается. Смена декодера
+ * (decoder_set) применяется писателем перед следующей порцией и
+ * сбрасывает состояние.
+ *
+ * Если декодер просит сброс по паузе (idle_reset), порция, пришедшая
+ * позже DECODER_FRAME_TIMEOUT_MS после предыдущей, начинает новый кадр:
+ * так Modbus RTU разделяет кадры паузой на линии.
+ */
+
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "config.h"
+
+/**
+ * @brief Контекст вызова декодера: порт, время и счетчики
+ */
+typedef struct {
+    int port;
+    uint32_t now_ms;                // Время приема порции, мс от запуска
+    uint32_t frames;                // Кадров с верной контрольной суммой за вызов
+    uint32_t errors;                // Ошибок (контрольная сумма, формат, потеря синхронизации)
+} decoder_ctx_t;
+
+/**
+ * @brief Декодер протокола
+ */
+typedef struct {
+    const char *name;
+    size_t state_size;              // Не больше DECODER_STATE_SIZE
+    bool idle_reset;                // Пауза на линии завершает кадр
+    void (*reset)(void *state);
+    void (*feed)(void *state, decoder_ctx_t *ctx, const uint8_t *data, size_t length);
+} decoder_ops_t;
+
+/**
+ * @brief Состояние декодера порта
+ */
+typedef struct {
+    const char *name;               // "none" если декодер не назначен
+    uint32_t frames;
+    uint32_t errors;
+} decoder_info_t;
+
+// Декодеры (decoder_modbus.cpp, decoder_nmea.cpp, decoder_tlv.cpp)
+extern const decoder_ops_t decoder_modbus;
+extern const decoder_ops_t decoder_nmea;
+extern const decoder_ops_t decoder_tlv;
+
+/**
+ * @brief Запись целого поля из декодера
+ */
+void decoder_emit_int(decoder_ctx_t *ctx, const char *key, int64_t value);
+
+/**
+ * @brief Запись поля с плавающей точкой из декодера
+ */
+void decoder_emit_float(decoder_ctx_t *ctx, const char *key, double value);
+
+/**
+ * @brief Поиск декодера по имени
+ *
+ * @return NULL для "none" и неизвестных имен
+ */
+const decoder_ops_t *decoder_find(const char *name);
+
+/**
+ * @brief Назначение декодера DECODER_DEFAULT всем портам и регистрация метрик
+ *
+ * Вызывается до запуска приема.
+ */
+void decoder_init(void);
+
+/**
+ * @brief Имя декодера допустимо для decoder_set() ("none" или известный декодер)
+ */
+bool decoder_name_valid(const char *name);
+
+/**
+ * @brief Смена декодера порта
+ *
+ * @param port Номер порта
+ * @param name Имя декодера или "none"
+ * @return false при неверном порте или неизвестном имени
+ */
+bool decoder_set(int port, const char *name);
+
+/**
+ * @brief Порция принятых данных порта (только из задачи приема порта)
+ *
+ * @param port Номер порта
+ * @param data Данные
+ * @param length Длина данных
+ * @param now_us Время приема порции, мкс
+ */
+void decoder_feed(int port, const uint8_t *data, size_t length, uint64_t now_us);
+
+/**
+ * @brief Состояние декодера порта
+ *
+ * @return false при неверном номере порта
+ */
+bool decoder_get_info(int port, decoder_info_t *info);
+
+#endif // DECODER_H
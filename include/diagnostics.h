@@ -0,0 +1,99 @@
+/**
+ * @file diagnostics.h
+ * @brief Статистика задач и пробуждений процессора (/api/tasks)
+ *
+ * Снимок всех задач FreeRTOS (uxTaskGetSystemState): приоритет, состояние,
+ * запас стека и процессорное время. Доля процессора считается за окно -
+ * время с предыдущего снимка, поэтому два запроса подряд показывают
+ * нагрузку между ними. Пробуждения простоя считает хук задачи IDLE:
+ * он вызывается один раз на каждый выход из ожидания прерывания (WFI),
+ * так что частота пробуждений - это частота прерываний, которые будили
+ * простаивающий процессор (тик, таймеры, периферия).
+ *
+ * В диагностической сборке (COMTOAIR_DIAGNOSTICS) дополнительно считаются
+ * фронты на выводе RX по прерыванию GPIO - проверка подключения без
+ * задачи опроса. Сводку раз в DIAG_RX_EDGE_REPORT_MS выводит таймер.
+ */
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Задача в снимке
+ */
+typedef struct {
+    char name[16];
+    uint32_t number;            // Номер задачи FreeRTOS (уникален)
+    const char *state;          // "running", "ready", "blocked", "suspended", "deleted"
+    uint32_t priority;          // Текущий (с учетом наследования)
+    uint32_t base_priority;
+    uint32_t stack_free;        // Наименьший запас стека, байт
+    uint64_t run_time_us;       // Процессорное время с запуска
+    uint32_t cpu_permille;      // Доля процессора за окно, 0.1%
+} diag_task_t;
+
+/**
+ * @brief Сводка снимка
+ */
+typedef struct {
+    bool run_time_stats;        // Счетчики времени доступны (CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS)
+    uint32_t task_count;        // Задач в системе
+    uint64_t run_time_us;       // Время счетчиков с запуска
+    uint64_t window_us;         // Окно: время с предыдущего снимка
+    uint32_t idle_permille;     // Доля простоя (задача IDLE) за окно, 0.1%
+    uint32_t idle_wakeups;      // Пробуждений простоя с запуска
+    uint32_t window_wakeups;    // Пробуждений простоя за окно
+    uint32_t rx_jitter_samples; // Замеров дрожания приема за окно
+    uint32_t rx_jitter_mean_us; // Среднее отклонение пробуждений приема за окно
+    uint32_t rx_jitter_max_us;  // Наибольшее отклонение за окно
+    uint32_t rx_pin_edges;      // Фронтов на выводе RX (только диагностическая сборка)
+} diag_summary_t;
+
+/**
+ * @brief Запуск учета пробуждений простоя и диагностики вывода RX
+ *
+ * Вызывается после настройки UART: прерывание по фронтам ставится на
+ * уже назначенный приемнику вывод, не меняя его настройки.
+ *
+ * @return true при успешном запуске, false в противном случае
+ */
+bool diag_start(void);
+
+/**
+ * @brief Снимок задач и сводка за окно с предыдущего снимка
+ *
+ * Окно общее для всех вызывающих; вызывать из одной задачи (HTTP сервер).
+ *
+ * @param tasks Массив задач (выход)
+ * @param max Размер массива
+ * @param summary Сводка (выход)
+ * @return Задач записано в массив (0, если их больше max или снимки недоступны)
+ */
+size_t diag_get_tasks(diag_task_t *tasks, size_t max, diag_summary_t *summary);
+
+/**
+ * @brief Запас стека задачи
+ */
+typedef struct {
+    char name[16];
+    uint32_t stack_free;        // Наименьший запас стека с запуска, байт
+    uint32_t stack_size;        // Размер стека из config.h, 0 - не задача моста
+} diag_stack_t;
+
+/**
+ * @brief Запас стека всех задач, по возрастанию запаса (/api/memory)
+ *
+ * Окно /api/tasks не сдвигает. Вызывать из той же задачи, что и
+ * diag_get_tasks (общий буфер снимка).
+ *
+ * @param stacks Массив (выход)
+ * @param max Размер массива
+ * @return Задач записано в массив
+ */
+size_t diag_get_stacks(diag_stack_t *stacks, size_t max);
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,119 @@
+/**
+ * @file dlog.h
+ * @brief Отложенный двоичный журнал для горячего пути
+ *
+ * Задачи приема и передачи не форматируют строки: dlog_write() кладет в
+ * кольцо без блокировок компактное событие (номер, до двух аргументов,
+ * время приема в мс). Задача журнала с низким приоритетом раз в
+ * DLOG_FLUSH_MS забирает события, форматирует их по таблице событий и
+ * выводит через esp_log с тегом модуля.
+ *
+ * Вывод каждого тега ограничен DLOG_RATE_PER_SEC строками в секунду;
+ * лишние события подавляются и выводятся одной строкой со счетчиком.
+ * Уровень вывода тегов меняется на лету (dlog_set_level, POST /api/log):
+ * события выше уровня тега отбрасываются еще до записи в кольцо.
+ */
+
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_log.h"
+
+/**
+ * @brief Теги (модули), события которых идут через отложенный журнал
+ */
+typedef enum {
+    DLOG_TAG_UART_RX = 0,       // "UartRx"
+    DLOG_TAG_COUNT,
+} dlog_tag_t;
+
+/**
+ * @brief События отложенного журнала (формат и уровень - в таблице dlog.cpp)
+ */
+typedef enum {
+    DLOG_RX_CHUNK = 0,          // D: принята порция (arg0 - байт)
+    DLOG_RX_FIFO_OVF,           // W: переполнение аппаратного FIFO (arg0 - всего)
+    DLOG_RX_BUFFER_FULL,        // W: переполнение буфера драйвера (arg0 - всего)
+    DLOG_RX_BREAK,              // I: BREAK в линии (arg0 - всего)
+    DLOG_RX_FRAME_ERR,          // W: ошибка кадра (arg0 - всего)
+    DLOG_RX_PARITY_ERR,         // W: ошибка четности (arg0 - всего)
+    DLOG_EVENT_COUNT,
+} dlog_event_t;
+
+/**
+ * @brief Статистика отложенного журнала
+ */
+typedef struct {
+    uint32_t recorded;          // Событий записано в кольцо
+    uint32_t dropped;           // Потеряно: кольцо заполнено
+    uint32_t suppressed;        // Подавлено ограничением частоты
+    uint32_t emitted;           // Выведено строк
+} dlog_stats_t;
+
+/**
+ * @brief Запуск задачи вывода журнала
+ *
+ * События, записанные до запуска, отбрасываются.
+ *
+ * @return true при успешном запуске, false в противном случае
+ */
+bool dlog_start(void);
+
+/**
+ * @brief Запись события (без форматирования и блокировок)
+ *
+ * Можно вызывать из любых задач одновременно. Если кольцо заполнено,
+ * событие отбрасывается и учитывается в dropped.
+ *
+ * @param event Номер события
+ * @param arg0 Первый аргумент формата
+ * @param arg1 Второй аргумент формата
+ */
+void dlog_write(dlog_event_t event, uint32_t arg0, uint32_t arg1);
+
+/**
+ * @brief Установка уровня вывода тега
+ *
+ * Уровень передается и в esp_log_level_set(), поэтому обычные ESP_LOGx
+ * модуля подчиняются тому же переключателю. Тег, не входящий в dlog_tag_t,
+ * меняет только уровень esp_log.
+ *
+ * @param tag Имя тега или "*" для всех тегов
+ * @param level Уровень вывода
+ */
+void dlog_set_level(const char *tag, esp_log_level_t level);
+
+/**
+ * @brief Текущий уровень вывода тега
+ */
+esp_log_level_t dlog_get_level(dlog_tag_t tag);
+
+/**
+ * @brief Имя тега (совпадает с TAG модуля)
+ */
+const char *dlog_tag_name(dlog_tag_t tag);
+
+/**
+ * @brief Имя уровня ("none", "error", "warn", "info", "debug", "verbose")
+ */
+const char *dlog_level_name(esp_log_level_t level);
+
+/**
+ * @brief Разбор имени уровня (см. dlog_level_name)
+ *
+ * @param name Имя уровня
+ * @param level Уровень (выход)
+ * @return true, если имя распознано
+ */
+bool dlog_parse_level(const char *name, esp_log_level_t *level);
+
+/**
+ * @brief Получение статистики журнала
+ *
+ * @param stats Указатель на структуру для сохранения статистики
+ */
+void dlog_get_stats(dlog_stats_t *stats);
+
+#endif // DLOG_H
@@ -0,0 +1,147 @@
+/**
+ * @file fanout.h
+ * @brief Раздача данных RS-232 потоковым клиентам с бюджетом отставания
+ *
+ * Данные хранятся один раз - в кольцевом буфере моста (web_server). Каждый
+ * потоковый клиент (ожидающий запрос /api/data?wait=, WebSocket /ws/stream,
+ * TCP сервер, SSE /api/events) занимает слот с собственным курсором -
+ * номером следующего байта - и копирует данные из буфера порциями перед
+ * отправкой.
+ *
+ * Для каждого транспорта задан бюджет отставания (байт между курсором и
+ * головой буфера) и действие при его превышении:
+ * - FANOUT_POLICY_GAP: курсор переводится на середину бюджета от головы,
+ *   клиент получает уведомление о пропуске и продолжает со свежих данных;
+ * - FANOUT_POLICY_DISCONNECT: клиент отключается.
+ * Бюджет не больше размера буфера минус FANOUT_LAG_MARGIN, поэтому
+ * отставший в пределах бюджета клиент успевает скопировать данные до их
+ * перезаписи; перезаписанные все же байты он получает как пропуск.
+ * Остановившийся клиент не задерживает писателя и других клиентов и не
+ * удерживает память: буфер общий и перезаписывается независимо от него.
+ */
+
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <atomic>
+#include "metrics.h"
+
+typedef enum {
+    FANOUT_TRANSPORT_HTTP = 0,      // Ожидающие запросы /api/data?wait=
+    FANOUT_TRANSPORT_WS,            // WebSocket /ws/stream
+    FANOUT_TRANSPORT_TCP,           // TCP сервер (raw и RFC 2217)
+    FANOUT_TRANSPORT_SSE,           // Server-Sent Events /api/events
+    FANOUT_TRANSPORT_COUNT,
+} fanout_transport_t;
+
+typedef enum {
+    FANOUT_POLICY_GAP = 0,          // Пропуск с уведомлением
+    FANOUT_POLICY_DISCONNECT,       // Отключение клиента
+} fanout_policy_t;
+
+typedef enum {
+    FANOUT_OK = 0,                  // Отставание в пределах бюджета
+    FANOUT_GAP,                     // Курсор переведен вперед, часть данных пропущена
+    FANOUT_EVICT,                   // Клиента нужно отключить
+} fanout_verdict_t;
+
+/**
+ * @brief Слот потокового клиента
+ *
+ * Курсор меняет только транспорт, владеющий слотом; остальные поля
+ * читаются обработчиками /api/clients и /api/metrics.
+ */
+typedef struct {
+    fanout_transport_t transport;
+    uint8_t slot;                   // Номер слота внутри транспорта
+    std::atomic<bool> active;
+    uint32_t seq;                   // Курсор: номер следующего байта для клиента
+    char labels[32];                // Метки метрик слота
+    metric_t lag;                   // Отставание от головы буфера, байт
+    metric_t dropped;               // Пропущено байт (перезаписаны или сверх бюджета)
+    metric_t gaps;                  // Переводов курсора вперед
+} fanout_client_t;
+
+/**
+ * @brief Инициализация слотов и метрик (повторные вызовы игнорируются)
+ */
+void fanout_init(void);
+
+/**
+ * @brief Занять слот клиента
+ *
+ * @param transport Транспорт
+ * @param seq Начальный курсор
+ * @return Слот или NULL, если свободных слотов транспорта нет
+ */
+fanout_client_t *fanout_open(fanout_transport_t transport, uint32_t seq);
+
+/**
+ * @brief Освободить слот клиента
+ */
+void fanout_close(fanout_client_t *client);
+
+/**
+ * @brief Проверка отставания клиента перед отправкой
+ *
+ * Курсор, перезаписанный или отставший больше бюджета, переводится вперед
+ * (FANOUT_GAP) либо клиент подлежит отключению (FANOUT_EVICT) - по
+ * политике транспорта. Обновляет метрики слота.
+ *
+ * @param client Слот клиента
+ * @param skipped Пропущено байт при FANOUT_GAP (выход, может быть NULL)
+ * @return Решение для клиента
+ */
+fanout_verdict_t fanout_check(fanout_client_t *client, uint32_t *skipped);
+
+/**
+ * @brief Проверка курсора клиента без слота (опрос /api/data?since=)
+ *
+ * @param transport Транспорт (политика которого применяется)
+ * @param seq Курсор (обновляется при FANOUT_GAP)
+ * @param skipped Пропущено байт при FANOUT_GAP (выход, может быть NULL)
+ * @return Решение для клиента
+ */
+fanout_verdict_t fanout_check_seq(fanout_transport_t transport, uint32_t *seq, uint32_t *skipped);
+
+/**
+ * @brief Установка бюджета отставания и политики транспорта
+ *
+ * Бюджет ограничивается диапазоном FANOUT_MIN_LAG_BUDGET ..
+ * DATA_BUFFER_SIZE - FANOUT_LAG_MARGIN.
+ */
+void fanout_set_policy(fanout_transport_t transport, uint32_t budget, fanout_policy_t policy);
+
+/**
+ * @brief Текущие бюджет отставания и политика транспорта
+ */
+void fanout_get_policy(fanout_transport_t transport, uint32_t *budget, fanout_policy_t *policy);
+
+/**
+ * @brief Количество отключенных за отставание клиентов транспорта
+ */
+uint32_t fanout_evictions(fanout_transport_t transport);
+
+/**
+ * @brief Количество слотов транспорта и доступ к ним (для вывода состояния)
+ */
+int fanout_slot_count(fanout_transport_t transport);
+fanout_client_t *fanout_slot(fanout_transport_t transport, int index);
+
+/**
+ * @brief Имена транспортов и политик (http/ws/tcp, gap/disconnect)
+ */
+const char *fanout_transport_name(fanout_transport_t transport);
+const char *fanout_policy_name(fanout_policy_t policy);
+
+/**
+ * @brief Разбор имен транспорта и политики
+ *
+ * @return true если имя известно
+ */
+bool fanout_parse_transport(const char *name, fanout_transport_t *transport);
+bool fanout_parse_policy(const char *name, fanout_policy_t *policy);
+
+#endif // FANOUT_H
@@ -0,0 +1,78 @@
+/**
+ * @file field_table.h
+ * @brief Таблица последних значений полей, выделенных декодерами (/api/fields)
+ *
+ * Поле - пара (порт, имя), например (0, "mb1.hr40"), и последнее значение:
+ * целое или с плавающей точкой. Таблица фиксированного размера
+ * (FIELD_TABLE_SIZE записей по ~40 байт) с открытой адресацией по хешу
+ * имени; запись, однажды занятая, не освобождается. Новое поле при
+ * заполненной таблице не сохраняется и учитывается в dropped.
+ *
+ * Писатели - задачи приема (у каждого порта одна); вставка нового поля
+ * идет под коротким спинлоком, обновление существующего - атомарными
+ * записями без блокировок. Читатель (HTTP обработчик) обходит все
+ * FIELD_TABLE_SIZE записей: время снимка не зависит от потока данных.
+ */
+
+#ifndef FIELD_TABLE_H
+#define FIELD_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "config.h"
+
+typedef enum {
+    FIELD_INT = 0,
+    FIELD_FLOAT,
+} field_type_t;
+
+/**
+ * @brief Копия записи таблицы
+ */
+typedef struct {
+    char key[FIELD_KEY_SIZE];
+    uint8_t port;
+    field_type_t type;
+    union {
+        int64_t i;
+        double f;
+    } value;
+    uint32_t updates;           // Обновлений с момента появления поля
+    uint32_t updated_ms;        // Время последнего обновления, мс от запуска (младшие 32 бита)
+} field_t;
+
+/**
+ * @brief Запись целого значения
+ *
+ * @param port Номер порта
+ * @param key Имя поля (длиннее FIELD_KEY_SIZE - 1 обрезается)
+ * @param value Значение
+ * @param now_ms Время, мс от запуска
+ * @return false если таблица заполнена
+ */
+bool field_table_set_int(int port, const char *key, int64_t value, uint32_t now_ms);
+
+/**
+ * @brief Запись значения с плавающей точкой (см. field_table_set_int)
+ */
+bool field_table_set_float(int port, const char *key, double value, uint32_t now_ms);
+
+/**
+ * @brief Копия записи по индексу 0..FIELD_TABLE_SIZE-1
+ *
+ * @return false если запись свободна
+ */
+bool field_table_get(size_t index, field_t *field);
+
+/**
+ * @brief Занято записей
+ */
+size_t field_table_count(void);
+
+/**
+ * @brief Новых полей, не поместившихся в таблицу
+ */
+uint32_t field_table_dropped(void);
+
+#endif // FIELD_TABLE_H
@@ -0,0 +1,87 @@
+/**
+ * @file flash_log.h
+ * @brief Запись принятых данных RS-232 в раздел флеш-памяти
+ *
+ * Раздел "caplog" (partitions.csv) используется как кольцо сегментов
+ * размером в один стираемый сектор. Сегменты пишутся только целиком и
+ * только по кругу, поэтому износ распределяется по всему разделу равномерно.
+ * Данные берутся из буфера моста задачей низкого приоритета со своим
+ * курсором: прием UART на запись во флеш не ждет никогда.
+ *
+ * После перезагрузки записанное сохраняется и доступно через
+ * /api/capture/download (от старых сегментов к новым). Байты, которые
+ * до программного сброса не успели попасть во флеш, переживают сброс в
+ * буфере моста (web_server_restore_data()) и записываются после него.
+ */
+
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Статистика записи во флеш
+ */
+typedef struct {
+    bool active;                // Раздел найден, задача записи работает
+    uint32_t partition_size;    // Размер раздела
+    uint32_t segment_count;     // Сегментов в разделе
+    uint32_t oldest_segment;    // Номер самого старого сегмента
+    uint32_t next_segment;      // Номер следующего сегмента
+    uint16_t boot;              // Номер текущего запуска (по сегментам во флеш)
+    uint32_t payload_bytes;     // Записано байт данных
+    uint32_t flash_bytes;       // Записано во флеш (сектора целиком)
+    uint32_t segments_written;  // Записано сегментов с запуска
+    uint32_t partial_segments;  // Из них неполных (сброс по таймауту)
+    uint32_t dropped_bytes;     // Потеряно: задача отстала от буфера моста
+    uint32_t write_errors;      // Ошибки стирания/записи
+    uint32_t last_write_us;     // Длительность последнего стирания+записи
+    uint32_t max_write_us;      // Максимальная длительность
+    uint64_t total_write_us;    // Суммарное время блокировки на флеш
+} flash_log_stats_t;
+
+/**
+ * @brief Функция вывода данных при выгрузке
+ *
+ * @return true для продолжения, false для остановки выгрузки
+ */
+typedef bool (*flash_log_sink_fn)(void *ctx, const uint8_t *data, size_t length);
+
+/**
+ * @brief Поиск раздела, восстановление положения записи и запуск задачи
+ *
+ * @return true если запись во флеш включена
+ */
+bool flash_log_start(void);
+
+/**
+ * @brief Уведомление о новых данных в буфере моста (вызывается писателем буфера)
+ */
+void flash_log_notify(void);
+
+/**
+ * @brief Последовательная выгрузка сохраненных данных
+ *
+ * Сегменты читаются по одному через буфер вызывающего, дважды: сначала
+ * проверяется CRC данных, затем данные выводятся. Сегмент с неверной CRC
+ * (запись прервана сбросом питания) или стертый до вывода пропускается;
+ * стертый посреди вывода прерывает выгрузку (возврат false).
+ *
+ * @param sink Функция вывода
+ * @param ctx Контекст функции вывода
+ * @param with_headers Выводить заголовки сегментов (формат для разбора)
+ * @param buf Буфер чтения (например, блок пула буферов)
+ * @param buf_size Размер буфера, порция вывода не больше него
+ * @return false если вывод был прерван
+ */
+bool flash_log_read_all(flash_log_sink_fn sink, void *ctx, bool with_headers,
+                        uint8_t *buf, size_t buf_size);
+
+/**
+ * @brief Получение статистики
+ */
+void flash_log_get_stats(flash_log_stats_t *stats);
+
+#endif // FLASH_LOG_H
@@ -0,0 +1,180 @@
+/**
+ * @file framer.h
+ * @brief Выделение кадров (сообщений протокола) из потока байт RS-232
+ *
+ * Порции от драйвера UART режут сообщения протокола произвольно. Фреймер
+ * собирает из потока целые кадры и передает их функции вывода вместе со
+ * временем приема первого байта кадра. Режимы:
+ * - FRAMER_LINE: строки, завершенные LF, CR или любым из них (CR LF -
+ *   один конец строки); символы конца строки в кадр не входят, пустые
+ *   строки пропускаются;
+ * - FRAMER_FIXED: кадры фиксированной длины;
+ * - FRAMER_LENGTH: длина в заголовке кадра (1 или 2 байта, BE/LE, после
+ *   len_offset байт заголовка); кадр - заголовок и тело целиком;
+ * - FRAMER_SLIP: RFC 1055, в кадр попадают декодированные данные;
+ * - FRAMER_COBS: кадры, разделенные нулевым байтом, декодированные;
+ * - FRAMER_IDLE: кадр заканчивается паузой на линии (framer_idle()).
+ *
+ * Разделители ищутся по машинному слову за шаг (framer_find_byte), а
+ * участки без служебных байт копируются целиком, поэтому стоимость
+ * обработки - порядка memcpy. Кадр длиннее FRAMER_MAX_FRAME выводится
+ * частями с флагом FRAMER_FLAG_PARTIAL. Память не выделяется.
+ *
+ * Экземпляр не потокобезопасен: его использует один писатель.
+ */
+
+#ifndef FRAMER_H
+#define FRAMER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "config.h"
+
+typedef enum {
+    FRAMER_NONE = 0,                // Порции как есть, без выделения кадров
+    FRAMER_LINE,
+    FRAMER_FIXED,
+    FRAMER_LENGTH,
+    FRAMER_SLIP,
+    FRAMER_COBS,
+    FRAMER_IDLE,
+    FRAMER_MODE_COUNT,
+} framer_mode_t;
+
+typedef enum {
+    FRAMER_EOL_LF = 0,              // LF, CR перед ним отбрасывается
+    FRAMER_EOL_CR,
+    FRAMER_EOL_ANY,                 // CR или LF, пустые строки пропускаются
+    FRAMER_EOL_COUNT,
+} framer_eol_t;
+
+// Флаги кадра
+#define FRAMER_FLAG_PARTIAL     0x01    // Кадр продолжается в следующем выводе
+#define FRAMER_FLAG_ERROR       0x02    // Ошибка кодирования (SLIP/COBS), данные до ошибки
+
+/**
+ * @brief Параметры фреймера
+ */
+typedef struct {
+    framer_mode_t mode;
+    framer_eol_t eol;               // FRAMER_LINE
+    uint16_t fixed_length;          // FRAMER_FIXED: длина кадра
+    uint8_t len_offset;             // FRAMER_LENGTH: байт заголовка до поля длины
+    uint8_t len_size;               // FRAMER_LENGTH: размер поля длины (1 или 2)
+    bool len_big_endian;            // FRAMER_LENGTH: порядок байт поля длины
+    int16_t len_adjust;             // FRAMER_LENGTH: поправка к значению поля (CRC и т.п.)
+} framer_config_t;
+
+/**
+ * @brief Функция вывода кадра
+ *
+ * @param ctx Контекст функции вывода
+ * @param frame Данные кадра (действительны только во время вызова)
+ * @param length Длина данных
+ * @param flags FRAMER_FLAG_*
+ * @param timestamp_us Время приема первого байта кадра, мкс
+ * @param end_seq Позиция в исходном потоке после последнего байта кадра
+ */
+typedef void (*framer_emit_fn)(void *ctx, const uint8_t *frame, size_t length, uint32_t flags,
+                               uint64_t timestamp_us, uint32_t end_seq);
+
+/**
+ * @brief Статистика фреймера
+ */
+typedef struct {
+    uint32_t frames;                // Выведено кадров (частей кадров)
+    uint32_t partial;               // Из них частей длинных кадров
+    uint32_t errors;                // Ошибок кодирования и недопустимых длин
+} framer_stats_t;
+
+/**
+ * @brief Состояние фреймера
+ */
+typedef struct {
+    framer_config_t config;
+    framer_emit_fn emit;
+    void *ctx;
+    uint32_t raw_seq;               // Позиция в исходном потоке начала текущей порции
+    uint64_t chunk_us;              // Время приема текущей порции
+    uint64_t frame_start_us;        // Время приема первого байта кадра
+    bool in_frame;                  // Кадр начат
+    bool in_part;                   // Текущий кадр уже выводился частями
+    uint32_t flags;                 // Флаги текущего кадра (FRAMER_FLAG_ERROR)
+    size_t length;                  // Байт в frame
+    uint32_t remaining;             // FIXED/LENGTH: байт до конца кадра
+    bool header_done;               // LENGTH: поле длины принято
+    bool escape;                    // SLIP: принят ESC
+    bool skip_lf;                   // LINE: пропустить LF после CR (CR LF в режиме ANY)
+    uint8_t cobs_left;              // COBS: байт до следующего кода
+    bool cobs_zero;                 // COBS: перед следующим блоком вставить 0
+    framer_stats_t stats;
+    uint8_t frame[FRAMER_MAX_FRAME];
+} framer_t;
+
+/**
+ * @brief Инициализация (и сброс) фреймера
+ *
+ * @param framer Фреймер
+ * @param config Параметры
+ * @param emit Функция вывода кадров
+ * @param ctx Контекст функции вывода
+ * @param raw_seq Позиция в исходном потоке первого байта, который будет передан
+ */
+void framer_init(framer_t *framer, const framer_config_t *config,
+                 framer_emit_fn emit, void *ctx, uint32_t raw_seq);
+
+/**
+ * @brief Обработка принятых байт
+ *
+ * @param framer Фреймер
+ * @param data Данные
+ * @param length Длина данных
+ * @param timestamp_us Время приема порции, мкс
+ */
+void framer_feed(framer_t *framer, const uint8_t *data, size_t length, uint64_t timestamp_us);
+
+/**
+ * @brief Пауза на линии: в режиме FRAMER_IDLE завершает текущий кадр
+ */
+void framer_idle(framer_t *framer);
+
+/**
+ * @brief Есть начатый, но не выведенный кадр
+ */
+bool framer_pending(const framer_t *framer);
+
+/**
+ * @brief Проверка параметров
+ */
+bool framer_config_is_valid(const framer_config_t *config);
+
+/**
+ * @brief Поиск байта a (словами по sizeof(uintptr_t) байт)
+ *
+ * @return Индекс первого вхождения или length, если байта нет
+ */
+size_t framer_find_byte(const uint8_t *data, size_t length, uint8_t a);
+
+/**
+ * @brief Поиск первого из байт a и b (словами по sizeof(uintptr_t) байт)
+ *
+ * @return Индекс первого вхождения или length, если байтов нет
+ */
+size_t framer_find_byte2(const uint8_t *data, size_t length, uint8_t a, uint8_t b);
+
+/**
+ * @brief Имена режимов и концов строки (none, line, ...; lf, cr, any)
+ */
+const char *framer_mode_name(framer_mode_t mode);
+const char *framer_eol_name(framer_eol_t eol);
+
+/**
+ * @brief Разбор имен режима и конца строки
+ *
+ * @return true если имя известно
+ */
+bool framer_parse_mode(const char *name, framer_mode_t *mode);
+bool framer_parse_eol(const char *name, framer_eol_t *eol);
+
+#endif // FRAMER_H
@@ -0,0 +1,151 @@
+/**
+ * @file json_writer.h
+ * @brief Потоковая запись JSON без выделения памяти
+ *
+ * Текст собирается в буфере фиксированного размера, который дает
+ * вызывающий (для HTTP - блок пула buffer_pool.h), и отдается функции
+ * flush по мере заполнения (для HTTP это httpd_resp_send_chunk). Размер
+ * ответа не ограничен, расход стека постоянный.
+ *
+ * Байтовые строки кодируются без потерь: байты 0x00-0x1F и 0x80-0xFF
+ * записываются как \u00XX, то есть код символа в JS равен значению
+ * байта. Для двоичных протоколов есть вариант base64.
+ *
+ * Модуль не зависит от ESP-IDF и собирается также под Linux (host/).
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "config.h"
+
+// Размер буфера писателя (столько байт уходит за один вызов flush)
+#define JSON_WRITER_CHUNK_SIZE  JSON_BUFFER_SIZE
+
+// Наименьший буфер: вмещает самую длинную последовательность (\u00XX)
+#define JSON_WRITER_MIN_BUFFER  8
+
+// Максимальная вложенность объектов и массивов
+#define JSON_WRITER_MAX_DEPTH   32
+
+/**
+ * @brief Функция вывода готового фрагмента
+ *
+ * @return true при успехе; после false писатель перестает выводить данные
+ */
+typedef bool (*json_flush_fn)(void *ctx, const char *data, size_t length);
+
+/**
+ * @brief Состояние писателя
+ */
+typedef struct {
+    char *buf;
+    size_t size;                // Размер buf
+    size_t len;                 // Заполнено байт в buf
+    json_flush_fn flush;
+    void *ctx;
+    uint32_t has_items;         // Бит на уровень: в контейнере уже есть элемент
+    uint8_t depth;              // Текущая вложенность
+    bool after_key;             // Только что записан ключ - запятая не нужна
+    bool failed;                // Ошибка вывода
+    uint8_t b64_carry[3];       // Неполная группа base64
+    uint8_t b64_carry_len;
+    char spare[JSON_WRITER_MIN_BUFFER]; // Буфер писателя без буфера (вывод отбрасывается)
+} json_writer_t;
+
+/**
+ * @brief Инициализация писателя
+ *
+ * Без буфера (buf == NULL или меньше JSON_WRITER_MIN_BUFFER байт) писатель
+ * сразу в состоянии ошибки: вывод отбрасывается, json_writer_finish
+ * возвращает false.
+ *
+ * @param w Писатель
+ * @param buf Буфер (обычно JSON_WRITER_CHUNK_SIZE байт), живет до json_writer_finish
+ * @param size Размер буфера
+ * @param flush Функция вывода
+ * @param ctx Контекст функции вывода
+ */
+void json_writer_init(json_writer_t *w, char *buf, size_t size, json_flush_fn flush, void *ctx);
+
+/**
+ * @brief Вывод оставшихся в буфере данных
+ *
+ * @return false если при выводе была ошибка
+ */
+bool json_writer_finish(json_writer_t *w);
+
+void json_begin_object(json_writer_t *w);
+void json_end_object(json_writer_t *w);
+void json_begin_array(json_writer_t *w);
+void json_end_array(json_writer_t *w);
+
+/**
+ * @brief Ключ следующего значения объекта (должен быть ASCII без экранирования)
+ */
+void json_key(json_writer_t *w, const char *key);
+
+void json_uint(json_writer_t *w, uint32_t value);
+void json_uint64(json_writer_t *w, uint64_t value);
+void json_int(json_writer_t *w, int32_t value);
+void json_int64(json_writer_t *w, int64_t value);
+
+/**
+ * @brief Число с плавающей точкой (10 значащих цифр); NaN и бесконечность - null
+ */
+void json_double(json_writer_t *w, double value);
+void json_bool(json_writer_t *w, bool value);
+void json_null(json_writer_t *w);
+
+/**
+ * @brief Строка из C-строки с экранированием
+ */
+void json_string(json_writer_t *w, const char *str);
+
+/**
+ * @brief Строка из произвольных байт с экранированием
+ */
+void json_string_bytes(json_writer_t *w, const uint8_t *data, size_t length);
+
+/**
+ * @brief Потоковая запись строки по частям
+ *
+ * json_string_begin(), любое число json_string_append(), json_string_end().
+ */
+void json_string_begin(json_writer_t *w);
+void json_string_append(json_writer_t *w, const uint8_t *data, size_t length);
+void json_string_end(json_writer_t *w);
+
+/**
+ * @brief Потоковая запись строки base64 по частям
+ *
+ * Части могут иметь любую длину: остаток до трех байт переносится
+ * в следующий вызов.
+ */
+void json_base64_begin(json_writer_t *w);
+void json_base64_append(json_writer_t *w, const uint8_t *data, size_t length);
+void json_base64_end(json_writer_t *w);
+
+/**
+ * @brief Запись уже готового фрагмента JSON без изменений
+ */
+void json_raw(json_writer_t *w, const char *data, size_t length);
+
+// Пары ключ-значение для объектов
+void json_kv_uint(json_writer_t *w, const char *key, uint32_t value);
+void json_kv_uint64(json_writer_t *w, const char *key, uint64_t value);
+void json_kv_int(json_writer_t *w, const char *key, int32_t value);
+void json_kv_bool(json_writer_t *w, const char *key, bool value);
+void json_kv_string(json_writer_t *w, const char *key, const char *str);
+
+/**
+ * @brief Длина начала data, не требующего экранирования
+ *
+ * Проверяет по 4 байта за шаг (SWAR). Экспортируется для тестов и замеров.
+ */
+size_t json_safe_prefix(const uint8_t *data, size_t length);
+
+#endif // JSON_WRITER_H
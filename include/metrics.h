@@ -0,0 +1,142 @@
+/**
+ * @file metrics.h
+ * @brief Реестр метрик: счетчики, датчики и гистограммы задержек
+ *
+ * Метрики - статические объекты модулей; модуль регистрирует их при
+ * запуске (metrics_register*), после чего /api/metrics выводит все
+ * зарегистрированные серии в текстовом формате Prometheus. Обновление
+ * метрики - одна атомарная операция (гистограмма - три), без блокировок
+ * и выделения памяти, поэтому метрики можно обновлять на горячем пути
+ * из любых задач. Серии одного семейства (одно имя, разные метки)
+ * выводятся вместе под общими HELP/TYPE.
+ *
+ * Кроме метрик модулей выводятся системные: свободная куча, время работы
+ * и минимальный запас стека задач, переданных в metrics_watch_task().
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Границы корзин гистограмм задержек: 100 мкс .. 1 с (см. metrics.cpp)
+#define METRICS_LATENCY_BUCKETS 12
+
+typedef enum {
+    METRIC_COUNTER = 0,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM,
+} metric_type_t;
+
+/**
+ * @brief Серия метрики (счетчик или датчик; заголовок гистограммы)
+ */
+typedef struct metric {
+    const char *name;               // Имя семейства, например comtoair_uart_rx_bytes_total
+    const char *help;               // Описание (HELP)
+    const char *labels;             // Метки без скобок: transport="ws" (или NULL)
+    metric_type_t type;
+    std::atomic<uint32_t> value;    // Значение счетчика / датчика
+    std::atomic<struct metric *> next;
+} metric_t;
+
+/**
+ * @brief Гистограмма задержек (в микросекундах, выводится в секундах)
+ */
+typedef struct {
+    metric_t base;
+    std::atomic<uint32_t> buckets[METRICS_LATENCY_BUCKETS + 1];    // Последняя - +Inf
+    std::atomic<uint32_t> sum_lo;   // Сумма наблюдений, мкс (младшие 32 бита)
+    std::atomic<uint32_t> sum_hi;
+} metric_histogram_t;
+
+/**
+ * @brief Функция вывода текста метрик
+ *
+ * @return true для продолжения, false для остановки вывода
+ */
+typedef bool (*metrics_sink_fn)(void *ctx, const char *data, size_t length);
+
+/**
+ * @brief Регистрация счетчика или датчика
+ *
+ * Повторная регистрация того же объекта игнорируется. Строки name, help
+ * и labels должны жить все время работы (литералы или статические буферы).
+ *
+ * @param metric Объект метрики (статический)
+ * @param type METRIC_COUNTER или METRIC_GAUGE
+ * @param name Имя семейства
+ * @param help Описание
+ * @param labels Метки серии или NULL
+ */
+void metrics_register(metric_t *metric, metric_type_t type, const char *name,
+                      const char *help, const char *labels);
+
+/**
+ * @brief Регистрация гистограммы задержек
+ *
+ * Имя семейства должно оканчиваться на _seconds: значения выводятся в секундах.
+ */
+void metrics_register_histogram(metric_histogram_t *histogram, const char *name,
+                                const char *help, const char *labels);
+
+/**
+ * @brief Добавление к счетчику
+ *
+ * @return Новое значение счетчика
+ */
+static inline uint32_t metric_add(metric_t *metric, uint32_t value)
+{
+    return metric->value.fetch_add(value, std::memory_order_relaxed) + value;
+}
+
+/**
+ * @brief Установка значения датчика
+ */
+static inline void metric_set(metric_t *metric, uint32_t value)
+{
+    metric->value.store(value, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Текущее значение счетчика или датчика
+ */
+static inline uint32_t metric_get(const metric_t *metric)
+{
+    return metric->value.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Учет одного наблюдения гистограммы
+ *
+ * @param histogram Гистограмма
+ * @param value_us Задержка, мкс
+ */
+void metric_observe_us(metric_histogram_t *histogram, uint32_t value_us);
+
+/**
+ * @brief Вывод запаса стека задачи (comtoair_task_stack_free_bytes)
+ *
+ * Повторная передача той же задачи и NULL игнорируются.
+ *
+ * @param task Задача
+ */
+void metrics_watch_task(TaskHandle_t task);
+
+/**
+ * @brief Вывод всех метрик в текстовом формате Prometheus (version 0.0.4)
+ *
+ * @param sink Функция вывода (порции до size байт)
+ * @param ctx Контекст функции вывода
+ * @param buffer Буфер порций (например, блок пула буферов)
+ * @param size Размер буфера
+ * @return false если вывод был прерван
+ */
+bool metrics_write(metrics_sink_fn sink, void *ctx, char *buffer, size_t size);
+
+#endif // METRICS_H
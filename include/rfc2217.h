@@ -0,0 +1,66 @@
+/**
+ * @file rfc2217.h
+ * @brief Разбор Telnet и опции COM-PORT (RFC 2217) для TCP сервера порта
+ *
+ * Входящий поток Telnet очищается от команд на месте, команды
+ * SET-BAUDRATE / SET-DATASIZE / SET-PARITY / SET-STOPSIZE применяются
+ * через rs232_reconfigure(), ответы накапливаются в reply и должны быть
+ * отправлены клиенту вызывающей стороной.
+ */
+
+#ifndef RFC2217_H
+#define RFC2217_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define RFC2217_REPLY_MAX   64      // Буфер ответов сервера
+#define RFC2217_SB_MAX      16      // Максимальная длина подопции
+
+// Команды Telnet
+#define TELNET_IAC          255
+#define TELNET_DONT         254
+#define TELNET_DO           253
+#define TELNET_WONT         252
+#define TELNET_WILL         251
+#define TELNET_SB           250
+#define TELNET_SE           240
+
+// Опции Telnet
+#define TELNET_OPT_BINARY   0
+#define TELNET_OPT_SGA      3
+#define TELNET_OPT_COM_PORT 44
+
+/**
+ * @brief Состояние Telnet сессии
+ */
+typedef struct {
+    uint8_t state;                      // Состояние разбора
+    uint8_t local_on;                   // Опции, включенные на стороне сервера (биты)
+    uint8_t remote_on;                  // Опции, включенные на стороне клиента (биты)
+    uint8_t sb_len;                     // Длина накопленной подопции
+    uint8_t sb[RFC2217_SB_MAX];         // Подопция (без IAC SB ... IAC SE)
+    uint8_t reply[RFC2217_REPLY_MAX];   // Ответы для отправки клиенту
+    size_t reply_len;
+    bool com_port;                      // Клиент согласовал COM-PORT-OPTION
+} rfc2217_session_t;
+
+/**
+ * @brief Начало сессии: в reply помещается начальное согласование опций
+ */
+void rfc2217_init(rfc2217_session_t *session);
+
+/**
+ * @brief Обработка принятых от клиента байт
+ *
+ * Данные для последовательного порта остаются в начале data.
+ *
+ * @param session Сессия
+ * @param data Принятые байты (изменяются на месте)
+ * @param length Количество принятых байт
+ * @return Количество байт данных для последовательного порта
+ */
+size_t rfc2217_process(rfc2217_session_t *session, uint8_t *data, size_t length);
+
+#endif // RFC2217_H
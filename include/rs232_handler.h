@@ -9,8 +9,12 @@
 #include "driver/uart.h"
 #include "driver/gpio.h"
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 
+// Бесконечное ожидание для rs232_read()
+#define RS232_WAIT_FOREVER  UINT32_MAX
+
 /**
  * @brief Структура конфигурации RS-232
  */
@@ -48,11 +52,20 @@ int rs232_read(uint8_t *buffer, size_t length, uint32_t timeout_ms);
  */
 int rs232_write(const uint8_t *data, size_t length);
 
+/**
+ * @brief Ожидание окончания передачи (буфер драйвера и FIFO пусты)
+ *
+ * @param timeout_ms Таймаут в миллисекундах
+ * @return true если все записанные байты переданы
+ */
+bool rs232_wait_tx_done(uint32_t timeout_ms);
+
 /**
  * @brief Изменение конфигурации RS-232
  * 
  * @param config Новая конфигурация
- * @return true при успешном изменении, false в противном случае
+ * @return true при успешном изменении, false в противном случае (порт
+ *         остается с прежними параметрами)
  */
 bool rs232_reconfigure(const rs232_config_t *config);
 
@@ -68,5 +81,52 @@ void rs232_get_config(rs232_config_t *config);
  */
 void rs232_flush(void);
 
+/**
+ * @brief Проверка корректности конфигурации
+ *
+ * @param config Конфигурация
+ * @return true если параметры поддерживаются портом
+ */
+bool rs232_config_is_valid(const rs232_config_t *config);
+
+/**
+ * @brief Сравнение конфигураций по полям (memcmp учитывал бы выравнивание)
+ */
+bool rs232_config_equal(const rs232_config_t *a, const rs232_config_t *b);
+
+/**
+ * @brief Название режима четности ("none", "odd", "even")
+ */
+const char *rs232_parity_name(uart_parity_t parity);
+
+/**
+ * @brief Разбор названия режима четности
+ *
+ * @return true если название распознано
+ */
+bool rs232_parse_parity(const char *name, uart_parity_t *parity);
+
+/**
+ * @brief Количество бит данных (5..8)
+ */
+int rs232_data_bits_count(uart_word_length_t data_bits);
+
+/**
+ * @brief Количество стоп-бит, умноженное на 2 (2 = 1, 3 = 1.5, 4 = 2)
+ */
+int rs232_stop_bits_x2(uart_stop_bits_t stop_bits);
+
+/**
+ * @brief Очередь событий драйвера UART
+ *
+ * @return Очередь или NULL, если прием идет через UHCI/GDMA
+ */
+QueueHandle_t rs232_get_event_queue(void);
+
+/**
+ * @brief Проверка, что прием идет через UHCI/GDMA (RS232_USE_UHCI_DMA)
+ */
+bool rs232_dma_enabled(void);
+
 #endif // RS232_HANDLER_H
 
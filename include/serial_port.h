@@ -0,0 +1,113 @@
+/**
+ * @file serial_port.h
+ * @brief Несколько последовательных портов на одном устройстве (/api/ports)
+ *
+ * Порт 0 - основной UART (UART_NUM): собственная задача приема с высшим
+ * приоритетом, буфер моста, журнал во флеш и все транспорты (HTTP,
+ * WebSocket, TCP). Функции этого модуля для порта 0 обращаются к тем же
+ * rs232_handler, uart_rx/uart_tx и буферу web_server.
+ *
+ * Порты 1..SERIAL_PORT_COUNT-1 (таблица в config.h) - дополнительные:
+ * у каждого свои параметры линии, буфер данных SERIAL_PORT_BUFFER_SIZE,
+ * счетчики и метрики с меткой port. Все дополнительные порты обслуживает
+ * одна задача port_rx: она ждет события драйверов всех портов сразу и
+ * забирает данные по кругу порциями SERIAL_PORT_READ_CHUNK, поэтому
+ * один быстрый порт не задерживает остальные.
+ *
+ * Бюджет приема (байт/с, маркерная корзина) ограничивает, сколько данных
+ * задача забирает с порта. Сверх бюджета байты копятся в буфере драйвера
+ * этого порта и теряются при его переполнении (overruns), не отнимая
+ * время у других портов и у основного.
+ */
+
+#ifndef SERIAL_PORT_H
+#define SERIAL_PORT_H
+
+#include "rs232_handler.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define SERIAL_PORT_PRIMARY     0
+
+/**
+ * @brief Состояние порта
+ */
+typedef struct {
+    uart_port_t uart;           // Номер UART
+    int tx_pin;
+    int rx_pin;
+    bool running;               // Драйвер установлен, прием идет
+    rs232_config_t config;      // Параметры линии
+    uint32_t budget;            // Бюджет приема, байт/с (0 - без ограничения)
+    uint32_t head;              // Номер следующего байта в буфере порта
+    uint32_t oldest;            // Номер самого старого доступного байта
+    uint32_t rx_bytes;          // Принято байт
+    uint32_t tx_bytes;          // Передано байт
+    uint32_t overruns;          // Переполнения FIFO и буфера драйвера
+    uint32_t errors;            // Ошибки кадра, четности и BREAK
+    uint32_t throttled;         // Проходов, ограниченных бюджетом
+} serial_port_info_t;
+
+/**
+ * @brief Количество портов (SERIAL_PORT_COUNT)
+ */
+int serial_port_count(void);
+
+/**
+ * @brief Запуск дополнительных портов и общей задачи приема
+ *
+ * Вызывается после запуска основного порта. Порт, драйвер которого не
+ * удалось установить, остается в списке с running = false.
+ *
+ * @return false если не удалось запустить задачу приема
+ */
+bool serial_ports_start(void);
+
+/**
+ * @brief Состояние порта
+ *
+ * @return false если номер порта вне диапазона
+ */
+bool serial_port_get_info(int port, serial_port_info_t *info);
+
+/**
+ * @brief Смена параметров линии (принятые байты сохраняются)
+ *
+ * При ошибке драйвера восстанавливаются прежние параметры.
+ *
+ * @return false при неверном номере порта или параметрах
+ */
+bool serial_port_configure(int port, const rs232_config_t *config);
+
+/**
+ * @brief Бюджет приема порта
+ *
+ * @param bytes_per_sec Байт в секунду, 0 - без ограничения
+ * @return false для основного порта (он не ограничивается) и неверного номера
+ */
+bool serial_port_set_budget(int port, uint32_t bytes_per_sec);
+
+/**
+ * @brief Передача в линию порта
+ *
+ * Для основного порта - через очередь uart_tx (uart_tx_write).
+ *
+ * @return Принято к передаче байт
+ */
+size_t serial_port_write(int port, const uint8_t *data, size_t length);
+
+/**
+ * @brief Чтение данных порта начиная с seq (см. byte_ring_read)
+ *
+ * @param port Номер порта
+ * @param seq Порядковый номер следующего байта (обновляется)
+ * @param buffer Буфер для данных
+ * @param length Размер буфера
+ * @param lost Количество потерянных (перезаписанных) байт, может быть NULL
+ * @return Количество прочитанных байт
+ */
+size_t serial_port_read_since(int port, uint32_t *seq, uint8_t *buffer, size_t length,
+                              uint32_t *lost);
+
+#endif // SERIAL_PORT_H
@@ -0,0 +1,66 @@
+/**
+ * @file serial_port_uart.h
+ * @brief Драйвер дополнительных портов (serial_port.h)
+ *
+ * Прошивка (serial_port_uart.cpp): драйвер UART ESP-IDF, события всех
+ * портов собраны в один набор очередей (QueueSet), и общая задача приема
+ * ждет их одним вызовом. Сборка под Linux (serial_port_uart_host.cpp):
+ * порт-петля, переданные байты возвращаются как принятые.
+ *
+ * Номера портов - индексы serial_port.h (1..SERIAL_PORT_COUNT-1).
+ */
+
+#ifndef SERIAL_PORT_UART_H
+#define SERIAL_PORT_UART_H
+
+#include "rs232_handler.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Установка драйвера порта
+ *
+ * Вызывается до serial_port_uart_wait() для всех портов.
+ */
+bool serial_port_uart_open(int port, uart_port_t uart, int tx_pin, int rx_pin,
+                           const rs232_config_t *config);
+
+/**
+ * @brief Смена параметров линии без сброса буферов
+ */
+bool serial_port_uart_set_config(int port, const rs232_config_t *config);
+
+/**
+ * @brief Байт в буфере приема драйвера
+ */
+size_t serial_port_uart_buffered(int port);
+
+/**
+ * @brief Чтение без ожидания
+ *
+ * @return Прочитано байт
+ */
+size_t serial_port_uart_read(int port, uint8_t *buffer, size_t length);
+
+/**
+ * @brief Передача (копируется в буфер передачи драйвера)
+ *
+ * @return Принято байт
+ */
+size_t serial_port_uart_write(int port, const uint8_t *data, size_t length);
+
+/**
+ * @brief Ожидание событий приема на любом из открытых портов
+ *
+ * Разбирает все накопившиеся события и добавляет к счетчикам порта
+ * переполнения (FIFO и буфер драйвера) и ошибки линии.
+ *
+ * @param timeout_ms Наибольшее ожидание
+ * @param overruns Счетчики переполнений по портам (SERIAL_PORT_COUNT)
+ * @param errors Счетчики ошибок по портам (SERIAL_PORT_COUNT)
+ * @return true если пришло хотя бы одно событие
+ */
+bool serial_port_uart_wait(uint32_t timeout_ms, uint32_t *overruns, uint32_t *errors);
+
+#endif // SERIAL_PORT_UART_H
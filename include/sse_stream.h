@@ -0,0 +1,60 @@
+/**
+ * @file sse_stream.h
+ * @brief Поток данных RS-232 как Server-Sent Events (/api/events)
+ *
+ * Для клиентов без WebSocket: браузерный EventSource, curl -N. Соединение
+ * держится асинхронным обработчиком httpd (httpd_req_async_handler_begin),
+ * поэтому задача сервера сразу возвращается к другим запросам. Данные
+ * отправляет задача sse_stream из кольцевого буфера моста по курсору
+ * клиента (слот fanout) и политике пакетирования транспорта sse.
+ *
+ * События потока (text/event-stream):
+ *   id: <seq>
+ *   data: "<данные>"
+ * - данные как JSON строка (байты 0x00-0x1F и 0x80-0xFF - \u00XX, как в
+ *   /api/data) или, с encoding=base64, строка base64. id - номер байта,
+ *   следующего за событием: браузер возвращает его в заголовке
+ *   Last-Event-ID при переподключении, и поток продолжается ровно с этого
+ *   места. Событие не больше SSE_EVENT_MAX_DATA байт данных и при
+ *   выделении кадров заканчивается на границе кадра.
+ *
+ *   event: gap - отставание сверх бюджета (FANOUT_SSE_LAG_BUDGET) или
+ *   перезаписанные данные: {"gap":<пропущено байт>,"seq":<продолжение>}
+ *
+ *   event: status - раз в status мс (по умолчанию SSE_STATUS_DEFAULT_MS):
+ *   {"uptime":<с>,"wifi":"<состояние>","ip":"<адрес>","seq":<голова>};
+ *   без id, поэтому Last-Event-ID не меняет. Заодно проверяет, жив ли
+ *   клиент: сокеты асинхронных запросов сервер не опрашивает.
+ *
+ *   event: trigger - с triggers=1, совпадение образца (trigger.h) на любом
+ *   порту: {"id":..,"trigger":..,"name":..,"port":..,"seq":..,"time_ms":..,
+ *   "before":..,"complete":..,"context":..}; context - байты до конца
+ *   совпадения и принятые после него к моменту отправки (полный контекст -
+ *   /api/triggers/events). Тоже без id.
+ */
+
+#ifndef SSE_STREAM_H
+#define SSE_STREAM_H
+
+#include "esp_http_server.h"
+#include <stdbool.h>
+
+/**
+ * @brief Регистрация обработчика /api/events и запуск задачи рассылки
+ *
+ * @param server Запущенный HTTP сервер
+ * @return true при успешной регистрации, false в противном случае
+ */
+bool sse_stream_register(httpd_handle_t server);
+
+/**
+ * @brief Уведомление о новых данных в буфере (вызывается писателем буфера)
+ */
+void sse_stream_notify(void);
+
+/**
+ * @brief Количество подключенных SSE клиентов
+ */
+int sse_stream_client_count(void);
+
+#endif // SSE_STREAM_H
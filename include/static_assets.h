@@ -0,0 +1,27 @@
+/**
+ * @file static_assets.h
+ * @brief Статические файлы веб-интерфейса, встроенные в прошивку
+ *
+ * Файлы из data/ сжимаются gzip при сборке (tools/gzip_asset.py) и
+ * встраиваются в образ как двоичные данные. Отдаются как есть с
+ * Content-Encoding: gzip, сильным ETag и ответом 304 на If-None-Match.
+ * Страница (index.html) проверяется браузером при каждой загрузке
+ * (no-cache), css и js подключаются по адресам с хешем содержимого
+ * и кешируются как immutable.
+ */
+
+#ifndef STATIC_ASSETS_H
+#define STATIC_ASSETS_H
+
+#include <stdbool.h>
+#include "esp_http_server.h"
+
+/**
+ * @brief Регистрация обработчиков статических файлов ("/" и файлы из data/)
+ *
+ * @param server Запущенный HTTP сервер
+ * @return true при успешной регистрации всех файлов
+ */
+bool static_assets_register(httpd_handle_t server);
+
+#endif // STATIC_ASSETS_H
@@ -0,0 +1,48 @@
+/**
+ * @file tcp_server.h
+ * @brief TCP сервер последовательного порта (в стиле ser2net)
+ *
+ * Два режима:
+ * - прозрачный TCP (TCP_SERIAL_RAW_PORT): байты передаются как есть;
+ * - Telnet с RFC 2217 (TCP_SERIAL_RFC2217_PORT): клиент может менять
+ *   скорость, четность, размер данных и стоп-биты порта.
+ */
+
+#ifndef TCP_SERVER_H
+#define TCP_SERVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Статистика TCP сервера
+ */
+typedef struct {
+    uint32_t clients;           // Подключено клиентов
+    uint32_t accepted;          // Всего принято подключений
+    uint32_t rejected;          // Отклонено (нет свободных слотов)
+    uint32_t tx_bytes;          // Отправлено клиентам байт
+    uint32_t rx_bytes;          // Принято от клиентов и записано в UART
+    uint32_t dropped;           // Пропущено байт из-за отставания клиентов
+} tcp_server_stats_t;
+
+/**
+ * @brief Запуск TCP сервера
+ *
+ * @return true при успешном запуске, false в противном случае
+ */
+bool tcp_server_start(void);
+
+/**
+ * @brief Уведомление о новых данных в буфере (вызывается писателем буфера)
+ */
+void tcp_server_notify(void);
+
+/**
+ * @brief Получение статистики TCP сервера
+ *
+ * @param stats Указатель на структуру для сохранения статистики
+ */
+void tcp_server_get_stats(tcp_server_stats_t *stats);
+
+#endif // TCP_SERVER_H
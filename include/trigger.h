@@ -0,0 +1,132 @@
+/**
+ * @file trigger.h
+ * @brief Триггеры: поиск образцов в принятом потоке (/api/triggers)
+ *
+ * До TRIGGER_MAX_PATTERNS образцов (текст или байты) компилируются в один
+ * автомат Ахо-Корасик: таблица переходов по классам байт (байты, не
+ * встречающиеся в образцах, - класс 0), поэтому на байт потока - одно
+ * обращение к таблице независимо от числа образцов. Память не выделяется.
+ *
+ * Автомат проходит порции каждого порта в задаче приема сразу после
+ * записи в буфер порта. Каждое совпадение увеличивает счетчик образца
+ * (comtoair_trigger_matches_total); не чаще TRIGGER_HOLDOFF_MS на образец
+ * создается событие: снимок контекста из буфера порта
+ * (TRIGGER_CONTEXT_BEFORE байт до конца совпадения и TRIGGER_CONTEXT_AFTER
+ * после, дописываются по мере приема). События хранятся в кольце из
+ * TRIGGER_EVENTS записей и рассылаются подписчикам /api/events?triggers=1.
+ *
+ * Новая конфигурация компилируется в свободную из двух таблиц и
+ * публикуется атомарно; задачи приема переходят на нее с очередной
+ * порцией, состояние автомата порта при этом сбрасывается. Конфигурация
+ * хранится в NVS (trigger_store.h).
+ */
+
+#ifndef TRIGGER_H
+#define TRIGGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "config.h"
+
+#define TRIGGER_ANY_PORT    -1
+
+/**
+ * @brief Образец
+ */
+typedef struct {
+    char name[TRIGGER_NAME_SIZE];
+    uint8_t pattern[TRIGGER_PATTERN_MAX];
+    uint8_t length;                 // 0 - образец не задан
+    int8_t port;                    // Номер порта или TRIGGER_ANY_PORT
+} trigger_def_t;
+
+/**
+ * @brief Набор образцов (хранится в NVS целиком)
+ */
+typedef struct {
+    trigger_def_t defs[TRIGGER_MAX_PATTERNS];
+} trigger_config_t;
+
+/**
+ * @brief Счетчики образца
+ */
+typedef struct {
+    uint32_t matches;               // Всего совпадений
+    uint32_t events;                // Из них с событием (вне паузы TRIGGER_HOLDOFF_MS)
+    uint32_t last_seq;              // Номер байта после последнего совпадения
+    uint32_t last_ms;               // Время последнего совпадения, мс от запуска
+} trigger_stats_t;
+
+/**
+ * @brief Событие: совпадение и контекст вокруг него
+ */
+typedef struct {
+    uint32_t id;                    // Номер события (растет с 0)
+    uint8_t trigger;                // Индекс образца
+    uint8_t port;
+    uint32_t seq;                   // Номер байта после совпадения в потоке порта
+    uint32_t time_ms;               // Время приема порции с совпадением
+    uint16_t before;                // Байт контекста до seq (совпадение входит)
+    uint16_t after;                 // Байт контекста после seq
+    bool complete;                  // Контекст после совпадения собран
+    uint8_t context[TRIGGER_CONTEXT_BEFORE + TRIGGER_CONTEXT_AFTER];
+} trigger_event_t;
+
+/**
+ * @brief Загрузка образцов из NVS и компиляция (после инициализации NVS)
+ */
+void trigger_init(void);
+
+/**
+ * @brief Компиляция и применение набора образцов
+ *
+ * @param config Набор
+ * @param persist Сохранить в NVS
+ * @param error Причина отказа (может быть NULL)
+ * @return false если набор не помещается в таблицы автомата
+ */
+bool trigger_set_config(const trigger_config_t *config, bool persist, const char **error);
+
+/**
+ * @brief Текущий набор образцов
+ */
+void trigger_get_config(trigger_config_t *config);
+
+/**
+ * @brief Занято состояний и классов байт текущим автоматом
+ */
+void trigger_get_usage(uint32_t *states, uint32_t *classes);
+
+/**
+ * @brief Счетчики образца (индекс 0..TRIGGER_MAX_PATTERNS-1)
+ */
+void trigger_get_stats(int index, trigger_stats_t *stats);
+
+/**
+ * @brief Порция принятых данных порта (только из задачи приема порта,
+ *        после записи порции в буфер порта)
+ *
+ * @param port Номер порта
+ * @param data Данные
+ * @param length Длина данных
+ * @param end_seq Номер байта после порции в буфере порта
+ * @param now_us Время приема порции, мкс
+ * @return true если создано новое событие
+ */
+bool trigger_feed(int port, const uint8_t *data, size_t length, uint32_t end_seq,
+                  uint64_t now_us);
+
+/**
+ * @brief Номер следующего события
+ */
+uint32_t trigger_event_head(void);
+
+/**
+ * @brief Копия события по номеру
+ *
+ * @return false если событие еще не создано или уже вытеснено
+ */
+bool trigger_get_event(uint32_t id, trigger_event_t *event);
+
+#endif // TRIGGER_H
@@ -0,0 +1,27 @@
+/**
+ * @file trigger_store.h
+ * @brief Хранение набора образцов триггеров (trigger.h)
+ *
+ * Прошивка (trigger_store.cpp): блоб в NVS, пространство имен
+ * TRIGGER_NVS_NAMESPACE. Сборка под Linux (trigger_store_host.cpp):
+ * копия в памяти процесса.
+ */
+
+#ifndef TRIGGER_STORE_H
+#define TRIGGER_STORE_H
+
+#include "trigger.h"
+
+/**
+ * @brief Чтение сохраненного набора
+ *
+ * @return false если набора нет или он другого размера
+ */
+bool trigger_store_load(trigger_config_t *config);
+
+/**
+ * @brief Сохранение набора
+ */
+bool trigger_store_save(const trigger_config_t *config);
+
+#endif // TRIGGER_STORE_H
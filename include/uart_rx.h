@@ -0,0 +1,73 @@
+/**
+ * @file uart_rx.h
+ * @brief Событийный приемный тракт UART
+ *
+ * Задача приема спит на очереди событий драйвера UART и просыпается только
+ * по прерыванию (порог FIFO, таймаут приема или обнаружение шаблона).
+ * Принятые байты сразу передаются в буфер моста (web_server_set_data).
+ */
+
+#ifndef UART_RX_H
+#define UART_RX_H
+
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Статистика приемного тракта
+ */
+typedef struct {
+    uint32_t rx_bytes;          // Принято байт
+    uint32_t data_events;       // События UART_DATA
+    uint32_t timeout_events;    // Из них по таймауту приема (пауза в линии)
+    uint32_t fifo_overflows;    // Переполнения аппаратного FIFO
+    uint32_t buffer_full;       // Переполнения кольцевого буфера драйвера
+    uint32_t breaks;            // Сигналы BREAK в линии
+    uint32_t frame_errors;      // Ошибки кадра
+    uint32_t parity_errors;     // Ошибки четности
+    uint32_t pattern_events;    // Срабатывания детектора шаблона
+    uint32_t jitter_samples;    // Замеров дрожания (пробуждения по порогу FIFO подряд)
+    uint32_t jitter_sum_us;     // Сумма отклонений пробуждений, мкс (по модулю 2^32)
+} uart_rx_stats_t;
+
+/**
+ * @brief Настройка порогов прерываний приема (UART_RX_FULL_THRESH, UART_RX_TIMEOUT_SYMBOLS)
+ *
+ * Вызывается после uart_driver_install() и uart_param_config().
+ *
+ * @param port Номер UART
+ * @return true при успешной настройке, false в противном случае
+ */
+bool uart_rx_configure(uart_port_t port);
+
+/**
+ * @brief Запуск задачи приема
+ *
+ * @param port Номер UART
+ * @param event_queue Очередь событий драйвера (rs232_get_event_queue());
+ *                    NULL - блокирующее чтение rs232_read() (UHCI/GDMA,
+ *                    сборка под Linux)
+ * @return true при успешном запуске, false в противном случае
+ */
+bool uart_rx_start(uart_port_t port, QueueHandle_t event_queue);
+
+/**
+ * @brief Получение статистики приемного тракта
+ *
+ * @param stats Указатель на структуру для сохранения статистики
+ */
+void uart_rx_get_stats(uart_rx_stats_t *stats);
+
+/**
+ * @brief Наибольшее отклонение пробуждения задачи приема от скорости линии
+ *
+ * Считается только при непрерывном приеме через очередь событий драйвера.
+ *
+ * @return Отклонение с предыдущего вызова, мкс (значение сбрасывается)
+ */
+uint32_t uart_rx_take_jitter_max(void);
+
+#endif // UART_RX_H
@@ -0,0 +1,149 @@
+/**
+ * @file uart_tx.h
+ * @brief Очередь передачи в UART
+ *
+ * Все писатели порта (POST /api/send, WebSocket, TCP клиенты) ставят
+ * данные в ограниченную очередь, которую разбирает задача передачи.
+ * Писатель не ждет линии: данные копируются в слот очереди, а драйвер
+ * передает их из своего кольцевого буфера (UART_TX_RING_SIZE).
+ *
+ * Для медленных устройств передача может идти с паузами между байтами
+ * и после посылки. Посылка с ожиданием ответа занимает линию до
+ * ответа или таймаута: следующая посылка уходит только после этого,
+ * поэтому принятые за это время байты относятся к ней (запрос-ответ).
+ */
+
+#ifndef UART_TX_H
+#define UART_TX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief Параметры посылки
+ */
+typedef struct {
+    uint32_t char_gap_us;       // Пауза между байтами (0 - без пауз)
+    uint32_t frame_gap_ms;      // Пауза после посылки перед следующей
+    uint32_t timeout_ms;        // Ожидание ответа (0 - не ждать)
+} uart_tx_options_t;
+
+/**
+ * @brief Состояние посылки
+ */
+typedef enum {
+    UART_TX_QUEUED = 0,         // В очереди
+    UART_TX_SENDING,            // Передается
+    UART_TX_WAITING,            // Передана, ждет ответа
+    UART_TX_DONE,               // Передана (и получен ответ, если его ждали)
+    UART_TX_TIMEOUT,            // Ответ не завершился за timeout_ms
+    UART_TX_FAILED,             // Драйвер не принял данные
+} uart_tx_state_t;
+
+/**
+ * @brief Результат посылки
+ *
+ * Ответ - байты буфера моста [rx_seq, rx_seq + rx_length): принятые
+ * с начала передачи до завершения ответа (конец кадра при выделении
+ * кадров, иначе пауза UART_TX_RESPONSE_IDLE_MS после последнего байта).
+ */
+typedef struct {
+    uint32_t id;
+    uart_tx_state_t state;
+    uint32_t length;            // Байт посылки
+    uint32_t sent;              // Передано байт
+    uint32_t rx_seq;            // Номер первого байта ответа
+    uint32_t rx_length;         // Байт ответа
+    uint32_t elapsed_us;        // От начала передачи до завершения
+} uart_tx_result_t;
+
+/**
+ * @brief Статистика очереди передачи
+ */
+typedef struct {
+    uint32_t depth;             // Посылок в очереди
+    uint32_t submitted;         // Принято посылок
+    uint32_t rejected;          // Отклонено: очередь заполнена
+    uint32_t tx_bytes;          // Передано байт
+    uint32_t timeouts;          // Ответ не дождались
+} uart_tx_stats_t;
+
+/**
+ * @brief Вызывается задачей передачи по завершении посылки
+ */
+typedef void (*uart_tx_done_fn)(uint32_t id, void *ctx);
+
+/**
+ * @brief Запуск задачи передачи
+ *
+ * @return true при успешном запуске, false в противном случае
+ */
+bool uart_tx_start(void);
+
+/**
+ * @brief Постановка посылки в очередь
+ *
+ * @param data Данные (копируются)
+ * @param length Длина, 1..UART_TX_MAX_PAYLOAD
+ * @param options Параметры или NULL (без пауз и ожидания ответа)
+ * @param wait Ожидание свободного слота (0 - сразу отказать)
+ * @param done Вызов по завершении или NULL
+ * @param ctx Контекст done
+ * @param id Номер посылки (выход), может быть NULL
+ * @return ESP_OK; ESP_ERR_INVALID_SIZE - неверная длина;
+ *         ESP_ERR_INVALID_ARG - параметры сверх пределов;
+ *         ESP_ERR_TIMEOUT - очередь заполнена; ESP_ERR_INVALID_STATE - не запущена
+ */
+esp_err_t uart_tx_submit(const uint8_t *data, size_t length, const uart_tx_options_t *options,
+                         TickType_t wait, uart_tx_done_fn done, void *ctx, uint32_t *id);
+
+/**
+ * @brief Передача потока без разметки (TCP, WebSocket)
+ *
+ * Делит данные на посылки по UART_TX_MAX_PAYLOAD и ждет свободных
+ * слотов не дольше wait на каждую.
+ *
+ * @return Поставлено в очередь байт
+ */
+size_t uart_tx_write(const uint8_t *data, size_t length, TickType_t wait);
+
+/**
+ * @brief В очереди есть свободный слот (посылка встанет без ожидания)
+ */
+bool uart_tx_has_room(void);
+
+/**
+ * @brief Результат посылки по номеру
+ *
+ * Хранятся результаты последних UART_TX_RESULTS посылок.
+ *
+ * @return false если номер неизвестен или результат уже вытеснен
+ */
+bool uart_tx_get_result(uint32_t id, uart_tx_result_t *result);
+
+/**
+ * @brief Посылка завершена (DONE, TIMEOUT или FAILED)
+ */
+bool uart_tx_finished(uart_tx_state_t state);
+
+/**
+ * @brief Название состояния ("queued", "sending", ...)
+ */
+const char *uart_tx_state_name(uart_tx_state_t state);
+
+/**
+ * @brief Статистика очереди
+ */
+void uart_tx_get_stats(uart_tx_stats_t *stats);
+
+/**
+ * @brief Приняты данные или пауза на линии (вызывается писателем буфера)
+ *
+ * Будит задачу передачи, только если она ждет ответа.
+ */
+void uart_tx_notify(void);
+
+#endif // UART_TX_H
@@ -8,6 +8,8 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
+#include "framer.h"
 
 /**
  * @brief Инициализация и запуск веб-сервера
@@ -39,6 +41,112 @@ size_t web_server_get_data(uint8_t *buffer, size_t length);
  */
 void web_server_set_data(const uint8_t *data, size_t length);
 
+/**
+ * @brief Чтение данных начиная с порядкового номера
+ *
+ * Позволяет клиенту продолжать чтение с того места, где он остановился,
+ * не теряя байты между опросами.
+ *
+ * @param seq Порядковый номер следующего байта (обновляется)
+ * @param buffer Буфер для данных
+ * @param length Размер буфера
+ * @param lost Количество потерянных (перезаписанных) байт, может быть NULL
+ * @return Количество прочитанных байт
+ */
+size_t web_server_read_since(uint32_t *seq, uint8_t *buffer, size_t length, uint32_t *lost);
+
+/**
+ * @brief Порядковый номер следующего байта (общее количество принятых байт)
+ */
+uint32_t web_server_data_seq(void);
+
+/**
+ * @brief Порядковый номер самого старого байта, еще хранящегося в буфере
+ */
+uint32_t web_server_data_oldest(void);
+
+/**
+ * @brief Количество байт, доступных для чтения начиная с seq
+ */
+uint32_t web_server_data_pending(uint32_t seq);
+
+/**
+ * @brief Количество байт, которые можно отдать клиенту начиная с seq
+ *
+ * Без выделения кадров равно web_server_data_pending(), иначе - байты
+ * до конца последнего выделенного кадра (или части длинного кадра).
+ */
+uint32_t web_server_data_ready(uint32_t seq);
+
+/**
+ * @brief Пауза на линии (вызывается задачей приема, единственным писателем)
+ *
+ * В режиме FRAMER_IDLE завершает начатый кадр.
+ */
+void web_server_data_idle(void);
+
+/**
+ * @brief Есть кадр FRAMER_IDLE, ожидающий паузы (для задачи приема)
+ */
+bool web_server_framing_pending(void);
+
+/**
+ * @brief Включено выделение кадров
+ *
+ * Тогда web_server_data_ready() отдает только завершенные кадры.
+ */
+bool web_server_framing_active(void);
+
+/**
+ * @brief Смена параметров выделения кадров
+ *
+ * Параметры применяются писателем перед следующей порцией данных (или
+ * паузой); начатый кадр при этом сбрасывается.
+ *
+ * @param config Параметры
+ * @return false если параметры недопустимы
+ */
+bool web_server_set_framer(const framer_config_t *config);
+
+/**
+ * @brief Текущие параметры выделения кадров
+ */
+void web_server_get_framer(framer_config_t *config);
+
+/**
+ * @brief Время приема байта seq (для задержки от UART до клиента)
+ *
+ * Хранится время последних DATA_RX_TIME_SLOTS порций.
+ *
+ * @param seq Порядковый номер байта
+ * @param time_us Время приема, младшие 32 бита esp_timer_get_time() (выход)
+ * @return false если байт еще не принят или его порция слишком старая
+ */
+bool web_server_data_rx_time(uint32_t seq, uint32_t *time_us);
+
+/**
+ * @brief Восстановление буфера моста после программного сброса
+ *
+ * Буфер и его границы хранятся в памяти noinit: после паники, сторожевого
+ * таймера или esp_restart принятые до сброса байты снова доступны под
+ * прежними номерами (клиент продолжает с того же since), а еще не
+ * записанные во флеш попадают в журнал flash_log. После включения питания
+ * буфер начинается пустым. Вызывается в начале app_main, до запуска приема.
+ *
+ * @return Байт, переживших сброс
+ */
+uint32_t web_server_restore_data(void);
+
+/**
+ * @brief Данные до seq записаны во флеш (вызывается задачей flash_log)
+ */
+void web_server_data_persisted(uint32_t seq);
+
+/**
+ * @brief Номер первого байта буфера, еще не записанного во флеш
+ */
+uint32_t web_server_data_unpersisted(void);
+
 /**
  * @brief Проверка статуса веб-сервера
  * 
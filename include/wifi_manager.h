@@ -1,6 +1,21 @@
 /**
  * @file wifi_manager.h
  * @brief Управление WiFi подключением
+ *
+ * Режимы: точка доступа, станция или оба сразу (станция подключается к
+ * сети предприятия, точка доступа остается для настройки на месте).
+ * Конфигурация хранится в NVS и применяется на лету (POST /api/wifi).
+ *
+ * Переподключение станции:
+ * - первая попытка сразу после потери связи, далее пауза растет вдвое от
+ *   WIFI_BACKOFF_MIN_MS до WIFI_BACKOFF_MAX_MS (со случайным разбросом);
+ *   пока точка доступа просто не видна, пауза не превышает
+ *   WIFI_BACKOFF_ABSENT_MAX_MS: такая попытка - один запрос на одном канале;
+ * - BSSID и канал последнего подключения запоминаются (в NVS), и попытка
+ *   идет сразу к этой точке без полного сканирования; каждая
+ *   WIFI_FULL_SCAN_EVERY-я неудачная попытка сканирует все каналы
+ *   (точка могла сменить канал или сеть - точку);
+ * - потеря маяков обнаруживается за WIFI_BEACON_TIMEOUT_S секунд.
  */
 
 #ifndef WIFI_MANAGER_H
@@ -11,21 +26,37 @@
 
 /**
  * @brief Режим работы WiFi
+ *
+ * Имена отличаются от wifi_mode_t ESP-IDF (WIFI_MODE_STA и т.п.).
  */
 typedef enum {
-    WIFI_MODE_STATION,     // Режим станции (подключение к сети)
-    WIFI_MODE_AP,          // Режим точки доступа
-    WIFI_MODE_APSTA        // Режим точка доступа + станция
-} wifi_mode_t;
+    WIFI_MANAGER_STA = 0,       // Режим станции (подключение к сети)
+    WIFI_MANAGER_AP,            // Режим точки доступа
+    WIFI_MANAGER_APSTA,         // Режим точка доступа + станция
+} wifi_manager_mode_t;
+
+/**
+ * @brief Энергосбережение станции (задержка против нагрева и потребления)
+ */
+typedef enum {
+    WIFI_MANAGER_PS_NONE = 0,   // Радио всегда включено: наименьшая задержка
+    WIFI_MANAGER_PS_MIN,        // Сон между маяками (DTIM): +до 100 мс к задержке приема
+    WIFI_MANAGER_PS_MAX,        // Сон по listen interval: наибольшая задержка
+} wifi_manager_ps_t;
 
 /**
  * @brief Структура конфигурации WiFi
  */
 typedef struct {
-    char ssid[32];          // SSID сети
-    char password[64];       // Пароль сети
-    wifi_mode_t mode;       // Режим работы
-} wifi_config_t;
+    wifi_manager_mode_t mode;   // Режим работы
+    char ssid[33];              // SSID сети (станция)
+    char password[65];          // Пароль сети (пустой - открытая сеть)
+    char ap_ssid[33];           // SSID точки доступа
+    char ap_password[65];       // Пароль точки доступа (пустой - открытая, иначе от 8 символов)
+    uint8_t ap_channel;         // Канал точки доступа (в режиме APSTA - канал сети)
+    wifi_manager_ps_t power_save;
+    uint8_t tx_power_dbm;       // Наибольшая мощность передатчика, дБм (0 - по умолчанию)
+} wifi_manager_config_t;
 
 /**
  * @brief Статус подключения WiFi
@@ -34,19 +65,44 @@ typedef enum {
     WIFI_STATUS_DISCONNECTED,
     WIFI_STATUS_CONNECTING,
     WIFI_STATUS_CONNECTED,
-    WIFI_STATUS_ERROR
+    WIFI_STATUS_ERROR           // Отказ в подключении (пароль, защита); попытки продолжаются
 } wifi_status_t;
 
+/**
+ * @brief Состояние станции и счетчики переподключений
+ */
+typedef struct {
+    wifi_status_t status;
+    char ip[16];                // Адрес станции (пустая строка без подключения)
+    uint8_t bssid[6];           // Точка доступа, к которой подключены (или из кэша)
+    uint8_t channel;
+    int8_t rssi;                // Уровень сигнала, дБм (0 без подключения)
+    bool fast_reconnect;        // Известны BSSID и канал: подключение без сканирования
+    uint32_t connects;          // Получений адреса
+    uint32_t disconnects;       // Потерь подключения
+    uint32_t attempt;           // Номер текущей попытки (0 - подключены или не пытаемся)
+    uint32_t retry_delay_ms;    // Пауза перед текущей попыткой
+    uint32_t last_reason;       // Причина последнего отключения (wifi_err_reason_t)
+    uint32_t last_connect_ms;   // От последней попытки до получения адреса
+    uint32_t last_outage_ms;    // От потери подключения до получения адреса
+    uint8_t ap_clients;         // Клиентов точки доступа
+} wifi_manager_info_t;
+
 /**
  * @brief Инициализация WiFi
- * 
+ *
+ * Читает конфигурацию из NVS (nvs_flash_init() уже вызван) или берет
+ * значения по умолчанию (WIFI_*_DEFAULT в config.h) и запускает WiFi.
+ *
  * @return true при успешной инициализации, false в противном случае
  */
 bool wifi_manager_init(void);
 
 /**
  * @brief Настройка WiFi в режиме точки доступа
- * 
+ *
+ * Режим станции сменяется на APSTA, остальные настройки сохраняются.
+ *
  * @param ssid SSID точки доступа
  * @param password Пароль точки доступа
  * @return true при успешной настройке, false в противном случае
@@ -55,7 +111,11 @@ bool wifi_setup_ap(const char *ssid, const char *password);
 
 /**
  * @brief Подключение к WiFi сети
- * 
+ *
+ * Режим точки доступа сменяется на APSTA (точка остается для настройки).
+ * Ожидает подключения не дольше WIFI_CONNECT_TIMEOUT_MS; после таймаута
+ * попытки продолжаются в фоне.
+ *
  * @param ssid SSID сети
  * @param password Пароль сети
  * @return true при успешном подключении, false в противном случае
@@ -64,31 +124,81 @@ bool wifi_connect_station(const char *ssid, const char *password);
 
 /**
  * @brief Получение статуса подключения
- * 
- * @return Текущий статус подключения
+ *
+ * @return Текущий статус подключения станции
  */
 wifi_status_t wifi_get_status(void);
 
 /**
  * @brief Получение IP адреса
- * 
+ *
  * @param ip_str Буфер для строки с IP адресом (минимум 16 символов)
- * @return true если IP адрес получен, false в противном случае
+ * @return true если IP адрес получен (станции, иначе точки доступа), false в противном случае
  */
 bool wifi_get_ip_address(char *ip_str);
 
 /**
  * @brief Отключение от WiFi сети
+ *
+ * Попытки переподключения прекращаются до следующей смены конфигурации.
  */
 void wifi_disconnect(void);
 
 /**
  * @brief Изменение конфигурации WiFi
- * 
+ *
+ * Конфигурация проверяется, сохраняется в NVS и применяется без
+ * перезапуска; подключенная станция переподключается, только если
+ * изменились SSID или пароль.
+ *
  * @param config Новая конфигурация
  * @return true при успешном изменении, false в противном случае
  */
-bool wifi_reconfigure(const wifi_config_t *config);
+bool wifi_reconfigure(const wifi_manager_config_t *config);
 
-#endif // WIFI_MANAGER_H
+/**
+ * @brief Текущая конфигурация
+ */
+void wifi_manager_get_config(wifi_manager_config_t *config);
+
+/**
+ * @brief Состояние станции и счетчики
+ */
+void wifi_manager_get_info(wifi_manager_info_t *info);
+
+/**
+ * @brief Конфигурация по умолчанию (WIFI_*_DEFAULT в config.h)
+ */
+void wifi_manager_default_config(wifi_manager_config_t *config);
+
+/**
+ * @brief Проверка конфигурации (длины SSID и паролей, канал, мощность)
+ */
+bool wifi_manager_config_valid(const wifi_manager_config_t *config);
+
+/**
+ * @brief Название режима ("sta", "ap", "apsta")
+ */
+const char *wifi_manager_mode_name(wifi_manager_mode_t mode);
+
+/**
+ * @brief Разбор названия режима
+ */
+bool wifi_manager_parse_mode(const char *name, wifi_manager_mode_t *mode);
+
+/**
+ * @brief Название режима энергосбережения ("none", "min", "max")
+ */
+const char *wifi_manager_ps_name(wifi_manager_ps_t ps);
+
+/**
+ * @brief Разбор названия режима энергосбережения
+ */
+bool wifi_manager_parse_ps(const char *name, wifi_manager_ps_t *ps);
 
+/**
+ * @brief Название статуса ("disconnected", "connecting", "connected", "error")
+ */
+const char *wifi_status_name(wifi_status_t status);
+
+#endif // WIFI_MANAGER_H
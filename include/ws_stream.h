@@ -0,0 +1,58 @@
+/**
+ * @file ws_stream.h
+ * @brief Потоковая передача данных RS-232 через WebSocket (/ws/stream)
+ *
+ * Каждый клиент имеет собственный курсор (слот fanout) в кольцевом буфере
+ * данных. Данные отправляются бинарными кадрами прямо из буфера, накопленными
+ * по политике пакетирования транспорта (batch_policy.h). Медленный
+ * клиент не задерживает ни задачу приема UART, ни других клиентов: кадр ему
+ * отправляется только когда предыдущий доставлен и сокет готов к записи.
+ * Отставание сверх бюджета (FANOUT_WS_LAG_BUDGET) по политике транспорта
+ * либо сообщается текстовым кадром {"gap":<пропущено>,"seq":<продолжение>},
+ * либо приводит к отключению клиента.
+ *
+ * С параметром frames=1 клиент получает выделенные кадры (framer.h) из
+ * журнала: бинарный кадр WebSocket - пачка записей, каждая с заголовком
+ * из 16 байт (little-endian): номер записи u32, время приема первого байта
+ * u64 (мкс), длина u16, флаги FRAMER_FLAG_* u8, резерв u8 - и данными.
+ * Пачка отправляется при накоплении WS_BATCH_FRAMES записей или по истечении
+ * max_delay_us политики пакетирования. Пропуск сообщается кадром {"gap":<записей>,"seq":<номер>}.
+ *
+ * Кадры от клиента (текстовые и бинарные, до UART_TX_MAX_PAYLOAD байт)
+ * передаются в порт через очередь передачи (uart_tx.h). Если очередь
+ * заполнена, клиент получает кадр {"tx_rejected":<байт>}.
+ */
+
+#ifndef WS_STREAM_H
+#define WS_STREAM_H
+
+#include "esp_http_server.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Регистрация обработчика /ws/stream и запуск задачи рассылки
+ *
+ * @param server Запущенный HTTP сервер
+ * @return true при успешной регистрации, false в противном случае
+ */
+bool ws_stream_register(httpd_handle_t server);
+
+/**
+ * @brief Уведомление о новых данных в буфере (вызывается писателем буфера)
+ */
+void ws_stream_notify(void);
+
+/**
+ * @brief Обработка закрытия сокета сервером
+ *
+ * @param sockfd Дескриптор закрытого сокета
+ */
+void ws_stream_on_close(int sockfd);
+
+/**
+ * @brief Количество подключенных WebSocket клиентов
+ */
+int ws_stream_client_count(void);
+
+#endif // WS_STREAM_H
@@ -0,0 +1,229 @@
+/**
+ * @file batch_policy.cpp
+ * @brief Политика пакетирования отправки данных RS-232 клиентам
+ *
+ * Параметры транспортов - атомарные поля (меняет обработчик HTTP, читают
+ * задачи отправки). Скорость поступления оценивает писатель буфера:
+ * экспоненциальное среднее интервала между порциями и размера порции
+ * (вес нового значения 1/8), опубликованное атомарно.
+ */
+
+#include "batch_policy.h"
+#include "config.h"
+#include "metrics.h"
+#include "boot.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include "lwip/sockets.h"
+#include "esp_log.h"
+
+static const char *TAG = "Batch";
+
+// Интервал после долгой паузы ограничивается, чтобы среднее быстро
+// вернулось к скорости следующего потока
+#define BATCH_INTERVAL_CAP_US   1000000
+#define BATCH_EWMA_SHIFT        3
+
+static const char *const mode_names[BATCH_MODE_COUNT] = {
+    "immediate", "fixed", "adaptive", "nagle",
+};
+
+/**
+ * @brief Параметры и статистика транспорта
+ */
+typedef struct {
+    std::atomic<uint8_t> mode;
+    std::atomic<uint32_t> max_bytes;
+    std::atomic<uint32_t> max_delay_us;
+    std::atomic<bool> flush_on_frame;
+    char labels[24];
+    metric_t packets;
+    metric_t bytes;
+} batch_transport_t;
+
+static batch_transport_t transports[FANOUT_TRANSPORT_COUNT];
+static std::atomic<uint32_t> config_version(0);
+static std::atomic<bool> initialized(false);
+
+// Оценка скорости: пишет только batch_observe()
+static int64_t last_chunk_us = 0;
+static uint32_t interval_avg_us = 0;
+static uint32_t chunk_avg = 0;
+static std::atomic<uint32_t> rate_interval_us(0);
+static std::atomic<uint32_t> rate_chunk_bytes(0);
+
+static void store_config(batch_transport_t *t, const batch_config_t *config)
+{
+    t->mode.store((uint8_t)config->mode, std::memory_order_relaxed);
+    t->max_bytes.store(config->max_bytes, std::memory_order_relaxed);
+    t->max_delay_us.store(config->max_delay_us, std::memory_order_relaxed);
+    t->flush_on_frame.store(config->flush_on_frame, std::memory_order_relaxed);
+    config_version.fetch_add(1, std::memory_order_release);
+}
+
+void batch_init(void)
+{
+    bool expected = false;
+    if (!initialized.compare_exchange_strong(expected, true)) {
+        return;
+    }
+
+    static const batch_config_t defaults[FANOUT_TRANSPORT_COUNT] = {
+        { BATCH_HTTP_MODE, BATCH_HTTP_MAX_BYTES, BATCH_HTTP_MAX_DELAY_US, BATCH_FLUSH_ON_FRAME },
+        { BATCH_WS_MODE, BATCH_WS_MAX_BYTES, BATCH_WS_MAX_DELAY_US, BATCH_FLUSH_ON_FRAME },
+        { BATCH_TCP_MODE, BATCH_TCP_MAX_BYTES, BATCH_TCP_MAX_DELAY_US, BATCH_FLUSH_ON_FRAME },
+        { BATCH_SSE_MODE, BATCH_SSE_MAX_BYTES, BATCH_SSE_MAX_DELAY_US, BATCH_FLUSH_ON_FRAME },
+    };
+
+    for (int i = 0; i < FANOUT_TRANSPORT_COUNT; i++) {
+        batch_transport_t *t = &transports[i];
+        store_config(t, &defaults[i]);
+        snprintf(t->labels, sizeof(t->labels), "transport=\"%s\"",
+                 fanout_transport_name((fanout_transport_t)i));
+        metrics_register(&t->packets, METRIC_COUNTER, "comtoair_batch_packets_total",
+                         "Responses, frames or send() calls carrying serial data", t->labels);
+        metrics_register(&t->bytes, METRIC_COUNTER, "comtoair_batch_bytes_total",
+                         "Serial data bytes sent to clients", t->labels);
+    }
+}
+
+bool batch_set_config(fanout_transport_t transport, const batch_config_t *config)
+{
+    if (config->mode < 0 || config->mode >= BATCH_MODE_COUNT || config->max_bytes == 0 ||
+        config->max_bytes > DATA_BUFFER_SIZE || config->max_delay_us > BATCH_MAX_DELAY_LIMIT_US) {
+        return false;
+    }
+    batch_init();
+    store_config(&transports[transport], config);
+    ESP_LOGI(TAG, "%s: %s, %lu bytes, %lu us%s", fanout_transport_name(transport),
+             mode_names[config->mode], (unsigned long)config->max_bytes,
+             (unsigned long)config->max_delay_us, config->flush_on_frame ? ", frame flush" : "");
+    return true;
+}
+
+void batch_get_config(fanout_transport_t transport, batch_config_t *config)
+{
+    batch_init();
+    const batch_transport_t *t = &transports[transport];
+    config->mode = (batch_mode_t)t->mode.load(std::memory_order_relaxed);
+    config->max_bytes = t->max_bytes.load(std::memory_order_relaxed);
+    config->max_delay_us = t->max_delay_us.load(std::memory_order_relaxed);
+    config->flush_on_frame = t->flush_on_frame.load(std::memory_order_relaxed);
+}
+
+uint32_t batch_config_version(void)
+{
+    return config_version.load(std::memory_order_acquire);
+}
+
+void batch_observe(size_t length, int64_t now_us)
+{
+    if (last_chunk_us != 0) {
+        int64_t interval = now_us - last_chunk_us;
+        uint32_t sample = interval > BATCH_INTERVAL_CAP_US ? BATCH_INTERVAL_CAP_US
+                                                           : (uint32_t)interval;
+        if (interval_avg_us == 0) {
+            interval_avg_us = sample;
+        } else {
+            interval_avg_us += ((int32_t)sample - (int32_t)interval_avg_us) >> BATCH_EWMA_SHIFT;
+        }
+        rate_interval_us.store(interval_avg_us, std::memory_order_relaxed);
+    }
+    last_chunk_us = now_us;
+
+    uint32_t size = length > DATA_BUFFER_SIZE ? DATA_BUFFER_SIZE : (uint32_t)length;
+    if (chunk_avg == 0) {
+        chunk_avg = size;
+    } else {
+        chunk_avg += ((int32_t)size - (int32_t)chunk_avg) >> BATCH_EWMA_SHIFT;
+    }
+    rate_chunk_bytes.store(chunk_avg > 0 ? chunk_avg : 1, std::memory_order_relaxed);
+}
+
+void batch_get_rate(batch_rate_t *rate)
+{
+    rate->interval_us = rate_interval_us.load(std::memory_order_relaxed);
+    rate->chunk_bytes = rate_chunk_bytes.load(std::memory_order_relaxed);
+}
+
+uint32_t batch_wait_us(fanout_transport_t transport, uint32_t pending, bool frame_ready,
+                       int64_t pending_since_us, int64_t now_us)
+{
+    const batch_transport_t *t = &transports[transport];
+    batch_mode_t mode = (batch_mode_t)t->mode.load(std::memory_order_relaxed);
+    uint32_t max_bytes = t->max_bytes.load(std::memory_order_relaxed);
+    uint32_t limit_us = t->max_delay_us.load(std::memory_order_relaxed);
+
+    if (mode == BATCH_MODE_IMMEDIATE || mode == BATCH_MODE_NAGLE || pending >= max_bytes ||
+        (frame_ready && t->flush_on_frame.load(std::memory_order_relaxed))) {
+        return 0;
+    }
+
+    if (mode == BATCH_MODE_ADAPTIVE) {
+        uint32_t interval = rate_interval_us.load(std::memory_order_relaxed);
+        uint32_t chunk = rate_chunk_bytes.load(std::memory_order_relaxed);
+        if (interval == 0 || interval >= limit_us) {
+            // Редкие порции: ожидание не наберет данных, только задержит
+            return 0;
+        }
+        // Время, за которое при текущей скорости наберется max_bytes
+        uint32_t chunks = (max_bytes - pending + chunk - 1) / chunk;
+        uint64_t fill_us = (uint64_t)chunks * interval;
+        if (fill_us < limit_us) {
+            limit_us = (uint32_t)fill_us;
+        }
+    }
+
+    int64_t age_us = now_us - pending_since_us;
+    if (age_us >= (int64_t)limit_us) {
+        return 0;
+    }
+    return limit_us - (uint32_t)age_us;
+}
+
+void batch_sent(fanout_transport_t transport, uint32_t bytes)
+{
+    boot_mark(BOOT_STAGE_FIRST_FORWARD);
+    metric_add(&transports[transport].packets, 1);
+    metric_add(&transports[transport].bytes, bytes);
+}
+
+void batch_get_stats(fanout_transport_t transport, batch_stats_t *stats)
+{
+    stats->packets = metric_get(&transports[transport].packets);
+    stats->bytes = metric_get(&transports[transport].bytes);
+}
+
+void batch_apply_socket(fanout_transport_t transport, int sock)
+{
+    batch_mode_t mode = (batch_mode_t)transports[transport].mode.load(std::memory_order_relaxed);
+
+    // Пакетирует либо приложение (TCP_NODELAY), либо стек TCP (Нейгл).
+    // Малый буфер оставляет данные в кольце, где отставание видно fanout.
+    int nodelay = mode != BATCH_MODE_NAGLE;
+    int sndbuf = (mode == BATCH_MODE_FIXED || mode == BATCH_MODE_NAGLE)
+                     ? BATCH_SNDBUF_THROUGHPUT : BATCH_SNDBUF_LOW_LATENCY;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    if (setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) != 0) {
+        // lwIP без LWIP_SO_SNDBUF: размер задает TCP_SND_BUF в sdkconfig
+        ESP_LOGD(TAG, "SO_SNDBUF not supported");
+    }
+}
+
+const char *batch_mode_name(batch_mode_t mode)
+{
+    return mode < BATCH_MODE_COUNT ? mode_names[mode] : "unknown";
+}
+
+bool batch_parse_mode(const char *name, batch_mode_t *mode)
+{
+    for (int m = 0; m < BATCH_MODE_COUNT; m++) {
+        if (strcmp(name, mode_names[m]) == 0) {
+            *mode = (batch_mode_t)m;
+            return true;
+        }
+    }
+    return false;
+}
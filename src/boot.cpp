@@ -0,0 +1,138 @@
+/**
+ * @file boot.cpp
+ * @brief Отметки времени загрузки (/api/boot)
+ */
+
+#include "boot.h"
+
+#include <string.h>
+#include <atomic>
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "Boot";
+
+#define BOOT_RECORD_MAGIC   0x544f4f42u     // "BOOT"
+
+/**
+ * Запись в памяти noinit: после программного сброса содержит запуск,
+ * который сбросился. check защищает от мусора после включения питания.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t check;                 // ~boot_count
+    uint32_t boot_count;
+    uint32_t reset_reason;
+    uint32_t carried_bytes;
+    std::atomic<uint32_t> stage_us[BOOT_STAGE_COUNT];
+} boot_noinit_t;
+
+static __NOINIT_ATTR boot_noinit_t record;
+
+static boot_record_t previous;
+static bool previous_valid = false;
+
+static void copy_record(boot_record_t *out)
+{
+    out->boot_count = record.boot_count;
+    out->reset_reason = record.reset_reason;
+    out->carried_bytes = record.carried_bytes;
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        out->stage_us[i] = record.stage_us[i].load(std::memory_order_relaxed);
+    }
+}
+
+void boot_begin(void)
+{
+    uint32_t boot_count = 1;
+    previous_valid = record.magic == BOOT_RECORD_MAGIC && record.check == ~record.boot_count;
+    if (previous_valid) {
+        copy_record(&previous);
+        boot_count = previous.boot_count + 1;
+    }
+
+    record.magic = BOOT_RECORD_MAGIC;
+    record.boot_count = boot_count;
+    record.check = ~boot_count;
+    record.reset_reason = (uint32_t)esp_reset_reason();
+    record.carried_bytes = 0;
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        record.stage_us[i].store(0, std::memory_order_relaxed);
+    }
+    boot_mark(BOOT_STAGE_APP_MAIN);
+
+    if (previous_valid) {
+        ESP_LOGI(TAG, "Boot %lu after %s reset; previous first_forward at %lu us",
+                 (unsigned long)boot_count, boot_reset_reason_name(record.reset_reason),
+                 (unsigned long)previous.stage_us[BOOT_STAGE_FIRST_FORWARD]);
+    }
+}
+
+void boot_mark(boot_stage_t stage)
+{
+    if (record.stage_us[stage].load(std::memory_order_relaxed) != 0) {
+        return;
+    }
+    // 0 означает "не достигнут"
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    uint32_t expected = 0;
+    if (record.stage_us[stage].compare_exchange_strong(expected, now != 0 ? now : 1,
+                                                       std::memory_order_relaxed) &&
+        stage == BOOT_STAGE_FIRST_FORWARD) {
+        ESP_LOGI(TAG, "First data forwarded %lu ms after start", (unsigned long)(now / 1000));
+    }
+}
+
+void boot_set_carried(uint32_t bytes)
+{
+    record.carried_bytes = bytes;
+}
+
+bool boot_get_records(boot_record_t *current, boot_record_t *prev)
+{
+    copy_record(current);
+    if (prev != NULL) {
+        if (previous_valid) {
+            *prev = previous;
+        } else {
+            memset(prev, 0, sizeof(*prev));
+        }
+    }
+    return previous_valid;
+}
+
+const char *boot_stage_name(boot_stage_t stage)
+{
+    switch (stage) {
+    case BOOT_STAGE_APP_MAIN:        return "app_main";
+    case BOOT_STAGE_UART_READY:      return "uart_ready";
+    case BOOT_STAGE_CAPTURE_STARTED: return "capture_started";
+    case BOOT_STAGE_NVS_READY:       return "nvs_ready";
+    case BOOT_STAGE_WIFI_STARTED:    return "wifi_started";
+    case BOOT_STAGE_HTTPD_STARTED:   return "httpd_started";
+    case BOOT_STAGE_TCP_STARTED:     return "tcp_started";
+    case BOOT_STAGE_INIT_DONE:       return "init_done";
+    case BOOT_STAGE_NETWORK_UP:      return "network_up";
+    case BOOT_STAGE_FIRST_RX:        return "first_rx";
+    case BOOT_STAGE_FIRST_FORWARD:   return "first_forward";
+    default:                         return "unknown";
+    }
+}
+
+const char *boot_reset_reason_name(uint32_t reason)
+{
+    switch ((esp_reset_reason_t)reason) {
+    case ESP_RST_POWERON:   return "poweron";
+    case ESP_RST_EXT:       return "external";
+    case ESP_RST_SW:        return "software";
+    case ESP_RST_PANIC:     return "panic";
+    case ESP_RST_INT_WDT:   return "int_wdt";
+    case ESP_RST_TASK_WDT:  return "task_wdt";
+    case ESP_RST_WDT:       return "wdt";
+    case ESP_RST_DEEPSLEEP: return "deepsleep";
+    case ESP_RST_BROWNOUT:  return "brownout";
+    default:                return "unknown";
+    }
+}
@@ -0,0 +1,84 @@
+/**
+ * @file buffer_pool.cpp
+ * @brief Пул блоков фиксированного размера
+ */
+
+#include "buffer_pool.h"
+#include "metrics.h"
+
+#include <atomic>
+#include "esp_log.h"
+
+static const char *TAG = "BufferPool";
+
+static_assert(BUFFER_POOL_BLOCKS >= 1 && BUFFER_POOL_BLOCKS <= 32, "Free mask is 32 bits");
+
+#define ALL_FREE    ((uint32_t)(((uint64_t)1 << BUFFER_POOL_BLOCKS) - 1))
+
+alignas(8) static uint8_t blocks[BUFFER_POOL_BLOCKS][BUFFER_POOL_BLOCK_SIZE];
+
+// Бит - свободный блок; начальное значение задано статически, поэтому
+// пул работает до buffer_pool_init
+static std::atomic<uint32_t> free_mask(ALL_FREE);
+static std::atomic<uint32_t> peak(0);
+
+static metric_t borrows;
+static metric_t exhausted;
+
+void buffer_pool_init(void)
+{
+    metrics_register(&borrows, METRIC_COUNTER, "comtoair_buffer_pool_borrows_total",
+                     "Blocks taken from the response buffer pool", NULL);
+    metrics_register(&exhausted, METRIC_COUNTER, "comtoair_buffer_pool_exhausted_total",
+                     "Buffer pool requests refused: no free block", NULL);
+}
+
+void *buffer_pool_borrow(void)
+{
+    uint32_t mask = free_mask.load(std::memory_order_relaxed);
+    uint32_t taken;
+    do {
+        if (mask == 0) {
+            if (metric_add(&exhausted, 1) == 1) {
+                ESP_LOGW(TAG, "Pool exhausted (%d blocks)", BUFFER_POOL_BLOCKS);
+            }
+            return NULL;
+        }
+        taken = mask & (~mask + 1);         // Младший свободный
+    } while (!free_mask.compare_exchange_weak(mask, mask & ~taken, std::memory_order_acquire,
+                                              std::memory_order_relaxed));
+
+    uint32_t in_use = BUFFER_POOL_BLOCKS - (uint32_t)__builtin_popcount(mask & ~taken);
+    uint32_t max = peak.load(std::memory_order_relaxed);
+    while (in_use > max &&
+           !peak.compare_exchange_weak(max, in_use, std::memory_order_relaxed)) {
+    }
+    metric_add(&borrows, 1);
+    return blocks[__builtin_ctz(taken)];
+}
+
+void buffer_pool_return(void *block)
+{
+    if (block == NULL) {
+        return;
+    }
+    size_t index = (size_t)((uint8_t *)block - &blocks[0][0]) / BUFFER_POOL_BLOCK_SIZE;
+    if (index >= BUFFER_POOL_BLOCKS || block != blocks[index]) {
+        ESP_LOGE(TAG, "Returned block %p is not from the pool", block);
+        return;
+    }
+    if (free_mask.fetch_or(1u << index, std::memory_order_release) & (1u << index)) {
+        ESP_LOGE(TAG, "Block %u returned twice", (unsigned)index);
+    }
+}
+
+void buffer_pool_get_stats(buffer_pool_stats_t *stats)
+{
+    uint32_t mask = free_mask.load(std::memory_order_relaxed);
+    stats->block_size = BUFFER_POOL_BLOCK_SIZE;
+    stats->blocks = BUFFER_POOL_BLOCKS;
+    stats->in_use = BUFFER_POOL_BLOCKS - (uint32_t)__builtin_popcount(mask);
+    stats->peak = peak.load(std::memory_order_relaxed);
+    stats->borrows = metric_get(&borrows);
+    stats->exhausted = metric_get(&exhausted);
+}
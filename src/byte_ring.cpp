@@ -0,0 +1,221 @@
+/**
+ * @file byte_ring.cpp
+ * @brief Кольцевой буфер байтов без блокировок (один писатель, много читателей)
+ *
+ * Схема согласования - как у seqlock: писатель сначала объявляет границу
+ * записи (reserve), затем копирует данные и публикует новую голову (head).
+ * Читатель копирует данные без блокировок, а после копирования проверяет
+ * reserve: все байты, которые писатель мог успеть перезаписать, отбрасываются
+ * и засчитываются как потерянные.
+ */
+
+#include "byte_ring.h"
+#include <string.h>
+
+// Знаковая разность порядковых номеров (корректна при переполнении 2^32)
+static inline int32_t seq_diff(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b);
+}
+
+static inline uint32_t ring_oldest(const byte_ring_t *ring, uint32_t head)
+{
+    return ring->filled.load(std::memory_order_relaxed) ? head - ring->size : ring->base;
+}
+
+static void ring_copy_out(const byte_ring_t *ring, uint32_t seq, uint8_t *dst, size_t length)
+{
+    uint32_t offset = seq & ring->mask;
+    size_t first = ring->size - offset;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(dst, ring->storage + offset, first);
+    if (length > first) {
+        memcpy(dst + first, ring->storage, length - first);
+    }
+}
+
+bool byte_ring_init(byte_ring_t *ring, uint8_t *storage, size_t size)
+{
+    if (ring == NULL || storage == NULL || size == 0 || (size & (size - 1)) != 0 ||
+        size > 0x40000000u) {
+        return false;
+    }
+    ring->storage = storage;
+    ring->size = (uint32_t)size;
+    ring->mask = (uint32_t)size - 1;
+    ring->base = 0;
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->reserve.store(0, std::memory_order_relaxed);
+    ring->filled.store(false, std::memory_order_relaxed);
+    return true;
+}
+
+bool byte_ring_restore(byte_ring_t *ring, uint32_t oldest, uint32_t head)
+{
+    if (head - oldest > ring->size) {
+        return false;
+    }
+    ring->base = oldest;
+    ring->reserve.store(head, std::memory_order_relaxed);
+    ring->filled.store(head - oldest == ring->size, std::memory_order_relaxed);
+    ring->head.store(head, std::memory_order_release);
+    return true;
+}
+
+void byte_ring_write(byte_ring_t *ring, const uint8_t *data, size_t length)
+{
+    if (length == 0) {
+        return;
+    }
+
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    uint32_t end = head + (uint32_t)length;
+
+    // В буфер помещаются только последние size байт
+    if (length > ring->size) {
+        data += length - ring->size;
+        head = end - ring->size;
+        length = ring->size;
+    }
+
+    // Объявляем перезаписываемую область до изменения данных
+    ring->reserve.store(end, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint32_t offset = head & ring->mask;
+    size_t first = ring->size - offset;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(ring->storage + offset, data, first);
+    if (length > first) {
+        memcpy(ring->storage, data + first, length - first);
+    }
+
+    if (!ring->filled.load(std::memory_order_relaxed) && end - ring->base >= ring->size) {
+        ring->filled.store(true, std::memory_order_relaxed);
+    }
+    ring->head.store(end, std::memory_order_release);
+}
+
+size_t byte_ring_read(const byte_ring_t *ring, uint32_t *cursor,
+                      uint8_t *buffer, size_t length, uint32_t *lost)
+{
+    uint32_t skipped = 0;
+    uint32_t head = ring->head.load(std::memory_order_acquire);
+    uint32_t oldest = ring_oldest(ring, head);
+    uint32_t cur = *cursor;
+
+    if (seq_diff(cur, head) > 0) {
+        // Курсор в идущей записи длиннее буфера (прошлое чтение пропустило
+        // перезаписанное до reserve - size) - данных еще нет, ничего не потеряно
+        if (seq_diff(cur, ring->reserve.load(std::memory_order_relaxed)) <= 0) {
+            if (lost != NULL) {
+                *lost = 0;
+            }
+            return 0;
+        }
+        // Курсор из будущего - отдаем все, что есть
+        cur = oldest;
+    } else if (seq_diff(oldest, cur) > 0) {
+        skipped += oldest - cur;
+        cur = oldest;
+    }
+
+    size_t n = head - cur;
+    if (n > length) {
+        n = length;
+    }
+    if (n > 0) {
+        ring_copy_out(ring, cur, buffer, n);
+
+        // Проверяем, не начал ли писатель перезаписывать скопированное.
+        // До первого заполнения floor "отрицателен" и проверка не срабатывает.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t floor = ring->reserve.load(std::memory_order_relaxed) - ring->size;
+        if (seq_diff(floor, cur) > 0) {
+            uint32_t overwritten = floor - cur;
+            if (overwritten >= n) {
+                skipped += overwritten;
+                cur += overwritten;
+                n = 0;
+            } else {
+                memmove(buffer, buffer + overwritten, n - overwritten);
+                n -= overwritten;
+                skipped += overwritten;
+                cur += overwritten;
+            }
+        }
+    }
+
+    *cursor = cur + (uint32_t)n;
+    if (lost != NULL) {
+        *lost = skipped;
+    }
+    return n;
+}
+
+bool byte_ring_read_at(const byte_ring_t *ring, uint32_t seq,
+                       uint8_t *buffer, size_t length)
+{
+    uint32_t head = ring->head.load(std::memory_order_acquire);
+    uint32_t oldest = ring_oldest(ring, head);
+
+    if (length > ring->size || seq_diff(seq, oldest) < 0 ||
+        seq_diff(head, seq) < (int32_t)length) {
+        return false;
+    }
+
+    ring_copy_out(ring, seq, buffer, length);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint32_t floor = ring->reserve.load(std::memory_order_relaxed) - ring->size;
+    return seq_diff(seq, floor) >= 0;
+}
+
+size_t byte_ring_peek(const byte_ring_t *ring, uint32_t seq, const uint8_t **data)
+{
+    uint32_t head = ring->head.load(std::memory_order_acquire);
+    uint32_t oldest = ring_oldest(ring, head);
+
+    if (seq_diff(seq, oldest) < 0 || seq_diff(head, seq) <= 0) {
+        return 0;
+    }
+
+    uint32_t offset = seq & ring->mask;
+    size_t length = head - seq;
+    if (length > ring->size - offset) {
+        length = ring->size - offset;
+    }
+    *data = ring->storage + offset;
+    return length;
+}
+
+bool byte_ring_still_valid(const byte_ring_t *ring, uint32_t seq)
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint32_t floor = ring->reserve.load(std::memory_order_relaxed) - ring->size;
+    return seq_diff(seq, floor) >= 0;
+}
+
+uint32_t byte_ring_head(const byte_ring_t *ring)
+{
+    return ring->head.load(std::memory_order_acquire);
+}
+
+uint32_t byte_ring_oldest(const byte_ring_t *ring)
+{
+    return ring_oldest(ring, ring->head.load(std::memory_order_acquire));
+}
+
+uint32_t byte_ring_pending(const byte_ring_t *ring, uint32_t cursor)
+{
+    uint32_t head = ring->head.load(std::memory_order_acquire);
+    int32_t diff = seq_diff(head, cursor);
+    if (diff <= 0) {
+        return 0;
+    }
+    return diff > (int32_t)ring->size ? ring->size : (uint32_t)diff;
+}
@@ -0,0 +1,325 @@
+/**
+ * @file capture_format.cpp
+ * @brief Двоичный формат выгрузки принятых данных
+ *
+ * Сжатие - формат блока LZ4: последовательности "токен (длина литералов,
+ * длина совпадения - 4), литералы, смещение u16 LE". Поиск совпадений -
+ * хеш-таблица последних позиций 4-байтных последовательностей (одна
+ * попытка на позицию), шаг поиска растет на несжимаемых участках.
+ * Соблюдены ограничения LZ4 (последние 5 байт - литералы, совпадение
+ * начинается не ближе 12 байт к концу), поэтому блоки распаковывает и
+ * стандартный LZ4_decompress_safe().
+ */
+
+#include "capture_format.h"
+
+#include <string.h>
+
+#define LZ_MIN_MATCH        4
+#define LZ_LAST_LITERALS    5
+#define LZ_MFLIMIT          12
+#define LZ_MAX_OFFSET       65535
+
+// Наибольшая разметка записи: номер (5), время (10), длина (5)
+#define RECORD_HEADER_MAX   20
+
+static const uint8_t stream_magic[4] = { 'C', 'T', 'A', 'B' };
+
+static uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - CAPTURE_LZ_HASH_BITS);
+}
+
+/**
+ * Продолжение длины (литералов или совпадения) байтами по 255
+ */
+static uint8_t *put_length(uint8_t *op, size_t n)
+{
+    while (n >= 255) {
+        *op++ = 255;
+        n -= 255;
+    }
+    *op++ = (uint8_t)n;
+    return op;
+}
+
+size_t capture_lz_compress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity,
+                           uint16_t *hash)
+{
+    uint8_t *op = dst;
+    uint8_t *oend = dst + capacity;
+    size_t anchor = 0;
+    size_t i = 0;
+
+    memset(hash, 0, sizeof(uint16_t) << CAPTURE_LZ_HASH_BITS);
+
+    while (i + LZ_MFLIMIT <= length) {
+        uint32_t v = read32(src + i);
+        uint32_t h = lz_hash(v);
+        size_t candidate = hash[h];
+        hash[h] = (uint16_t)i;
+        if (candidate >= i || i - candidate > LZ_MAX_OFFSET || read32(src + candidate) != v) {
+            // Чем дольше нет совпадений, тем крупнее шаг
+            i += 1 + ((i - anchor) >> 6);
+            continue;
+        }
+
+        while (i > anchor && candidate > 0 && src[i - 1] == src[candidate - 1]) {
+            i--;
+            candidate--;
+        }
+        size_t match_len = LZ_MIN_MATCH;
+        size_t match_limit = length - LZ_LAST_LITERALS;
+        while (i + match_len < match_limit && src[i + match_len] == src[candidate + match_len]) {
+            match_len++;
+        }
+
+        size_t literals = i - anchor;
+        size_t extra = match_len - LZ_MIN_MATCH;
+        if ((size_t)(oend - op) < 1 + literals / 255 + 1 + literals + 2 + extra / 255 + 1) {
+            return 0;
+        }
+        uint8_t *token = op++;
+        *token = (uint8_t)((literals >= 15 ? 15 : literals) << 4);
+        if (literals >= 15) {
+            op = put_length(op, literals - 15);
+        }
+        memcpy(op, src + anchor, literals);
+        op += literals;
+        size_t offset = i - candidate;
+        *op++ = (uint8_t)offset;
+        *op++ = (uint8_t)(offset >> 8);
+        *token |= (uint8_t)(extra >= 15 ? 15 : extra);
+        if (extra >= 15) {
+            op = put_length(op, extra - 15);
+        }
+
+        i += match_len;
+        anchor = i;
+        // Позиция внутри совпадения - кандидат для следующего повтора
+        if (i + LZ_MFLIMIT <= length) {
+            hash[lz_hash(read32(src + i - 2))] = (uint16_t)(i - 2);
+        }
+    }
+
+    // Последняя последовательность - только литералы
+    size_t literals = length - anchor;
+    if ((size_t)(oend - op) < 1 + literals / 255 + 1 + literals) {
+        return 0;
+    }
+    uint8_t *token = op++;
+    *token = (uint8_t)((literals >= 15 ? 15 : literals) << 4);
+    if (literals >= 15) {
+        op = put_length(op, literals - 15);
+    }
+    memcpy(op, src + anchor, literals);
+    op += literals;
+    return (size_t)(op - dst);
+}
+
+size_t capture_lz_decompress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity)
+{
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + length;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + capacity;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) {
+                    return SIZE_MAX;
+                }
+                b = *ip++;
+                literals += b;
+            } while (b == 255);
+        }
+        if (literals > (size_t)(iend - ip) || literals > (size_t)(oend - op)) {
+            return SIZE_MAX;
+        }
+        memcpy(op, ip, literals);
+        op += literals;
+        ip += literals;
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return SIZE_MAX;
+        }
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) {
+            return SIZE_MAX;
+        }
+        size_t match_len = token & 15;
+        if (match_len == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) {
+                    return SIZE_MAX;
+                }
+                b = *ip++;
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += LZ_MIN_MATCH;
+        if (match_len > (size_t)(oend - op)) {
+            return SIZE_MAX;
+        }
+        // Побайтно: совпадение может перекрываться с выводом
+        const uint8_t *match = op - offset;
+        for (size_t k = 0; k < match_len; k++) {
+            op[k] = match[k];
+        }
+        op += match_len;
+    }
+    return (size_t)(op - dst);
+}
+
+static size_t put_varint(uint8_t *p, uint64_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static void emit(capture_encoder_t *enc, const uint8_t *data, size_t length)
+{
+    if (enc->failed || length == 0) {
+        return;
+    }
+    if (!enc->flush(enc->ctx, data, length)) {
+        enc->failed = true;
+        return;
+    }
+    enc->out_bytes += length;
+}
+
+/**
+ * Вывод накопленного блока (перед первым - заголовок потока) одним фрагментом
+ */
+static void flush_block(capture_encoder_t *enc)
+{
+    if (enc->block_len == 0 && enc->header_sent) {
+        return;
+    }
+
+    uint8_t head[CAPTURE_FORMAT_RESERVE];
+    size_t n = 0;
+    if (!enc->header_sent) {
+        memcpy(head, stream_magic, sizeof(stream_magic));
+        n = sizeof(stream_magic);
+        head[n++] = CAPTURE_FORMAT_VERSION;
+        head[n++] = (uint8_t)enc->kind;
+        enc->header_sent = true;
+    }
+
+    uint8_t *payload = enc->buf + CAPTURE_FORMAT_RESERVE;
+    size_t payload_len = enc->block_len;
+    if (enc->block_len > 0) {
+        // Сжатый блок берется, только если он короче исходного
+        size_t packed = 0;
+        if (enc->lz != NULL) {
+            packed = capture_lz_compress(payload, enc->block_len,
+                                         enc->lz->out + CAPTURE_FORMAT_RESERVE,
+                                         enc->block_len - 1, enc->lz->hash);
+        }
+        if (packed > 0) {
+            head[n++] = CAPTURE_CODEC_LZ4;
+            n += put_varint(head + n, enc->block_len);
+            n += put_varint(head + n, packed);
+            payload = enc->lz->out + CAPTURE_FORMAT_RESERVE;
+            payload_len = packed;
+        } else {
+            head[n++] = CAPTURE_CODEC_STORED;
+            n += put_varint(head + n, enc->block_len);
+        }
+    }
+
+    // Заголовок - в запас перед данными, чтобы вывести все одним вызовом
+    memcpy(payload - n, head, n);
+    emit(enc, payload - n, n + payload_len);
+    enc->raw_bytes += enc->block_len;
+    enc->block_len = 0;
+}
+
+void capture_encoder_init(capture_encoder_t *enc, capture_kind_t kind, uint8_t *buf,
+                          size_t block_size, capture_lz_state_t *lz,
+                          capture_flush_fn flush, void *ctx)
+{
+    memset(enc, 0, sizeof(*enc));
+    enc->buf = buf;
+    enc->block_size = block_size;
+    enc->lz = block_size <= CAPTURE_FORMAT_BLOCK_SIZE ? lz : NULL;
+    enc->flush = flush;
+    enc->ctx = ctx;
+    enc->kind = kind;
+}
+
+void capture_encoder_record(capture_encoder_t *enc, uint32_t seq, uint64_t timestamp_us,
+                            uint32_t flags, const uint8_t *data, size_t length)
+{
+    if (enc->block_len + RECORD_HEADER_MAX + length > enc->block_size) {
+        flush_block(enc);
+    }
+
+    uint8_t *p = enc->buf + CAPTURE_FORMAT_RESERVE + enc->block_len;
+    int64_t ts_delta = (int64_t)(timestamp_us - enc->last_ts);
+    size_t n = put_varint(p, seq - enc->next_seq);
+    n += put_varint(p + n, ((uint64_t)ts_delta << 1) ^ (uint64_t)(ts_delta >> 63));
+    n += put_varint(p + n, ((uint64_t)length << 2) | (flags & 3));
+    memcpy(p + n, data, length);
+    enc->block_len += n + length;
+
+    enc->next_seq = seq + (enc->kind == CAPTURE_KIND_RECORDS ? 1 : (uint32_t)length);
+    enc->last_ts = timestamp_us;
+}
+
+void capture_encoder_write(capture_encoder_t *enc, const uint8_t *data, size_t length)
+{
+    while (length > 0) {
+        size_t n = enc->block_size - enc->block_len;
+        if (n > length) {
+            n = length;
+        }
+        memcpy(enc->buf + CAPTURE_FORMAT_RESERVE + enc->block_len, data, n);
+        enc->block_len += n;
+        data += n;
+        length -= n;
+        if (enc->block_len == enc->block_size) {
+            flush_block(enc);
+        }
+    }
+}
+
+bool capture_encoder_finish(capture_encoder_t *enc, uint32_t next, uint32_t head,
+                            uint32_t lost, uint64_t now_us)
+{
+    flush_block(enc);
+
+    uint8_t tail[2 + 5 * 3 + 10];
+    size_t n = 0;
+    tail[n++] = CAPTURE_CODEC_STORED;
+    tail[n++] = 0;
+    n += put_varint(tail + n, next);
+    n += put_varint(tail + n, head);
+    n += put_varint(tail + n, lost);
+    n += put_varint(tail + n, now_us);
+    emit(enc, tail, n);
+    return !enc->failed;
+}
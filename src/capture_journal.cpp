@@ -0,0 +1,175 @@
+/**
+ * @file capture_journal.cpp
+ * @brief Журнал принятых порций данных с метками времени
+ *
+ * Данные записей хранятся в byte_ring (арена), заголовки - в отдельном
+ * кольце. Заголовок защищен как seqlock: писатель сначала портит номер
+ * в слоте, затем пишет поля и публикует номер; читатель проверяет номер
+ * до и после чтения полей. Данные копируются через byte_ring_read_at(),
+ * который сам проверяет, что их не перезаписали во время копирования.
+ */
+
+#include "capture_journal.h"
+#include "byte_ring.h"
+
+#include <atomic>
+
+static_assert((CAPTURE_ARENA_SIZE & (CAPTURE_ARENA_SIZE - 1)) == 0,
+              "CAPTURE_ARENA_SIZE must be a power of two");
+static_assert((CAPTURE_MAX_RECORDS & (CAPTURE_MAX_RECORDS - 1)) == 0,
+              "CAPTURE_MAX_RECORDS must be a power of two");
+static_assert(CAPTURE_MAX_CHUNK <= CAPTURE_ARENA_SIZE,
+              "CAPTURE_MAX_CHUNK must fit into the arena");
+
+/**
+ * Слот кольца заголовков (все поля атомарные: читатели без блокировок)
+ */
+typedef struct {
+    std::atomic<uint32_t> seq;          // Номер записи в слоте
+    std::atomic<uint32_t> data_seq;     // Позиция данных в арене
+    std::atomic<uint32_t> length;
+    std::atomic<uint32_t> flags;
+    std::atomic<uint32_t> ts_lo;
+    std::atomic<uint32_t> ts_hi;
+} record_slot_t;
+
+static uint8_t arena_storage[CAPTURE_ARENA_SIZE];
+static byte_ring_t arena = BYTE_RING_STATIC_INIT(arena_storage);
+
+static record_slot_t slots[CAPTURE_MAX_RECORDS];
+static std::atomic<uint32_t> head(0);
+static std::atomic<uint32_t> bytes_total(0);
+
+// Знаковая разность порядковых номеров (корректна при переполнении 2^32)
+static inline int32_t seq_diff(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b);
+}
+
+static void append_record(const uint8_t *data, uint32_t length, uint64_t timestamp_us,
+                          uint32_t flags)
+{
+    uint32_t seq = head.load(std::memory_order_relaxed);
+    record_slot_t *slot = &slots[seq & (CAPTURE_MAX_RECORDS - 1)];
+
+    // Данные пишутся раньше заголовка: опубликованная запись всегда полная
+    uint32_t data_seq = byte_ring_head(&arena);
+    byte_ring_write(&arena, data, length);
+
+    // seq - 1 никогда не ожидается в этом слоте: читатели увидят несовпадение
+    slot->seq.store(seq - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->data_seq.store(data_seq, std::memory_order_relaxed);
+    slot->length.store(length, std::memory_order_relaxed);
+    slot->flags.store(flags, std::memory_order_relaxed);
+    slot->ts_lo.store((uint32_t)timestamp_us, std::memory_order_relaxed);
+    slot->ts_hi.store((uint32_t)(timestamp_us >> 32), std::memory_order_relaxed);
+    slot->seq.store(seq, std::memory_order_release);
+
+    head.store(seq + 1, std::memory_order_release);
+    bytes_total.store(bytes_total.load(std::memory_order_relaxed) + length,
+                      std::memory_order_relaxed);
+}
+
+void capture_journal_append(const uint8_t *data, size_t length, uint64_t timestamp_us)
+{
+    while (length > 0) {
+        uint32_t n = length > CAPTURE_MAX_CHUNK ? CAPTURE_MAX_CHUNK : (uint32_t)length;
+        append_record(data, n, timestamp_us, 0);
+        data += n;
+        length -= n;
+    }
+}
+
+void capture_journal_append_frame(const uint8_t *data, size_t length, uint64_t timestamp_us,
+                                  uint32_t flags)
+{
+    if (length > CAPTURE_MAX_CHUNK) {
+        length = CAPTURE_MAX_CHUNK;
+    }
+    append_record(data, (uint32_t)length, timestamp_us, flags);
+}
+
+/**
+ * Чтение заголовка; false если слот уже занят другой записью
+ */
+static bool read_slot(uint32_t seq, capture_record_t *record, uint32_t *data_seq)
+{
+    const record_slot_t *slot = &slots[seq & (CAPTURE_MAX_RECORDS - 1)];
+
+    if (slot->seq.load(std::memory_order_acquire) != seq) {
+        return false;
+    }
+    *data_seq = slot->data_seq.load(std::memory_order_relaxed);
+    record->length = slot->length.load(std::memory_order_relaxed);
+    record->flags = slot->flags.load(std::memory_order_relaxed);
+    uint32_t lo = slot->ts_lo.load(std::memory_order_relaxed);
+    uint32_t hi = slot->ts_hi.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->seq.load(std::memory_order_relaxed) != seq) {
+        return false;
+    }
+
+    record->seq = seq;
+    record->timestamp_us = ((uint64_t)hi << 32) | lo;
+    return true;
+}
+
+capture_read_result_t capture_journal_read(uint32_t seq, capture_record_t *record,
+                                           uint8_t *buffer)
+{
+    uint32_t current = head.load(std::memory_order_acquire);
+    if (seq_diff(seq, current) >= 0) {
+        return CAPTURE_READ_END;
+    }
+    if (seq_diff(current, seq) > CAPTURE_MAX_RECORDS) {
+        return CAPTURE_READ_GAP;
+    }
+
+    uint32_t data_seq;
+    if (!read_slot(seq, record, &data_seq)) {
+        return CAPTURE_READ_GAP;
+    }
+    if (!byte_ring_read_at(&arena, data_seq, buffer, record->length)) {
+        return CAPTURE_READ_GAP;
+    }
+    return CAPTURE_READ_OK;
+}
+
+uint32_t capture_journal_head(void)
+{
+    return head.load(std::memory_order_acquire);
+}
+
+uint32_t capture_journal_oldest(void)
+{
+    uint32_t current = head.load(std::memory_order_acquire);
+    uint32_t count = current < CAPTURE_MAX_RECORDS ? current : CAPTURE_MAX_RECORDS;
+    uint32_t first = current - count;
+
+    // Данные перезаписываются от старых записей к новым, поэтому
+    // доступные записи образуют непрерывный хвост - ищем его начало
+    uint32_t lo = 0;
+    uint32_t hi = count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        capture_record_t record;
+        uint32_t data_seq;
+        if (read_slot(first + mid, &record, &data_seq) &&
+            byte_ring_still_valid(&arena, data_seq)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return first + lo;
+}
+
+void capture_journal_get_stats(capture_journal_stats_t *stats)
+{
+    stats->head = capture_journal_head();
+    stats->oldest = capture_journal_oldest();
+    stats->bytes_total = bytes_total.load(std::memory_order_relaxed);
+    stats->arena_size = CAPTURE_ARENA_SIZE;
+    stats->max_records = CAPTURE_MAX_RECORDS;
+}
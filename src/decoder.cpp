@@ -0,0 +1,164 @@
+/**
+ * @file decoder.cpp
+ * @brief Декодеры протоколов: реестр, состояние портов, запись полей
+ */
+
+#include "decoder.h"
+#include "field_table.h"
+#include "metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include "esp_log.h"
+
+static const char *TAG = "Decoder";
+
+static const decoder_ops_t *const registry[] = {
+    &decoder_modbus,
+    &decoder_nmea,
+    &decoder_tlv,
+};
+#define REGISTRY_SIZE   (int)(sizeof(registry) / sizeof(registry[0]))
+
+/**
+ * Декодер порта. requested - индекс в реестре (-1 - нет), его пишет
+ * HTTP обработчик; active и состояние - только задача приема порта.
+ */
+typedef struct {
+    std::atomic<int> requested;
+    std::atomic<uint32_t> version;
+    uint32_t applied_version;
+    const decoder_ops_t *active;
+    uint64_t last_us;                   // Время предыдущей порции
+    metric_t frames;
+    metric_t errors;
+    char labels[12];                    // port="N"
+    alignas(8) uint8_t state[DECODER_STATE_SIZE];
+} decoder_port_t;
+
+static decoder_port_t ports[SERIAL_PORT_COUNT];
+
+static int registry_index(const char *name)
+{
+    for (int i = 0; i < REGISTRY_SIZE; i++) {
+        if (strcmp(registry[i]->name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const decoder_ops_t *decoder_find(const char *name)
+{
+    int index = registry_index(name);
+    return index < 0 ? NULL : registry[index];
+}
+
+void decoder_emit_int(decoder_ctx_t *ctx, const char *key, int64_t value)
+{
+    field_table_set_int(ctx->port, key, value, ctx->now_ms);
+}
+
+void decoder_emit_float(decoder_ctx_t *ctx, const char *key, double value)
+{
+    field_table_set_float(ctx->port, key, value, ctx->now_ms);
+}
+
+void decoder_init(void)
+{
+    for (int i = 0; i < REGISTRY_SIZE; i++) {
+        if (registry[i]->state_size > DECODER_STATE_SIZE) {
+            ESP_LOGE(TAG, "Decoder %s: state %u > DECODER_STATE_SIZE", registry[i]->name,
+                     (unsigned)registry[i]->state_size);
+        }
+    }
+    for (int p = 0; p < SERIAL_PORT_COUNT; p++) {
+        decoder_port_t *dp = &ports[p];
+        snprintf(dp->labels, sizeof(dp->labels), "port=\"%d\"", p);
+        metrics_register(&dp->frames, METRIC_COUNTER, "comtoair_decoder_frames_total",
+                         "Protocol frames decoded with a valid checksum", dp->labels);
+        metrics_register(&dp->errors, METRIC_COUNTER, "comtoair_decoder_errors_total",
+                         "Protocol frames rejected by checksum or format", dp->labels);
+        if (!decoder_set(p, DECODER_DEFAULT)) {
+            ESP_LOGE(TAG, "Unknown DECODER_DEFAULT: %s", DECODER_DEFAULT);
+        }
+    }
+}
+
+bool decoder_name_valid(const char *name)
+{
+    if (strcmp(name, "none") == 0) {
+        return true;
+    }
+    int index = registry_index(name);
+    return index >= 0 && registry[index]->state_size <= DECODER_STATE_SIZE;
+}
+
+bool decoder_set(int port, const char *name)
+{
+    if (port < 0 || port >= SERIAL_PORT_COUNT || !decoder_name_valid(name)) {
+        return false;
+    }
+    int index = strcmp(name, "none") == 0 ? -1 : registry_index(name);
+    ports[port].requested.store(index, std::memory_order_relaxed);
+    ports[port].version.fetch_add(1, std::memory_order_release);
+    ESP_LOGI(TAG, "Port %d decoder: %s", port, name);
+    return true;
+}
+
+/**
+ * Применение нового декодера (только в контексте писателя порта)
+ */
+static void apply_pending(decoder_port_t *dp)
+{
+    uint32_t version = dp->version.load(std::memory_order_acquire);
+    if (version == dp->applied_version) {
+        return;
+    }
+    int index = dp->requested.load(std::memory_order_relaxed);
+    dp->active = index < 0 ? NULL : registry[index];
+    if (dp->active != NULL) {
+        dp->active->reset(dp->state);
+    }
+    dp->last_us = 0;
+    dp->applied_version = version;
+}
+
+void decoder_feed(int port, const uint8_t *data, size_t length, uint64_t now_us)
+{
+    decoder_port_t *dp = &ports[port];
+    apply_pending(dp);
+    const decoder_ops_t *ops = dp->active;
+    if (ops == NULL) {
+        return;
+    }
+
+    if (ops->idle_reset && dp->last_us != 0 &&
+        now_us - dp->last_us > (uint64_t)DECODER_FRAME_TIMEOUT_MS * 1000) {
+        ops->reset(dp->state);
+    }
+    dp->last_us = now_us;
+
+    decoder_ctx_t ctx = { port, (uint32_t)(now_us / 1000), 0, 0 };
+    ops->feed(dp->state, &ctx, data, length);
+    if (ctx.frames != 0) {
+        metric_add(&dp->frames, ctx.frames);
+    }
+    if (ctx.errors != 0) {
+        metric_add(&dp->errors, ctx.errors);
+    }
+}
+
+bool decoder_get_info(int port, decoder_info_t *info)
+{
+    if (port < 0 || port >= SERIAL_PORT_COUNT) {
+        return false;
+    }
+    const decoder_port_t *dp = &ports[port];
+    int index = dp->requested.load(std::memory_order_relaxed);
+    info->name = index < 0 ? "none" : registry[index]->name;
+    info->frames = metric_get(&dp->frames);
+    info->errors = metric_get(&dp->errors);
+    return true;
+}
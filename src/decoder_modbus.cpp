@@ -0,0 +1,312 @@
+/**
+ * @file decoder_modbus.cpp
+ * @brief Декодер Modbus RTU
+ *
+ * Поток на линии - запросы ведущего и ответы ведомых вперемешку. Длина
+ * кадра RTU не передается: по коду функции известны возможные длины
+ * (запрос или ответ), и кадром считается тот вариант, у которого сходится
+ * CRC-16. Если ни один не сошелся, отбрасывается первый байт и поиск
+ * продолжается со следующего (ошибка учитывается один раз на эпизод
+ * потери синхронизации). Пока синхронизации нет, вариант, ждущий еще
+ * байт, уступает целому кадру дальше в буфере. Пауза на линии
+ * сбрасывает неполный кадр (idle_reset).
+ *
+ * Адреса регистров есть только в запросе, поэтому значения ответа на
+ * чтение (функции 1-4) записываются, если перед ним был принят запрос
+ * того же ведомого с той же функцией. Поля:
+ *   mb<ведомый>.hr<адрес> - holding register (3, 6, 16)
+ *   mb<ведомый>.ir<адрес> - input register (4)
+ *   mb<ведомый>.co<адрес> - coil, 0/1 (1, 5, 15)
+ *   mb<ведомый>.di<адрес> - discrete input, 0/1 (2)
+ *   mb<ведомый>.exc       - код последнего исключения
+ */
+
+#include "decoder.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define MODBUS_MAX_FRAME    256
+
+typedef struct {
+    uint8_t buf[MODBUS_MAX_FRAME];
+    uint16_t start;                 // Начало непросмотренных байт в buf
+    uint16_t length;                // Байт от start
+    bool resync;                    // Идет поиск начала кадра (ошибка уже учтена)
+    // Последний запрос чтения: адреса для ответа
+    bool req_valid;
+    uint8_t req_slave;
+    uint8_t req_fc;
+    uint16_t req_addr;
+    uint16_t req_count;
+} modbus_state_t;
+
+static_assert(sizeof(modbus_state_t) <= DECODER_STATE_SIZE, "DECODER_STATE_SIZE too small");
+
+struct crc_table_t {
+    uint16_t v[256];
+};
+
+static constexpr crc_table_t make_crc_table()
+{
+    crc_table_t t = {};
+    for (int i = 0; i < 256; i++) {
+        uint16_t crc = (uint16_t)i;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+        }
+        t.v[i] = crc;
+    }
+    return t;
+}
+
+// CRC-16/MODBUS (полином 0x8005, отраженный), таблица строится при компиляции
+static constexpr crc_table_t crc_table = make_crc_table();
+
+static bool crc_ok(const uint8_t *frame, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length - 2; i++) {
+        crc = (uint16_t)((crc >> 8) ^ crc_table.v[(crc ^ frame[i]) & 0xFF]);
+    }
+    return frame[length - 2] == (crc & 0xFF) && frame[length - 1] == (crc >> 8);
+}
+
+static inline uint16_t be16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void emit_reg(decoder_ctx_t *ctx, uint8_t slave, const char *kind, uint32_t addr,
+                     int64_t value)
+{
+    char key[FIELD_KEY_SIZE];
+    snprintf(key, sizeof(key), "mb%u.%s%lu", slave, kind, (unsigned long)addr);
+    decoder_emit_int(ctx, key, value);
+}
+
+static void emit_bits(decoder_ctx_t *ctx, uint8_t slave, const char *kind, uint16_t addr,
+                      uint16_t count, const uint8_t *bytes)
+{
+    for (uint16_t i = 0; i < count; i++) {
+        emit_reg(ctx, slave, kind, (uint32_t)addr + i, (bytes[i / 8] >> (i % 8)) & 1);
+    }
+}
+
+static void emit_words(decoder_ctx_t *ctx, uint8_t slave, const char *kind, uint16_t addr,
+                       uint16_t count, const uint8_t *words)
+{
+    for (uint16_t i = 0; i < count; i++) {
+        emit_reg(ctx, slave, kind, (uint32_t)addr + i, be16(words + 2 * i));
+    }
+}
+
+/**
+ * Разбор кадра с верной CRC
+ */
+static void handle_frame(modbus_state_t *s, decoder_ctx_t *ctx, const uint8_t *f,
+                         bool request)
+{
+    uint8_t slave = f[0];
+    uint8_t fc = f[1];
+
+    if (fc & 0x80) {
+        char key[FIELD_KEY_SIZE];
+        snprintf(key, sizeof(key), "mb%u.exc", slave);
+        decoder_emit_int(ctx, key, f[2]);
+        s->req_valid = false;
+        return;
+    }
+
+    switch (fc) {
+    case 1: case 2: case 3: case 4:
+        if (request) {
+            s->req_valid = true;
+            s->req_slave = slave;
+            s->req_fc = fc;
+            s->req_addr = be16(f + 2);
+            s->req_count = be16(f + 4);
+            return;
+        }
+        if (!s->req_valid || s->req_slave != slave || s->req_fc != fc) {
+            return;
+        }
+        s->req_valid = false;
+        if (fc <= 2) {
+            if (f[2] != (s->req_count + 7) / 8) {
+                return;
+            }
+            emit_bits(ctx, slave, fc == 1 ? "co" : "di", s->req_addr, s->req_count, f + 3);
+        } else {
+            if (f[2] != s->req_count * 2) {
+                return;
+            }
+            emit_words(ctx, slave, fc == 3 ? "hr" : "ir", s->req_addr, s->req_count, f + 3);
+        }
+        return;
+    case 5:
+        emit_reg(ctx, slave, "co", be16(f + 2), be16(f + 4) == 0xFF00);
+        return;
+    case 6:
+        emit_reg(ctx, slave, "hr", be16(f + 2), be16(f + 4));
+        return;
+    case 15:
+        if (request && f[6] == (be16(f + 4) + 7) / 8) {
+            emit_bits(ctx, slave, "co", be16(f + 2), be16(f + 4), f + 7);
+        }
+        return;
+    case 16:
+        if (request && f[6] == be16(f + 4) * 2) {
+            emit_words(ctx, slave, "hr", be16(f + 2), be16(f + 4), f + 7);
+        }
+        return;
+    default:
+        return;
+    }
+}
+
+/**
+ * Варианты длины кадра, начинающегося с f
+ *
+ * @param available Принято байт от f
+ * @param len Длины: [0] - запрос, [1] - ответ (0 - варианта нет,
+ *            -1 - длина еще неизвестна)
+ * @return false для неизвестного кода функции
+ */
+static bool candidate_lengths(const uint8_t *f, size_t available, int len[2])
+{
+    uint8_t fc = f[1];
+    if (fc & 0x80) {
+        len[0] = 0;
+        len[1] = 5;
+        return (fc & 0x7F) >= 1 && (fc & 0x7F) <= 24;
+    }
+    switch (fc) {
+    case 1: case 2: case 3: case 4:
+        len[0] = 8;
+        len[1] = available >= 3 ? 5 + f[2] : -1;
+        return true;
+    case 5: case 6:
+        len[0] = 8;
+        len[1] = 0;
+        return true;
+    case 15: case 16:
+        len[0] = available >= 7 ? 9 + f[6] : -1;
+        len[1] = 8;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Поиск кадра, начинающегося с f
+ *
+ * @param waiting true если длина одного из вариантов больше принятого
+ * @return Длина кадра с верной CRC (0 - нет), request - это запрос
+ */
+static size_t match_at(const modbus_state_t *s, const uint8_t *f, size_t available,
+                       bool *waiting, bool *request)
+{
+    int len[2];
+    *waiting = false;
+    if (available < 2 || !candidate_lengths(f, available, len)) {
+        return 0;
+    }
+    // Ответ на запрос того же ведомого с той же функцией проверяется первым
+    bool reply_first = s->req_valid && s->req_slave == f[0] && s->req_fc == f[1];
+    for (int k = 0; k < 2; k++) {
+        int i = reply_first ? 1 - k : k;
+        if (len[i] == 0 || len[i] > MODBUS_MAX_FRAME) {
+            continue;
+        }
+        if (len[i] < 0 || (size_t)len[i] > available) {
+            *waiting = true;
+            continue;
+        }
+        if (crc_ok(f, (size_t)len[i])) {
+            *request = i == 0;
+            return (size_t)len[i];
+        }
+    }
+    return 0;
+}
+
+/**
+ * Выделение кадров из начала буфера
+ */
+static void parse(modbus_state_t *s, decoder_ctx_t *ctx)
+{
+    while (s->length >= 2) {
+        const uint8_t *f = s->buf + s->start;
+        bool waiting;
+        bool request;
+        size_t length = match_at(s, f, s->length, &waiting, &request);
+
+        if (length != 0) {
+            handle_frame(s, ctx, f, request);
+            ctx->frames++;
+            s->resync = false;
+            s->start = (uint16_t)(s->start + length);
+            s->length = (uint16_t)(s->length - length);
+            continue;
+        }
+        if (waiting && s->resync) {
+            // Без синхронизации длинный вариант может оказаться мусором:
+            // если дальше в буфере уже есть целый кадр, поиск идет с него
+            size_t skip = 0;
+            for (size_t off = 1; off + 4 <= s->length && skip == 0; off++) {
+                bool w;
+                if (match_at(s, f + off, s->length - off, &w, &request) != 0) {
+                    skip = off;
+                }
+            }
+            if (skip != 0) {
+                s->start = (uint16_t)(s->start + skip);
+                s->length = (uint16_t)(s->length - skip);
+                continue;
+            }
+        }
+        if (waiting) {
+            return;
+        }
+        if (!s->resync) {
+            ctx->errors++;
+            s->resync = true;
+        }
+        s->start++;
+        s->length--;
+    }
+}
+
+static void modbus_reset(void *state)
+{
+    modbus_state_t *s = (modbus_state_t *)state;
+    memset(s, 0, sizeof(*s));
+}
+
+static void modbus_feed(void *state, decoder_ctx_t *ctx, const uint8_t *data, size_t length)
+{
+    modbus_state_t *s = (modbus_state_t *)state;
+    while (length > 0) {
+        // Непросмотренные байты - в начало буфера (сдвиг раз на порцию,
+        // а не на каждый отброшенный байт)
+        if (s->start != 0) {
+            memmove(s->buf, s->buf + s->start, s->length);
+            s->start = 0;
+        }
+        size_t n = MODBUS_MAX_FRAME - s->length;
+        if (n > length) {
+            n = length;
+        }
+        memcpy(s->buf + s->length, data, n);
+        s->length = (uint16_t)(s->length + n);
+        data += n;
+        length -= n;
+        parse(s, ctx);
+    }
+}
+
+const decoder_ops_t decoder_modbus = {
+    "modbus", sizeof(modbus_state_t), true, modbus_reset, modbus_feed,
+};
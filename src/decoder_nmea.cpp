@@ -0,0 +1,199 @@
+/**
+ * @file decoder_nmea.cpp
+ * @brief Декодер NMEA 0183
+ *
+ * Предложение - строка от '$' или '!' до CR/LF с контрольной суммой *hh
+ * (XOR байт между началом и '*'). Строка без суммы, с неверной суммой или
+ * длиннее NMEA_MAX_LINE - ошибка. Поля выделяются из GGA и RMC любого
+ * источника ($GP, $GN, $GL...); остальные предложения только считаются.
+ *   gga.time (hhmmss), gga.lat, gga.lon (градусы, юг и запад - минус),
+ *   gga.fix, gga.sats, gga.hdop, gga.alt (м)
+ *   rmc.valid (1 - A, 0 - V), rmc.lat, rmc.lon, rmc.speed_kn, rmc.course,
+ *   rmc.date (ddmmyy)
+ */
+
+#include "decoder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NMEA_MAX_LINE   96      // 82 по стандарту и запас для расширений
+#define NMEA_MAX_FIELDS 24
+
+typedef struct {
+    char line[NMEA_MAX_LINE + 1];
+    uint8_t length;
+    bool in_line;
+    bool overflow;
+} nmea_state_t;
+
+static_assert(sizeof(nmea_state_t) <= DECODER_STATE_SIZE, "DECODER_STATE_SIZE too small");
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/**
+ * Широта/долгота из (d)ddmm.mmmm и полушария
+ */
+static bool parse_coord(const char *value, const char *hemisphere, double *degrees)
+{
+    if (*value == '\0') {
+        return false;
+    }
+    double v = strtod(value, NULL);
+    int whole = (int)(v / 100);
+    *degrees = whole + (v - whole * 100) / 60.0;
+    if (*hemisphere == 'S' || *hemisphere == 'W') {
+        *degrees = -*degrees;
+    }
+    return true;
+}
+
+static void emit_number(decoder_ctx_t *ctx, const char *key, const char *value)
+{
+    if (*value != '\0') {
+        decoder_emit_float(ctx, key, strtod(value, NULL));
+    }
+}
+
+static void emit_integer(decoder_ctx_t *ctx, const char *key, const char *value)
+{
+    if (*value != '\0') {
+        decoder_emit_int(ctx, key, strtol(value, NULL, 10));
+    }
+}
+
+static void emit_coords(decoder_ctx_t *ctx, const char *lat_key, const char *lon_key,
+                        char *const *field)
+{
+    double degrees;
+    if (parse_coord(field[0], field[1], &degrees)) {
+        decoder_emit_float(ctx, lat_key, degrees);
+    }
+    if (parse_coord(field[2], field[3], &degrees)) {
+        decoder_emit_float(ctx, lon_key, degrees);
+    }
+}
+
+/**
+ * Разбор предложения с верной суммой (line - без '*hh', с нулем в конце)
+ */
+static void handle_sentence(decoder_ctx_t *ctx, char *line)
+{
+    char *field[NMEA_MAX_FIELDS];
+    int count = 0;
+    for (char *p = line; count < NMEA_MAX_FIELDS; p++) {
+        field[count++] = p;
+        p = strchr(p, ',');
+        if (p == NULL) {
+            break;
+        }
+        *p = '\0';
+    }
+    // field[0] - "$GPGGA": источник (2 символа) и тип
+    if (line[0] != '$' || strlen(field[0]) != 6) {
+        return;
+    }
+    const char *type = field[0] + 3;
+
+    if (strcmp(type, "GGA") == 0 && count >= 10) {
+        emit_integer(ctx, "gga.time", field[1]);
+        emit_coords(ctx, "gga.lat", "gga.lon", field + 2);
+        emit_integer(ctx, "gga.fix", field[6]);
+        emit_integer(ctx, "gga.sats", field[7]);
+        emit_number(ctx, "gga.hdop", field[8]);
+        emit_number(ctx, "gga.alt", field[9]);
+    } else if (strcmp(type, "RMC") == 0 && count >= 10) {
+        if (field[2][0] != '\0') {
+            decoder_emit_int(ctx, "rmc.valid", field[2][0] == 'A');
+        }
+        emit_coords(ctx, "rmc.lat", "rmc.lon", field + 3);
+        emit_number(ctx, "rmc.speed_kn", field[7]);
+        emit_number(ctx, "rmc.course", field[8]);
+        emit_integer(ctx, "rmc.date", field[9]);
+    }
+}
+
+/**
+ * Проверка суммы и разбор принятой строки
+ */
+static void end_line(nmea_state_t *s, decoder_ctx_t *ctx)
+{
+    char *line = s->line;
+    line[s->length] = '\0';
+    char *star = strchr(line, '*');
+    if (star == NULL || star[1] == '\0' || star[2] == '\0') {
+        ctx->errors++;
+        return;
+    }
+    int hi = hex_value(star[1]);
+    int lo = hex_value(star[2]);
+    uint8_t sum = 0;
+    for (const char *p = line + 1; p < star; p++) {
+        sum ^= (uint8_t)*p;
+    }
+    if (hi < 0 || lo < 0 || sum != (uint8_t)((hi << 4) | lo)) {
+        ctx->errors++;
+        return;
+    }
+    *star = '\0';
+    ctx->frames++;
+    handle_sentence(ctx, line);
+}
+
+static void nmea_reset(void *state)
+{
+    nmea_state_t *s = (nmea_state_t *)state;
+    memset(s, 0, sizeof(*s));
+}
+
+static void nmea_feed(void *state, decoder_ctx_t *ctx, const uint8_t *data, size_t length)
+{
+    nmea_state_t *s = (nmea_state_t *)state;
+    for (size_t i = 0; i < length; i++) {
+        char c = (char)data[i];
+        if (c == '$' || c == '!') {
+            if (s->in_line && !s->overflow) {
+                ctx->errors++;      // Начало нового предложения до конца строки
+            }
+            s->line[0] = c;
+            s->length = 1;
+            s->in_line = true;
+            s->overflow = false;
+            continue;
+        }
+        if (!s->in_line) {
+            continue;
+        }
+        if (c == '\r' || c == '\n') {
+            if (!s->overflow) {
+                end_line(s, ctx);
+            }
+            s->in_line = false;
+            continue;
+        }
+        if (s->length == NMEA_MAX_LINE) {
+            if (!s->overflow) {
+                ctx->errors++;
+                s->overflow = true;
+            }
+            continue;
+        }
+        s->line[s->length++] = c;
+    }
+}
+
+const decoder_ops_t decoder_nmea = {
+    "nmea", sizeof(nmea_state_t), false, nmea_reset, nmea_feed,
+};
@@ -0,0 +1,126 @@
+/**
+ * @file decoder_tlv.cpp
+ * @brief Декодер простого двоичного протокола TLV
+ *
+ * Кадр: DECODER_TLV_SYNC, тег (1 байт), длина значения (1 байт), значение,
+ * CRC-8 (полином 0x07, начальное 0) по тегу, длине и значению. Значение
+ * длиной 1, 2, 4 или 8 байт записывается как целое без знака (little
+ * endian) в поле tlv.<тег>; кадры с другими длинами только считаются.
+ *
+ * Каждый кадр с неверной CRC - ошибка; байты вне кадров - одна ошибка на
+ * эпизод потери синхронизации. После неверной CRC поиск продолжается со
+ * следующего DECODER_TLV_SYNC внутри уже принятого кадра, поэтому
+ * ложная синхронизация не теряет следующий кадр.
+ */
+
+#include "decoder.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define TLV_MAX_FRAME   (3 + 255 + 1)
+
+typedef struct {
+    uint8_t buf[TLV_MAX_FRAME];
+    uint16_t length;
+    bool resync;                    // Идет поиск синхронизации (мусор уже учтен)
+} tlv_state_t;
+
+static_assert(sizeof(tlv_state_t) <= DECODER_STATE_SIZE, "DECODER_STATE_SIZE too small");
+
+static uint8_t crc8(const uint8_t *data, size_t length)
+{
+    uint8_t crc = 0;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void handle_frame(decoder_ctx_t *ctx, const uint8_t *f)
+{
+    uint8_t len = f[2];
+    if (len != 1 && len != 2 && len != 4 && len != 8) {
+        return;
+    }
+    uint64_t value = 0;
+    for (int i = len - 1; i >= 0; i--) {
+        value = (value << 8) | f[3 + i];
+    }
+    char key[FIELD_KEY_SIZE];
+    snprintf(key, sizeof(key), "tlv.%u", f[1]);
+    decoder_emit_int(ctx, key, (int64_t)value);
+}
+
+/**
+ * Отбросить байты до следующего байта синхронизации после buf[0]
+ */
+static void skip_to_sync(tlv_state_t *s)
+{
+    const uint8_t *next = s->length > 1 ?
+        (const uint8_t *)memchr(s->buf + 1, DECODER_TLV_SYNC, s->length - 1) : NULL;
+    size_t drop = next != NULL ? (size_t)(next - s->buf) : s->length;
+    s->length = (uint16_t)(s->length - drop);
+    memmove(s->buf, s->buf + drop, s->length);
+}
+
+static void parse(tlv_state_t *s, decoder_ctx_t *ctx)
+{
+    while (s->length > 0) {
+        if (s->buf[0] != DECODER_TLV_SYNC) {
+            if (!s->resync) {
+                ctx->errors++;
+                s->resync = true;
+            }
+            skip_to_sync(s);
+            continue;
+        }
+        if (s->length < 3) {
+            return;
+        }
+        size_t frame_len = 3 + (size_t)s->buf[2] + 1;
+        if (s->length < frame_len) {
+            return;
+        }
+        if (crc8(s->buf + 1, frame_len - 2) != s->buf[frame_len - 1]) {
+            ctx->errors++;
+            s->resync = true;
+            skip_to_sync(s);
+            continue;
+        }
+        handle_frame(ctx, s->buf);
+        ctx->frames++;
+        s->resync = false;
+        s->length = (uint16_t)(s->length - frame_len);
+        memmove(s->buf, s->buf + frame_len, s->length);
+    }
+}
+
+static void tlv_reset(void *state)
+{
+    tlv_state_t *s = (tlv_state_t *)state;
+    memset(s, 0, sizeof(*s));
+}
+
+static void tlv_feed(void *state, decoder_ctx_t *ctx, const uint8_t *data, size_t length)
+{
+    tlv_state_t *s = (tlv_state_t *)state;
+    while (length > 0) {
+        size_t n = TLV_MAX_FRAME - s->length;
+        if (n > length) {
+            n = length;
+        }
+        memcpy(s->buf + s->length, data, n);
+        s->length = (uint16_t)(s->length + n);
+        data += n;
+        length -= n;
+        parse(s, ctx);
+    }
+}
+
+const decoder_ops_t decoder_tlv = {
+    "tlv", sizeof(tlv_state_t), false, tlv_reset, tlv_feed,
+};
@@ -0,0 +1,330 @@
+/**
+ * @file diagnostics.cpp
+ * @brief Статистика задач и пробуждений процессора (/api/tasks)
+ *
+ * Раньше в рабочей прошивке постоянно работала задача опроса уровня RX
+ * (gpio_get_level каждые 10 мс): 100 лишних пробуждений в секунду даже
+ * без данных в линии. Проверка подключения теперь есть только в
+ * диагностической сборке и не опрашивает вывод: фронты считает
+ * прерывание GPIO, а сводку раз в DIAG_RX_EDGE_REPORT_MS выводит таймер.
+ * Чтобы прерывание на каждый фронт не отнимало процессор на высоких
+ * скоростях, после DIAG_RX_EDGE_LIMIT фронтов за период оно отключается
+ * до следующей сводки.
+ */
+
+#include "diagnostics.h"
+#include "config.h"
+#include "metrics.h"
+#include "uart_rx.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_freertos_hooks.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#if COMTOAIR_DIAGNOSTICS
+#include <atomic>
+#include "driver/gpio.h"
+#endif
+
+static const char *TAG = "Diag";
+
+static metric_t idle_wakeups;
+static bool started = false;
+
+// Состояние окна: пишет только вызывающий diag_get_tasks (HTTP сервер)
+typedef struct {
+    uint32_t number;
+    uint64_t run_time;
+} diag_prev_t;
+
+#if configUSE_TRACE_FACILITY
+static TaskStatus_t status[DIAG_MAX_TASKS];
+static diag_prev_t prev_tasks[DIAG_MAX_TASKS];
+static size_t prev_count = 0;
+static uint64_t prev_total = 0;
+#endif
+static int64_t prev_time_us = 0;
+static uint32_t prev_wakeups = 0;
+static uint32_t prev_jitter_samples = 0;
+static uint32_t prev_jitter_sum = 0;
+
+/**
+ * Хук задачи IDLE: true - следующий вызов после очередного прерывания
+ */
+static bool idle_hook(void)
+{
+    metric_add(&idle_wakeups, 1);
+    return true;
+}
+
+#if COMTOAIR_DIAGNOSTICS
+static metric_t rx_pin_edges;
+static std::atomic<uint32_t> period_edges{0};
+static esp_timer_handle_t edge_timer = NULL;
+
+/**
+ * Прерывание по любому фронту на выводе RX
+ */
+static void rx_edge_isr(void *arg)
+{
+    metric_add(&rx_pin_edges, 1);
+    if (period_edges.fetch_add(1, std::memory_order_relaxed) + 1 >= DIAG_RX_EDGE_LIMIT) {
+        gpio_intr_disable(UART_RX_PIN);
+    }
+}
+
+/**
+ * Сводка по фронтам RX (задача esp_timer): начало и конец активности,
+ * предупреждение о подключении; прерывание снова разрешается
+ */
+static void edge_report(void *arg)
+{
+    static bool active = false;
+    static bool warned = false;
+    static uint32_t periods = 0;
+
+    uint32_t edges = period_edges.exchange(0, std::memory_order_relaxed);
+    int level = gpio_get_level(UART_RX_PIN);
+    periods++;
+
+    if ((edges > 0) != active) {
+        active = edges > 0;
+        ESP_LOGI(TAG, "RX pin %s: %lu%s edges in %d ms, level %d, total %lu",
+                 active ? "active" : "idle", (unsigned long)edges,
+                 edges >= DIAG_RX_EDGE_LIMIT ? "+" : "", DIAG_RX_EDGE_REPORT_MS, level,
+                 (unsigned long)metric_get(&rx_pin_edges));
+    }
+    if (!warned && metric_get(&rx_pin_edges) == 0 &&
+        periods * DIAG_RX_EDGE_REPORT_MS >= 10000) {
+        ESP_LOGW(TAG, "RX pin level never changed (level %d)! Check wiring!", level);
+        warned = true;
+    }
+    gpio_intr_enable(UART_RX_PIN);
+}
+
+/**
+ * Счетчик фронтов на выводе RX. Вывод уже назначен приемнику UART:
+ * меняется только тип прерывания, gpio_config() не вызывается
+ */
+static bool start_edge_counter(void)
+{
+    metrics_register(&rx_pin_edges, METRIC_COUNTER, "comtoair_diag_rx_pin_edges_total",
+                     "Edges seen on the RX pin by the diagnostic GPIO interrupt", NULL);
+
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "gpio_install_isr_service failed: %s", esp_err_to_name(ret));
+        return false;
+    }
+    gpio_set_intr_type(UART_RX_PIN, GPIO_INTR_ANYEDGE);
+    ret = gpio_isr_handler_add(UART_RX_PIN, rx_edge_isr, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "gpio_isr_handler_add failed: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = edge_report,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "diag_rx_edges",
+        .skip_unhandled_events = true,
+    };
+    if (esp_timer_create(&timer_args, &edge_timer) != ESP_OK ||
+        esp_timer_start_periodic(edge_timer, DIAG_RX_EDGE_REPORT_MS * 1000ULL) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start RX edge report timer");
+        return false;
+    }
+    gpio_intr_enable(UART_RX_PIN);
+    ESP_LOGI(TAG, "RX pin edge counter on GPIO%d (level %d)", UART_RX_PIN,
+             gpio_get_level(UART_RX_PIN));
+    return true;
+}
+#endif // COMTOAIR_DIAGNOSTICS
+
+bool diag_start(void)
+{
+    if (started) {
+        return true;
+    }
+    metrics_register(&idle_wakeups, METRIC_COUNTER, "comtoair_idle_wakeups_total",
+                     "Interrupts that woke the CPU from the idle task", NULL);
+    esp_err_t ret = esp_register_freertos_idle_hook(idle_hook);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register idle hook: %s", esp_err_to_name(ret));
+        return false;
+    }
+    prev_time_us = esp_timer_get_time();
+    started = true;
+
+#if COMTOAIR_DIAGNOSTICS
+    return start_edge_counter();
+#else
+    return true;
+#endif
+}
+
+#if configUSE_TRACE_FACILITY
+static const char *state_name(eTaskState state)
+{
+    switch (state) {
+    case eRunning:      return "running";
+    case eReady:        return "ready";
+    case eBlocked:      return "blocked";
+    case eSuspended:    return "suspended";
+    case eDeleted:      return "deleted";
+    default:            return "invalid";
+    }
+}
+
+/**
+ * Процессорное время задачи в предыдущем снимке (0 - новая задача)
+ */
+static uint64_t prev_run_time(uint32_t number)
+{
+    for (size_t i = 0; i < prev_count; i++) {
+        if (prev_tasks[i].number == number) {
+            return prev_tasks[i].run_time;
+        }
+    }
+    return 0;
+}
+#endif
+
+size_t diag_get_tasks(diag_task_t *tasks, size_t max, diag_summary_t *summary)
+{
+    memset(summary, 0, sizeof(*summary));
+
+    int64_t now = esp_timer_get_time();
+    summary->window_us = (uint64_t)(now - prev_time_us);
+    prev_time_us = now;
+
+    summary->idle_wakeups = metric_get(&idle_wakeups);
+    summary->window_wakeups = summary->idle_wakeups - prev_wakeups;
+    prev_wakeups = summary->idle_wakeups;
+
+    uart_rx_stats_t rx;
+    uart_rx_get_stats(&rx);
+    summary->rx_jitter_samples = rx.jitter_samples - prev_jitter_samples;
+    if (summary->rx_jitter_samples > 0) {
+        summary->rx_jitter_mean_us = (rx.jitter_sum_us - prev_jitter_sum) /
+                                     summary->rx_jitter_samples;
+    }
+    summary->rx_jitter_max_us = uart_rx_take_jitter_max();
+    prev_jitter_samples = rx.jitter_samples;
+    prev_jitter_sum = rx.jitter_sum_us;
+
+#if COMTOAIR_DIAGNOSTICS
+    summary->rx_pin_edges = metric_get(&rx_pin_edges);
+#endif
+
+    summary->task_count = uxTaskGetNumberOfTasks();
+#if configUSE_TRACE_FACILITY
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    size_t count = uxTaskGetSystemState(status, DIAG_MAX_TASKS, &total);
+    if (count == 0 || count > max) {
+        return 0;
+    }
+    summary->run_time_stats = configGENERATE_RUN_TIME_STATS != 0;
+    summary->run_time_us = (uint64_t)total;
+    uint64_t window_total = (uint64_t)total - prev_total;
+    prev_total = (uint64_t)total;
+
+    for (size_t i = 0; i < count; i++) {
+        const TaskStatus_t &s = status[i];
+        diag_task_t &t = tasks[i];
+        strncpy(t.name, s.pcTaskName, sizeof(t.name) - 1);
+        t.name[sizeof(t.name) - 1] = '\0';
+        t.number = (uint32_t)s.xTaskNumber;
+        t.state = state_name(s.eCurrentState);
+        t.priority = (uint32_t)s.uxCurrentPriority;
+        t.base_priority = (uint32_t)s.uxBasePriority;
+        t.stack_free = (uint32_t)s.usStackHighWaterMark;
+        t.run_time_us = (uint64_t)s.ulRunTimeCounter;
+        uint64_t delta = t.run_time_us - prev_run_time(t.number);
+        t.cpu_permille = window_total > 0 ? (uint32_t)(delta * 1000 / window_total) : 0;
+        if (strncmp(t.name, "IDLE", 4) == 0) {
+            summary->idle_permille += t.cpu_permille;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        prev_tasks[i].number = tasks[i].number;
+        prev_tasks[i].run_time = tasks[i].run_time_us;
+    }
+    prev_count = count;
+
+    // По убыванию приоритета: снимок читается как раскладка задач
+    for (size_t i = 1; i < count; i++) {
+        diag_task_t t = tasks[i];
+        size_t j = i;
+        while (j > 0 && tasks[j - 1].base_priority < t.base_priority) {
+            tasks[j] = tasks[j - 1];
+            j--;
+        }
+        tasks[j] = t;
+    }
+    return count;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Размеры стеков задач моста (config.h) по имени задачи
+ */
+typedef struct {
+    const char *name;
+    uint32_t size;
+} diag_stack_size_t;
+
+static const diag_stack_size_t stack_sizes[] = {
+    { "uart_read_task", TASK_STACK_UART_RX },
+    { "port_rx",        TASK_STACK_PORT_RX },
+    { "uart_tx",        TASK_STACK_UART_TX },
+    { "tcp_forward",    TASK_STACK_TCP_FORWARD },
+    { "ws_stream",      TASK_STACK_WS_STREAM },
+    { "sse_stream",     TASK_STACK_SSE_STREAM },
+    { "tcp_serial",     TASK_STACK_TCP_SERIAL },
+    { "http_wait",      TASK_STACK_HTTP_WAIT },
+    { "httpd",          TASK_STACK_HTTPD },
+    { "flash_log",      TASK_STACK_FLASH_LOG },
+    { "dlog",           TASK_STACK_DLOG },
+};
+
+size_t diag_get_stacks(diag_stack_t *stacks, size_t max)
+{
+#if configUSE_TRACE_FACILITY
+    size_t count = uxTaskGetSystemState(status, DIAG_MAX_TASKS, NULL);
+    if (count > max) {
+        count = max;
+    }
+    for (size_t i = 0; i < count; i++) {
+        diag_stack_t &t = stacks[i];
+        strncpy(t.name, status[i].pcTaskName, sizeof(t.name) - 1);
+        t.name[sizeof(t.name) - 1] = '\0';
+        t.stack_free = (uint32_t)status[i].usStackHighWaterMark;
+        t.stack_size = 0;
+        for (size_t k = 0; k < sizeof(stack_sizes) / sizeof(stack_sizes[0]); k++) {
+            if (strcmp(t.name, stack_sizes[k].name) == 0) {
+                t.stack_size = stack_sizes[k].size;
+            }
+        }
+    }
+    // Меньший запас - выше
+    for (size_t i = 1; i < count; i++) {
+        diag_stack_t t = stacks[i];
+        size_t j = i;
+        while (j > 0 && stacks[j - 1].stack_free > t.stack_free) {
+            stacks[j] = stacks[j - 1];
+            j--;
+        }
+        stacks[j] = t;
+    }
+    return count;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,281 @@
+/**
+ * @file dlog.cpp
+ * @brief Отложенный двоичный журнал для горячего пути
+ *
+ * Кольцо событий - ограниченная очередь с несколькими писателями и одним
+ * читателем: у каждого слота есть номер. Свободный слот позиции pos имеет
+ * номер pos; писатель занимает позицию сдвигом head (CAS), заполняет слот
+ * и публикует номер pos + 1. Читатель забирает слот с номером tail + 1 и
+ * освобождает его для следующего круга номером tail + DLOG_RING_SIZE.
+ * Писатель никогда не ждет: если слот еще не освобожден, событие теряется.
+ */
+
+#include "dlog.h"
+#include "config.h"
+#include "metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+static const char *TAG = "DLog";
+
+static_assert((DLOG_RING_SIZE & (DLOG_RING_SIZE - 1)) == 0,
+              "DLOG_RING_SIZE must be a power of two");
+
+/**
+ * Описание события: тег, уровень и формат (аргументы - unsigned long)
+ */
+typedef struct {
+    dlog_tag_t tag;
+    esp_log_level_t level;
+    const char *format;
+} dlog_event_info_t;
+
+// Порядок совпадает с dlog_event_t
+static const dlog_event_info_t events[] = {
+    { DLOG_TAG_UART_RX, ESP_LOG_DEBUG,  "RX %lu bytes" },
+    { DLOG_TAG_UART_RX, ESP_LOG_WARN,   "HW FIFO overflow (total %lu)" },
+    { DLOG_TAG_UART_RX, ESP_LOG_WARN,   "Driver ring buffer full (total %lu)" },
+    { DLOG_TAG_UART_RX, ESP_LOG_INFO,   "BREAK on line (total %lu)" },
+    { DLOG_TAG_UART_RX, ESP_LOG_WARN,   "Frame error (total %lu)" },
+    { DLOG_TAG_UART_RX, ESP_LOG_WARN,   "Parity error (total %lu)" },
+};
+static_assert(sizeof(events) / sizeof(events[0]) == DLOG_EVENT_COUNT,
+              "events[] must describe every dlog_event_t");
+
+static const char *const tag_names[] = {
+    "UartRx",
+};
+static_assert(sizeof(tag_names) / sizeof(tag_names[0]) == DLOG_TAG_COUNT,
+              "tag_names[] must name every dlog_tag_t");
+
+static const char *const level_names[] = {
+    "none", "error", "warn", "info", "debug", "verbose",
+};
+
+typedef struct {
+    std::atomic<uint32_t> seq;  // Номер слота (см. описание файла)
+    uint16_t event;
+    uint32_t time_ms;
+    uint32_t args[2];
+} dlog_slot_t;
+
+static dlog_slot_t ring[DLOG_RING_SIZE];
+static std::atomic<uint32_t> head(0);
+static uint32_t tail = 0;                   // Только задача журнала
+static std::atomic<bool> started(false);
+
+static std::atomic<uint8_t> tag_levels[DLOG_TAG_COUNT];
+
+static std::atomic<uint32_t> stat_recorded(0);
+static std::atomic<uint32_t> stat_dropped(0);
+static std::atomic<uint32_t> stat_suppressed(0);
+static std::atomic<uint32_t> stat_emitted(0);
+
+/**
+ * Окно ограничения частоты вывода тега (только задача журнала)
+ */
+typedef struct {
+    uint32_t window_start_ms;
+    uint32_t lines;
+    uint32_t suppressed;
+} dlog_rate_t;
+
+static dlog_rate_t rates[DLOG_TAG_COUNT];
+
+// Знаковая разность порядковых номеров (корректна при переполнении 2^32)
+static inline int32_t seq_diff(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b);
+}
+
+static inline uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void dlog_write(dlog_event_t event, uint32_t arg0, uint32_t arg1)
+{
+    const dlog_event_info_t *info = &events[event];
+    if (info->level > tag_levels[info->tag].load(std::memory_order_relaxed) ||
+        !started.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    uint32_t pos = head.load(std::memory_order_relaxed);
+    dlog_slot_t *slot;
+    while (true) {
+        slot = &ring[pos & (DLOG_RING_SIZE - 1)];
+        int32_t diff = seq_diff(slot->seq.load(std::memory_order_acquire), pos);
+        if (diff == 0) {
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Задача журнала не успевает - не ждем
+            stat_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->event = (uint16_t)event;
+    slot->time_ms = now_ms();
+    slot->args[0] = arg0;
+    slot->args[1] = arg1;
+    slot->seq.store(pos + 1, std::memory_order_release);
+    stat_recorded.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Вывод строк о подавленных событиях тегов, у которых закончилось окно
+ */
+static void flush_suppressed(uint32_t time_ms)
+{
+    for (int tag = 0; tag < DLOG_TAG_COUNT; tag++) {
+        dlog_rate_t *rate = &rates[tag];
+        // События из кольца могут быть старше начала окна
+        if (seq_diff(time_ms, rate->window_start_ms) < 1000) {
+            continue;
+        }
+        if (rate->suppressed > 0) {
+            ESP_LOG_LEVEL(ESP_LOG_WARN, tag_names[tag], "%lu messages suppressed",
+                          (unsigned long)rate->suppressed);
+            stat_emitted.fetch_add(1, std::memory_order_relaxed);
+        }
+        rate->window_start_ms = time_ms;
+        rate->lines = 0;
+        rate->suppressed = 0;
+    }
+}
+
+static void emit(uint16_t event, uint32_t time_ms, const uint32_t *args)
+{
+    const dlog_event_info_t *info = &events[event];
+    // Уровень могли понизить, пока событие лежало в кольце
+    if (info->level > tag_levels[info->tag].load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    flush_suppressed(time_ms);
+    dlog_rate_t *rate = &rates[info->tag];
+    if (rate->lines >= DLOG_RATE_PER_SEC) {
+        rate->suppressed++;
+        stat_suppressed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    rate->lines++;
+
+    char text[96];
+    snprintf(text, sizeof(text), info->format, (unsigned long)args[0], (unsigned long)args[1]);
+    // Время события, а не вывода: задача журнала отстает до DLOG_FLUSH_MS
+    ESP_LOG_LEVEL(info->level, tag_names[info->tag], "[%lu] %s", (unsigned long)time_ms, text);
+    stat_emitted.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Задача журнала: вывод накопленных событий раз в DLOG_FLUSH_MS
+ */
+static void dlog_task(void *pvParameters)
+{
+    uint32_t reported_dropped = 0;
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(DLOG_FLUSH_MS));
+
+        while (true) {
+            dlog_slot_t *slot = &ring[tail & (DLOG_RING_SIZE - 1)];
+            if (slot->seq.load(std::memory_order_acquire) != tail + 1) {
+                break;
+            }
+            uint16_t event = slot->event;
+            uint32_t time_ms = slot->time_ms;
+            uint32_t args[2] = { slot->args[0], slot->args[1] };
+            slot->seq.store(tail + DLOG_RING_SIZE, std::memory_order_release);
+            tail++;
+
+            emit(event, time_ms, args);
+        }
+        flush_suppressed(now_ms());
+
+        uint32_t dropped = stat_dropped.load(std::memory_order_relaxed);
+        if (dropped != reported_dropped) {
+            ESP_LOGW(TAG, "%lu events lost (log ring full)",
+                     (unsigned long)(dropped - reported_dropped));
+            reported_dropped = dropped;
+        }
+    }
+}
+
+bool dlog_start(void)
+{
+    if (started.load()) {
+        return true;
+    }
+    for (uint32_t i = 0; i < DLOG_RING_SIZE; i++) {
+        ring[i].seq.store(i, std::memory_order_relaxed);
+    }
+    for (int tag = 0; tag < DLOG_TAG_COUNT; tag++) {
+        tag_levels[tag].store(DLOG_DEFAULT_LEVEL, std::memory_order_relaxed);
+    }
+    TaskHandle_t task = NULL;
+    if (xTaskCreate(dlog_task, "dlog", TASK_STACK_DLOG, NULL, TASK_PRIO_DLOG,
+                    &task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create log task");
+        return false;
+    }
+    metrics_watch_task(task);
+    started.store(true, std::memory_order_release);
+    return true;
+}
+
+void dlog_set_level(const char *tag, esp_log_level_t level)
+{
+    bool all = strcmp(tag, "*") == 0;
+    for (int i = 0; i < DLOG_TAG_COUNT; i++) {
+        if (all || strcmp(tag, tag_names[i]) == 0) {
+            tag_levels[i].store(level, std::memory_order_relaxed);
+        }
+    }
+    esp_log_level_set(tag, level);
+    ESP_LOGI(TAG, "Log level of '%s' set to %s", tag, dlog_level_name(level));
+}
+
+esp_log_level_t dlog_get_level(dlog_tag_t tag)
+{
+    return (esp_log_level_t)tag_levels[tag].load(std::memory_order_relaxed);
+}
+
+const char *dlog_tag_name(dlog_tag_t tag)
+{
+    return tag_names[tag];
+}
+
+const char *dlog_level_name(esp_log_level_t level)
+{
+    return level >= ESP_LOG_NONE && level <= ESP_LOG_VERBOSE ? level_names[level] : "unknown";
+}
+
+bool dlog_parse_level(const char *name, esp_log_level_t *level)
+{
+    for (int i = ESP_LOG_NONE; i <= ESP_LOG_VERBOSE; i++) {
+        if (strcmp(name, level_names[i]) == 0) {
+            *level = (esp_log_level_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void dlog_get_stats(dlog_stats_t *stats)
+{
+    stats->recorded = stat_recorded.load(std::memory_order_relaxed);
+    stats->dropped = stat_dropped.load(std::memory_order_relaxed);
+    stats->suppressed = stat_suppressed.load(std::memory_order_relaxed);
+    stats->emitted = stat_emitted.load(std::memory_order_relaxed);
+}
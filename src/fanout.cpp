@@ -0,0 +1,275 @@
+/**
+ * @file fanout.cpp
+ * @brief Раздача данных RS-232 потоковым клиентам с бюджетом отставания
+ *
+ * Слоты всех транспортов лежат в одной таблице: сначала ожидающие запросы
+ * HTTP, затем WebSocket, затем TCP. Занятие и освобождение слота - в
+ * критической секции; курсор слота меняет только задача его транспорта.
+ */
+
+#include "fanout.h"
+#include "web_server.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+
+static const char *TAG = "Fanout";
+
+static_assert(FANOUT_MIN_LAG_BUDGET <= DATA_BUFFER_SIZE - FANOUT_LAG_MARGIN,
+              "FANOUT_LAG_MARGIN leaves no room for the lag budget");
+
+#define FANOUT_MAX_CLIENTS (API_DATA_MAX_WAITERS + WS_STREAM_MAX_CLIENTS + TCP_SERIAL_MAX_CLIENTS + \
+                            SSE_MAX_CLIENTS)
+
+static const char *const transport_names[FANOUT_TRANSPORT_COUNT] = { "http", "ws", "tcp", "sse" };
+static const char *const policy_names[] = { "gap", "disconnect" };
+
+static const int slot_counts[FANOUT_TRANSPORT_COUNT] = {
+    API_DATA_MAX_WAITERS, WS_STREAM_MAX_CLIENTS, TCP_SERIAL_MAX_CLIENTS, SSE_MAX_CLIENTS,
+};
+
+/**
+ * @brief Политика транспорта
+ */
+typedef struct {
+    std::atomic<uint32_t> budget;   // Бюджет отставания, байт
+    std::atomic<uint8_t> policy;    // fanout_policy_t
+    char labels[24];                // Метки метрик транспорта
+    metric_t evictions;             // Отключено клиентов за отставание
+} fanout_transport_state_t;
+
+static fanout_client_t clients[FANOUT_MAX_CLIENTS];
+static fanout_transport_state_t transports[FANOUT_TRANSPORT_COUNT];
+static portMUX_TYPE slots_lock = portMUX_INITIALIZER_UNLOCKED;
+static std::atomic<bool> initialized(false);
+
+// Знаковая разность порядковых номеров (корректна при переполнении 2^32)
+static inline int32_t seq_diff(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b);
+}
+
+static int slot_base(fanout_transport_t transport)
+{
+    int base = 0;
+    for (int t = 0; t < transport; t++) {
+        base += slot_counts[t];
+    }
+    return base;
+}
+
+static uint32_t clamp_budget(uint32_t budget)
+{
+    if (budget < FANOUT_MIN_LAG_BUDGET) {
+        return FANOUT_MIN_LAG_BUDGET;
+    }
+    if (budget > DATA_BUFFER_SIZE - FANOUT_LAG_MARGIN) {
+        return DATA_BUFFER_SIZE - FANOUT_LAG_MARGIN;
+    }
+    return budget;
+}
+
+void fanout_init(void)
+{
+    bool expected = false;
+    if (!initialized.compare_exchange_strong(expected, true)) {
+        return;
+    }
+
+    static const uint32_t budgets[FANOUT_TRANSPORT_COUNT] = {
+        FANOUT_HTTP_LAG_BUDGET, FANOUT_WS_LAG_BUDGET, FANOUT_TCP_LAG_BUDGET, FANOUT_SSE_LAG_BUDGET,
+    };
+    static const fanout_policy_t policies[FANOUT_TRANSPORT_COUNT] = {
+        FANOUT_HTTP_LAG_POLICY, FANOUT_WS_LAG_POLICY, FANOUT_TCP_LAG_POLICY, FANOUT_SSE_LAG_POLICY,
+    };
+
+    int index = 0;
+    for (int t = 0; t < FANOUT_TRANSPORT_COUNT; t++) {
+        fanout_transport_state_t *state = &transports[t];
+        state->budget.store(clamp_budget(budgets[t]));
+        state->policy.store(policies[t]);
+        snprintf(state->labels, sizeof(state->labels), "transport=\"%s\"", transport_names[t]);
+        metrics_register(&state->evictions, METRIC_COUNTER, "comtoair_client_evictions_total",
+                         "Streaming clients disconnected for exceeding the lag budget",
+                         state->labels);
+
+        for (int i = 0; i < slot_counts[t]; i++, index++) {
+            fanout_client_t *client = &clients[index];
+            client->transport = (fanout_transport_t)t;
+            client->slot = (uint8_t)i;
+            client->active.store(false);
+            snprintf(client->labels, sizeof(client->labels), "transport=\"%s\",slot=\"%d\"",
+                     transport_names[t], i);
+            metrics_register(&client->dropped, METRIC_COUNTER,
+                             "comtoair_client_dropped_bytes_total",
+                             "Bytes a client skipped (overwritten or over the lag budget)",
+                             client->labels);
+            metrics_register(&client->lag, METRIC_GAUGE, "comtoair_client_lag_bytes",
+                             "Bytes a streaming client is behind the receive buffer",
+                             client->labels);
+            metrics_register(&client->gaps, METRIC_COUNTER, "comtoair_client_gaps_total",
+                             "Times a client cursor was moved forward past unsent data",
+                             client->labels);
+        }
+    }
+}
+
+fanout_client_t *fanout_open(fanout_transport_t transport, uint32_t seq)
+{
+    fanout_init();
+
+    fanout_client_t *found = NULL;
+    int base = slot_base(transport);
+    portENTER_CRITICAL(&slots_lock);
+    for (int i = 0; i < slot_counts[transport]; i++) {
+        fanout_client_t *client = &clients[base + i];
+        if (!client->active.load(std::memory_order_relaxed)) {
+            client->seq = seq;
+            client->active.store(true, std::memory_order_release);
+            found = client;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&slots_lock);
+
+    if (found != NULL) {
+        metric_set(&found->lag, web_server_data_pending(seq));
+    }
+    return found;
+}
+
+void fanout_close(fanout_client_t *client)
+{
+    if (client == NULL) {
+        return;
+    }
+    metric_set(&client->lag, 0);
+    portENTER_CRITICAL(&slots_lock);
+    client->active.store(false, std::memory_order_release);
+    portEXIT_CRITICAL(&slots_lock);
+}
+
+fanout_verdict_t fanout_check_seq(fanout_transport_t transport, uint32_t *seq, uint32_t *skipped)
+{
+    fanout_transport_state_t *state = &transports[transport];
+    uint32_t head = web_server_data_seq();
+    uint32_t oldest = web_server_data_oldest();
+
+    if (skipped != NULL) {
+        *skipped = 0;
+    }
+
+    // Курсор "из будущего" (сохранен клиентом до перезагрузки) - с самых старых данных
+    if (seq_diff(*seq, head) > 0) {
+        *seq = oldest;
+        return FANOUT_OK;
+    }
+
+    uint32_t budget = state->budget.load(std::memory_order_relaxed);
+    uint32_t lag = head - *seq;
+    if (seq_diff(oldest, *seq) <= 0 && lag <= budget) {
+        return FANOUT_OK;
+    }
+
+    if (state->policy.load(std::memory_order_relaxed) == FANOUT_POLICY_DISCONNECT) {
+        metric_add(&state->evictions, 1);
+        ESP_LOGW(TAG, "Evicting %s client: lag %lu > budget %lu",
+                 transport_names[transport], (unsigned long)lag, (unsigned long)budget);
+        return FANOUT_EVICT;
+    }
+
+    // Продолжение с середины бюджета: клиент получает свежие данные и
+    // запас до следующего пропуска. Сохранилось меньше половины бюджета
+    // (после запуска или восстановления) - с самых старых данных
+    uint32_t resume = head - budget / 2;
+    if (seq_diff(resume, oldest) < 0) {
+        resume = oldest;
+    }
+    if (skipped != NULL) {
+        *skipped = resume - *seq;
+    }
+    *seq = resume;
+    return FANOUT_GAP;
+}
+
+fanout_verdict_t fanout_check(fanout_client_t *client, uint32_t *skipped)
+{
+    uint32_t n = 0;
+    fanout_verdict_t verdict = fanout_check_seq(client->transport, &client->seq, &n);
+    if (verdict == FANOUT_GAP) {
+        metric_add(&client->dropped, n);
+        metric_add(&client->gaps, 1);
+    }
+    metric_set(&client->lag, web_server_data_pending(client->seq));
+    if (skipped != NULL) {
+        *skipped = n;
+    }
+    return verdict;
+}
+
+void fanout_set_policy(fanout_transport_t transport, uint32_t budget, fanout_policy_t policy)
+{
+    fanout_init();
+    transports[transport].budget.store(clamp_budget(budget));
+    transports[transport].policy.store(policy);
+    ESP_LOGI(TAG, "%s: lag budget %lu bytes, policy %s", transport_names[transport],
+             (unsigned long)transports[transport].budget.load(), policy_names[policy]);
+}
+
+void fanout_get_policy(fanout_transport_t transport, uint32_t *budget, fanout_policy_t *policy)
+{
+    fanout_init();
+    *budget = transports[transport].budget.load(std::memory_order_relaxed);
+    *policy = (fanout_policy_t)transports[transport].policy.load(std::memory_order_relaxed);
+}
+
+uint32_t fanout_evictions(fanout_transport_t transport)
+{
+    return metric_get(&transports[transport].evictions);
+}
+
+int fanout_slot_count(fanout_transport_t transport)
+{
+    return slot_counts[transport];
+}
+
+fanout_client_t *fanout_slot(fanout_transport_t transport, int index)
+{
+    fanout_init();
+    return &clients[slot_base(transport) + index];
+}
+
+const char *fanout_transport_name(fanout_transport_t transport)
+{
+    return transport_names[transport];
+}
+
+const char *fanout_policy_name(fanout_policy_t policy)
+{
+    return policy_names[policy];
+}
+
+bool fanout_parse_transport(const char *name, fanout_transport_t *transport)
+{
+    for (int t = 0; t < FANOUT_TRANSPORT_COUNT; t++) {
+        if (strcmp(name, transport_names[t]) == 0) {
+            *transport = (fanout_transport_t)t;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool fanout_parse_policy(const char *name, fanout_policy_t *policy)
+{
+    for (int p = FANOUT_POLICY_GAP; p <= FANOUT_POLICY_DISCONNECT; p++) {
+        if (strcmp(name, policy_names[p]) == 0) {
+            *policy = (fanout_policy_t)p;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file field_table.cpp
+ * @brief Таблица последних значений полей, выделенных декодерами
+ *
+ * Имя и порт записи пишутся один раз, до публикации флагом used (release);
+ * значение хранится битами в атомарном 64-битном слове, поэтому читатель
+ * без блокировок получает либо старое, либо новое значение целиком.
+ */
+
+#include "field_table.h"
+
+#include <string.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+
+static_assert((FIELD_TABLE_SIZE & (FIELD_TABLE_SIZE - 1)) == 0,
+              "FIELD_TABLE_SIZE must be a power of two");
+
+typedef struct {
+    std::atomic<bool> used;
+    char key[FIELD_KEY_SIZE];
+    uint8_t port;
+    std::atomic<uint8_t> type;
+    std::atomic<uint64_t> bits;         // int64_t или double
+    std::atomic<uint32_t> updates;
+    std::atomic<uint32_t> updated_ms;
+} field_slot_t;
+
+static field_slot_t slots[FIELD_TABLE_SIZE];
+static std::atomic<uint32_t> used_count(0);
+static std::atomic<uint32_t> dropped(0);
+static portMUX_TYPE insert_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t key_hash(int port, const char *key)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u ^ (uint32_t)port;
+    for (const char *p = key; *p != '\0'; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619u;
+    }
+    return h;
+}
+
+static inline bool slot_matches(const field_slot_t *slot, int port, const char *key)
+{
+    return slot->port == port && strncmp(slot->key, key, FIELD_KEY_SIZE - 1) == 0;
+}
+
+/**
+ * Запись поля: поиск по цепочке проб, новая запись - под спинлоком
+ * (вставлять могут задачи приема разных портов)
+ */
+static field_slot_t *find_or_insert(int port, const char *key)
+{
+    uint32_t start = key_hash(port, key);
+    for (uint32_t i = 0; i < FIELD_TABLE_SIZE; i++) {
+        field_slot_t *slot = &slots[(start + i) & (FIELD_TABLE_SIZE - 1)];
+        if (slot->used.load(std::memory_order_acquire)) {
+            if (slot_matches(slot, port, key)) {
+                return slot;
+            }
+            continue;
+        }
+
+        field_slot_t *found = NULL;
+        portENTER_CRITICAL(&insert_lock);
+        // Пока ждали, запись могла занять другая задача
+        for (uint32_t j = i; j < FIELD_TABLE_SIZE && found == NULL; j++) {
+            field_slot_t *s = &slots[(start + j) & (FIELD_TABLE_SIZE - 1)];
+            if (!s->used.load(std::memory_order_relaxed)) {
+                strncpy(s->key, key, FIELD_KEY_SIZE - 1);
+                s->key[FIELD_KEY_SIZE - 1] = '\0';
+                s->port = (uint8_t)port;
+                s->updates.store(0, std::memory_order_relaxed);
+                s->used.store(true, std::memory_order_release);
+                used_count.fetch_add(1, std::memory_order_relaxed);
+                found = s;
+            } else if (slot_matches(s, port, key)) {
+                found = s;
+            }
+        }
+        portEXIT_CRITICAL(&insert_lock);
+        if (found == NULL) {
+            break;
+        }
+        return found;
+    }
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return NULL;
+}
+
+static bool store(int port, const char *key, field_type_t type, uint64_t bits, uint32_t now_ms)
+{
+    field_slot_t *slot = find_or_insert(port, key);
+    if (slot == NULL) {
+        return false;
+    }
+    slot->type.store((uint8_t)type, std::memory_order_relaxed);
+    slot->bits.store(bits, std::memory_order_relaxed);
+    slot->updated_ms.store(now_ms, std::memory_order_relaxed);
+    slot->updates.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool field_table_set_int(int port, const char *key, int64_t value, uint32_t now_ms)
+{
+    return store(port, key, FIELD_INT, (uint64_t)value, now_ms);
+}
+
+bool field_table_set_float(int port, const char *key, double value, uint32_t now_ms)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return store(port, key, FIELD_FLOAT, bits, now_ms);
+}
+
+bool field_table_get(size_t index, field_t *field)
+{
+    if (index >= FIELD_TABLE_SIZE) {
+        return false;
+    }
+    field_slot_t *slot = &slots[index];
+    if (!slot->used.load(std::memory_order_acquire)) {
+        return false;
+    }
+    memcpy(field->key, slot->key, sizeof(field->key));
+    field->port = slot->port;
+    field->type = (field_type_t)slot->type.load(std::memory_order_relaxed);
+    uint64_t bits = slot->bits.load(std::memory_order_relaxed);
+    memcpy(&field->value, &bits, sizeof(bits));
+    field->updates = slot->updates.load(std::memory_order_relaxed);
+    field->updated_ms = slot->updated_ms.load(std::memory_order_relaxed);
+    return true;
+}
+
+size_t field_table_count(void)
+{
+    return used_count.load(std::memory_order_relaxed);
+}
+
+uint32_t field_table_dropped(void)
+{
+    return dropped.load(std::memory_order_relaxed);
+}
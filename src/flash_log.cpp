@@ -0,0 +1,400 @@
+/**
+ * @file flash_log.cpp
+ * @brief Запись принятых данных RS-232 в раздел флеш-памяти
+ *
+ * Формат раздела: кольцо сегментов по FLASH_LOG_SEGMENT_SIZE байт (один
+ * сектор). Сегмент с номером N лежит в секторе N % segment_count и
+ * начинается с заголовка segment_header_t, за которым идут данные.
+ * Заголовок и данные защищены CRC32, поэтому сегмент, запись которого
+ * прервалась (сброс питания), при чтении просто пропускается: заголовок
+ * пишется вместе с данными и может оказаться во флеш без их конца.
+ *
+ * Каждый сегмент стоит одного стирания сектора, поэтому неполные
+ * сегменты (сброс по FLASH_LOG_FLUSH_MS) увеличивают износ: отношение
+ * flash_bytes / payload_bytes выдается как коэффициент записи.
+ */
+
+#include "flash_log.h"
+#include "web_server.h"
+#include "config.h"
+#include "metrics.h"
+
+#include <string.h>
+#include <stddef.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "FlashLog";
+
+#define FLASH_LOG_MAGIC         0x474f4c43u     // "CLOG"
+#define FLASH_LOG_SEGMENT_SIZE  4096            // Стираемый сектор SPI флеш
+
+/**
+ * @brief Заголовок сегмента во флеш
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t segment;           // Номер сегмента (сквозной между запусками)
+    uint32_t data_seq;          // Номер первого байта в буфере моста этого запуска
+    uint64_t timestamp_us;      // Время приема первого байта, мкс от запуска
+    uint16_t boot;              // Номер запуска
+    uint16_t length;            // Байт данных в сегменте
+    uint32_t data_crc;          // CRC32 данных
+    uint32_t header_crc;        // CRC32 предыдущих полей заголовка
+} segment_header_t;
+
+static_assert(sizeof(segment_header_t) == 32, "segment header must be 32 bytes");
+
+#define FLASH_LOG_PAYLOAD       (FLASH_LOG_SEGMENT_SIZE - sizeof(segment_header_t))
+
+static const esp_partition_t *partition = NULL;
+static uint32_t segment_count = 0;
+static TaskHandle_t writer_task = NULL;
+
+// Время блокировки задачи записи на стирании и записи сектора
+static metric_histogram_t write_duration;
+
+// Сегмент, который собирает задача записи (заголовок + данные)
+static uint8_t segment_buf[FLASH_LOG_SEGMENT_SIZE];
+
+// Положение в кольце и статистика (пишет задача записи, читает HTTP)
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static flash_log_stats_t stats;
+
+// Номер байта буфера моста, при появлении которого нужно будить задачу
+static std::atomic<uint32_t> wake_seq(0);
+
+// Знаковая разность порядковых номеров (корректна при переполнении 2^32)
+static inline int32_t seq_diff(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b);
+}
+
+static uint32_t header_crc(const segment_header_t *header)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)header, offsetof(segment_header_t, header_crc));
+}
+
+static bool header_valid(const segment_header_t *header)
+{
+    return header->magic == FLASH_LOG_MAGIC &&
+           header->length <= FLASH_LOG_PAYLOAD &&
+           header->header_crc == header_crc(header);
+}
+
+static inline size_t segment_offset(uint32_t segment)
+{
+    return (size_t)(segment % segment_count) * FLASH_LOG_SEGMENT_SIZE;
+}
+
+/**
+ * Восстановление положения записи по заголовкам сегментов
+ */
+static void scan_partition(void)
+{
+    bool found = false;
+    uint32_t newest = 0;
+    uint32_t oldest = 0;
+    uint16_t boot = 0;
+
+    for (uint32_t i = 0; i < segment_count; i++) {
+        segment_header_t header;
+        if (esp_partition_read(partition, (size_t)i * FLASH_LOG_SEGMENT_SIZE,
+                               &header, sizeof(header)) != ESP_OK ||
+            !header_valid(&header) || header.segment % segment_count != i) {
+            continue;
+        }
+        if (!found || seq_diff(header.segment, newest) > 0) {
+            newest = header.segment;
+        }
+        if (!found || seq_diff(header.segment, oldest) < 0) {
+            oldest = header.segment;
+        }
+        if (!found || (int16_t)(header.boot - boot) > 0) {
+            boot = header.boot;
+        }
+        found = true;
+    }
+
+    uint32_t next = found ? newest + 1 : 0;
+    if (found && seq_diff(next, oldest) > (int32_t)segment_count) {
+        oldest = next - segment_count;
+    }
+
+    stats.next_segment = next;
+    stats.oldest_segment = found ? oldest : 0;
+    stats.boot = found ? boot + 1 : 0;
+
+    ESP_LOGI(TAG, "Partition '%s': %lu segments, stored %lu..%lu, boot %u",
+             partition->label, (unsigned long)segment_count,
+             (unsigned long)stats.oldest_segment, (unsigned long)next, stats.boot);
+}
+
+/**
+ * Стирание сектора и запись собранного сегмента
+ */
+static bool write_segment(uint32_t fill, uint32_t data_seq, uint64_t start_us, bool partial)
+{
+    segment_header_t *header = (segment_header_t *)segment_buf;
+    uint8_t *payload = segment_buf + sizeof(segment_header_t);
+
+    portENTER_CRITICAL(&stats_lock);
+    uint32_t segment = stats.next_segment;
+    uint16_t boot = stats.boot;
+    portEXIT_CRITICAL(&stats_lock);
+
+    header->magic = FLASH_LOG_MAGIC;
+    header->segment = segment;
+    header->data_seq = data_seq;
+    header->timestamp_us = start_us;
+    header->boot = boot;
+    header->length = (uint16_t)fill;
+    header->data_crc = esp_rom_crc32_le(0, payload, fill);
+    header->header_crc = header_crc(header);
+
+    size_t offset = segment_offset(segment);
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret = esp_partition_erase_range(partition, offset, FLASH_LOG_SEGMENT_SIZE);
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(partition, offset, segment_buf, sizeof(segment_header_t) + fill);
+    }
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - t0);
+    metric_observe_us(&write_duration, elapsed);
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.last_write_us = elapsed;
+    if (elapsed > stats.max_write_us) {
+        stats.max_write_us = elapsed;
+    }
+    stats.total_write_us += elapsed;
+    stats.flash_bytes += FLASH_LOG_SEGMENT_SIZE;
+    if (ret == ESP_OK) {
+        stats.payload_bytes += fill;
+        stats.segments_written++;
+        if (partial) {
+            stats.partial_segments++;
+        }
+    } else {
+        stats.write_errors++;
+    }
+    // Сектор стерт в любом случае: номер сегмента занят
+    stats.next_segment = segment + 1;
+    if (seq_diff(stats.next_segment, stats.oldest_segment) > (int32_t)segment_count) {
+        stats.oldest_segment = stats.next_segment - segment_count;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Segment %lu write failed: %s", (unsigned long)segment, esp_err_to_name(ret));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Задача записи: переносит байты из буфера моста в сегменты флеш
+ */
+static void flash_log_task(void *pvParameters)
+{
+    uint8_t *payload = segment_buf + sizeof(segment_header_t);
+    // После программного сброса - с байт, не успевших попасть во флеш
+    uint32_t cursor = web_server_data_unpersisted();
+    uint32_t fill = 0;
+    uint32_t first_seq = cursor;
+    uint64_t start_us = 0;
+
+    ESP_LOGI(TAG, "Flash log task started");
+
+    while (1) {
+        wake_seq.store(cursor + (FLASH_LOG_PAYLOAD - fill), std::memory_order_relaxed);
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FLASH_LOG_FLUSH_MS));
+
+        while (1) {
+            uint32_t lost = 0;
+            size_t n = web_server_read_since(&cursor, payload + fill, FLASH_LOG_PAYLOAD - fill, &lost);
+            if (lost > 0) {
+                portENTER_CRITICAL(&stats_lock);
+                stats.dropped_bytes += lost;
+                portEXIT_CRITICAL(&stats_lock);
+            }
+            if (n == 0) {
+                break;
+            }
+            if (fill == 0) {
+                first_seq = cursor - n;
+                start_us = (uint64_t)esp_timer_get_time();
+            }
+            fill += n;
+            if (fill == FLASH_LOG_PAYLOAD) {
+                if (write_segment(fill, first_seq, start_us, false)) {
+                    web_server_data_persisted(cursor);
+                }
+                fill = 0;
+            }
+        }
+
+        // Неполный сегмент не держим в RAM дольше FLASH_LOG_FLUSH_MS
+        if (fill > 0 &&
+            (uint64_t)esp_timer_get_time() - start_us >= (uint64_t)FLASH_LOG_FLUSH_MS * 1000) {
+            if (write_segment(fill, first_seq, start_us, true)) {
+                web_server_data_persisted(cursor);
+            }
+            fill = 0;
+        }
+    }
+}
+
+bool flash_log_start(void)
+{
+#if FLASH_LOG_ENABLE
+    partition = esp_partition_find_first((esp_partition_type_t)FLASH_LOG_PARTITION_TYPE,
+                                         (esp_partition_subtype_t)FLASH_LOG_PARTITION_SUBTYPE,
+                                         FLASH_LOG_PARTITION_LABEL);
+    if (partition == NULL) {
+        ESP_LOGW(TAG, "Partition '%s' not found, flash log disabled", FLASH_LOG_PARTITION_LABEL);
+        return false;
+    }
+
+    segment_count = partition->size / FLASH_LOG_SEGMENT_SIZE;
+    if (segment_count < 2) {
+        ESP_LOGE(TAG, "Partition '%s' is too small", FLASH_LOG_PARTITION_LABEL);
+        return false;
+    }
+    stats.partition_size = partition->size;
+    stats.segment_count = segment_count;
+    scan_partition();
+
+    if (xTaskCreate(flash_log_task, "flash_log", TASK_STACK_FLASH_LOG, NULL, TASK_PRIO_FLASH_LOG,
+                    &writer_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create flash log task");
+        return false;
+    }
+    metrics_register_histogram(&write_duration, "comtoair_flash_write_seconds",
+                               "Flash segment erase and write time", NULL);
+    metrics_watch_task(writer_task);
+    stats.active = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void flash_log_notify(void)
+{
+    if (writer_task != NULL &&
+        seq_diff(web_server_data_seq(), wake_seq.load(std::memory_order_relaxed)) >= 0) {
+        xTaskNotifyGive(writer_task);
+    }
+}
+
+/**
+ * Сегмент стерт или стирается задачей записи. Номер следующего сегмента
+ * растет до стирания сектора, поэтому false после чтения означает, что
+ * прочитанное еще не было затронуто стиранием.
+ */
+static bool segment_overwritten(uint32_t segment)
+{
+    portENTER_CRITICAL(&stats_lock);
+    bool overwritten = seq_diff(stats.next_segment, segment) >= (int32_t)segment_count;
+    portEXIT_CRITICAL(&stats_lock);
+    return overwritten;
+}
+
+/**
+ * Проверка данных сегмента по data_crc (первый проход, без вывода)
+ */
+static bool segment_data_valid(const segment_header_t *header, size_t offset,
+                               uint8_t *buf, size_t buf_size)
+{
+    uint32_t crc = 0;
+    for (uint32_t done = 0; done < header->length; ) {
+        uint32_t n = header->length - done;
+        if (n > buf_size) {
+            n = buf_size;
+        }
+        if (esp_partition_read(partition, offset + done, buf, n) != ESP_OK) {
+            return false;
+        }
+        crc = esp_rom_crc32_le(crc, buf, n);
+        done += n;
+    }
+    return crc == header->data_crc && !segment_overwritten(header->segment);
+}
+
+bool flash_log_read_all(flash_log_sink_fn sink, void *ctx, bool with_headers,
+                        uint8_t *buf, size_t buf_size)
+{
+    if (partition == NULL) {
+        return true;
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    uint32_t segment = stats.oldest_segment;
+    uint32_t end = stats.next_segment;
+    portEXIT_CRITICAL(&stats_lock);
+
+    for (; seq_diff(end, segment) > 0; segment++) {
+        // Самый старый сегмент полного кольца будет стерт следующей записью
+        if (segment_overwritten(segment)) {
+            continue;
+        }
+
+        size_t offset = segment_offset(segment);
+        segment_header_t header;
+        if (esp_partition_read(partition, offset, &header, sizeof(header)) != ESP_OK ||
+            !header_valid(&header) || header.segment != segment) {
+            continue;
+        }
+        offset += sizeof(header);
+
+        // Сегмент с оборванными данными (сброс питания во время записи) или
+        // стертый во время проверки не выводится
+        if (!segment_data_valid(&header, offset, buf, buf_size)) {
+            ESP_LOGW(TAG, "Segment %lu skipped: data CRC mismatch or overwritten",
+                     (unsigned long)segment);
+            continue;
+        }
+        if (with_headers && !sink(ctx, (const uint8_t *)&header, sizeof(header))) {
+            return false;
+        }
+
+        // Второй проход - вывод. Порция проверяется после чтения: сектор,
+        // который начали стирать посреди вывода, прерывает выгрузку, чтобы
+        // клиент не получил чужие байты под заголовком этого сегмента
+        uint32_t crc = 0;
+        for (uint32_t done = 0; done < header.length; ) {
+            uint32_t n = header.length - done;
+            if (n > buf_size) {
+                n = buf_size;
+            }
+            if (esp_partition_read(partition, offset + done, buf, n) != ESP_OK) {
+                return false;
+            }
+            if (segment_overwritten(segment)) {
+                ESP_LOGW(TAG, "Segment %lu overwritten during download", (unsigned long)segment);
+                return false;
+            }
+            crc = esp_rom_crc32_le(crc, buf, n);
+            if (!sink(ctx, buf, n)) {
+                return false;
+            }
+            done += n;
+        }
+        if (crc != header.data_crc) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void flash_log_get_stats(flash_log_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
@@ -0,0 +1,473 @@
+/**
+ * @file framer.cpp
+ * @brief Выделение кадров из потока байт RS-232
+ *
+ * Поиск разделителей - по слову за шаг (SWAR): в слове w байт, равный a,
+ * обнуляется в v = w ^ (a * 0x0101..), а выражение (v - 0x0101..) & ~v &
+ * 0x8080.. отлично от нуля тогда и только тогда, когда в v есть нулевой
+ * байт. Ложных срабатываний у этой проверки нет, но бит может оказаться
+ * установлен и в старшем байте после найденного нулевого (заем), поэтому
+ * позиция уточняется побайтно внутри найденного слова.
+ */
+
+#include "framer.h"
+
+#include <string.h>
+
+typedef uintptr_t word_t;
+
+static const word_t WORD_ONES = (word_t)-1 / 0xFF;
+static const word_t WORD_HIGHS = WORD_ONES << 7;
+
+// SLIP (RFC 1055)
+#define SLIP_END        0xC0
+#define SLIP_ESC        0xDB
+#define SLIP_ESC_END    0xDC
+#define SLIP_ESC_ESC    0xDD
+
+static const char *const mode_names[FRAMER_MODE_COUNT] = {
+    "none", "line", "fixed", "length", "slip", "cobs", "idle",
+};
+static const char *const eol_names[FRAMER_EOL_COUNT] = { "lf", "cr", "any" };
+
+static inline word_t has_zero(word_t v)
+{
+    return (v - WORD_ONES) & ~v & WORD_HIGHS;
+}
+
+static inline word_t load_word(const uint8_t *p)
+{
+    word_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+size_t framer_find_byte(const uint8_t *data, size_t length, uint8_t a)
+{
+    size_t i = 0;
+
+    // До границы слова побайтно, дальше выровненными словами
+    while (i < length && ((uintptr_t)(data + i) & (sizeof(word_t) - 1)) != 0) {
+        if (data[i] == a) {
+            return i;
+        }
+        i++;
+    }
+
+    const word_t pattern = WORD_ONES * a;
+    while (i + sizeof(word_t) <= length) {
+        if (has_zero(load_word(data + i) ^ pattern)) {
+            break;
+        }
+        i += sizeof(word_t);
+    }
+
+    while (i < length && data[i] != a) {
+        i++;
+    }
+    return i;
+}
+
+size_t framer_find_byte2(const uint8_t *data, size_t length, uint8_t a, uint8_t b)
+{
+    size_t i = 0;
+
+    while (i < length && ((uintptr_t)(data + i) & (sizeof(word_t) - 1)) != 0) {
+        if (data[i] == a || data[i] == b) {
+            return i;
+        }
+        i++;
+    }
+
+    const word_t pattern_a = WORD_ONES * a;
+    const word_t pattern_b = WORD_ONES * b;
+    while (i + sizeof(word_t) <= length) {
+        word_t w = load_word(data + i);
+        if (has_zero(w ^ pattern_a) | has_zero(w ^ pattern_b)) {
+            break;
+        }
+        i += sizeof(word_t);
+    }
+
+    while (i < length && data[i] != a && data[i] != b) {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * Вывод накопленных данных кадра (целого кадра или его части)
+ */
+static void emit_data(framer_t *f, uint32_t flags, uint32_t end_seq)
+{
+    f->emit(f->ctx, f->frame, f->length, flags, f->frame_start_us, end_seq);
+    f->stats.frames++;
+    if (flags & FRAMER_FLAG_PARTIAL) {
+        f->stats.partial++;
+    }
+    if (flags & FRAMER_FLAG_ERROR) {
+        f->stats.errors++;
+    }
+    f->length = 0;
+}
+
+static inline void begin_frame(framer_t *f)
+{
+    if (!f->in_frame) {
+        f->in_frame = true;
+        f->frame_start_us = f->chunk_us;
+    }
+}
+
+/**
+ * Завершение кадра; пустые кадры без ошибок не выводятся
+ */
+static void end_frame(framer_t *f, uint32_t end_seq)
+{
+    if (f->length > 0 || f->in_part || f->flags != 0) {
+        emit_data(f, f->flags, end_seq);
+    }
+    f->in_frame = false;
+    f->in_part = false;
+    f->flags = 0;
+    f->length = 0;
+}
+
+/**
+ * Добавление данных в кадр; при заполнении буфера кадр выводится частью
+ *
+ * @param raw_pos Позиция data[0] в исходном потоке
+ */
+static void append(framer_t *f, const uint8_t *data, size_t length, uint32_t raw_pos)
+{
+    begin_frame(f);
+    while (length > 0) {
+        size_t room = FRAMER_MAX_FRAME - f->length;
+        if (room == 0) {
+            emit_data(f, FRAMER_FLAG_PARTIAL, raw_pos);
+            f->in_part = true;
+            f->frame_start_us = f->chunk_us;
+            room = FRAMER_MAX_FRAME;
+        }
+        size_t n = length < room ? length : room;
+        memcpy(f->frame + f->length, data, n);
+        f->length += n;
+        data += n;
+        length -= n;
+        raw_pos += (uint32_t)n;
+    }
+}
+
+static inline void append_byte(framer_t *f, uint8_t value, uint32_t raw_pos)
+{
+    append(f, &value, 1, raw_pos);
+}
+
+static void feed_line(framer_t *f, const uint8_t *data, size_t length)
+{
+    const framer_eol_t eol = f->config.eol;
+    const uint8_t delimiter = eol == FRAMER_EOL_CR ? '\r' : '\n';
+    size_t i = 0;
+
+    while (i < length) {
+        if (f->skip_lf) {
+            f->skip_lf = false;
+            if (data[i] == '\n') {
+                i++;
+                continue;
+            }
+        }
+
+        size_t k = eol == FRAMER_EOL_ANY
+                       ? framer_find_byte2(data + i, length - i, '\r', '\n')
+                       : framer_find_byte(data + i, length - i, delimiter);
+        if (k > 0) {
+            append(f, data + i, k, f->raw_seq + (uint32_t)i);
+            i += k;
+        }
+        if (i == length) {
+            break;
+        }
+
+        uint8_t d = data[i++];
+        if (eol == FRAMER_EOL_ANY && d == '\r') {
+            f->skip_lf = true;
+        }
+        if (eol == FRAMER_EOL_LF && f->length > 0 && f->frame[f->length - 1] == '\r') {
+            f->length--;
+        }
+        end_frame(f, f->raw_seq + (uint32_t)i);
+    }
+}
+
+static void feed_fixed(framer_t *f, const uint8_t *data, size_t length)
+{
+    size_t i = 0;
+
+    while (i < length) {
+        if (!f->in_frame) {
+            begin_frame(f);
+            f->remaining = f->config.fixed_length;
+        }
+        size_t n = length - i < f->remaining ? length - i : f->remaining;
+        append(f, data + i, n, f->raw_seq + (uint32_t)i);
+        i += n;
+        f->remaining -= (uint32_t)n;
+        if (f->remaining == 0) {
+            end_frame(f, f->raw_seq + (uint32_t)i);
+        }
+    }
+}
+
+static void feed_length(framer_t *f, const uint8_t *data, size_t length)
+{
+    const framer_config_t *cfg = &f->config;
+    const size_t header = (size_t)cfg->len_offset + cfg->len_size;
+    size_t i = 0;
+
+    while (i < length) {
+        if (!f->in_frame) {
+            begin_frame(f);
+            f->header_done = false;
+        }
+
+        if (!f->header_done) {
+            // Заголовок до конца поля длины помещается в frame целиком
+            size_t need = header - f->length;
+            size_t n = length - i < need ? length - i : need;
+            append(f, data + i, n, f->raw_seq + (uint32_t)i);
+            i += n;
+            if (f->length < header) {
+                break;
+            }
+
+            const uint8_t *field = f->frame + cfg->len_offset;
+            uint32_t value = field[0];
+            if (cfg->len_size == 2) {
+                value = cfg->len_big_endian ? ((uint32_t)field[0] << 8) | field[1]
+                                            : ((uint32_t)field[1] << 8) | field[0];
+            }
+            int32_t body = (int32_t)value + cfg->len_adjust;
+            f->header_done = true;
+            if (body < 0) {
+                // Длина недопустима: заголовок выводится как ошибочный кадр
+                f->flags |= FRAMER_FLAG_ERROR;
+                body = 0;
+            }
+            f->remaining = (uint32_t)body;
+            if (f->remaining == 0) {
+                end_frame(f, f->raw_seq + (uint32_t)i);
+            }
+            continue;
+        }
+
+        size_t n = length - i < f->remaining ? length - i : f->remaining;
+        append(f, data + i, n, f->raw_seq + (uint32_t)i);
+        i += n;
+        f->remaining -= (uint32_t)n;
+        if (f->remaining == 0) {
+            end_frame(f, f->raw_seq + (uint32_t)i);
+        }
+    }
+}
+
+static void feed_slip(framer_t *f, const uint8_t *data, size_t length)
+{
+    size_t i = 0;
+
+    while (i < length) {
+        if (f->escape) {
+            uint8_t b = data[i];
+            f->escape = false;
+            if (b == SLIP_ESC_END) {
+                b = SLIP_END;
+            } else if (b == SLIP_ESC_ESC) {
+                b = SLIP_ESC;
+            } else if (b == SLIP_END) {
+                // ESC перед END: кадр обрывается, END обрабатывается ниже
+                f->flags |= FRAMER_FLAG_ERROR;
+                continue;
+            } else {
+                f->flags |= FRAMER_FLAG_ERROR;
+            }
+            append_byte(f, b, f->raw_seq + (uint32_t)i);
+            i++;
+            continue;
+        }
+
+        size_t k = framer_find_byte2(data + i, length - i, SLIP_END, SLIP_ESC);
+        if (k > 0) {
+            append(f, data + i, k, f->raw_seq + (uint32_t)i);
+            i += k;
+        }
+        if (i == length) {
+            break;
+        }
+
+        if (data[i++] == SLIP_ESC) {
+            begin_frame(f);
+            f->escape = true;
+            continue;
+        }
+        // Пустые кадры между END (обычный признак начала кадра) пропускаются
+        end_frame(f, f->raw_seq + (uint32_t)i);
+    }
+}
+
+static void feed_cobs(framer_t *f, const uint8_t *data, size_t length)
+{
+    size_t i = 0;
+
+    while (i < length) {
+        size_t end = i + framer_find_byte(data + i, length - i, 0);
+
+        while (i < end) {
+            if (f->cobs_left == 0) {
+                uint8_t code = data[i];
+                // Нуль между блоками: после блока короче 254 байт
+                if (f->in_frame && f->cobs_zero) {
+                    append_byte(f, 0, f->raw_seq + (uint32_t)i);
+                }
+                begin_frame(f);
+                f->cobs_left = code - 1;
+                f->cobs_zero = code != 0xFF;
+                i++;
+                continue;
+            }
+            size_t n = end - i < f->cobs_left ? end - i : f->cobs_left;
+            append(f, data + i, n, f->raw_seq + (uint32_t)i);
+            i += n;
+            f->cobs_left -= (uint8_t)n;
+        }
+        if (i == length) {
+            break;
+        }
+
+        // Разделитель: блок, оборванный нулем, - ошибка кодирования
+        i++;
+        if (f->cobs_left != 0) {
+            f->flags |= FRAMER_FLAG_ERROR;
+        }
+        end_frame(f, f->raw_seq + (uint32_t)i);
+        f->cobs_left = 0;
+        f->cobs_zero = false;
+    }
+}
+
+static void feed_none(framer_t *f, const uint8_t *data, size_t length)
+{
+    // Каждая порция - отдельный кадр (длинные делятся без флага PARTIAL)
+    size_t i = 0;
+    while (i < length) {
+        size_t n = length - i < FRAMER_MAX_FRAME ? length - i : FRAMER_MAX_FRAME;
+        begin_frame(f);
+        memcpy(f->frame, data + i, n);
+        f->length = n;
+        i += n;
+        end_frame(f, f->raw_seq + (uint32_t)i);
+    }
+}
+
+void framer_init(framer_t *framer, const framer_config_t *config,
+                 framer_emit_fn emit, void *ctx, uint32_t raw_seq)
+{
+    memset(framer, 0, offsetof(framer_t, frame));
+    framer->config = *config;
+    framer->emit = emit;
+    framer->ctx = ctx;
+    framer->raw_seq = raw_seq;
+}
+
+void framer_feed(framer_t *framer, const uint8_t *data, size_t length, uint64_t timestamp_us)
+{
+    if (length == 0) {
+        return;
+    }
+    framer->chunk_us = timestamp_us;
+
+    switch (framer->config.mode) {
+    case FRAMER_LINE:
+        feed_line(framer, data, length);
+        break;
+    case FRAMER_FIXED:
+        feed_fixed(framer, data, length);
+        break;
+    case FRAMER_LENGTH:
+        feed_length(framer, data, length);
+        break;
+    case FRAMER_SLIP:
+        feed_slip(framer, data, length);
+        break;
+    case FRAMER_COBS:
+        feed_cobs(framer, data, length);
+        break;
+    case FRAMER_IDLE:
+        append(framer, data, length, framer->raw_seq);
+        break;
+    default:
+        feed_none(framer, data, length);
+        break;
+    }
+    framer->raw_seq += (uint32_t)length;
+}
+
+void framer_idle(framer_t *framer)
+{
+    if (framer->config.mode == FRAMER_IDLE && framer->in_frame) {
+        end_frame(framer, framer->raw_seq);
+    }
+}
+
+bool framer_pending(const framer_t *framer)
+{
+    return framer->in_frame;
+}
+
+bool framer_config_is_valid(const framer_config_t *config)
+{
+    if (config->mode < 0 || config->mode >= FRAMER_MODE_COUNT ||
+        config->eol < 0 || config->eol >= FRAMER_EOL_COUNT) {
+        return false;
+    }
+    if (config->mode == FRAMER_FIXED && config->fixed_length == 0) {
+        return false;
+    }
+    if (config->mode == FRAMER_LENGTH &&
+        ((config->len_size != 1 && config->len_size != 2) ||
+         (size_t)config->len_offset + config->len_size > FRAMER_MAX_FRAME)) {
+        return false;
+    }
+    return true;
+}
+
+const char *framer_mode_name(framer_mode_t mode)
+{
+    return mode < FRAMER_MODE_COUNT ? mode_names[mode] : "unknown";
+}
+
+const char *framer_eol_name(framer_eol_t eol)
+{
+    return eol < FRAMER_EOL_COUNT ? eol_names[eol] : "unknown";
+}
+
+bool framer_parse_mode(const char *name, framer_mode_t *mode)
+{
+    for (int m = 0; m < FRAMER_MODE_COUNT; m++) {
+        if (strcmp(name, mode_names[m]) == 0) {
+            *mode = (framer_mode_t)m;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool framer_parse_eol(const char *name, framer_eol_t *eol)
+{
+    for (int e = 0; e < FRAMER_EOL_COUNT; e++) {
+        if (strcmp(name, eol_names[e]) == 0) {
+            *eol = (framer_eol_t)e;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,442 @@
+/**
+ * @file json_writer.cpp
+ * @brief Потоковая запись JSON без выделения памяти
+ */
+
+#include "json_writer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char HEX[] = "0123456789abcdef";
+static const char B64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Константы для проверки четырех байт за раз
+#define ONES    0x01010101u
+#define HIGHS   0x80808080u
+
+static void flush_buf(json_writer_t *w)
+{
+    if (w->len > 0 && !w->failed) {
+        if (!w->flush(w->ctx, w->buf, w->len)) {
+            w->failed = true;
+        }
+    }
+    w->len = 0;
+}
+
+static inline void put_char(json_writer_t *w, char c)
+{
+    if (w->len == w->size) {
+        flush_buf(w);
+    }
+    w->buf[w->len++] = c;
+}
+
+static void put_data(json_writer_t *w, const char *data, size_t length)
+{
+    while (length > 0) {
+        if (w->len == w->size) {
+            flush_buf(w);
+        }
+        size_t n = w->size - w->len;
+        if (n > length) {
+            n = length;
+        }
+        memcpy(w->buf + w->len, data, n);
+        w->len += n;
+        data += n;
+        length -= n;
+    }
+}
+
+/**
+ * Запятая перед очередным элементом контейнера
+ */
+static void begin_value(json_writer_t *w)
+{
+    if (w->after_key) {
+        w->after_key = false;
+        return;
+    }
+    if (w->depth == 0) {
+        return;
+    }
+    uint32_t bit = 1u << (w->depth - 1);
+    if (w->has_items & bit) {
+        put_char(w, ',');
+    }
+    w->has_items |= bit;
+}
+
+static void open_container(json_writer_t *w, char c)
+{
+    begin_value(w);
+    put_char(w, c);
+    if (w->depth < JSON_WRITER_MAX_DEPTH) {
+        w->depth++;
+        w->has_items &= ~(1u << (w->depth - 1));
+    }
+}
+
+static void close_container(json_writer_t *w, char c)
+{
+    if (w->depth > 0) {
+        w->depth--;
+    }
+    put_char(w, c);
+}
+
+void json_writer_init(json_writer_t *w, char *buf, size_t size, json_flush_fn flush, void *ctx)
+{
+    w->buf = buf;
+    w->size = size;
+    w->len = 0;
+    w->flush = flush;
+    w->ctx = ctx;
+    w->has_items = 0;
+    w->depth = 0;
+    w->after_key = false;
+    w->failed = false;
+    w->b64_carry_len = 0;
+    if (buf == NULL || size < JSON_WRITER_MIN_BUFFER) {
+        w->buf = w->spare;
+        w->size = sizeof(w->spare);
+        w->failed = true;
+    }
+}
+
+bool json_writer_finish(json_writer_t *w)
+{
+    flush_buf(w);
+    return !w->failed;
+}
+
+void json_begin_object(json_writer_t *w)
+{
+    open_container(w, '{');
+}
+
+void json_end_object(json_writer_t *w)
+{
+    close_container(w, '}');
+}
+
+void json_begin_array(json_writer_t *w)
+{
+    open_container(w, '[');
+}
+
+void json_end_array(json_writer_t *w)
+{
+    close_container(w, ']');
+}
+
+void json_key(json_writer_t *w, const char *key)
+{
+    begin_value(w);
+    put_char(w, '"');
+    put_data(w, key, strlen(key));
+    put_char(w, '"');
+    put_char(w, ':');
+    w->after_key = true;
+}
+
+void json_uint64(json_writer_t *w, uint64_t value)
+{
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    begin_value(w);
+    while (n > 0) {
+        put_char(w, digits[--n]);
+    }
+}
+
+void json_uint(json_writer_t *w, uint32_t value)
+{
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    begin_value(w);
+    while (n > 0) {
+        put_char(w, digits[--n]);
+    }
+}
+
+void json_int(json_writer_t *w, int32_t value)
+{
+    if (value < 0) {
+        begin_value(w);
+        put_char(w, '-');
+        w->after_key = true;    // Цифры продолжают то же значение
+        json_uint(w, (uint32_t)0 - (uint32_t)value);
+    } else {
+        json_uint(w, (uint32_t)value);
+    }
+}
+
+void json_int64(json_writer_t *w, int64_t value)
+{
+    if (value < 0) {
+        begin_value(w);
+        put_char(w, '-');
+        w->after_key = true;    // Цифры продолжают то же значение
+        json_uint64(w, (uint64_t)0 - (uint64_t)value);
+    } else {
+        json_uint64(w, (uint64_t)value);
+    }
+}
+
+void json_double(json_writer_t *w, double value)
+{
+    if (isnan(value) || isinf(value)) {
+        json_null(w);
+        return;
+    }
+    char text[24];
+    int n = snprintf(text, sizeof(text), "%.10g", value);
+    begin_value(w);
+    put_data(w, text, (size_t)n);
+}
+
+void json_bool(json_writer_t *w, bool value)
+{
+    begin_value(w);
+    if (value) {
+        put_data(w, "true", 4);
+    } else {
+        put_data(w, "false", 5);
+    }
+}
+
+void json_null(json_writer_t *w)
+{
+    begin_value(w);
+    put_data(w, "null", 4);
+}
+
+void json_raw(json_writer_t *w, const char *data, size_t length)
+{
+    begin_value(w);
+    put_data(w, data, length);
+}
+
+static inline size_t safe_prefix(const uint8_t *data, size_t length)
+{
+    size_t i = 0;
+
+    // Слово безопасно, если в нем нет байт < 0x20, >= 0x80, '"' и '\\'
+    while (i + 4 <= length) {
+        uint32_t x;
+        memcpy(&x, data + i, sizeof(x));
+        uint32_t q = x ^ (ONES * '"');
+        uint32_t b = x ^ (ONES * '\\');
+        uint32_t bad = ((x - ONES * 0x20) & ~x) |
+                       ((q - ONES) & ~q) |
+                       ((b - ONES) & ~b) |
+                       x;
+        if (bad & HIGHS) {
+            break;
+        }
+        i += 4;
+    }
+
+    // Остаток и слово с особым байтом - побайтно
+    while (i < length) {
+        uint8_t c = data[i];
+        if (c < 0x20 || c >= 0x80 || c == '"' || c == '\\') {
+            break;
+        }
+        i++;
+    }
+    return i;
+}
+
+size_t json_safe_prefix(const uint8_t *data, size_t length)
+{
+    return safe_prefix(data, length);
+}
+
+static inline void put_escaped(json_writer_t *w, uint8_t c)
+{
+    // Самая длинная последовательность - \u00XX
+    if (w->size - w->len < 6) {
+        flush_buf(w);
+    }
+    char *out = w->buf + w->len;
+    out[0] = '\\';
+    switch (c) {
+    case '"':  out[1] = '"';  w->len += 2; return;
+    case '\\': out[1] = '\\'; w->len += 2; return;
+    case '\n': out[1] = 'n';  w->len += 2; return;
+    case '\r': out[1] = 'r';  w->len += 2; return;
+    case '\t': out[1] = 't';  w->len += 2; return;
+    default:
+        out[1] = 'u';
+        out[2] = '0';
+        out[3] = '0';
+        out[4] = HEX[c >> 4];
+        out[5] = HEX[c & 0x0f];
+        w->len += 6;
+        return;
+    }
+}
+
+void json_string_begin(json_writer_t *w)
+{
+    begin_value(w);
+    put_char(w, '"');
+}
+
+void json_string_append(json_writer_t *w, const uint8_t *data, size_t length)
+{
+    size_t i = 0;
+    while (i < length) {
+        // Проверяем не дальше свободного места: безопасный участок
+        // копируется в буфер одним memcpy
+        if (w->len == w->size) {
+            flush_buf(w);
+        }
+        size_t room = w->size - w->len;
+        size_t limit = length - i < room ? length - i : room;
+        size_t run = safe_prefix(data + i, limit);
+        memcpy(w->buf + w->len, data + i, run);
+        w->len += run;
+        i += run;
+
+        if (run < limit) {
+            put_escaped(w, data[i]);
+            i++;
+        }
+    }
+}
+
+void json_string_end(json_writer_t *w)
+{
+    put_char(w, '"');
+}
+
+void json_string_bytes(json_writer_t *w, const uint8_t *data, size_t length)
+{
+    json_string_begin(w);
+    json_string_append(w, data, length);
+    json_string_end(w);
+}
+
+void json_string(json_writer_t *w, const char *str)
+{
+    json_string_bytes(w, (const uint8_t *)str, strlen(str));
+}
+
+static inline void put_b64_group(char *out, uint32_t v)
+{
+    out[0] = B64[(v >> 18) & 0x3f];
+    out[1] = B64[(v >> 12) & 0x3f];
+    out[2] = B64[(v >> 6) & 0x3f];
+    out[3] = B64[v & 0x3f];
+}
+
+void json_base64_begin(json_writer_t *w)
+{
+    json_string_begin(w);
+    w->b64_carry_len = 0;
+}
+
+void json_base64_append(json_writer_t *w, const uint8_t *data, size_t length)
+{
+    // Дополняем остаток предыдущего вызова до трех байт
+    while (w->b64_carry_len > 0 && length > 0) {
+        w->b64_carry[w->b64_carry_len++] = *data++;
+        length--;
+        if (w->b64_carry_len == 3) {
+            char out[4];
+            put_b64_group(out, ((uint32_t)w->b64_carry[0] << 16) |
+                               ((uint32_t)w->b64_carry[1] << 8) | w->b64_carry[2]);
+            put_data(w, out, 4);
+            w->b64_carry_len = 0;
+        }
+    }
+
+    // Полные группы пишем прямо в буфер писателя
+    while (length >= 3) {
+        if (w->size - w->len < 4) {
+            flush_buf(w);
+        }
+        size_t groups = (w->size - w->len) / 4;
+        if (groups > length / 3) {
+            groups = length / 3;
+        }
+        char *out = w->buf + w->len;
+        for (size_t g = 0; g < groups; g++) {
+            put_b64_group(out, ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2]);
+            out += 4;
+            data += 3;
+        }
+        w->len += groups * 4;
+        length -= groups * 3;
+    }
+
+    while (length > 0) {
+        w->b64_carry[w->b64_carry_len++] = *data++;
+        length--;
+    }
+}
+
+void json_base64_end(json_writer_t *w)
+{
+    if (w->b64_carry_len > 0) {
+        char out[4];
+        uint32_t v = (uint32_t)w->b64_carry[0] << 16;
+        if (w->b64_carry_len == 2) {
+            v |= (uint32_t)w->b64_carry[1] << 8;
+        }
+        put_b64_group(out, v);
+        out[3] = '=';
+        if (w->b64_carry_len == 1) {
+            out[2] = '=';
+        }
+        put_data(w, out, 4);
+        w->b64_carry_len = 0;
+    }
+    json_string_end(w);
+}
+
+void json_kv_uint(json_writer_t *w, const char *key, uint32_t value)
+{
+    json_key(w, key);
+    json_uint(w, value);
+}
+
+void json_kv_uint64(json_writer_t *w, const char *key, uint64_t value)
+{
+    json_key(w, key);
+    json_uint64(w, value);
+}
+
+void json_kv_int(json_writer_t *w, const char *key, int32_t value)
+{
+    json_key(w, key);
+    json_int(w, value);
+}
+
+void json_kv_bool(json_writer_t *w, const char *key, bool value)
+{
+    json_key(w, key);
+    json_bool(w, value);
+}
+
+void json_kv_string(json_writer_t *w, const char *key, const char *str)
+{
+    json_key(w, key);
+    json_string(w, str);
+}
@@ -0,0 +1,275 @@
+/**
+ * @file metrics.cpp
+ * @brief Реестр метрик и вывод в текстовом формате Prometheus
+ *
+ * Реестр - односвязный список; серии одного семейства стоят в нем подряд
+ * (новая серия вставляется после последней серии с тем же именем).
+ * Вставка выполняется в критической секции, а вывод обходит список без
+ * блокировок: указатель next публикуется после заполнения серии.
+ */
+
+#include "metrics.h"
+#include "config.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+// Верхние границы корзин гистограмм задержек, мкс
+static const uint32_t latency_bounds_us[METRICS_LATENCY_BUCKETS] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000,
+};
+
+static const char *const type_names[] = { "counter", "gauge", "histogram" };
+
+static std::atomic<metric_t *> registry_head(NULL);
+static portMUX_TYPE registry_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t watched_tasks[METRICS_MAX_TASKS];
+static std::atomic<int> watched_count(0);
+
+/**
+ * Вывод: строки форматируются прямо в буфер вызывающего и уходят в sink
+ * порциями (строка может разделиться между порциями)
+ */
+typedef struct {
+    metrics_sink_fn sink;
+    void *ctx;
+    bool ok;
+    char *buffer;
+    size_t size;
+    size_t length;
+} metrics_out_t;
+
+static void out_flush(metrics_out_t *out)
+{
+    if (out->ok && out->length > 0) {
+        out->ok = out->sink(out->ctx, out->buffer, out->length);
+    }
+    out->length = 0;
+}
+
+static void out_printf(metrics_out_t *out, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void out_printf(metrics_out_t *out, const char *format, ...)
+{
+    // Не поместилось в остаток - отправка накопленного и повтор в пустой
+    // буфер; длиннее всего буфера - обрезается
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t room = out->size - out->length;
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(out->buffer + out->length, room, format, args);
+        va_end(args);
+        if (len < 0) {
+            return;
+        }
+        if ((size_t)len < room) {
+            out->length += (size_t)len;
+            return;
+        }
+        if (out->length == 0) {
+            out->length = room - 1;
+            return;
+        }
+        out_flush(out);
+    }
+}
+
+static void insert(metric_t *metric)
+{
+    portENTER_CRITICAL(&registry_lock);
+    // После последней серии того же семейства, иначе в конец списка
+    metric_t *after = NULL;
+    for (metric_t *m = registry_head.load(); m != NULL; m = m->next.load()) {
+        if (after == NULL || strcmp(m->name, metric->name) == 0 ||
+            strcmp(after->name, metric->name) != 0) {
+            after = m;
+        }
+    }
+    if (after == NULL) {
+        registry_head.store(metric, std::memory_order_release);
+    } else {
+        metric->next.store(after->next.load(), std::memory_order_relaxed);
+        after->next.store(metric, std::memory_order_release);
+    }
+    portEXIT_CRITICAL(&registry_lock);
+}
+
+void metrics_register(metric_t *metric, metric_type_t type, const char *name,
+                      const char *help, const char *labels)
+{
+    if (metric->name != NULL) {
+        return;
+    }
+    metric->name = name;
+    metric->help = help;
+    metric->labels = labels;
+    metric->type = type;
+    insert(metric);
+}
+
+void metrics_register_histogram(metric_histogram_t *histogram, const char *name,
+                                const char *help, const char *labels)
+{
+    if (histogram->base.name != NULL) {
+        return;
+    }
+    histogram->base.name = name;
+    histogram->base.help = help;
+    histogram->base.labels = labels;
+    histogram->base.type = METRIC_HISTOGRAM;
+    insert(&histogram->base);
+}
+
+void metric_observe_us(metric_histogram_t *histogram, uint32_t value_us)
+{
+    int bucket = 0;
+    while (bucket < METRICS_LATENCY_BUCKETS && value_us > latency_bounds_us[bucket]) {
+        bucket++;
+    }
+    histogram->buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    // 64-битная сумма из двух слов: перенос в старшее слово отдельной операцией
+    uint32_t old = histogram->sum_lo.fetch_add(value_us, std::memory_order_relaxed);
+    if (old + value_us < old) {
+        histogram->sum_hi.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void metrics_watch_task(TaskHandle_t task)
+{
+    if (task == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&registry_lock);
+    int count = watched_count.load(std::memory_order_relaxed);
+    bool known = false;
+    for (int i = 0; i < count; i++) {
+        known = known || watched_tasks[i] == task;
+    }
+    if (!known && count < METRICS_MAX_TASKS) {
+        watched_tasks[count] = task;
+        watched_count.store(count + 1, std::memory_order_release);
+    }
+    portEXIT_CRITICAL(&registry_lock);
+}
+
+/**
+ * Имя серии с метками и дополнительной меткой (le для корзин гистограммы)
+ */
+static void out_series(metrics_out_t *out, const char *name, const char *suffix,
+                       const char *labels, const char *extra)
+{
+    bool has_labels = labels != NULL && labels[0] != '\0';
+    if (!has_labels && extra == NULL) {
+        out_printf(out, "%s%s", name, suffix);
+    } else if (!has_labels) {
+        out_printf(out, "%s%s{%s}", name, suffix, extra);
+    } else if (extra == NULL) {
+        out_printf(out, "%s%s{%s}", name, suffix, labels);
+    } else {
+        out_printf(out, "%s%s{%s,%s}", name, suffix, labels, extra);
+    }
+}
+
+static void write_histogram(metrics_out_t *out, metric_histogram_t *histogram)
+{
+    const metric_t *m = &histogram->base;
+    char le[24];
+    uint32_t cumulative = 0;
+
+    for (int i = 0; i <= METRICS_LATENCY_BUCKETS; i++) {
+        cumulative += histogram->buckets[i].load(std::memory_order_relaxed);
+        if (i < METRICS_LATENCY_BUCKETS) {
+            snprintf(le, sizeof(le), "le=\"%lu.%06lu\"",
+                     (unsigned long)(latency_bounds_us[i] / 1000000),
+                     (unsigned long)(latency_bounds_us[i] % 1000000));
+        } else {
+            snprintf(le, sizeof(le), "le=\"+Inf\"");
+        }
+        out_series(out, m->name, "_bucket", m->labels, le);
+        out_printf(out, " %lu\n", (unsigned long)cumulative);
+    }
+
+    uint32_t hi, lo;
+    do {
+        hi = histogram->sum_hi.load(std::memory_order_relaxed);
+        lo = histogram->sum_lo.load(std::memory_order_relaxed);
+    } while (hi != histogram->sum_hi.load(std::memory_order_relaxed));
+    uint64_t sum_us = ((uint64_t)hi << 32) | lo;
+
+    out_series(out, m->name, "_sum", m->labels, NULL);
+    out_printf(out, " %llu.%06llu\n",
+               (unsigned long long)(sum_us / 1000000), (unsigned long long)(sum_us % 1000000));
+    out_series(out, m->name, "_count", m->labels, NULL);
+    out_printf(out, " %lu\n", (unsigned long)cumulative);
+}
+
+static void write_system(metrics_out_t *out)
+{
+    uint64_t uptime_us = (uint64_t)esp_timer_get_time();
+    out_printf(out, "# HELP comtoair_uptime_seconds Time since boot\n"
+                    "# TYPE comtoair_uptime_seconds gauge\n"
+                    "comtoair_uptime_seconds %llu.%06llu\n",
+               (unsigned long long)(uptime_us / 1000000), (unsigned long long)(uptime_us % 1000000));
+    out_printf(out, "# HELP comtoair_heap_free_bytes Free heap\n"
+                    "# TYPE comtoair_heap_free_bytes gauge\n"
+                    "comtoair_heap_free_bytes %lu\n",
+               (unsigned long)esp_get_free_heap_size());
+    out_printf(out, "# HELP comtoair_heap_min_free_bytes Lowest free heap since boot\n"
+                    "# TYPE comtoair_heap_min_free_bytes gauge\n"
+                    "comtoair_heap_min_free_bytes %lu\n",
+               (unsigned long)esp_get_minimum_free_heap_size());
+    out_printf(out, "# HELP comtoair_heap_largest_free_block_bytes Largest free heap block\n"
+                    "# TYPE comtoair_heap_largest_free_block_bytes gauge\n"
+                    "comtoair_heap_largest_free_block_bytes %lu\n",
+               (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT));
+
+    int count = watched_count.load(std::memory_order_acquire);
+    if (count == 0) {
+        return;
+    }
+    out_printf(out, "# HELP comtoair_task_stack_free_bytes Stack high-water mark (never used)\n"
+                    "# TYPE comtoair_task_stack_free_bytes gauge\n");
+    for (int i = 0; i < count; i++) {
+        out_printf(out, "comtoair_task_stack_free_bytes{task=\"%s\"} %lu\n",
+                   pcTaskGetName(watched_tasks[i]),
+                   (unsigned long)uxTaskGetStackHighWaterMark(watched_tasks[i]));
+    }
+}
+
+bool metrics_write(metrics_sink_fn sink, void *ctx, char *buffer, size_t size)
+{
+    metrics_out_t out;
+    out.sink = sink;
+    out.ctx = ctx;
+    out.ok = true;
+    out.buffer = buffer;
+    out.size = size;
+    out.length = 0;
+
+    const char *family = NULL;
+    for (metric_t *m = registry_head.load(std::memory_order_acquire); m != NULL && out.ok;
+         m = m->next.load(std::memory_order_acquire)) {
+        if (family == NULL || strcmp(family, m->name) != 0) {
+            family = m->name;
+            out_printf(&out, "# HELP %s %s\n# TYPE %s %s\n",
+                       m->name, m->help, m->name, type_names[m->type]);
+        }
+        if (m->type == METRIC_HISTOGRAM) {
+            write_histogram(&out, (metric_histogram_t *)m);
+        } else {
+            out_series(&out, m->name, "", m->labels, NULL);
+            out_printf(&out, " %lu\n", (unsigned long)metric_get(m));
+        }
+    }
+
+    write_system(&out);
+    out_flush(&out);
+    return out.ok;
+}
@@ -0,0 +1,353 @@
+/**
+ * @file rfc2217.cpp
+ * @brief Разбор Telnet и опции COM-PORT (RFC 2217) для TCP сервера порта
+ */
+
+#include "rfc2217.h"
+#include "rs232_handler.h"
+
+#include <string.h>
+
+// Состояния разбора входящего потока
+enum {
+    ST_DATA = 0,
+    ST_IAC,
+    ST_WILL,
+    ST_WONT,
+    ST_DO,
+    ST_DONT,
+    ST_SB,
+    ST_SB_IAC,
+};
+
+// Команды COM-PORT-OPTION (клиент -> сервер; ответ сервера = команда + 100)
+enum {
+    CPO_SIGNATURE = 0,
+    CPO_SET_BAUDRATE = 1,
+    CPO_SET_DATASIZE = 2,
+    CPO_SET_PARITY = 3,
+    CPO_SET_STOPSIZE = 4,
+    CPO_SET_CONTROL = 5,
+    CPO_SET_LINESTATE_MASK = 10,
+    CPO_SET_MODEMSTATE_MASK = 11,
+    CPO_PURGE_DATA = 12,
+};
+#define CPO_SERVER_OFFSET   100
+
+// Значения SET-PARITY
+#define CPO_PARITY_NONE     1
+#define CPO_PARITY_ODD      2
+#define CPO_PARITY_EVEN     3
+
+// Значения SET-STOPSIZE
+#define CPO_STOP_1          1
+#define CPO_STOP_2          2
+#define CPO_STOP_1_5        3
+
+static const char SIGNATURE[] = "ComToAir";
+
+static uint8_t option_bit(uint8_t option)
+{
+    switch (option) {
+    case TELNET_OPT_BINARY:   return 0x01;
+    case TELNET_OPT_SGA:      return 0x02;
+    case TELNET_OPT_COM_PORT: return 0x04;
+    default:                  return 0;
+    }
+}
+
+static void reply_bytes(rfc2217_session_t *session, const uint8_t *bytes, size_t length)
+{
+    // При переполнении ответ отбрасывается целиком, чтобы не рвать команду
+    if (session->reply_len + length > sizeof(session->reply)) {
+        return;
+    }
+    memcpy(session->reply + session->reply_len, bytes, length);
+    session->reply_len += length;
+}
+
+static void reply_command(rfc2217_session_t *session, uint8_t command, uint8_t option)
+{
+    uint8_t cmd[3] = { TELNET_IAC, command, option };
+    reply_bytes(session, cmd, sizeof(cmd));
+}
+
+/**
+ * Ответ на подопцию COM-PORT: IAC SB 44 <cmd+100> <value...> IAC SE
+ */
+static void reply_com_port(rfc2217_session_t *session, uint8_t command,
+                           const uint8_t *value, size_t length)
+{
+    uint8_t out[RFC2217_SB_MAX * 2 + 6];
+    size_t n = 0;
+    out[n++] = TELNET_IAC;
+    out[n++] = TELNET_SB;
+    out[n++] = TELNET_OPT_COM_PORT;
+    out[n++] = command + CPO_SERVER_OFFSET;
+    for (size_t i = 0; i < length && i < RFC2217_SB_MAX; i++) {
+        out[n++] = value[i];
+        if (value[i] == TELNET_IAC) {
+            out[n++] = TELNET_IAC;
+        }
+    }
+    out[n++] = TELNET_IAC;
+    out[n++] = TELNET_SE;
+    reply_bytes(session, out, n);
+}
+
+static void reply_com_port_u8(rfc2217_session_t *session, uint8_t command, uint8_t value)
+{
+    reply_com_port(session, command, &value, 1);
+}
+
+static uint8_t parity_to_cpo(uart_parity_t parity)
+{
+    switch (parity) {
+    case UART_PARITY_ODD:  return CPO_PARITY_ODD;
+    case UART_PARITY_EVEN: return CPO_PARITY_EVEN;
+    default:               return CPO_PARITY_NONE;
+    }
+}
+
+static uint8_t stop_bits_to_cpo(uart_stop_bits_t stop_bits)
+{
+    switch (stop_bits) {
+    case UART_STOP_BITS_2:   return CPO_STOP_2;
+    case UART_STOP_BITS_1_5: return CPO_STOP_1_5;
+    default:                 return CPO_STOP_1;
+    }
+}
+
+/**
+ * Обработка подопции COM-PORT-OPTION
+ */
+static void handle_com_port(rfc2217_session_t *session, const uint8_t *sb, size_t length)
+{
+    if (length < 1) {
+        return;
+    }
+    uint8_t command = sb[0];
+    const uint8_t *value = sb + 1;
+    size_t value_len = length - 1;
+
+    rs232_config_t config;
+    rs232_get_config(&config);
+    rs232_config_t requested = config;
+
+    switch (command) {
+    case CPO_SIGNATURE:
+        reply_com_port(session, command, (const uint8_t *)SIGNATURE, sizeof(SIGNATURE) - 1);
+        return;
+
+    case CPO_SET_BAUDRATE: {
+        if (value_len >= 4) {
+            uint32_t baud = ((uint32_t)value[0] << 24) | ((uint32_t)value[1] << 16) |
+                            ((uint32_t)value[2] << 8) | value[3];
+            if (baud != 0) {
+                requested.baud_rate = baud;
+                rs232_reconfigure(&requested);
+                rs232_get_config(&config);
+            }
+        }
+        uint8_t out[4] = {
+            (uint8_t)(config.baud_rate >> 24), (uint8_t)(config.baud_rate >> 16),
+            (uint8_t)(config.baud_rate >> 8), (uint8_t)config.baud_rate,
+        };
+        reply_com_port(session, command, out, sizeof(out));
+        return;
+    }
+
+    case CPO_SET_DATASIZE:
+        if (value_len >= 1 && value[0] >= 5 && value[0] <= 8) {
+            requested.data_bits = (uart_word_length_t)(UART_DATA_5_BITS + (value[0] - 5));
+            rs232_reconfigure(&requested);
+            rs232_get_config(&config);
+        }
+        reply_com_port_u8(session, command, (uint8_t)(5 + (config.data_bits - UART_DATA_5_BITS)));
+        return;
+
+    case CPO_SET_PARITY:
+        if (value_len >= 1 && value[0] >= CPO_PARITY_NONE && value[0] <= CPO_PARITY_EVEN) {
+            requested.parity = value[0] == CPO_PARITY_ODD ? UART_PARITY_ODD :
+                               value[0] == CPO_PARITY_EVEN ? UART_PARITY_EVEN :
+                               UART_PARITY_DISABLE;
+            rs232_reconfigure(&requested);
+            rs232_get_config(&config);
+        }
+        reply_com_port_u8(session, command, parity_to_cpo(config.parity));
+        return;
+
+    case CPO_SET_STOPSIZE:
+        if (value_len >= 1 && value[0] >= CPO_STOP_1 && value[0] <= CPO_STOP_1_5) {
+            requested.stop_bits = value[0] == CPO_STOP_2 ? UART_STOP_BITS_2 :
+                                  value[0] == CPO_STOP_1_5 ? UART_STOP_BITS_1_5 :
+                                  UART_STOP_BITS_1;
+            rs232_reconfigure(&requested);
+            rs232_get_config(&config);
+        }
+        reply_com_port_u8(session, command, stop_bits_to_cpo(config.stop_bits));
+        return;
+
+    case CPO_SET_CONTROL:
+        // Аппаратное управление потоком и линии DTR/RTS не поддерживаются:
+        // на запрос состояния (0) отвечаем "без управления потоком" (1)
+        reply_com_port_u8(session, command, (value_len >= 1 && value[0] != 0) ? value[0] : 1);
+        return;
+
+    case CPO_SET_LINESTATE_MASK:
+    case CPO_SET_MODEMSTATE_MASK:
+        reply_com_port_u8(session, command, value_len >= 1 ? value[0] : 0);
+        return;
+
+    case CPO_PURGE_DATA:
+        rs232_flush();
+        reply_com_port_u8(session, command, value_len >= 1 ? value[0] : 0);
+        return;
+
+    default:
+        return;
+    }
+}
+
+/**
+ * Согласование опций: соглашаемся на BINARY, SGA и COM-PORT, остальное отклоняем
+ */
+static void handle_negotiation(rfc2217_session_t *session, uint8_t state, uint8_t option)
+{
+    uint8_t bit = option_bit(option);
+
+    switch (state) {
+    case ST_WILL:
+        if (bit == 0) {
+            reply_command(session, TELNET_DONT, option);
+        } else if (!(session->remote_on & bit)) {
+            session->remote_on |= bit;
+            reply_command(session, TELNET_DO, option);
+        }
+        if (option == TELNET_OPT_COM_PORT) {
+            session->com_port = true;
+        }
+        break;
+
+    case ST_WONT:
+        if (session->remote_on & bit) {
+            session->remote_on &= ~bit;
+            reply_command(session, TELNET_DONT, option);
+        }
+        if (option == TELNET_OPT_COM_PORT) {
+            session->com_port = false;
+        }
+        break;
+
+    case ST_DO:
+        // COM-PORT со стороны сервера не предлагается (сервер - это порт)
+        if (bit == 0 || option == TELNET_OPT_COM_PORT) {
+            reply_command(session, TELNET_WONT, option);
+        } else if (!(session->local_on & bit)) {
+            session->local_on |= bit;
+            reply_command(session, TELNET_WILL, option);
+        }
+        break;
+
+    case ST_DONT:
+        if (session->local_on & bit) {
+            session->local_on &= ~bit;
+            reply_command(session, TELNET_WONT, option);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void rfc2217_init(rfc2217_session_t *session)
+{
+    memset(session, 0, sizeof(*session));
+    session->state = ST_DATA;
+
+    // Предлагаем прозрачный 8-битный канал и просим клиента включить COM-PORT
+    session->local_on = option_bit(TELNET_OPT_BINARY) | option_bit(TELNET_OPT_SGA);
+    reply_command(session, TELNET_WILL, TELNET_OPT_BINARY);
+    reply_command(session, TELNET_WILL, TELNET_OPT_SGA);
+    reply_command(session, TELNET_DO, TELNET_OPT_BINARY);
+    reply_command(session, TELNET_DO, TELNET_OPT_COM_PORT);
+    session->remote_on = option_bit(TELNET_OPT_BINARY) | option_bit(TELNET_OPT_COM_PORT);
+}
+
+size_t rfc2217_process(rfc2217_session_t *session, uint8_t *data, size_t length)
+{
+    size_t out = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        uint8_t c = data[i];
+
+        switch (session->state) {
+        case ST_DATA:
+            if (c == TELNET_IAC) {
+                session->state = ST_IAC;
+            } else {
+                data[out++] = c;
+            }
+            break;
+
+        case ST_IAC:
+            switch (c) {
+            case TELNET_IAC:
+                data[out++] = c;   // IAC IAC - байт 0xFF в данных
+                session->state = ST_DATA;
+                break;
+            case TELNET_WILL: session->state = ST_WILL; break;
+            case TELNET_WONT: session->state = ST_WONT; break;
+            case TELNET_DO:   session->state = ST_DO; break;
+            case TELNET_DONT: session->state = ST_DONT; break;
+            case TELNET_SB:
+                session->sb_len = 0;
+                session->state = ST_SB;
+                break;
+            default:
+                // NOP, AYT, BRK и т.п. - игнорируем
+                session->state = ST_DATA;
+                break;
+            }
+            break;
+
+        case ST_WILL:
+        case ST_WONT:
+        case ST_DO:
+        case ST_DONT:
+            handle_negotiation(session, session->state, c);
+            session->state = ST_DATA;
+            break;
+
+        case ST_SB:
+            if (c == TELNET_IAC) {
+                session->state = ST_SB_IAC;
+            } else if (session->sb_len < sizeof(session->sb)) {
+                session->sb[session->sb_len++] = c;
+            }
+            break;
+
+        case ST_SB_IAC:
+            if (c == TELNET_SE) {
+                if (session->sb_len > 0 && session->sb[0] == TELNET_OPT_COM_PORT) {
+                    handle_com_port(session, session->sb + 1, session->sb_len - 1);
+                }
+                session->state = ST_DATA;
+            } else {
+                // IAC IAC внутри подопции - литерал 0xFF
+                if (session->sb_len < sizeof(session->sb)) {
+                    session->sb[session->sb_len++] = c;
+                }
+                session->state = ST_SB;
+            }
+            break;
+
+        default:
+            session->state = ST_DATA;
+            break;
+        }
+    }
+
+    return out;
+}
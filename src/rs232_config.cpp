@@ -0,0 +1,77 @@
+/**
+ * @file rs232_config.cpp
+ * @brief Проверка и преобразование параметров RS-232
+ *
+ * Не зависит от драйвера UART и собирается как в прошивке, так и
+ * в сборке для Linux (host/).
+ */
+
+#include "rs232_handler.h"
+#include "config.h"
+
+#include <string.h>
+
+bool rs232_config_is_valid(const rs232_config_t *config)
+{
+    if (config == NULL) {
+        return false;
+    }
+    if (config->baud_rate < RS232_MIN_BAUD_RATE || config->baud_rate > RS232_MAX_BAUD_RATE) {
+        return false;
+    }
+    if (config->data_bits < UART_DATA_5_BITS || config->data_bits > UART_DATA_8_BITS) {
+        return false;
+    }
+    if (config->parity != UART_PARITY_DISABLE && config->parity != UART_PARITY_ODD &&
+        config->parity != UART_PARITY_EVEN) {
+        return false;
+    }
+    if (config->stop_bits != UART_STOP_BITS_1 && config->stop_bits != UART_STOP_BITS_1_5 &&
+        config->stop_bits != UART_STOP_BITS_2) {
+        return false;
+    }
+    return true;
+}
+
+bool rs232_config_equal(const rs232_config_t *a, const rs232_config_t *b)
+{
+    return a->baud_rate == b->baud_rate && a->data_bits == b->data_bits &&
+           a->parity == b->parity && a->stop_bits == b->stop_bits;
+}
+
+const char *rs232_parity_name(uart_parity_t parity)
+{
+    switch (parity) {
+    case UART_PARITY_ODD:  return "odd";
+    case UART_PARITY_EVEN: return "even";
+    default:               return "none";
+    }
+}
+
+bool rs232_parse_parity(const char *name, uart_parity_t *parity)
+{
+    if (strcmp(name, "none") == 0 || strcmp(name, "n") == 0) {
+        *parity = UART_PARITY_DISABLE;
+    } else if (strcmp(name, "odd") == 0 || strcmp(name, "o") == 0) {
+        *parity = UART_PARITY_ODD;
+    } else if (strcmp(name, "even") == 0 || strcmp(name, "e") == 0) {
+        *parity = UART_PARITY_EVEN;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int rs232_data_bits_count(uart_word_length_t data_bits)
+{
+    return 5 + (int)(data_bits - UART_DATA_5_BITS);
+}
+
+int rs232_stop_bits_x2(uart_stop_bits_t stop_bits)
+{
+    switch (stop_bits) {
+    case UART_STOP_BITS_1_5: return 3;
+    case UART_STOP_BITS_2:   return 4;
+    default:                 return 2;
+    }
+}
@@ -0,0 +1,388 @@
+/**
+ * @file rs232_handler.cpp
+ * @brief Обработчик интерфейса RS-232
+ *
+ * Два режима приема:
+ * - драйвер UART с очередью событий (по умолчанию), данные забирает
+ *   задача uart_rx;
+ * - UHCI/GDMA (RS232_USE_UHCI_DMA): FIFO разгружается DMA в два буфера
+ *   попеременно, процессор получает прерывание только по окончании
+ *   транзакции (пауза в линии или заполнение буфера), а не на каждый
+ *   порог FIFO. Подходит для скоростей 2-5 Мбод.
+ *
+ * Смена параметров на лету не сбрасывает FIFO и буферы: уже принятые
+ * байты остаются в драйвере (или DMA буфере) и читаются как обычно,
+ * а передача перед сменой скорости дожидается отправки последнего байта.
+ */
+
+#include "rs232_handler.h"
+#include "config.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+
+#if RS232_USE_UHCI_DMA
+#include "soc/soc_caps.h"
+#if !SOC_UHCI_SUPPORTED
+#error "RS232_USE_UHCI_DMA requires a chip with UHCI (e.g. ESP32-C6)"
+#endif
+#include "driver/uhci.h"
+#endif
+
+static const char *TAG = "RS232";
+
+// Максимальное ожидание окончания передачи перед сменой параметров
+#define RS232_TX_DRAIN_TIMEOUT_MS   500
+
+// Текущая конфигурация порта
+static rs232_config_t current_config = {
+    .baud_rate = UART_BAUD_RATE,
+    .data_bits = UART_DATA_8_BITS,
+    .parity = UART_PARITY_DISABLE,
+    .stop_bits = UART_STOP_BITS_1,
+};
+static portMUX_TYPE config_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Писатели и смена параметров не должны пересекаться
+static SemaphoreHandle_t tx_lock = NULL;
+static QueueHandle_t event_queue = NULL;
+static bool initialized = false;
+
+#if RS232_USE_UHCI_DMA
+/**
+ * @brief Порция данных, принятая DMA (передается из прерывания в задачу)
+ */
+typedef struct {
+    uint8_t *data;
+    size_t length;
+    bool last;      // Транзакция завершена, буфер можно переиспользовать
+} dma_chunk_t;
+
+static uhci_controller_handle_t uhci_ctrl = NULL;
+static QueueHandle_t dma_queue = NULL;
+static SemaphoreHandle_t dma_tx_done = NULL;
+static uint8_t dma_rx_buf[2][RS232_DMA_BUF_SIZE] __attribute__((aligned(4)));
+static uint8_t dma_tx_buf[RS232_DMA_TX_SIZE] __attribute__((aligned(4)));
+static int dma_armed = 0;
+static dma_chunk_t dma_current;
+static size_t dma_offset = 0;
+static volatile bool dma_flush_pending = false;
+
+static bool uhci_rx_event(uhci_controller_handle_t ctrl, const uhci_rx_event_data_t *edata,
+                          void *user_ctx)
+{
+    dma_chunk_t chunk = {
+        .data = edata->data,
+        .length = edata->recv_size,
+        .last = edata->flags.totally_received != 0,
+    };
+    // Порций на транзакцию немного (по паузам в линии), а задача приема
+    // разбирает очередь быстрее, чем DMA заполняет буфер
+    BaseType_t woken = pdFALSE;
+    xQueueSendFromISR(dma_queue, &chunk, &woken);
+    return woken == pdTRUE;
+}
+
+static bool uhci_tx_done(uhci_controller_handle_t ctrl, const uhci_tx_done_event_data_t *edata,
+                         void *user_ctx)
+{
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(dma_tx_done, &woken);
+    return woken == pdTRUE;
+}
+
+static bool dma_init(void)
+{
+    dma_queue = xQueueCreate(RS232_DMA_QUEUE_LEN, sizeof(dma_chunk_t));
+    dma_tx_done = xSemaphoreCreateBinary();
+    if (dma_queue == NULL || dma_tx_done == NULL) {
+        return false;
+    }
+
+    uhci_controller_config_t uhci_config = {};
+    uhci_config.uart_port = UART_NUM;
+    uhci_config.tx_trans_queue_depth = 2;
+    uhci_config.max_receive_internal_mem = RS232_DMA_BUF_SIZE;
+    uhci_config.max_transmit_size = RS232_DMA_TX_SIZE;
+    uhci_config.dma_burst_size = 32;
+    uhci_config.rx_eof_flags.idle_eof = 1;
+
+    esp_err_t ret = uhci_new_controller(&uhci_config, &uhci_ctrl);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UHCI controller init failed: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    uhci_event_callbacks_t callbacks = {};
+    callbacks.on_rx_trans_event = uhci_rx_event;
+    callbacks.on_tx_trans_done = uhci_tx_done;
+    uhci_register_event_callbacks(uhci_ctrl, &callbacks, NULL);
+
+    dma_armed = 0;
+    ret = uhci_receive(uhci_ctrl, dma_rx_buf[dma_armed], sizeof(dma_rx_buf[0]));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UHCI receive failed: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    ESP_LOGI(TAG, "UHCI/GDMA RX enabled: 2 x %d bytes", RS232_DMA_BUF_SIZE);
+    return true;
+}
+
+/**
+ * Следующая порция от DMA; по последней порции транзакции сначала
+ * запускаем прием во второй буфер, а потом отдаем данные из первого
+ */
+static bool dma_next_chunk(TickType_t ticks)
+{
+    if (xQueueReceive(dma_queue, &dma_current, ticks) != pdTRUE) {
+        return false;
+    }
+    dma_offset = 0;
+    if (dma_current.last) {
+        dma_armed ^= 1;
+        uhci_receive(uhci_ctrl, dma_rx_buf[dma_armed], sizeof(dma_rx_buf[0]));
+    }
+    return true;
+}
+
+static int dma_read(uint8_t *buffer, size_t length, TickType_t ticks)
+{
+    size_t total = 0;
+
+    // Очистку выполняет сам читатель: буферы DMA принадлежат ему
+    if (dma_flush_pending) {
+        dma_flush_pending = false;
+        while (dma_next_chunk(0)) {
+        }
+        dma_offset = dma_current.length;
+    }
+
+    while (total < length) {
+        // Первую порцию ждем, остальные забираем только если уже есть
+        if (dma_offset >= dma_current.length && !dma_next_chunk(total == 0 ? ticks : 0)) {
+            break;
+        }
+
+        size_t n = dma_current.length - dma_offset;
+        if (n > length - total) {
+            n = length - total;
+        }
+        memcpy(buffer + total, dma_current.data + dma_offset, n);
+        dma_offset += n;
+        total += n;
+    }
+    return (int)total;
+}
+
+static int dma_write(const uint8_t *data, size_t length)
+{
+    size_t total = 0;
+    while (total < length) {
+        // DMA читает буфер асинхронно - копируем в постоянную память
+        size_t n = length - total;
+        if (n > sizeof(dma_tx_buf)) {
+            n = sizeof(dma_tx_buf);
+        }
+        memcpy(dma_tx_buf, data + total, n);
+        if (uhci_transmit(uhci_ctrl, dma_tx_buf, n) != ESP_OK ||
+            xSemaphoreTake(dma_tx_done, pdMS_TO_TICKS(RS232_TX_DRAIN_TIMEOUT_MS)) != pdTRUE) {
+            break;
+        }
+        total += n;
+    }
+    return (int)total;
+}
+#endif // RS232_USE_UHCI_DMA
+
+bool rs232_init(const rs232_config_t *config)
+{
+    if (initialized) {
+        return rs232_reconfigure(config);
+    }
+    if (!rs232_config_is_valid(config)) {
+        ESP_LOGE(TAG, "Invalid RS-232 configuration");
+        return false;
+    }
+
+    tx_lock = xSemaphoreCreateMutex();
+    if (tx_lock == NULL) {
+        return false;
+    }
+
+    uart_config_t uart_config = {
+        .baud_rate = (int)config->baud_rate,
+        .data_bits = config->data_bits,
+        .parity = config->parity,
+        .stop_bits = config->stop_bits,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .rx_flow_ctrl_thresh = 122,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+
+    esp_err_t ret = ESP_OK;
+#if !RS232_USE_UHCI_DMA
+    ESP_LOGI(TAG, "Installing UART driver...");
+    // С буфером передачи uart_write_bytes() копирует данные и не ждет линии
+    ret = uart_driver_install(UART_NUM, UART_RX_RING_SIZE, UART_TX_RING_SIZE,
+                              UART_EVENT_QUEUE_LEN, &event_queue, 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UART driver install failed: %s", esp_err_to_name(ret));
+        return false;
+    }
+#endif
+
+    ret = uart_param_config(UART_NUM, &uart_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UART param config failed: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Setting UART pins: TX=GPIO%d, RX=GPIO%d", UART_TX_PIN, UART_RX_PIN);
+    ret = uart_set_pin(UART_NUM, UART_TX_PIN, UART_RX_PIN,
+                       UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UART set pin failed: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+#if RS232_USE_UHCI_DMA
+    if (!dma_init()) {
+        return false;
+    }
+#endif
+
+    portENTER_CRITICAL(&config_lock);
+    current_config = *config;
+    portEXIT_CRITICAL(&config_lock);
+    initialized = true;
+
+    ESP_LOGI(TAG, "UART initialized: %lu baud, data_bits=%d, parity=%s, stop_bits_x2=%d",
+             (unsigned long)config->baud_rate, rs232_data_bits_count(config->data_bits),
+             rs232_parity_name(config->parity), rs232_stop_bits_x2(config->stop_bits));
+    return true;
+}
+
+int rs232_read(uint8_t *buffer, size_t length, uint32_t timeout_ms)
+{
+    TickType_t ticks = timeout_ms == RS232_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+#if RS232_USE_UHCI_DMA
+    return dma_read(buffer, length, ticks);
+#else
+    return uart_read_bytes(UART_NUM, buffer, length, ticks);
+#endif
+}
+
+int rs232_write(const uint8_t *data, size_t length)
+{
+    if (tx_lock == NULL) {
+        return -1;
+    }
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+#if RS232_USE_UHCI_DMA
+    int written = dma_write(data, length);
+#else
+    int written = uart_write_bytes(UART_NUM, data, length);
+#endif
+    xSemaphoreGive(tx_lock);
+    return written;
+}
+
+bool rs232_wait_tx_done(uint32_t timeout_ms)
+{
+#if RS232_USE_UHCI_DMA
+    // dma_write() возвращается после окончания транзакции
+    return true;
+#else
+    return uart_wait_tx_done(UART_NUM, pdMS_TO_TICKS(timeout_ms)) == ESP_OK;
+#endif
+}
+
+bool rs232_reconfigure(const rs232_config_t *config)
+{
+    if (!rs232_config_is_valid(config)) {
+        ESP_LOGE(TAG, "Invalid RS-232 configuration");
+        return false;
+    }
+    if (!initialized) {
+        return rs232_init(config);
+    }
+
+    rs232_config_t old_config;
+    rs232_get_config(&old_config);
+
+    // Новые записи не начинаются, пока параметры меняются; уже поставленные
+    // в передачу байты уходят со старыми параметрами
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+#if !RS232_USE_UHCI_DMA
+    uart_wait_tx_done(UART_NUM, pdMS_TO_TICKS(RS232_TX_DRAIN_TIMEOUT_MS));
+#endif
+
+    // FIFO и буферы приема не сбрасываются: принятые байты сохраняются
+    esp_err_t ret = ESP_OK;
+    if (config->baud_rate != old_config.baud_rate) {
+        ret = uart_set_baudrate(UART_NUM, config->baud_rate);
+    }
+    if (ret == ESP_OK && config->data_bits != old_config.data_bits) {
+        ret = uart_set_word_length(UART_NUM, config->data_bits);
+    }
+    if (ret == ESP_OK && config->parity != old_config.parity) {
+        ret = uart_set_parity(UART_NUM, config->parity);
+    }
+    if (ret == ESP_OK && config->stop_bits != old_config.stop_bits) {
+        ret = uart_set_stop_bits(UART_NUM, config->stop_bits);
+    }
+
+    if (ret == ESP_OK) {
+        portENTER_CRITICAL(&config_lock);
+        current_config = *config;
+        portEXIT_CRITICAL(&config_lock);
+    } else {
+        // Откат: часть параметров могла примениться (новая скорость со
+        // старой четностью), порт возвращается к current_config
+        uart_set_baudrate(UART_NUM, old_config.baud_rate);
+        uart_set_word_length(UART_NUM, old_config.data_bits);
+        uart_set_parity(UART_NUM, old_config.parity);
+        uart_set_stop_bits(UART_NUM, old_config.stop_bits);
+    }
+    xSemaphoreGive(tx_lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Reconfigure failed: %s, previous settings restored", esp_err_to_name(ret));
+        return false;
+    }
+
+    ESP_LOGI(TAG, "UART reconfigured: %lu baud, data_bits=%d, parity=%s, stop_bits_x2=%d",
+             (unsigned long)config->baud_rate, rs232_data_bits_count(config->data_bits),
+             rs232_parity_name(config->parity), rs232_stop_bits_x2(config->stop_bits));
+    return true;
+}
+
+void rs232_get_config(rs232_config_t *config)
+{
+    portENTER_CRITICAL(&config_lock);
+    *config = current_config;
+    portEXIT_CRITICAL(&config_lock);
+}
+
+void rs232_flush(void)
+{
+#if RS232_USE_UHCI_DMA
+    // Отбрасываем все, что DMA уже принял, но еще не прочитано
+    dma_flush_pending = true;
+#else
+    uart_flush_input(UART_NUM);
+#endif
+}
+
+QueueHandle_t rs232_get_event_queue(void)
+{
+    return event_queue;
+}
+
+bool rs232_dma_enabled(void)
+{
+    return RS232_USE_UHCI_DMA != 0;
+}
@@ -0,0 +1,349 @@
+/**
+ * @file serial_port.cpp
+ * @brief Несколько последовательных портов на одном устройстве (/api/ports)
+ *
+ * Основной порт (0) не меняется: его функции делегируются rs232_handler,
+ * uart_rx/uart_tx и буферу web_server. Здесь - контексты дополнительных
+ * портов и общая задача их приема.
+ *
+ * Задача port_rx ниже задачи приема основного порта (TASK_PRIO_PORT_RX):
+ * драйверы копят байты в своих буферах по прерываниям, задаче достаточно
+ * успевать за SERIAL_PORT_RX_RING_SIZE байт каждого порта. За проход с
+ * порта берется не больше SERIAL_PORT_READ_CHUNK байт; проходы повторяются,
+ * пока у какого-либо порта остаются данные и бюджет.
+ */
+
+#include "serial_port.h"
+#include "serial_port_uart.h"
+#include "config.h"
+#include "byte_ring.h"
+#include "web_server.h"
+#include "uart_rx.h"
+#include "uart_tx.h"
+#include "metrics.h"
+#include "decoder.h"
+#include "trigger.h"
+#include "sse_stream.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "SerialPort";
+
+typedef struct {
+    uart_port_t uart;
+    int tx_pin;
+    int rx_pin;
+} port_hw_t;
+
+// Выводы портов; порт 0 - основной UART
+static const port_hw_t hw_table[] = {
+    { UART_NUM, UART_TX_PIN, UART_RX_PIN },
+#if SERIAL_PORT_COUNT > 1
+    { SERIAL_PORT1_UART, SERIAL_PORT1_TX_PIN, SERIAL_PORT1_RX_PIN },
+#endif
+#if SERIAL_PORT_COUNT > 2
+    { SERIAL_PORT2_UART, SERIAL_PORT2_TX_PIN, SERIAL_PORT2_RX_PIN },
+#endif
+};
+static_assert(sizeof(hw_table) / sizeof(hw_table[0]) == SERIAL_PORT_COUNT,
+              "SERIAL_PORT_COUNT: 1..3, add SERIAL_PORTn_* for more ports");
+
+/**
+ * Контекст дополнительного порта
+ */
+typedef struct {
+    byte_ring_t ring;                   // Пишет только задача приема
+    rs232_config_t config;              // Под config_lock
+    std::atomic<uint32_t> budget;       // Байт/с, 0 - без ограничения
+    std::atomic<bool> running;
+    // Маркерная корзина бюджета (только задача приема)
+    uint32_t tokens;
+    int64_t refill_us;
+    metric_t rx_bytes;
+    metric_t tx_bytes;
+    metric_t overruns;
+    metric_t errors;
+    metric_t throttled;
+    char labels[12];                    // port="N"
+} port_ctx_t;
+
+static port_ctx_t ports[SERIAL_PORT_COUNT];     // [0] не используется
+static uint8_t port_storage[SERIAL_PORT_COUNT - 1][SERIAL_PORT_BUFFER_SIZE];
+static portMUX_TYPE config_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Порция данных (используется только задачей приема)
+static uint8_t rx_chunk[SERIAL_PORT_READ_CHUNK];
+
+static inline bool is_aux(int port)
+{
+    return port > SERIAL_PORT_PRIMARY && port < SERIAL_PORT_COUNT;
+}
+
+/**
+ * Пополнение корзины: budget байт в секунду, запас - SERIAL_PORT_BUDGET_BURST_MS
+ */
+static void refill(port_ctx_t *ctx, uint32_t budget, int64_t now)
+{
+    uint32_t burst = (uint32_t)((uint64_t)budget * SERIAL_PORT_BUDGET_BURST_MS / 1000);
+    if (burst < SERIAL_PORT_READ_CHUNK) {
+        burst = SERIAL_PORT_READ_CHUNK;
+    }
+    uint64_t add = (uint64_t)(now - ctx->refill_us) * budget / 1000000;
+    if (add == 0) {
+        return;
+    }
+    if (ctx->tokens + add >= burst) {
+        ctx->tokens = burst;
+        ctx->refill_us = now;
+    } else {
+        // Остаток интервала, не давший целого байта, переносится
+        ctx->tokens += (uint32_t)add;
+        ctx->refill_us += (int64_t)(add * 1000000 / budget);
+    }
+}
+
+/**
+ * Проходы по кругу по всем портам
+ *
+ * @return true если какой-либо порт ждет пополнения бюджета
+ */
+static bool service_ports(void)
+{
+    int64_t now = esp_timer_get_time();
+    bool limited = false;
+    bool more;
+
+    do {
+        more = false;
+        for (int p = 1; p < SERIAL_PORT_COUNT; p++) {
+            port_ctx_t *ctx = &ports[p];
+            if (!ctx->running.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            size_t buffered = serial_port_uart_buffered(p);
+            if (buffered == 0) {
+                continue;
+            }
+
+            size_t allowed = buffered < SERIAL_PORT_READ_CHUNK ? buffered : SERIAL_PORT_READ_CHUNK;
+            uint32_t budget = ctx->budget.load(std::memory_order_relaxed);
+            if (budget != 0) {
+                refill(ctx, budget, now);
+                if (ctx->tokens < allowed) {
+                    allowed = ctx->tokens;
+                    metric_add(&ctx->throttled, 1);
+                    limited = true;
+                }
+            }
+            if (allowed == 0) {
+                continue;
+            }
+
+            size_t n = serial_port_uart_read(p, rx_chunk, allowed);
+            if (n == 0) {
+                continue;
+            }
+            byte_ring_write(&ctx->ring, rx_chunk, n);
+            decoder_feed(p, rx_chunk, n, (uint64_t)now);
+            if (trigger_feed(p, rx_chunk, n, byte_ring_head(&ctx->ring), (uint64_t)now)) {
+                sse_stream_notify();
+            }
+            metric_add(&ctx->rx_bytes, (uint32_t)n);
+            if (budget != 0) {
+                ctx->tokens -= (uint32_t)n;
+            }
+            if (n < buffered && (budget == 0 || ctx->tokens > 0)) {
+                more = true;
+            }
+        }
+    } while (more);
+
+    return limited;
+}
+
+static void port_rx_task(void *arg)
+{
+    uint32_t overruns[SERIAL_PORT_COUNT];
+    uint32_t errors[SERIAL_PORT_COUNT];
+    bool limited = false;
+
+    for (;;) {
+        memset(overruns, 0, sizeof(overruns));
+        memset(errors, 0, sizeof(errors));
+        serial_port_uart_wait(limited ? SERIAL_PORT_THROTTLE_MS : SERIAL_PORT_IDLE_MS,
+                              overruns, errors);
+        for (int p = 1; p < SERIAL_PORT_COUNT; p++) {
+            if (overruns[p] != 0) {
+                metric_add(&ports[p].overruns, overruns[p]);
+            }
+            if (errors[p] != 0) {
+                metric_add(&ports[p].errors, errors[p]);
+            }
+        }
+        limited = service_ports();
+    }
+}
+
+static void register_metrics(port_ctx_t *ctx)
+{
+    metrics_register(&ctx->rx_bytes, METRIC_COUNTER, "comtoair_port_rx_bytes_total",
+                     "Bytes received on an auxiliary serial port", ctx->labels);
+    metrics_register(&ctx->tx_bytes, METRIC_COUNTER, "comtoair_port_tx_bytes_total",
+                     "Bytes queued for transmission on an auxiliary serial port", ctx->labels);
+    metrics_register(&ctx->overruns, METRIC_COUNTER, "comtoair_port_overruns_total",
+                     "Receive FIFO or driver buffer overflows on an auxiliary serial port",
+                     ctx->labels);
+    metrics_register(&ctx->errors, METRIC_COUNTER, "comtoair_port_line_errors_total",
+                     "Frame, parity and break errors on an auxiliary serial port", ctx->labels);
+    metrics_register(&ctx->throttled, METRIC_COUNTER, "comtoair_port_throttled_total",
+                     "Receive passes limited by the port budget", ctx->labels);
+}
+
+int serial_port_count(void)
+{
+    return SERIAL_PORT_COUNT;
+}
+
+bool serial_ports_start(void)
+{
+    bool any = false;
+    for (int p = 1; p < SERIAL_PORT_COUNT; p++) {
+        port_ctx_t *ctx = &ports[p];
+        byte_ring_init(&ctx->ring, port_storage[p - 1], SERIAL_PORT_BUFFER_SIZE);
+        ctx->config = { UART_BAUD_RATE, UART_DATA_8_BITS, UART_PARITY_DISABLE, UART_STOP_BITS_1 };
+        ctx->budget.store(SERIAL_PORT_BUDGET_DEFAULT, std::memory_order_relaxed);
+        snprintf(ctx->labels, sizeof(ctx->labels), "port=\"%d\"", p);
+        register_metrics(ctx);
+
+        const port_hw_t *hw = &hw_table[p];
+        if (!serial_port_uart_open(p, hw->uart, hw->tx_pin, hw->rx_pin, &ctx->config)) {
+            ESP_LOGE(TAG, "Port %d (UART%d) not started", p, (int)hw->uart);
+            continue;
+        }
+        ctx->running.store(true, std::memory_order_relaxed);
+        any = true;
+        ESP_LOGI(TAG, "Port %d: UART%d TX=GPIO%d RX=GPIO%d", p, (int)hw->uart,
+                 hw->tx_pin, hw->rx_pin);
+    }
+    if (!any) {
+        return SERIAL_PORT_COUNT == 1;
+    }
+
+    TaskHandle_t task = NULL;
+    if (xTaskCreate(port_rx_task, "port_rx", TASK_STACK_PORT_RX, NULL, TASK_PRIO_PORT_RX,
+                    &task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create port_rx task");
+        return false;
+    }
+    metrics_watch_task(task);
+    return true;
+}
+
+bool serial_port_get_info(int port, serial_port_info_t *info)
+{
+    if (port < 0 || port >= SERIAL_PORT_COUNT) {
+        return false;
+    }
+    memset(info, 0, sizeof(*info));
+    info->uart = hw_table[port].uart;
+    info->tx_pin = hw_table[port].tx_pin;
+    info->rx_pin = hw_table[port].rx_pin;
+
+    if (port == SERIAL_PORT_PRIMARY) {
+        uart_rx_stats_t rx;
+        uart_tx_stats_t tx;
+        uart_rx_get_stats(&rx);
+        uart_tx_get_stats(&tx);
+        info->running = true;
+        rs232_get_config(&info->config);
+        info->head = web_server_data_seq();
+        info->oldest = web_server_data_oldest();
+        info->rx_bytes = rx.rx_bytes;
+        info->tx_bytes = tx.tx_bytes;
+        info->overruns = rx.fifo_overflows + rx.buffer_full;
+        info->errors = rx.frame_errors + rx.parity_errors + rx.breaks;
+        return true;
+    }
+
+    const port_ctx_t *ctx = &ports[port];
+    info->running = ctx->running.load(std::memory_order_relaxed);
+    portENTER_CRITICAL(&config_lock);
+    info->config = ctx->config;
+    portEXIT_CRITICAL(&config_lock);
+    info->budget = ctx->budget.load(std::memory_order_relaxed);
+    info->head = byte_ring_head(&ctx->ring);
+    info->oldest = byte_ring_oldest(&ctx->ring);
+    info->rx_bytes = metric_get(&ctx->rx_bytes);
+    info->tx_bytes = metric_get(&ctx->tx_bytes);
+    info->overruns = metric_get(&ctx->overruns);
+    info->errors = metric_get(&ctx->errors);
+    info->throttled = metric_get(&ctx->throttled);
+    return true;
+}
+
+bool serial_port_configure(int port, const rs232_config_t *config)
+{
+    if (port == SERIAL_PORT_PRIMARY) {
+        return rs232_reconfigure(config);
+    }
+    if (!is_aux(port) || !rs232_config_is_valid(config) ||
+        !ports[port].running.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    if (!serial_port_uart_set_config(port, config)) {
+        // Часть параметров могла примениться - возвращаем прежние
+        portENTER_CRITICAL(&config_lock);
+        rs232_config_t previous = ports[port].config;
+        portEXIT_CRITICAL(&config_lock);
+        serial_port_uart_set_config(port, &previous);
+        return false;
+    }
+    portENTER_CRITICAL(&config_lock);
+    ports[port].config = *config;
+    portEXIT_CRITICAL(&config_lock);
+    ESP_LOGI(TAG, "Port %d reconfigured: %lu baud", port, (unsigned long)config->baud_rate);
+    return true;
+}
+
+bool serial_port_set_budget(int port, uint32_t bytes_per_sec)
+{
+    if (!is_aux(port)) {
+        return false;
+    }
+    ports[port].budget.store(bytes_per_sec, std::memory_order_relaxed);
+    return true;
+}
+
+size_t serial_port_write(int port, const uint8_t *data, size_t length)
+{
+    if (port == SERIAL_PORT_PRIMARY) {
+        return uart_tx_write(data, length, 0);
+    }
+    if (!is_aux(port) || !ports[port].running.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    size_t written = serial_port_uart_write(port, data, length);
+    metric_add(&ports[port].tx_bytes, (uint32_t)written);
+    return written;
+}
+
+size_t serial_port_read_since(int port, uint32_t *seq, uint8_t *buffer, size_t length,
+                              uint32_t *lost)
+{
+    if (port == SERIAL_PORT_PRIMARY) {
+        return web_server_read_since(seq, buffer, length, lost);
+    }
+    if (!is_aux(port)) {
+        if (lost != NULL) {
+            *lost = 0;
+        }
+        return 0;
+    }
+    return byte_ring_read(&ports[port].ring, seq, buffer, length, lost);
+}
@@ -0,0 +1,173 @@
+/**
+ * @file serial_port_uart.cpp
+ * @brief Драйвер дополнительных портов на UART ESP-IDF
+ *
+ * У каждого порта свой драйвер с буфером приема SERIAL_PORT_RX_RING_SIZE
+ * и очередью событий; очереди собраны в один набор, поэтому общая задача
+ * приема спит, пока ни на одном порту нет событий. Из набора на каждое
+ * возвращенное событие читается ровно одно сообщение очереди - иначе
+ * набор переполнится.
+ *
+ * Переполнение буфера драйвера не сбрасывает его: принятые байты остаются,
+ * драйвер возобновит прием, когда задача их заберет (порт, ограниченный
+ * бюджетом, теряет только новые байты).
+ */
+
+#include "serial_port_uart.h"
+#include "config.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+static const char *TAG = "PortUart";
+
+// Ожидание передачи уже записанных байт перед сменой параметров
+#define PORT_TX_DRAIN_TIMEOUT_MS    500
+
+typedef struct {
+    uart_port_t uart;
+    QueueHandle_t events;
+    bool open;
+} port_uart_t;
+
+static port_uart_t port_uarts[SERIAL_PORT_COUNT];
+static QueueSetHandle_t event_set = NULL;
+
+static bool apply_config(uart_port_t uart, const rs232_config_t *config)
+{
+    esp_err_t ret = uart_set_baudrate(uart, config->baud_rate);
+    if (ret == ESP_OK) {
+        ret = uart_set_word_length(uart, config->data_bits);
+    }
+    if (ret == ESP_OK) {
+        ret = uart_set_parity(uart, config->parity);
+    }
+    if (ret == ESP_OK) {
+        ret = uart_set_stop_bits(uart, config->stop_bits);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UART%d config failed: %s", (int)uart, esp_err_to_name(ret));
+        return false;
+    }
+    return true;
+}
+
+bool serial_port_uart_open(int port, uart_port_t uart, int tx_pin, int rx_pin,
+                           const rs232_config_t *config)
+{
+    if (event_set == NULL) {
+        event_set = xQueueCreateSet(SERIAL_PORT_EVENT_QUEUE_LEN * (SERIAL_PORT_COUNT - 1));
+        if (event_set == NULL) {
+            return false;
+        }
+    }
+
+    port_uart_t *pu = &port_uarts[port];
+    esp_err_t ret = uart_driver_install(uart, SERIAL_PORT_RX_RING_SIZE, SERIAL_PORT_TX_RING_SIZE,
+                                        SERIAL_PORT_EVENT_QUEUE_LEN, &pu->events, 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UART%d driver install failed: %s", (int)uart, esp_err_to_name(ret));
+        return false;
+    }
+
+    uart_config_t uart_config = {
+        .baud_rate = (int)config->baud_rate,
+        .data_bits = config->data_bits,
+        .parity = config->parity,
+        .stop_bits = config->stop_bits,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .rx_flow_ctrl_thresh = 122,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+    ret = uart_param_config(uart, &uart_config);
+    if (ret == ESP_OK) {
+        ret = uart_set_pin(uart, tx_pin, rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    }
+    if (ret == ESP_OK) {
+        // Те же пороги прерываний, что у основного порта
+        ret = uart_set_rx_full_threshold(uart, UART_RX_FULL_THRESH);
+    }
+    if (ret == ESP_OK) {
+        ret = uart_set_rx_timeout(uart, UART_RX_TIMEOUT_SYMBOLS);
+    }
+    if (ret != ESP_OK || xQueueAddToSet(pu->events, event_set) != pdPASS) {
+        ESP_LOGE(TAG, "UART%d setup failed: %s", (int)uart, esp_err_to_name(ret));
+        uart_driver_delete(uart);
+        pu->events = NULL;
+        return false;
+    }
+
+    pu->uart = uart;
+    pu->open = true;
+    return true;
+}
+
+bool serial_port_uart_set_config(int port, const rs232_config_t *config)
+{
+    port_uart_t *pu = &port_uarts[port];
+    if (!pu->open) {
+        return false;
+    }
+    uart_wait_tx_done(pu->uart, pdMS_TO_TICKS(PORT_TX_DRAIN_TIMEOUT_MS));
+    return apply_config(pu->uart, config);
+}
+
+size_t serial_port_uart_buffered(int port)
+{
+    size_t buffered = 0;
+    if (port_uarts[port].open) {
+        uart_get_buffered_data_len(port_uarts[port].uart, &buffered);
+    }
+    return buffered;
+}
+
+size_t serial_port_uart_read(int port, uint8_t *buffer, size_t length)
+{
+    int n = uart_read_bytes(port_uarts[port].uart, buffer, length, 0);
+    return n > 0 ? (size_t)n : 0;
+}
+
+size_t serial_port_uart_write(int port, const uint8_t *data, size_t length)
+{
+    int n = uart_write_bytes(port_uarts[port].uart, data, length);
+    return n > 0 ? (size_t)n : 0;
+}
+
+bool serial_port_uart_wait(uint32_t timeout_ms, uint32_t *overruns, uint32_t *errors)
+{
+    if (event_set == NULL) {
+        vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+        return false;
+    }
+
+    bool any = false;
+    TickType_t wait = pdMS_TO_TICKS(timeout_ms);
+    QueueSetMemberHandle_t member;
+    while ((member = xQueueSelectFromSet(event_set, wait)) != NULL) {
+        wait = 0;
+        uart_event_t event;
+        for (int p = 1; p < SERIAL_PORT_COUNT; p++) {
+            if (port_uarts[p].events != member ||
+                xQueueReceive(port_uarts[p].events, &event, 0) != pdTRUE) {
+                continue;
+            }
+            any = true;
+            switch (event.type) {
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                overruns[p]++;
+                break;
+            case UART_FRAME_ERR:
+            case UART_PARITY_ERR:
+            case UART_BREAK:
+                errors[p]++;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    return any;
+}
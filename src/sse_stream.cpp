@@ -0,0 +1,561 @@
+/**
+ * @file sse_stream.cpp
+ * @brief Поток данных RS-232 как Server-Sent Events (/api/events)
+ *
+ * Обработчик запроса только занимает слот fanout, отправляет заголовки
+ * и передает копию запроса задаче sse_stream. Задача просыпается по
+ * уведомлению от писателя буфера, по окончании окна накопления или ко
+ * времени события status и пишет в сокет клиента только после проверки
+ * готовности к записи, поэтому медленный клиент задерживает лишь свою
+ * очередь событий.
+ *
+ * Событие собирается целиком в общем буфере задачи (данные экранируются
+ * писателем JSON) под clients_lock и уходит одним куском chunked-ответа
+ * уже без него: обработчик HTTP не ждет отправки медленному клиенту.
+ * Клиент, сокет которого закрыт или не принимает данные, отключается:
+ * копия запроса завершается, сессия закрывается.
+ */
+
+#include "sse_stream.h"
+#include "web_server.h"
+#include "config.h"
+#include "metrics.h"
+#include "fanout.h"
+#include "batch_policy.h"
+#include "json_writer.h"
+#include "wifi_manager.h"
+#include "trigger.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "SseStream";
+
+// Повторная проверка готовности сокета медленного клиента
+#define SSE_WRITE_RETRY_MS  50
+
+// Событие: поля id/event, data с экранированными данными (до 6 символов
+// на байт, \u00XX) и событие gap перед ним
+#define SSE_EVENT_SIZE      (SSE_EVENT_MAX_DATA * 6 + 192)
+
+/**
+ * @brief Состояние SSE клиента. Индекс - номер слота fanout.
+ */
+typedef struct {
+    httpd_req_t *req;               // Копия запроса (async handler), NULL - свободен
+    int fd;                         // Сокет клиента
+    fanout_client_t *cursor;        // Курсор в буфере данных
+    bool base64;                    // Данные событий в base64
+    uint32_t status_ms;             // Период события status
+    int64_t status_due_us;          // Время следующего события status
+    int64_t pending_since_us;       // Время появления неотправленных данных
+    uint32_t gap_pending;           // Потерянные байты, о которых клиент еще не знает
+    uint32_t dropped;               // Всего потеряно байт для этого клиента
+    uint32_t batch_version;         // Версия политики пакетирования, примененная к сокету
+    bool triggers;                  // Подписка на события триггеров
+    uint32_t trigger_next;          // Следующее событие триггера для клиента
+    bool sending;                   // Идет отправка без clients_lock, слот не освобождать
+} sse_client_t;
+
+static sse_client_t clients[SSE_MAX_CLIENTS];
+static std::atomic<int> client_count(0);
+static SemaphoreHandle_t clients_lock = NULL;
+static httpd_handle_t sse_server = NULL;
+static TaskHandle_t stream_task = NULL;
+
+// Сборка события (только задача sse_stream)
+static char event_buf[SSE_EVENT_SIZE];
+static size_t event_len;
+static uint8_t event_data[SSE_EVENT_MAX_DATA];
+static json_writer_t event_writer;
+static char event_json[JSON_WRITER_CHUNK_SIZE];
+static trigger_event_t trigger_event;
+static trigger_config_t trigger_config;
+
+// Задержка от приема байта до отправки события с ним клиенту
+static metric_histogram_t delivery;
+
+static bool event_flush(void *ctx, const char *data, size_t length)
+{
+    if (event_len + length > sizeof(event_buf)) {
+        return false;
+    }
+    memcpy(event_buf + event_len, data, length);
+    event_len += length;
+    return true;
+}
+
+static void event_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+static void event_printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(event_buf + event_len, sizeof(event_buf) - event_len, format, args);
+    va_end(args);
+    if (n > 0) {
+        event_len += (size_t)n;
+        if (event_len > sizeof(event_buf) - 1) {
+            event_len = sizeof(event_buf) - 1;
+        }
+    }
+}
+
+static void event_gap(uint32_t missed, uint32_t seq)
+{
+    event_printf("event: gap\nid: %lu\ndata: {\"gap\":%lu,\"seq\":%lu}\n\n",
+                 (unsigned long)seq, (unsigned long)missed, (unsigned long)seq);
+}
+
+static void event_status(void)
+{
+    wifi_manager_info_t info;
+    wifi_manager_get_info(&info);
+
+    event_printf("event: status\ndata: ");
+    json_writer_init(&event_writer, event_json, sizeof(event_json), event_flush, NULL);
+    json_begin_object(&event_writer);
+    json_kv_uint(&event_writer, "uptime", (uint32_t)(esp_timer_get_time() / 1000000));
+    json_kv_string(&event_writer, "wifi", wifi_status_name(info.status));
+    json_kv_string(&event_writer, "ip", info.ip);
+    json_kv_uint(&event_writer, "seq", web_server_data_seq());
+    json_end_object(&event_writer);
+    json_writer_finish(&event_writer);
+    event_printf("\n\n");
+}
+
+static void event_trigger(const trigger_event_t *event, bool base64)
+{
+    event_printf("event: trigger\ndata: ");
+    json_writer_init(&event_writer, event_json, sizeof(event_json), event_flush, NULL);
+    json_begin_object(&event_writer);
+    json_kv_uint(&event_writer, "id", event->id);
+    json_kv_uint(&event_writer, "trigger", event->trigger);
+    json_kv_string(&event_writer, "name", trigger_config.defs[event->trigger].name);
+    json_kv_uint(&event_writer, "port", event->port);
+    json_kv_uint(&event_writer, "seq", event->seq);
+    json_kv_uint(&event_writer, "time_ms", event->time_ms);
+    json_kv_uint(&event_writer, "before", event->before);
+    json_kv_bool(&event_writer, "complete", event->complete);
+    json_key(&event_writer, "context");
+    if (base64) {
+        json_base64_begin(&event_writer);
+        json_base64_append(&event_writer, event->context, event->before + event->after);
+        json_base64_end(&event_writer);
+    } else {
+        json_string_bytes(&event_writer, event->context, event->before + event->after);
+    }
+    json_end_object(&event_writer);
+    json_writer_finish(&event_writer);
+    event_printf("\n\n");
+}
+
+static bool socket_writable(int fd)
+{
+    fd_set wfds;
+    FD_ZERO(&wfds);
+    FD_SET(fd, &wfds);
+    struct timeval tv = { 0, 0 };
+    return select(fd + 1, NULL, &wfds, NULL, &tv) > 0;
+}
+
+/**
+ * Клиент закрыл соединение (EventSource после запроса ничего не пишет,
+ * поэтому готовность сокета к чтению - это FIN или ошибка)
+ */
+static bool peer_closed(int fd)
+{
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(fd, &rfds);
+    struct timeval tv = { 0, 0 };
+    if (select(fd + 1, &rfds, NULL, NULL, &tv) <= 0) {
+        return false;
+    }
+    char c;
+    int n = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+}
+
+static void close_client(sse_client_t *client)
+{
+    ESP_LOGI(TAG, "Client disconnected: fd=%d, dropped=%lu",
+             client->fd, (unsigned long)client->dropped);
+    httpd_sess_trigger_close(sse_server, client->fd);
+    httpd_req_async_handler_complete(client->req);
+    fanout_close(client->cursor);
+    client->req = NULL;
+    client->cursor = NULL;
+    client_count.fetch_sub(1);
+}
+
+/**
+ * Отправка собранного события (вызывается под clients_lock)
+ *
+ * На время блокирующей отправки clients_lock отпускается; слот помечен
+ * sending, поэтому reap_closed_clients() его не освобождает.
+ */
+static bool send_event(sse_client_t *client)
+{
+    client->sending = true;
+    xSemaphoreGive(clients_lock);
+    esp_err_t err = httpd_resp_send_chunk(client->req, event_buf, event_len);
+    xSemaphoreTake(clients_lock, portMAX_DELAY);
+    client->sending = false;
+    if (err != ESP_OK) {
+        close_client(client);
+        return false;
+    }
+    return true;
+}
+
+static uint32_t ms_until(int64_t due_us, int64_t now_us)
+{
+    return due_us > now_us ? (uint32_t)((due_us - now_us + 999) / 1000) : 0;
+}
+
+/**
+ * Обслуживание одного клиента; возвращает время (мс) до следующей проверки
+ */
+static uint32_t service_client(sse_client_t *client, int64_t now_us)
+{
+    uint32_t batch_version = batch_config_version();
+    if (client->batch_version != batch_version) {
+        client->batch_version = batch_version;
+        batch_apply_socket(FANOUT_TRANSPORT_SSE, client->fd);
+    }
+
+    event_len = 0;
+    if (now_us >= client->status_due_us) {
+        if (peer_closed(client->fd)) {
+            close_client(client);
+            return UINT32_MAX;
+        }
+        if (!socket_writable(client->fd)) {
+            return SSE_WRITE_RETRY_MS;
+        }
+        client->status_due_us = now_us + (int64_t)client->status_ms * 1000;
+        event_status();
+        if (!send_event(client)) {
+            return UINT32_MAX;
+        }
+        event_len = 0;
+    }
+    uint32_t status_ms = ms_until(client->status_due_us, now_us);
+
+    // События триггеров - отдельными кусками до данных, без id. Не больше
+    // одного за проверку готовности сокета: отправка блокирующая, остальные -
+    // на следующих проходах
+    uint32_t trigger_head = client->triggers ? trigger_event_head() : client->trigger_next;
+    while (client->trigger_next != trigger_head &&
+           !trigger_get_event(client->trigger_next, &trigger_event)) {
+        client->trigger_next++;     // Вытеснено из кольца
+    }
+    if (client->trigger_next != trigger_head) {
+        if (!socket_writable(client->fd)) {
+            return SSE_WRITE_RETRY_MS;
+        }
+        trigger_get_config(&trigger_config);
+        event_trigger(&trigger_event, client->base64);
+        if (!send_event(client)) {
+            return UINT32_MAX;
+        }
+        event_len = 0;
+        client->trigger_next++;
+        if (client->trigger_next != trigger_head) {
+            return SSE_WRITE_RETRY_MS;
+        }
+    }
+
+    // Отставание сверх бюджета: пропуск с уведомлением или отключение
+    uint32_t skipped = 0;
+    if (fanout_check(client->cursor, &skipped) == FANOUT_EVICT) {
+        close_client(client);
+        return UINT32_MAX;
+    }
+    client->gap_pending += skipped;
+
+    uint32_t seq = client->cursor->seq;
+    uint32_t pending = web_server_data_ready(seq);
+    if (pending == 0 && client->gap_pending == 0) {
+        client->pending_since_us = 0;
+        return status_ms;
+    }
+
+    if (client->gap_pending == 0) {
+        if (client->pending_since_us == 0) {
+            client->pending_since_us = now_us;
+        }
+        uint32_t wait_us = batch_wait_us(FANOUT_TRANSPORT_SSE, pending,
+                                         web_server_framing_active(),
+                                         client->pending_since_us, now_us);
+        if (wait_us > 0) {
+            uint32_t wait_ms = (wait_us + 999) / 1000;
+            return wait_ms < status_ms ? wait_ms : status_ms;
+        }
+    }
+
+    if (!socket_writable(client->fd)) {
+        return SSE_WRITE_RETRY_MS;
+    }
+
+    // Данные перезаписаны между проверкой и чтением - тоже пропуск
+    size_t want = pending < SSE_EVENT_MAX_DATA ? pending : SSE_EVENT_MAX_DATA;
+    uint32_t lost = 0;
+    size_t n = web_server_read_since(&seq, event_data, want, &lost);
+    client->gap_pending += lost;
+    if (client->gap_pending > 0) {
+        event_gap(client->gap_pending, seq - (uint32_t)n);
+        client->dropped += client->gap_pending;
+        client->gap_pending = 0;
+    }
+
+    uint32_t first_seq = seq - (uint32_t)n;
+    uint32_t rx_time_us = 0;
+    bool timed = n > 0 && web_server_data_rx_time(first_seq, &rx_time_us);
+    if (n > 0) {
+        event_printf("id: %lu\ndata: ", (unsigned long)seq);
+        json_writer_init(&event_writer, event_json, sizeof(event_json), event_flush, NULL);
+        if (client->base64) {
+            json_base64_begin(&event_writer);
+            json_base64_append(&event_writer, event_data, n);
+            json_base64_end(&event_writer);
+        } else {
+            json_string_bytes(&event_writer, event_data, n);
+        }
+        json_writer_finish(&event_writer);
+        event_printf("\n\n");
+    }
+
+    client->cursor->seq = seq;
+    client->pending_since_us = 0;
+    if (event_len == 0 || !send_event(client)) {
+        return UINT32_MAX;
+    }
+    if (n > 0) {
+        batch_sent(FANOUT_TRANSPORT_SSE, (uint32_t)n);
+    }
+    if (timed) {
+        metric_observe_us(&delivery, (uint32_t)esp_timer_get_time() - rx_time_us);
+    }
+    return web_server_data_ready(seq) > 0 ? 0 : status_ms;
+}
+
+/**
+ * Задача рассылки событий SSE клиентам
+ */
+static void sse_stream_task(void *pvParameters)
+{
+    TickType_t wait = portMAX_DELAY;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        int64_t now_us = esp_timer_get_time();
+        uint32_t next_ms = UINT32_MAX;
+
+        xSemaphoreTake(clients_lock, portMAX_DELAY);
+        for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+            if (clients[i].req == NULL) {
+                continue;
+            }
+            uint32_t ms = service_client(&clients[i], now_us);
+            if (ms < next_ms) {
+                next_ms = ms;
+            }
+        }
+        xSemaphoreGive(clients_lock);
+
+        if (next_ms == UINT32_MAX) {
+            wait = portMAX_DELAY;
+        } else {
+            wait = pdMS_TO_TICKS(next_ms);
+            if (wait == 0 && next_ms > 0) {
+                wait = 1;
+            }
+        }
+    }
+}
+
+/**
+ * Отключение клиентов, закрывших соединение; true если слот освободился
+ */
+static bool reap_closed_clients(void)
+{
+    bool reaped = false;
+    xSemaphoreTake(clients_lock, portMAX_DELAY);
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if (clients[i].req != NULL && !clients[i].sending && peer_closed(clients[i].fd)) {
+            close_client(&clients[i]);
+            reaped = true;
+        }
+    }
+    xSemaphoreGive(clients_lock);
+    return reaped;
+}
+
+/**
+ * HTTP обработчик /api/events
+ *
+ * GET /api/events                    - события с текущего момента
+ * GET /api/events?since=<seq>        - начиная с порядкового номера seq
+ * Заголовок Last-Event-ID (переподключение EventSource) важнее since.
+ * Дополнительно: encoding=base64, status=<мс> - период события status
+ * (SSE_STATUS_MIN_MS..SSE_STATUS_MAX_MS), triggers=1 - события триггеров.
+ * Все слоты заняты - 503, отставание сверх бюджета при политике
+ * отключения - 410 (EventSource после этого не переподключается).
+ */
+static esp_err_t sse_events_handler(httpd_req_t *req)
+{
+    bool has_since = false;
+    bool base64 = false;
+    bool triggers = false;
+    uint32_t seq = 0;
+    uint32_t status_ms = SSE_STATUS_DEFAULT_MS;
+    char query[96];
+    char value[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+            seq = (uint32_t)strtoul(value, NULL, 10);
+            has_since = true;
+        }
+        base64 = httpd_query_key_value(query, "encoding", value, sizeof(value)) == ESP_OK &&
+                 strcmp(value, "base64") == 0;
+        triggers = httpd_query_key_value(query, "triggers", value, sizeof(value)) == ESP_OK &&
+                   strcmp(value, "1") == 0;
+        if (httpd_query_key_value(query, "status", value, sizeof(value)) == ESP_OK) {
+            status_ms = (uint32_t)strtoul(value, NULL, 10);
+            if (status_ms < SSE_STATUS_MIN_MS) {
+                status_ms = SSE_STATUS_MIN_MS;
+            } else if (status_ms > SSE_STATUS_MAX_MS) {
+                status_ms = SSE_STATUS_MAX_MS;
+            }
+        }
+    }
+    if (httpd_req_get_hdr_value_str(req, "Last-Event-ID", value, sizeof(value)) == ESP_OK &&
+        value[0] != '\0') {
+        seq = (uint32_t)strtoul(value, NULL, 10);
+        has_since = true;
+    }
+    if (!has_since) {
+        seq = web_server_data_seq();
+    }
+
+    // Пропуск сообщит задача событием gap; здесь - только отказ по политике
+    uint32_t check_seq = seq;
+    if (fanout_check_seq(FANOUT_TRANSPORT_SSE, &check_seq, NULL) == FANOUT_EVICT) {
+        httpd_resp_set_status(req, "410 Gone");
+        httpd_resp_set_type(req, "text/plain");
+        return httpd_resp_send(req, "Client is too far behind, reconnect without Last-Event-ID",
+                               HTTPD_RESP_USE_STRLEN);
+    }
+
+    int fd = httpd_req_to_sockfd(req);
+    fanout_client_t *cursor = NULL;
+    if (stream_task != NULL) {
+        cursor = fanout_open(FANOUT_TRANSPORT_SSE, seq);
+        // Перезагруженная страница подключается раньше, чем задача заметит
+        // закрытие старого соединения - освобождаем слоты закрытых сразу
+        if (cursor == NULL && reap_closed_clients()) {
+            cursor = fanout_open(FANOUT_TRANSPORT_SSE, seq);
+        }
+    }
+    if (cursor == NULL) {
+        ESP_LOGW(TAG, "Too many SSE clients, rejecting fd=%d", fd);
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_type(req, "text/plain");
+        httpd_resp_set_hdr(req, "Retry-After", "5");
+        return httpd_resp_send(req, "Too many event stream clients", HTTPD_RESP_USE_STRLEN);
+    }
+
+    // Заголовки и пауза переподключения - сразу, до передачи запроса задаче
+    char retry[32];
+    snprintf(retry, sizeof(retry), "retry: %d\n\n", SSE_RETRY_MS);
+    httpd_resp_set_type(req, "text/event-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_req_t *async_req = NULL;
+    if (httpd_resp_send_chunk(req, retry, HTTPD_RESP_USE_STRLEN) != ESP_OK ||
+        httpd_req_async_handler_begin(req, &async_req) != ESP_OK) {
+        fanout_close(cursor);
+        return ESP_FAIL;
+    }
+
+    xSemaphoreTake(clients_lock, portMAX_DELAY);
+    sse_client_t *client = &clients[cursor->slot];
+    client->req = async_req;
+    client->fd = fd;
+    client->cursor = cursor;
+    client->base64 = base64;
+    client->status_ms = status_ms;
+    client->status_due_us = 0;
+    client->pending_since_us = 0;
+    client->gap_pending = 0;
+    client->dropped = 0;
+    client->batch_version = batch_config_version();
+    client->triggers = triggers;
+    client->trigger_next = trigger_event_head();
+    client->sending = false;
+    batch_apply_socket(FANOUT_TRANSPORT_SSE, fd);
+    client_count.fetch_add(1);
+    xSemaphoreGive(clients_lock);
+
+    ESP_LOGI(TAG, "Client connected: fd=%d, seq=%lu", fd, (unsigned long)seq);
+    xTaskNotifyGive(stream_task);
+    return ESP_OK;
+}
+
+bool sse_stream_register(httpd_handle_t server)
+{
+    if (clients_lock == NULL) {
+        clients_lock = xSemaphoreCreateMutex();
+        if (clients_lock == NULL) {
+            return false;
+        }
+        fanout_init();
+        batch_init();
+        metrics_register_histogram(&delivery, "comtoair_uart_to_client_seconds",
+                                   "Time from UART receive to delivery to a client",
+                                   "transport=\"sse\"");
+    }
+
+    if (stream_task == NULL &&
+        xTaskCreate(sse_stream_task, "sse_stream", TASK_STACK_SSE_STREAM, NULL,
+                    TASK_PRIO_SSE_STREAM, &stream_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create SSE stream task");
+        return false;
+    }
+    metrics_watch_task(stream_task);
+
+    sse_server = server;
+
+    httpd_uri_t uri;
+    memset(&uri, 0, sizeof(uri));
+    uri.uri = "/api/events";
+    uri.method = HTTP_GET;
+    uri.handler = sse_events_handler;
+    uri.user_ctx = NULL;
+    return httpd_register_uri_handler(server, &uri) == ESP_OK;
+}
+
+void sse_stream_notify(void)
+{
+    if (client_count.load(std::memory_order_relaxed) > 0 && stream_task != NULL) {
+        xTaskNotifyGive(stream_task);
+    }
+}
+
+int sse_stream_client_count(void)
+{
+    return client_count.load();
+}
@@ -0,0 +1,117 @@
+/**
+ * @file static_assets.cpp
+ * @brief Статические файлы веб-интерфейса, встроенные в прошивку
+ */
+
+#include "static_assets.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "esp_log.h"
+
+static const char *TAG = "StaticAssets";
+
+// Данные, встроенные через target_add_binary_data (src/CMakeLists.txt)
+extern const uint8_t index_html_gz_start[] asm("_binary_index_html_gz_start");
+extern const uint8_t index_html_gz_end[] asm("_binary_index_html_gz_end");
+extern const uint8_t app_js_gz_start[] asm("_binary_app_js_gz_start");
+extern const uint8_t app_js_gz_end[] asm("_binary_app_js_gz_end");
+extern const uint8_t style_css_gz_start[] asm("_binary_style_css_gz_start");
+extern const uint8_t style_css_gz_end[] asm("_binary_style_css_gz_end");
+
+// Страница проверяется при каждой загрузке (дешево: 304 без тела)
+#define CACHE_REVALIDATE    "no-cache"
+// Файлы с хешем содержимого в адресе не меняются никогда
+#define CACHE_IMMUTABLE     "public, max-age=31536000, immutable"
+
+/**
+ * @brief Описание встроенного файла
+ */
+typedef struct {
+    const char *uri;
+    const char *type;
+    const char *cache_control;
+    const uint8_t *start;
+    const uint8_t *end;
+    char etag[20];              // "xxxxxxxxxxxxxxxx" (FNV-1a 64 от сжатых данных)
+} static_asset_t;
+
+static static_asset_t assets[] = {
+    { "/",           "text/html; charset=utf-8", CACHE_REVALIDATE, index_html_gz_start, index_html_gz_end, "" },
+    { "/index.html", "text/html; charset=utf-8", CACHE_REVALIDATE, index_html_gz_start, index_html_gz_end, "" },
+    { "/app.js",     "application/javascript",   CACHE_IMMUTABLE,  app_js_gz_start,     app_js_gz_end,     "" },
+    { "/style.css",  "text/css",                 CACHE_IMMUTABLE,  style_css_gz_start,  style_css_gz_end,  "" },
+};
+
+/**
+ * Сильный ETag: хеш от отдаваемого (сжатого) содержимого
+ */
+static void make_etag(static_asset_t *asset)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const uint8_t *p = asset->start; p < asset->end; p++) {
+        hash = (hash ^ *p) * 0x100000001b3ULL;
+    }
+    snprintf(asset->etag, sizeof(asset->etag), "\"%08lx%08lx\"",
+             (unsigned long)(hash >> 32), (unsigned long)(hash & 0xffffffffu));
+}
+
+/**
+ * Проверка If-None-Match: список ETag через запятую или "*"
+ */
+static bool etag_matches(httpd_req_t *req, const char *etag)
+{
+    char value[128];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", value, sizeof(value)) != ESP_OK) {
+        return false;
+    }
+    // Слабое сравнение (RFC 9110): префикс W/ не мешает совпадению
+    return strcmp(value, "*") == 0 || strstr(value, etag) != NULL;
+}
+
+static esp_err_t static_asset_handler(httpd_req_t *req)
+{
+    const static_asset_t *asset = (const static_asset_t *)req->user_ctx;
+
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", asset->cache_control);
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+
+    if (etag_matches(req, asset->etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    // Все поддерживаемые браузеры принимают gzip; распаковки на устройстве нет
+    httpd_resp_set_type(req, asset->type);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    return httpd_resp_send(req, (const char *)asset->start, asset->end - asset->start);
+}
+
+bool static_assets_register(httpd_handle_t server)
+{
+    bool ok = true;
+
+    for (size_t i = 0; i < sizeof(assets) / sizeof(assets[0]); i++) {
+        static_asset_t *asset = &assets[i];
+        if (asset->etag[0] == '\0') {
+            make_etag(asset);
+        }
+
+        httpd_uri_t uri = {
+            .uri       = asset->uri,
+            .method    = HTTP_GET,
+            .handler   = static_asset_handler,
+            .user_ctx  = asset
+        };
+        if (httpd_register_uri_handler(server, &uri) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to register %s", asset->uri);
+            ok = false;
+        } else {
+            ESP_LOGD(TAG, "%s: %d bytes gzip, ETag %s", asset->uri,
+                     (int)(asset->end - asset->start), asset->etag);
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,554 @@
+/**
+ * @file tcp_server.cpp
+ * @brief TCP сервер последовательного порта (в стиле ser2net)
+ *
+ * Задача "tcp_serial" принимает подключения и переносит байты из сокетов
+ * в очередь передачи UART (uart_tx.h). Если очередь заполнена, принятое
+ * остается в буфере клиента, а его сокет не читается, пока в очереди не
+ * появится место: TCP окно задерживает этого отправителя, остальные
+ * клиенты и новые подключения обслуживаются. Задача "tcp_forward" просыпается по уведомлению от писателя
+ * буфера данных, копирует новые байты в буфер клиента (web_server_read_since
+ * проверяет, что копия не перезаписана) и отправляет их, не блокируясь
+ * на медленных клиентах (MSG_DONTWAIT). Байты, перезаписанные до
+ * копирования, пропускаются: отправка продолжается с самого старого
+ * сохраненного байта. Все отправки в сокеты выполняет
+ * только задача "tcp_forward", включая ответы Telnet. Курсоры клиентов и
+ * бюджет отставания - слоты fanout (FANOUT_TCP_LAG_BUDGET). Момент отправки
+ * и TCP_NODELAY задает политика пакетирования (batch_policy.h).
+ */
+
+#include "tcp_server.h"
+#include "rfc2217.h"
+#include "uart_tx.h"
+#include "web_server.h"
+#include "config.h"
+#include "metrics.h"
+#include "fanout.h"
+#include "batch_policy.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "TcpSerial";
+
+// Повторная попытка отправки клиенту с заполненным окном TCP
+#define TCP_SERIAL_RETRY_MS     10
+
+// Ожидание места в очереди передачи UART для принятых от клиента байт
+#define TCP_SERIAL_TX_WAIT_MS   10
+
+/**
+ * @brief Состояние TCP клиента
+ */
+typedef struct {
+    int sock;                       // Сокет клиента, -1 если слот свободен
+    bool telnet;                    // Режим Telnet / RFC 2217
+    bool iac_pending;               // Не отправлен второй байт экранирования 0xFF
+    bool closing;                   // Соединение разрывается, данные не отправляются
+    fanout_client_t *cursor;        // Курсор в буфере данных
+    int64_t pending_since_us;       // Время появления неотправленных данных
+    uint32_t batch_version;         // Версия политики пакетирования, примененная к сокету
+    uint8_t tx_buf[TCP_SERIAL_TX_CHUNK];    // Скопированные из буфера данные
+    uint16_t tx_len;                // Байт в tx_buf
+    uint16_t tx_off;                // Из них уже отправлено
+    bool tx_timed;                  // Известно время приема первого байта tx_buf
+    uint32_t tx_rx_us;              // Время приема первого байта tx_buf
+    uint8_t rx_buf[TCP_SERIAL_RX_CHUNK];    // Принятые байты, не поставленные в очередь UART
+    uint16_t rx_len;                // Байт в rx_buf (сокет не читается, пока не 0)
+    rfc2217_session_t session;      // Состояние Telnet (только в режиме telnet)
+} tcp_client_t;
+
+static tcp_client_t clients[TCP_SERIAL_MAX_CLIENTS];
+static SemaphoreHandle_t clients_lock = NULL;
+static TaskHandle_t forward_task = NULL;
+
+static std::atomic<uint32_t> stat_clients(0);
+static std::atomic<uint32_t> stat_accepted(0);
+static std::atomic<uint32_t> stat_rejected(0);
+static std::atomic<uint32_t> stat_tx_bytes(0);
+static std::atomic<uint32_t> stat_rx_bytes(0);
+static std::atomic<uint32_t> stat_dropped(0);
+
+// Задержка от приема байта до передачи его в сокет
+static metric_histogram_t delivery;
+
+static int open_listener(uint16_t port)
+{
+    if (port == 0) {
+        return -1;
+    }
+
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(sock, TCP_SERIAL_MAX_CLIENTS) != 0) {
+        ESP_LOGE(TAG, "Unable to listen on port %d: errno %d", port, errno);
+        close(sock);
+        return -1;
+    }
+
+    ESP_LOGI(TAG, "Listening on port %d", port);
+    return sock;
+}
+
+static void accept_client(int listen_sock, bool telnet)
+{
+    int sock = accept(listen_sock, NULL, NULL);
+    if (sock < 0) {
+        return;
+    }
+
+    // TCP_NODELAY и буфер отправки - по режиму пакетирования
+    int opt = 1;
+    setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &opt, sizeof(opt));
+    uint32_t batch_version = batch_config_version();
+    batch_apply_socket(FANOUT_TRANSPORT_TCP, sock);
+
+    bool added = false;
+    xSemaphoreTake(clients_lock, portMAX_DELAY);
+    for (int i = 0; i < TCP_SERIAL_MAX_CLIENTS; i++) {
+        tcp_client_t *client = &clients[i];
+        if (client->sock < 0) {
+            client->cursor = fanout_open(FANOUT_TRANSPORT_TCP, web_server_data_seq());
+            if (client->cursor == NULL) {
+                break;
+            }
+            client->sock = sock;
+            client->telnet = telnet;
+            client->iac_pending = false;
+            client->closing = false;
+            client->pending_since_us = 0;
+            client->batch_version = batch_version;
+            client->tx_len = 0;
+            client->tx_off = 0;
+            client->tx_timed = false;
+            client->rx_len = 0;
+            if (telnet) {
+                rfc2217_init(&client->session);
+            }
+            added = true;
+            break;
+        }
+    }
+    xSemaphoreGive(clients_lock);
+
+    if (!added) {
+        stat_rejected.fetch_add(1);
+        ESP_LOGW(TAG, "Too many clients, rejecting connection");
+        close(sock);
+        return;
+    }
+
+    stat_accepted.fetch_add(1);
+    stat_clients.fetch_add(1);
+    ESP_LOGI(TAG, "Client connected (%s)", telnet ? "RFC 2217" : "raw");
+    xTaskNotifyGive(forward_task);
+}
+
+static void close_client(tcp_client_t *client)
+{
+    xSemaphoreTake(clients_lock, portMAX_DELAY);
+    if (client->sock >= 0) {
+        close(client->sock);
+        client->sock = -1;
+        stat_clients.fetch_sub(1);
+        fanout_close(client->cursor);
+        client->cursor = NULL;
+    }
+    xSemaphoreGive(clients_lock);
+    ESP_LOGI(TAG, "Client disconnected");
+}
+
+/**
+ * Постановка принятых байт клиента в очередь передачи UART; true если
+ * поставлены все
+ */
+static bool client_flush_rx(tcp_client_t *client, TickType_t wait)
+{
+    if (client->rx_len == 0) {
+        return true;
+    }
+    size_t queued = uart_tx_write(client->rx_buf, client->rx_len, wait);
+    if (queued > 0) {
+        memmove(client->rx_buf, client->rx_buf + queued, client->rx_len - queued);
+        client->rx_len -= (uint16_t)queued;
+        stat_rx_bytes.fetch_add(queued);
+    }
+    return client->rx_len == 0;
+}
+
+/**
+ * Прием данных от клиента и запись в UART
+ */
+static void client_receive(tcp_client_t *client)
+{
+    int len = recv(client->sock, client->rx_buf, sizeof(client->rx_buf), 0);
+    if (len <= 0) {
+        close_client(client);
+        return;
+    }
+
+    size_t data_len = (size_t)len;
+    if (client->telnet) {
+        xSemaphoreTake(clients_lock, portMAX_DELAY);
+        data_len = rfc2217_process(&client->session, client->rx_buf, data_len);
+        bool has_reply = client->session.reply_len > 0;
+        xSemaphoreGive(clients_lock);
+        if (has_reply) {
+            xTaskNotifyGive(forward_task);
+        }
+    }
+
+    // Очередь заполнена - остаток ждет в rx_buf, сокет пока не читается
+    client->rx_len = (uint16_t)data_len;
+    client_flush_rx(client, pdMS_TO_TICKS(TCP_SERIAL_TX_WAIT_MS));
+}
+
+/**
+ * Задача приема подключений и данных от клиентов
+ */
+static void tcp_serial_task(void *pvParameters)
+{
+    int raw_sock = open_listener(TCP_SERIAL_RAW_PORT);
+    int telnet_sock = open_listener(TCP_SERIAL_RFC2217_PORT);
+
+    while (1) {
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        int max_fd = -1;
+
+        if (raw_sock >= 0) {
+            FD_SET(raw_sock, &rfds);
+            max_fd = raw_sock;
+        }
+        if (telnet_sock >= 0) {
+            FD_SET(telnet_sock, &rfds);
+            if (telnet_sock > max_fd) {
+                max_fd = telnet_sock;
+            }
+        }
+        // Слоты занимает и освобождает только эта задача. Клиент с
+        // непоставленными в очередь байтами не читается до появления места
+        bool backlog = false;
+        for (int i = 0; i < TCP_SERIAL_MAX_CLIENTS; i++) {
+            tcp_client_t *client = &clients[i];
+            if (client->sock < 0) {
+                continue;
+            }
+            if (client->rx_len > 0 &&
+                (!uart_tx_has_room() || !client_flush_rx(client, 0))) {
+                backlog = true;
+                continue;
+            }
+            FD_SET(client->sock, &rfds);
+            if (client->sock > max_fd) {
+                max_fd = client->sock;
+            }
+        }
+
+        struct timeval retry = { 0, TCP_SERIAL_RETRY_MS * 1000 };
+        int ready = max_fd < 0 ? -1 : select(max_fd + 1, &rfds, NULL, NULL, backlog ? &retry : NULL);
+        if (ready == 0) {
+            // Повторная постановка в очередь
+            continue;
+        }
+        if (ready < 0) {
+            vTaskDelay(pdMS_TO_TICKS(backlog ? TCP_SERIAL_RETRY_MS : 100));
+            continue;
+        }
+
+        if (raw_sock >= 0 && FD_ISSET(raw_sock, &rfds)) {
+            accept_client(raw_sock, false);
+        }
+        if (telnet_sock >= 0 && FD_ISSET(telnet_sock, &rfds)) {
+            accept_client(telnet_sock, true);
+        }
+        for (int i = 0; i < TCP_SERIAL_MAX_CLIENTS; i++) {
+            if (clients[i].sock >= 0 && FD_ISSET(clients[i].sock, &rfds)) {
+                client_receive(&clients[i]);
+            }
+        }
+    }
+}
+
+/**
+ * Отправка без блокировки; false если окно TCP заполнено
+ */
+static bool send_nonblocking(tcp_client_t *client, const uint8_t *data, size_t length, size_t *sent)
+{
+    int ret = send(client->sock, data, length, MSG_DONTWAIT);
+    if (ret < 0) {
+        *sent = 0;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            // Соединение разорвано - задача tcp_serial закроет сокет
+            shutdown(client->sock, SHUT_RDWR);
+        }
+        return false;
+    }
+    *sent = (size_t)ret;
+    return *sent == length;
+}
+
+static bool flush_replies(tcp_client_t *client)
+{
+    rfc2217_session_t *session = &client->session;
+    if (!client->telnet || session->reply_len == 0) {
+        return true;
+    }
+
+    size_t sent = 0;
+    bool done = send_nonblocking(client, session->reply, session->reply_len, &sent);
+    memmove(session->reply, session->reply + sent, session->reply_len - sent);
+    session->reply_len -= sent;
+    return done;
+}
+
+static void staged_sent(tcp_client_t *client, size_t sent)
+{
+    if (sent == 0) {
+        return;
+    }
+    if (client->tx_timed) {
+        metric_observe_us(&delivery, (uint32_t)esp_timer_get_time() - client->tx_rx_us);
+        client->tx_timed = false;
+    }
+    client->tx_off += (uint16_t)sent;
+    stat_tx_bytes.fetch_add(sent);
+    batch_sent(FANOUT_TRANSPORT_TCP, (uint32_t)sent);
+}
+
+/**
+ * Отправка скопированных в tx_buf данных; false если окно TCP заполнено
+ */
+static bool send_staged(tcp_client_t *client)
+{
+    static const uint8_t iac_escape[2] = { TELNET_IAC, TELNET_IAC };
+    size_t sent = 0;
+
+    if (client->iac_pending) {
+        if (!send_nonblocking(client, iac_escape, 1, &sent)) {
+            return false;
+        }
+        client->iac_pending = false;
+    }
+
+    while (client->tx_off < client->tx_len) {
+        const uint8_t *data = client->tx_buf + client->tx_off;
+        size_t length = client->tx_len - client->tx_off;
+
+        if (client->telnet) {
+            // В режиме Telnet байт 0xFF передается как IAC IAC
+            const uint8_t *iac = (const uint8_t *)memchr(data, TELNET_IAC, length);
+            if (iac == data) {
+                bool done = send_nonblocking(client, iac_escape, 2, &sent);
+                if (sent > 0) {
+                    staged_sent(client, 1);
+                    client->iac_pending = (sent == 1);
+                }
+                if (!done) {
+                    return false;
+                }
+                continue;
+            }
+            if (iac != NULL) {
+                length = iac - data;
+            }
+        }
+
+        bool done = send_nonblocking(client, data, length, &sent);
+        staged_sent(client, sent);
+        if (!done) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Отправка клиенту новых данных; false если клиент не принимает данные
+ *
+ * Если политика пакетирования откладывает отправку, в *wait_us
+ * записывается время до следующей проверки (если оно меньше текущего).
+ */
+static bool forward_data(tcp_client_t *client, int64_t now_us, uint32_t *wait_us)
+{
+    if (client->closing) {
+        return true;
+    }
+
+    // Отставшего сверх бюджета клиента переводим ближе к голове (или отключаем)
+    uint32_t skipped = 0;
+    switch (fanout_check(client->cursor, &skipped)) {
+    case FANOUT_EVICT:
+        client->closing = true;
+        shutdown(client->sock, SHUT_RDWR);
+        return true;
+    case FANOUT_GAP:
+        stat_dropped.fetch_add(skipped);
+        break;
+    default:
+        break;
+    }
+    uint32_t *seq = &client->cursor->seq;
+
+    // Сначала то, что уже скопировано
+    if (!send_staged(client)) {
+        return false;
+    }
+
+    uint32_t pending = web_server_data_pending(*seq);
+    if (pending == 0) {
+        client->pending_since_us = 0;
+        return true;
+    }
+    if (client->pending_since_us == 0) {
+        client->pending_since_us = now_us;
+    }
+    bool frame_ready = web_server_framing_active() && web_server_data_ready(*seq) > 0;
+    uint32_t batch_wait = batch_wait_us(FANOUT_TRANSPORT_TCP, pending, frame_ready,
+                                        client->pending_since_us, now_us);
+    if (batch_wait > 0) {
+        if (batch_wait < *wait_us) {
+            *wait_us = batch_wait;
+        }
+        return true;
+    }
+
+    while (1) {
+        // Копия проверяется после копирования: перезаписанные байты
+        // пропускаются, курсор - на самом старом сохраненном байте
+        uint32_t lost = 0;
+        size_t n = web_server_read_since(seq, client->tx_buf, sizeof(client->tx_buf), &lost);
+        if (lost > 0) {
+            stat_dropped.fetch_add(lost);
+        }
+        if (n == 0) {
+            client->pending_since_us = 0;
+            return true;
+        }
+        client->tx_len = (uint16_t)n;
+        client->tx_off = 0;
+        client->tx_timed = web_server_data_rx_time(*seq - (uint32_t)n, &client->tx_rx_us);
+        if (!send_staged(client)) {
+            return false;
+        }
+    }
+}
+
+/**
+ * Задача отправки данных UART клиентам
+ */
+static void tcp_forward_task(void *pvParameters)
+{
+    TickType_t wait = portMAX_DELAY;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, wait);
+        wait = portMAX_DELAY;
+
+        int64_t now_us = esp_timer_get_time();
+        uint32_t batch_version = batch_config_version();
+        uint32_t wait_us = UINT32_MAX;
+
+        xSemaphoreTake(clients_lock, portMAX_DELAY);
+        for (int i = 0; i < TCP_SERIAL_MAX_CLIENTS; i++) {
+            tcp_client_t *client = &clients[i];
+            if (client->sock < 0) {
+                continue;
+            }
+            if (client->batch_version != batch_version) {
+                client->batch_version = batch_version;
+                batch_apply_socket(FANOUT_TRANSPORT_TCP, client->sock);
+            }
+            if (!flush_replies(client) || !forward_data(client, now_us, &wait_us)) {
+                wait = pdMS_TO_TICKS(TCP_SERIAL_RETRY_MS);
+            }
+        }
+        xSemaphoreGive(clients_lock);
+
+        if (wait_us != UINT32_MAX) {
+            // Отложенная политикой пакетирования отправка
+            TickType_t batch_ticks = pdMS_TO_TICKS((wait_us + 999) / 1000);
+            if (batch_ticks == 0) {
+                batch_ticks = 1;
+            }
+            if (batch_ticks < wait) {
+                wait = batch_ticks;
+            }
+        }
+    }
+}
+
+bool tcp_server_start(void)
+{
+    if (TCP_SERIAL_RAW_PORT == 0 && TCP_SERIAL_RFC2217_PORT == 0) {
+        return true;
+    }
+
+    clients_lock = xSemaphoreCreateMutex();
+    if (clients_lock == NULL) {
+        return false;
+    }
+    for (int i = 0; i < TCP_SERIAL_MAX_CLIENTS; i++) {
+        clients[i].sock = -1;
+    }
+    fanout_init();
+    batch_init();
+    metrics_register_histogram(&delivery, "comtoair_uart_to_client_seconds",
+                               "Time from UART receive to delivery to a client",
+                               "transport=\"tcp\"");
+
+    TaskHandle_t listener_task = NULL;
+    if (xTaskCreate(tcp_forward_task, "tcp_forward", TASK_STACK_TCP_FORWARD, NULL,
+                    TASK_PRIO_TCP_FORWARD, &forward_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create forward task");
+        return false;
+    }
+    if (xTaskCreate(tcp_serial_task, "tcp_serial", TASK_STACK_TCP_SERIAL, NULL,
+                    TASK_PRIO_TCP_SERIAL, &listener_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create listener task");
+        return false;
+    }
+    metrics_watch_task(forward_task);
+    metrics_watch_task(listener_task);
+    return true;
+}
+
+void tcp_server_notify(void)
+{
+    if (stat_clients.load(std::memory_order_relaxed) > 0 && forward_task != NULL) {
+        xTaskNotifyGive(forward_task);
+    }
+}
+
+void tcp_server_get_stats(tcp_server_stats_t *stats)
+{
+    stats->clients = stat_clients.load();
+    stats->accepted = stat_accepted.load();
+    stats->rejected = stat_rejected.load();
+    stats->tx_bytes = stat_tx_bytes.load();
+    stats->rx_bytes = stat_rx_bytes.load();
+    stats->dropped = stat_dropped.load();
+}
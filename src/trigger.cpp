@@ -0,0 +1,459 @@
+/**
+ * @file trigger.cpp
+ * @brief Триггеры: автомат Ахо-Корасик над потоком порта, события
+ *
+ * Таблицы автомата две: задача приема берет активную, увеличив ее
+ * счетчик занятости (и перепроверив, что она все еще активна), HTTP
+ * обработчик компилирует новую конфигурацию в другую таблицу, дождавшись,
+ * пока ее не использует ни одна задача приема, и затем делает ее активной.
+ *
+ * Кольцо событий защищено коротким спинлоком: события создают задачи
+ * приема разных портов, копии забирают HTTP обработчики и sse_stream.
+ * Контекст читается из буфера порта вне спинлока.
+ */
+
+#include "trigger.h"
+#include "trigger_store.h"
+#include "serial_port.h"
+#include "metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+static const char *TAG = "Trigger";
+
+static_assert(TRIGGER_MAX_PATTERNS <= 8, "Match mask is 8 bits");
+static_assert(TRIGGER_MAX_STATES <= 255, "Automaton states are uint8_t");
+static_assert(TRIGGER_MAX_CLASSES <= 256, "At most 256 byte classes");
+
+/**
+ * Автомат: переходы определены для всех состояний и классов (DFA), out -
+ * маска образцов, заканчивающихся в состоянии (с учетом суффиксов)
+ */
+typedef struct {
+    uint8_t cls[256];                                       // Класс байта
+    uint8_t next[TRIGGER_MAX_STATES][TRIGGER_MAX_CLASSES];
+    uint8_t out[TRIGGER_MAX_STATES];
+    uint8_t port_mask[SERIAL_PORT_COUNT];                   // Образцы, действующие на порту
+    uint32_t generation;
+    uint8_t states;
+    uint8_t classes;
+} trigger_table_t;
+
+static trigger_table_t tables[2];
+static std::atomic<int> active_table(-1);
+static std::atomic<uint32_t> table_busy[2];
+static uint32_t table_generation = 0;
+
+// Очередь обхода и переходы по неудаче (только компиляция)
+static uint8_t fail_link[TRIGGER_MAX_STATES];
+static uint8_t bfs_queue[TRIGGER_MAX_STATES];
+
+static trigger_config_t current;
+static portMUX_TYPE config_lock = portMUX_INITIALIZER_UNLOCKED;
+
+typedef struct {
+    metric_t matches;
+    std::atomic<uint32_t> events;
+    std::atomic<uint32_t> last_seq;
+    std::atomic<uint32_t> last_ms;
+    std::atomic<uint32_t> last_event_ms;
+    char labels[16];                    // trigger="N"
+} trigger_counter_t;
+
+static trigger_counter_t counters[TRIGGER_MAX_PATTERNS];
+
+/**
+ * Состояние порта (только задача приема порта)
+ */
+typedef struct {
+    uint32_t generation;                // Таблица, к которой относится state
+    uint8_t state;
+    uint8_t pending;                    // Событий порта с неполным контекстом
+    uint8_t scratch[TRIGGER_CONTEXT_BEFORE > TRIGGER_CONTEXT_AFTER ?
+                    TRIGGER_CONTEXT_BEFORE : TRIGGER_CONTEXT_AFTER];
+} trigger_port_t;
+
+static trigger_port_t ports[SERIAL_PORT_COUNT];
+
+static trigger_event_t events[TRIGGER_EVENTS];
+static uint32_t next_event_id = 0;      // Под events_lock
+static std::atomic<uint32_t> event_head(0);
+static portMUX_TYPE events_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * Сборка автомата
+ *
+ * @return false если образцы не помещаются в таблицу
+ */
+static bool compile(const trigger_config_t *config, trigger_table_t *t, const char **error)
+{
+    memset(t->cls, 0, sizeof(t->cls));
+    memset(t->next, 0, sizeof(t->next));
+    memset(t->out, 0, sizeof(t->out));
+    memset(t->port_mask, 0, sizeof(t->port_mask));
+    t->classes = 1;
+    t->states = 1;
+
+    for (int k = 0; k < TRIGGER_MAX_PATTERNS; k++) {
+        const trigger_def_t *def = &config->defs[k];
+        for (int i = 0; i < def->length; i++) {
+            uint8_t b = def->pattern[i];
+            if (t->cls[b] != 0) {
+                continue;
+            }
+            if (t->classes == TRIGGER_MAX_CLASSES) {
+                *error = "Too many distinct bytes in patterns (TRIGGER_MAX_CLASSES)";
+                return false;
+            }
+            t->cls[b] = t->classes++;
+        }
+    }
+
+    // Бор: 0 в next означает "перехода нет" (в корень переходов нет)
+    for (int k = 0; k < TRIGGER_MAX_PATTERNS; k++) {
+        const trigger_def_t *def = &config->defs[k];
+        if (def->length == 0) {
+            continue;
+        }
+        uint8_t s = 0;
+        for (int i = 0; i < def->length; i++) {
+            uint8_t c = t->cls[def->pattern[i]];
+            if (t->next[s][c] == 0) {
+                if (t->states == TRIGGER_MAX_STATES) {
+                    *error = "Patterns too long in total (TRIGGER_MAX_STATES)";
+                    return false;
+                }
+                t->next[s][c] = t->states++;
+            }
+            s = t->next[s][c];
+        }
+        t->out[s] |= (uint8_t)(1u << k);
+        for (int p = 0; p < SERIAL_PORT_COUNT; p++) {
+            if (def->port == TRIGGER_ANY_PORT || def->port == p) {
+                t->port_mask[p] |= (uint8_t)(1u << k);
+            }
+        }
+    }
+
+    // Обход в ширину: переходы по неудаче и достройка переходов до DFA
+    size_t head = 0;
+    size_t tail = 0;
+    for (int c = 0; c < t->classes; c++) {
+        uint8_t u = t->next[0][c];
+        if (u != 0) {
+            fail_link[u] = 0;
+            bfs_queue[tail++] = u;
+        }
+    }
+    while (head < tail) {
+        uint8_t s = bfs_queue[head++];
+        for (int c = 0; c < t->classes; c++) {
+            uint8_t u = t->next[s][c];
+            uint8_t f = t->next[fail_link[s]][c];
+            if (u != 0) {
+                fail_link[u] = f;
+                t->out[u] |= t->out[f];
+                bfs_queue[tail++] = u;
+            } else {
+                t->next[s][c] = f;
+            }
+        }
+    }
+    return true;
+}
+
+static int table_acquire(void)
+{
+    for (;;) {
+        int index = active_table.load();
+        if (index < 0) {
+            return -1;
+        }
+        table_busy[index].fetch_add(1);
+        if (active_table.load() == index) {
+            return index;
+        }
+        table_busy[index].fetch_sub(1);
+    }
+}
+
+static inline void table_release(int index)
+{
+    table_busy[index].fetch_sub(1);
+}
+
+static bool config_valid(const trigger_config_t *config, const char **error)
+{
+    for (int k = 0; k < TRIGGER_MAX_PATTERNS; k++) {
+        const trigger_def_t *def = &config->defs[k];
+        if (def->length > TRIGGER_PATTERN_MAX ||
+            memchr(def->name, '\0', sizeof(def->name)) == NULL ||
+            (def->port != TRIGGER_ANY_PORT && (def->port < 0 || def->port >= SERIAL_PORT_COUNT))) {
+            *error = "Invalid pattern definition";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool trigger_set_config(const trigger_config_t *config, bool persist, const char **error)
+{
+    const char *reason = NULL;
+    if (!config_valid(config, &reason)) {
+        if (error != NULL) {
+            *error = reason;
+        }
+        return false;
+    }
+
+    int active = active_table.load();
+    int index = active < 0 ? 0 : 1 - active;
+    // Таблицу могла взять задача приема до прошлого переключения
+    while (table_busy[index].load() != 0) {
+        vTaskDelay(1);
+    }
+    trigger_table_t *t = &tables[index];
+    if (!compile(config, t, &reason)) {
+        if (error != NULL) {
+            *error = reason;
+        }
+        return false;
+    }
+    t->generation = ++table_generation;
+
+    trigger_config_t previous;
+    portENTER_CRITICAL(&config_lock);
+    previous = current;
+    current = *config;
+    portEXIT_CRITICAL(&config_lock);
+    active_table.store(index);
+
+    // Счетчики измененных образцов - с нуля
+    for (int k = 0; k < TRIGGER_MAX_PATTERNS; k++) {
+        if (memcmp(&previous.defs[k], &config->defs[k], sizeof(trigger_def_t)) != 0) {
+            trigger_counter_t *tc = &counters[k];
+            metric_set(&tc->matches, 0);
+            tc->events.store(0);
+            tc->last_seq.store(0);
+            tc->last_ms.store(0);
+        }
+    }
+
+    ESP_LOGI(TAG, "Compiled: %u states, %u byte classes", t->states, t->classes);
+    if (persist && !trigger_store_save(config)) {
+        if (error != NULL) {
+            *error = "Applied, but not saved to NVS";
+        }
+    }
+    return true;
+}
+
+void trigger_init(void)
+{
+    for (int k = 0; k < TRIGGER_MAX_PATTERNS; k++) {
+        trigger_counter_t *tc = &counters[k];
+        snprintf(tc->labels, sizeof(tc->labels), "trigger=\"%d\"", k);
+        metrics_register(&tc->matches, METRIC_COUNTER, "comtoair_trigger_matches_total",
+                         "Pattern matches on the serial stream", tc->labels);
+    }
+
+    trigger_config_t config;
+    memset(&config, 0, sizeof(config));
+    if (!trigger_store_load(&config)) {
+        memset(&config, 0, sizeof(config));
+    }
+    const char *error = NULL;
+    if (!trigger_set_config(&config, false, &error)) {
+        ESP_LOGE(TAG, "Stored triggers rejected: %s", error);
+        memset(&config, 0, sizeof(config));
+        trigger_set_config(&config, false, NULL);
+    }
+}
+
+void trigger_get_config(trigger_config_t *config)
+{
+    portENTER_CRITICAL(&config_lock);
+    *config = current;
+    portEXIT_CRITICAL(&config_lock);
+}
+
+void trigger_get_usage(uint32_t *states, uint32_t *classes)
+{
+    int index = active_table.load();
+    *states = index < 0 ? 0 : tables[index].states;
+    *classes = index < 0 ? 0 : tables[index].classes;
+}
+
+void trigger_get_stats(int index, trigger_stats_t *stats)
+{
+    const trigger_counter_t *tc = &counters[index];
+    stats->matches = metric_get(&tc->matches);
+    stats->events = tc->events.load(std::memory_order_relaxed);
+    stats->last_seq = tc->last_seq.load(std::memory_order_relaxed);
+    stats->last_ms = tc->last_ms.load(std::memory_order_relaxed);
+}
+
+static inline bool event_live(const trigger_event_t *event, uint32_t head)
+{
+    return head - event->id <= TRIGGER_EVENTS && event->id != head;
+}
+
+/**
+ * Событие с контекстом до конца совпадения
+ */
+static void record_event(trigger_port_t *tp, int port, int trigger, uint32_t seq,
+                         uint32_t now_ms)
+{
+    uint32_t cursor = seq - TRIGGER_CONTEXT_BEFORE;
+    size_t n = serial_port_read_since(port, &cursor, tp->scratch, TRIGGER_CONTEXT_BEFORE, NULL);
+    // В начале потока курсор переходит на самый старый байт - лишнее после seq отбрасывается
+    if ((int32_t)(cursor - seq) > 0) {
+        uint32_t extra = cursor - seq;
+        n = extra < n ? n - extra : 0;
+    }
+
+    portENTER_CRITICAL(&events_lock);
+    uint32_t id = next_event_id++;
+    trigger_event_t *event = &events[id % TRIGGER_EVENTS];
+    event->id = id;
+    event->trigger = (uint8_t)trigger;
+    event->port = (uint8_t)port;
+    event->seq = seq;
+    event->time_ms = now_ms;
+    event->before = (uint16_t)n;
+    event->after = 0;
+    event->complete = false;
+    memcpy(event->context, tp->scratch, n);
+    event_head.store(id + 1, std::memory_order_release);
+    portEXIT_CRITICAL(&events_lock);
+    tp->pending++;
+}
+
+/**
+ * Дописывание контекста после совпадения в неполные события порта
+ */
+static void fill_pending(trigger_port_t *tp, int port, uint32_t end_seq)
+{
+    uint8_t pending = 0;
+    for (int i = 0; i < TRIGGER_EVENTS; i++) {
+        trigger_event_t *event = &events[i];
+        portENTER_CRITICAL(&events_lock);
+        uint32_t head = event_head.load(std::memory_order_relaxed);
+        bool ours = event_live(event, head) && event->port == port && !event->complete;
+        uint32_t id = event->id;
+        uint32_t from = event->seq + event->after;
+        uint32_t need = TRIGGER_CONTEXT_AFTER - event->after;
+        portEXIT_CRITICAL(&events_lock);
+        if (!ours) {
+            continue;
+        }
+
+        uint32_t available = end_seq - from;
+        uint32_t want = available < need ? available : need;
+        uint32_t lost = 0;
+        size_t n = 0;
+        if (want > 0) {
+            n = serial_port_read_since(port, &from, tp->scratch, want, &lost);
+        }
+
+        portENTER_CRITICAL(&events_lock);
+        if (event->id == id && event_live(event, event_head.load(std::memory_order_relaxed))) {
+            if (lost != 0) {
+                event->complete = true;     // Продолжение перезаписано - контекст не дописать
+            } else {
+                memcpy(event->context + event->before + event->after, tp->scratch, n);
+                event->after = (uint16_t)(event->after + n);
+                event->complete = event->after == TRIGGER_CONTEXT_AFTER;
+            }
+            if (!event->complete) {
+                pending++;
+            }
+        }
+        portEXIT_CRITICAL(&events_lock);
+    }
+    tp->pending = pending;
+}
+
+/**
+ * Совпадение образцов из маски hit; true если создано событие
+ */
+static bool on_match(trigger_port_t *tp, int port, uint8_t hit, uint32_t seq, uint32_t now_ms)
+{
+    bool created = false;
+    for (int k = 0; hit != 0; k++, hit >>= 1) {
+        if (!(hit & 1)) {
+            continue;
+        }
+        trigger_counter_t *tc = &counters[k];
+        metric_add(&tc->matches, 1);
+        tc->last_seq.store(seq, std::memory_order_relaxed);
+        tc->last_ms.store(now_ms, std::memory_order_relaxed);
+        uint32_t last = tc->last_event_ms.load(std::memory_order_relaxed);
+        if (tc->events.load(std::memory_order_relaxed) != 0 &&
+            now_ms - last < TRIGGER_HOLDOFF_MS) {
+            continue;
+        }
+        tc->last_event_ms.store(now_ms, std::memory_order_relaxed);
+        tc->events.fetch_add(1, std::memory_order_relaxed);
+        record_event(tp, port, k, seq, now_ms);
+        created = true;
+    }
+    return created;
+}
+
+bool trigger_feed(int port, const uint8_t *data, size_t length, uint32_t end_seq,
+                  uint64_t now_us)
+{
+    trigger_port_t *tp = &ports[port];
+    bool created = false;
+    int index = table_acquire();
+    if (index >= 0) {
+        const trigger_table_t *t = &tables[index];
+        if (tp->generation != t->generation) {
+            tp->generation = t->generation;
+            tp->state = 0;
+        }
+        uint8_t mask = t->port_mask[port];
+        if (mask != 0) {
+            uint32_t now_ms = (uint32_t)(now_us / 1000);
+            uint32_t start_seq = end_seq - (uint32_t)length;
+            uint8_t s = tp->state;
+            for (size_t i = 0; i < length; i++) {
+                s = t->next[s][t->cls[data[i]]];
+                uint8_t hit = t->out[s] & mask;
+                if (hit != 0) {
+                    created |= on_match(tp, port, hit, start_seq + (uint32_t)i + 1, now_ms);
+                }
+            }
+            tp->state = s;
+        }
+        table_release(index);
+    }
+    if (tp->pending != 0) {
+        fill_pending(tp, port, end_seq);
+    }
+    return created;
+}
+
+uint32_t trigger_event_head(void)
+{
+    return event_head.load(std::memory_order_acquire);
+}
+
+bool trigger_get_event(uint32_t id, trigger_event_t *event)
+{
+    bool found = false;
+    portENTER_CRITICAL(&events_lock);
+    const trigger_event_t *slot = &events[id % TRIGGER_EVENTS];
+    if (slot->id == id && event_live(slot, event_head.load(std::memory_order_relaxed))) {
+        *event = *slot;
+        found = true;
+    }
+    portEXIT_CRITICAL(&events_lock);
+    return found;
+}
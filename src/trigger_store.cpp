@@ -0,0 +1,45 @@
+/**
+ * @file trigger_store.cpp
+ * @brief Набор образцов триггеров в NVS
+ */
+
+#include "trigger_store.h"
+
+#include "nvs.h"
+#include "esp_log.h"
+
+static const char *TAG = "TriggerStore";
+
+bool trigger_store_load(trigger_config_t *config)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(TRIGGER_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return false;
+    }
+    size_t length = sizeof(*config);
+    esp_err_t ret = nvs_get_blob(nvs, "config", config, &length);
+    nvs_close(nvs);
+    if (ret == ESP_OK && length != sizeof(*config)) {
+        ESP_LOGW(TAG, "Stored triggers have a different layout, ignored");
+        return false;
+    }
+    return ret == ESP_OK;
+}
+
+bool trigger_store_save(const trigger_config_t *config)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(TRIGGER_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(nvs, "config", config, sizeof(*config));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save triggers to NVS: %s", esp_err_to_name(ret));
+        return false;
+    }
+    return true;
+}
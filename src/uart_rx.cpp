@@ -0,0 +1,311 @@
+/**
+ * @file uart_rx.cpp
+ * @brief Событийный приемный тракт UART
+ *
+ * Вместо опроса uart_get_buffered_data_len() каждые 20 мс задача ждет
+ * события драйвера с бесконечным таймаутом. Драйвер выдает UART_DATA,
+ * когда в FIFO набралось UART_RX_FULL_THRESH байт или линия молчит
+ * UART_RX_TIMEOUT_SYMBOLS символов, поэтому задержка от байта до буфера
+ * ограничена временем приема порога FIFO, а в простое задача не просыпается.
+ *
+ * Без очереди событий (прием через UHCI/GDMA, RS232_USE_UHCI_DMA, или
+ * имитация порта в сборке под Linux) задача блокируется в rs232_read()
+ * до появления очередной порции.
+ *
+ * Паузу на линии (конец кадра в режиме FRAMER_IDLE) сообщает сам драйвер:
+ * UART_DATA с timeout_flag (аппаратный таймаут приема) или UART_PATTERN_DET.
+ * Без очереди событий, пока кадр не завершен, чтение идет с таймаутом
+ * в UART_RX_TIMEOUT_SYMBOLS символов (не меньше 1 мс).
+ *
+ * Задача приема не форматирует строк: события пишутся в отложенный
+ * журнал (dlog) и выводятся задачей журнала с низким приоритетом.
+ *
+ * Дрожание приема: при непрерывном потоке события по порогу FIFO идут
+ * строго через event.size символов, поэтому отклонение интервала между
+ * пробуждениями задачи от этого времени - задержка планирования задачи
+ * приема (comtoair_uart_rx_jitter_seconds, /api/tasks).
+ */
+
+#include "uart_rx.h"
+#include "config.h"
+#include "web_server.h"
+#include "rs232_handler.h"
+#include "dlog.h"
+#include "metrics.h"
+
+#include <atomic>
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "UartRx";
+
+// Счетчики пишет только задача приема, читают HTTP обработчики и /api/metrics
+typedef struct {
+    metric_t rx_bytes;
+    metric_t data_events;
+    metric_t timeout_events;
+    metric_t fifo_overflows;
+    metric_t buffer_full;
+    metric_t breaks;
+    metric_t frame_errors;
+    metric_t parity_errors;
+    metric_t pattern_events;
+} uart_rx_counters_t;
+
+static uart_rx_counters_t counters;
+static metric_histogram_t rx_jitter;
+static std::atomic<uint32_t> jitter_samples{0};
+static std::atomic<uint32_t> jitter_sum_us{0};
+static std::atomic<uint32_t> jitter_max_us{0};
+
+// Время предыдущего пробуждения по порогу FIFO (0 - после паузы в линии)
+static int64_t last_full_us = 0;
+
+static uart_port_t rx_port = UART_NUM;
+static QueueHandle_t rx_queue = NULL;
+
+// Буфер для очередной порции данных (используется только задачей приема)
+static uint8_t rx_chunk[UART_BUF_SIZE];
+
+static inline uint32_t count(metric_t &counter, uint32_t value = 1)
+{
+    return metric_add(&counter, value);
+}
+
+static void register_metrics(void)
+{
+    metrics_register(&counters.rx_bytes, METRIC_COUNTER, "comtoair_uart_rx_bytes_total",
+                     "Bytes received from the serial line", NULL);
+    metrics_register(&counters.data_events, METRIC_COUNTER, "comtoair_uart_rx_events_total",
+                     "UART receive wakeups", "type=\"data\"");
+    metrics_register(&counters.timeout_events, METRIC_COUNTER, "comtoair_uart_rx_events_total",
+                     "UART receive wakeups", "type=\"timeout\"");
+    metrics_register(&counters.pattern_events, METRIC_COUNTER, "comtoair_uart_rx_events_total",
+                     "UART receive wakeups", "type=\"pattern\"");
+    metrics_register(&counters.fifo_overflows, METRIC_COUNTER, "comtoair_uart_errors_total",
+                     "UART receive errors", "type=\"fifo_overflow\"");
+    metrics_register(&counters.buffer_full, METRIC_COUNTER, "comtoair_uart_errors_total",
+                     "UART receive errors", "type=\"buffer_full\"");
+    metrics_register(&counters.frame_errors, METRIC_COUNTER, "comtoair_uart_errors_total",
+                     "UART receive errors", "type=\"frame\"");
+    metrics_register(&counters.parity_errors, METRIC_COUNTER, "comtoair_uart_errors_total",
+                     "UART receive errors", "type=\"parity\"");
+    metrics_register(&counters.breaks, METRIC_COUNTER, "comtoair_uart_errors_total",
+                     "UART receive errors", "type=\"break\"");
+    metrics_register_histogram(&rx_jitter, "comtoair_uart_rx_jitter_seconds",
+                               "Deviation of receive wakeups from the line rate during "
+                               "continuous reception", NULL);
+}
+
+/**
+ * Длительность символа на линии при текущих параметрах, нс
+ */
+static uint32_t symbol_ns(void)
+{
+    rs232_config_t config;
+    rs232_get_config(&config);
+    if (config.baud_rate == 0) {
+        return 0;
+    }
+    uint32_t symbol_bits = 1 + rs232_data_bits_count(config.data_bits) +
+                           (config.parity != UART_PARITY_DISABLE ? 1 : 0) +
+                           (rs232_stop_bits_x2(config.stop_bits) + 1) / 2;
+    return (uint32_t)((uint64_t)symbol_bits * 1000000000ULL / config.baud_rate);
+}
+
+/**
+ * Учет отклонения пробуждения по порогу FIFO от скорости линии
+ */
+static void track_jitter(const uart_event_t &event)
+{
+    int64_t now = esp_timer_get_time();
+    if (event.timeout_flag) {
+        last_full_us = 0;
+        return;
+    }
+    if (last_full_us != 0 && event.size >= UART_RX_FULL_THRESH) {
+        int64_t expected = (int64_t)event.size * symbol_ns() / 1000;
+        int64_t deviation = now - last_full_us - expected;
+        uint32_t value = (uint32_t)(deviation < 0 ? -deviation : deviation);
+        metric_observe_us(&rx_jitter, value);
+        jitter_samples.fetch_add(1, std::memory_order_relaxed);
+        jitter_sum_us.fetch_add(value, std::memory_order_relaxed);
+        if (value > jitter_max_us.load(std::memory_order_relaxed)) {
+            jitter_max_us.store(value, std::memory_order_relaxed);
+        }
+    }
+    last_full_us = now;
+}
+
+/**
+ * Перенос всех накопленных драйвером байт в буфер моста без ожидания
+ */
+static void drain_rx(void)
+{
+    int len;
+    while ((len = uart_read_bytes(rx_port, rx_chunk, sizeof(rx_chunk), 0)) > 0) {
+        web_server_set_data(rx_chunk, len);
+        count(counters.rx_bytes, (uint32_t)len);
+        dlog_write(DLOG_RX_CHUNK, (uint32_t)len, 0);
+    }
+}
+
+/**
+ * Задача для чтения данных из UART по событиям драйвера
+ */
+static void uart_rx_task(void *pvParameters)
+{
+    uart_event_t event;
+    ESP_LOGI(TAG, "UART RX task started (event driven)");
+
+    while (1) {
+        if (xQueueReceive(rx_queue, &event, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        switch (event.type) {
+        case UART_DATA:
+            count(counters.data_events);
+            track_jitter(event);
+            drain_rx();
+            if (event.timeout_flag) {
+                count(counters.timeout_events);
+                web_server_data_idle();
+            }
+            break;
+
+        case UART_FIFO_OVF:
+            last_full_us = 0;
+            // Драйвер уже сбросил FIFO; то, что успело попасть в кольцевой
+            // буфер драйвера, остается корректным и забирается целиком
+            dlog_write(DLOG_RX_FIFO_OVF, count(counters.fifo_overflows), 0);
+            drain_rx();
+            break;
+
+        case UART_BUFFER_FULL:
+            dlog_write(DLOG_RX_BUFFER_FULL, count(counters.buffer_full), 0);
+            drain_rx();
+            break;
+
+        case UART_BREAK:
+            dlog_write(DLOG_RX_BREAK, count(counters.breaks), 0);
+            break;
+
+        case UART_FRAME_ERR:
+            dlog_write(DLOG_RX_FRAME_ERR, count(counters.frame_errors), 0);
+            break;
+
+        case UART_PARITY_ERR:
+            dlog_write(DLOG_RX_PARITY_ERR, count(counters.parity_errors), 0);
+            break;
+
+        case UART_PATTERN_DET:
+            count(counters.pattern_events);
+            // Позиции шаблона пока не используются - освобождаем очередь позиций
+            while (uart_pattern_pop_pos(rx_port) >= 0) {
+            }
+            drain_rx();
+            web_server_data_idle();
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * Длительность паузы конца кадра при чтении без событий драйвера, мс
+ */
+static uint32_t idle_timeout_ms(void)
+{
+    uint32_t ms = (UART_RX_TIMEOUT_SYMBOLS * symbol_ns() + 999999) / 1000000;
+    return ms > 0 ? ms : 1;
+}
+
+/**
+ * Задача для чтения данных без очереди событий (UHCI/GDMA или имитация)
+ */
+static void uart_rx_blocking_task(void *pvParameters)
+{
+    ESP_LOGI(TAG, "UART RX task started (blocking read%s)",
+             rs232_dma_enabled() ? ", UHCI/GDMA" : "");
+
+    while (1) {
+        bool framing = web_server_framing_pending();
+        int len = rs232_read(rx_chunk, sizeof(rx_chunk),
+                             framing ? idle_timeout_ms() : RS232_WAIT_FOREVER);
+        if (len <= 0) {
+            if (framing) {
+                count(counters.timeout_events);
+                web_server_data_idle();
+            }
+            continue;
+        }
+        count(counters.data_events);
+        web_server_set_data(rx_chunk, len);
+        count(counters.rx_bytes, (uint32_t)len);
+        dlog_write(DLOG_RX_CHUNK, (uint32_t)len, 0);
+    }
+}
+
+bool uart_rx_configure(uart_port_t port)
+{
+    esp_err_t ret = uart_set_rx_full_threshold(port, UART_RX_FULL_THRESH);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "uart_set_rx_full_threshold failed: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    ret = uart_set_rx_timeout(port, UART_RX_TIMEOUT_SYMBOLS);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "uart_set_rx_timeout failed: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+#ifdef UART_RX_PATTERN_CHR
+    uart_enable_pattern_det_baud_intr(port, UART_RX_PATTERN_CHR, 1, 9, 0, 0);
+    uart_pattern_queue_reset(port, UART_EVENT_QUEUE_LEN);
+#endif
+
+    ESP_LOGI(TAG, "RX thresholds: full=%d bytes, timeout=%d symbols",
+             UART_RX_FULL_THRESH, UART_RX_TIMEOUT_SYMBOLS);
+    return true;
+}
+
+bool uart_rx_start(uart_port_t port, QueueHandle_t event_queue)
+{
+    TaskHandle_t task = NULL;
+    rx_port = port;
+    rx_queue = event_queue;
+    register_metrics();
+
+    if (xTaskCreate(event_queue != NULL ? uart_rx_task : uart_rx_blocking_task,
+                    "uart_read_task", TASK_STACK_UART_RX, NULL, TASK_PRIO_UART_RX,
+                    &task) != pdPASS) {
+        return false;
+    }
+    metrics_watch_task(task);
+    return true;
+}
+
+void uart_rx_get_stats(uart_rx_stats_t *stats)
+{
+    stats->rx_bytes = metric_get(&counters.rx_bytes);
+    stats->data_events = metric_get(&counters.data_events);
+    stats->timeout_events = metric_get(&counters.timeout_events);
+    stats->fifo_overflows = metric_get(&counters.fifo_overflows);
+    stats->buffer_full = metric_get(&counters.buffer_full);
+    stats->breaks = metric_get(&counters.breaks);
+    stats->frame_errors = metric_get(&counters.frame_errors);
+    stats->parity_errors = metric_get(&counters.parity_errors);
+    stats->pattern_events = metric_get(&counters.pattern_events);
+    stats->jitter_samples = jitter_samples.load(std::memory_order_relaxed);
+    stats->jitter_sum_us = jitter_sum_us.load(std::memory_order_relaxed);
+}
+
+uint32_t uart_rx_take_jitter_max(void)
+{
+    return jitter_max_us.exchange(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,383 @@
+/**
+ * @file uart_tx.cpp
+ * @brief Очередь передачи в UART
+ *
+ * Слоты очереди статические (UART_TX_QUEUE_LEN по UART_TX_MAX_PAYLOAD
+ * байт). Свободные и занятые слоты считают два счетных семафора: писатель
+ * ждет свободного слота не дольше заданного (0 - отказ сразу, HTTP 429),
+ * задача передачи спит на занятых. Слоты заполняются по кругу под
+ * мьютексом, разбираются единственной задачей в том же порядке.
+ *
+ * Ожидание ответа: задача запоминает номер следующего принятого байта
+ * перед передачей и после нее ждет либо конца кадра (при выделении
+ * кадров), либо паузы UART_TX_RESPONSE_IDLE_MS после последнего
+ * принятого байта. Писатель буфера будит ее через uart_tx_notify(),
+ * только пока она ждет ответа.
+ */
+
+#include "uart_tx.h"
+#include "config.h"
+#include "rs232_handler.h"
+#include "web_server.h"
+#include "metrics.h"
+
+#include <string.h>
+#include <atomic>
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+
+static const char *TAG = "UartTx";
+
+static_assert((UART_TX_RESULTS & (UART_TX_RESULTS - 1)) == 0,
+              "UART_TX_RESULTS must be a power of two");
+static_assert(UART_TX_RESULTS >= UART_TX_QUEUE_LEN + 2,
+              "UART_TX_RESULTS must cover the queue");
+
+// Ожидание окончания передачи посылки (байт в буфере драйвера)
+#define UART_TX_DRAIN_TIMEOUT_MS    1000
+
+/**
+ * @brief Слот очереди
+ */
+typedef struct {
+    uint32_t id;
+    uint32_t length;
+    uart_tx_options_t options;
+    uart_tx_done_fn done;
+    void *ctx;
+    uint8_t data[UART_TX_MAX_PAYLOAD];
+} tx_slot_t;
+
+static tx_slot_t slots[UART_TX_QUEUE_LEN];
+static uint32_t slot_head = 0;          // Следующий слот писателя (под submit_lock)
+static uint32_t slot_tail = 0;          // Следующий слот задачи передачи
+static uint32_t next_id = 1;            // Под submit_lock
+static SemaphoreHandle_t submit_lock = NULL;
+static SemaphoreHandle_t free_slots = NULL;
+static SemaphoreHandle_t used_slots = NULL;
+static TaskHandle_t tx_task = NULL;
+static std::atomic<bool> awaiting_response(false);
+static std::atomic<uint32_t> depth(0);
+
+// Результаты последних посылок (по номеру посылки)
+static uart_tx_result_t results[UART_TX_RESULTS];
+static portMUX_TYPE results_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static metric_t submitted;
+static metric_t rejected;
+static metric_t tx_bytes;
+static metric_t timeouts;
+static metric_t queue_depth;
+static metric_histogram_t response_time;
+
+static const char *state_names[] = {
+    "queued", "sending", "waiting", "done", "timeout", "failed",
+};
+
+static void set_result(const uart_tx_result_t *result)
+{
+    portENTER_CRITICAL(&results_lock);
+    results[result->id & (UART_TX_RESULTS - 1)] = *result;
+    portEXIT_CRITICAL(&results_lock);
+}
+
+/**
+ * Время ожидания до момента deadline_us в тиках (не меньше одного)
+ */
+static TickType_t ticks_until(int64_t deadline_us, int64_t now_us)
+{
+    if (deadline_us <= now_us) {
+        return 0;
+    }
+    TickType_t ticks = pdMS_TO_TICKS((uint32_t)((deadline_us - now_us + 999) / 1000));
+    return ticks > 0 ? ticks : 1;
+}
+
+/**
+ * Пауза на линии: короткая - активным ожиданием, длинная - с отдачей процессора
+ */
+static void line_pause_us(uint32_t us)
+{
+    if (us <= UART_TX_SPIN_MAX_US) {
+        esp_rom_delay_us(us);
+        return;
+    }
+    TickType_t ticks = pdMS_TO_TICKS((us + 999) / 1000);
+    vTaskDelay(ticks > 0 ? ticks : 1);
+}
+
+/**
+ * Передача посылки; возвращает передано байт
+ */
+static uint32_t transmit(const tx_slot_t *slot)
+{
+    if (slot->options.char_gap_us == 0) {
+        int written = rs232_write(slot->data, slot->length);
+        return written > 0 ? (uint32_t)written : 0;
+    }
+
+    // Пауза отсчитывается от ухода байта из FIFO, а не от записи в драйвер
+    uint32_t sent = 0;
+    while (sent < slot->length) {
+        if (rs232_write(slot->data + sent, 1) != 1) {
+            break;
+        }
+        sent++;
+        rs232_wait_tx_done(UART_TX_DRAIN_TIMEOUT_MS);
+        if (sent < slot->length) {
+            line_pause_us(slot->options.char_gap_us);
+        }
+    }
+    return sent;
+}
+
+/**
+ * Ожидание ответа на посылку: байты с rx_seq до конца кадра или паузы
+ */
+static uart_tx_state_t wait_response(uint32_t rx_seq, uint32_t timeout_ms, uint32_t *rx_length)
+{
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    uint32_t seen = rx_seq;
+    int64_t last_rx_us = 0;
+    uart_tx_state_t state = UART_TX_TIMEOUT;
+
+    awaiting_response.store(true);
+    while (true) {
+        int64_t now_us = esp_timer_get_time();
+        uint32_t head = web_server_data_seq();
+        *rx_length = head - rx_seq;
+
+        if (web_server_framing_active()) {
+            uint32_t ready = web_server_data_ready(rx_seq);
+            if (ready > 0) {
+                *rx_length = ready;
+                state = UART_TX_DONE;
+                break;
+            }
+        } else {
+            if (head != seen) {
+                seen = head;
+                last_rx_us = now_us;
+            }
+            if (last_rx_us != 0 && now_us - last_rx_us >= UART_TX_RESPONSE_IDLE_MS * 1000) {
+                state = UART_TX_DONE;
+                break;
+            }
+        }
+        if (now_us >= deadline_us) {
+            break;
+        }
+
+        int64_t wake_us = deadline_us;
+        if (last_rx_us != 0 && last_rx_us + UART_TX_RESPONSE_IDLE_MS * 1000 < wake_us) {
+            wake_us = last_rx_us + UART_TX_RESPONSE_IDLE_MS * 1000;
+        }
+        ulTaskNotifyTake(pdTRUE, ticks_until(wake_us, now_us));
+    }
+    awaiting_response.store(false);
+    return state;
+}
+
+static void process(const tx_slot_t *slot)
+{
+    uart_tx_result_t result = {};
+    result.id = slot->id;
+    result.length = slot->length;
+    result.state = UART_TX_SENDING;
+    // Ответом считается все, что принято с начала передачи
+    result.rx_seq = web_server_data_seq();
+    set_result(&result);
+
+    int64_t start_us = esp_timer_get_time();
+    result.sent = transmit(slot);
+    metric_add(&tx_bytes, result.sent);
+    result.state = result.sent == slot->length ? UART_TX_DONE : UART_TX_FAILED;
+
+    if (result.state == UART_TX_DONE && slot->options.timeout_ms > 0) {
+        // Таймаут ответа - от ухода последнего байта
+        rs232_wait_tx_done(UART_TX_DRAIN_TIMEOUT_MS);
+        result.state = UART_TX_WAITING;
+        set_result(&result);
+        result.state = wait_response(result.rx_seq, slot->options.timeout_ms, &result.rx_length);
+        if (result.state == UART_TX_TIMEOUT) {
+            metric_add(&timeouts, 1);
+        } else {
+            metric_observe_us(&response_time, (uint32_t)(esp_timer_get_time() - start_us));
+        }
+    }
+    result.elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+    set_result(&result);
+    if (result.state == UART_TX_FAILED) {
+        ESP_LOGW(TAG, "Send %lu failed: %lu of %lu bytes", (unsigned long)result.id,
+                 (unsigned long)result.sent, (unsigned long)result.length);
+    }
+    if (slot->done != NULL) {
+        slot->done(slot->id, slot->ctx);
+    }
+
+    if (slot->options.frame_gap_ms > 0) {
+        rs232_wait_tx_done(UART_TX_DRAIN_TIMEOUT_MS);
+        line_pause_us(slot->options.frame_gap_ms * 1000);
+    }
+}
+
+/**
+ * Задача передачи: посылки по одной в порядке постановки
+ */
+static void uart_tx_task(void *pvParameters)
+{
+    while (1) {
+        xSemaphoreTake(used_slots, portMAX_DELAY);
+        process(&slots[slot_tail % UART_TX_QUEUE_LEN]);
+        slot_tail++;
+        metric_set(&queue_depth, depth.fetch_sub(1) - 1);
+        xSemaphoreGive(free_slots);
+    }
+}
+
+bool uart_tx_start(void)
+{
+    if (tx_task != NULL) {
+        return true;
+    }
+    submit_lock = xSemaphoreCreateMutex();
+    free_slots = xSemaphoreCreateCounting(UART_TX_QUEUE_LEN, UART_TX_QUEUE_LEN);
+    used_slots = xSemaphoreCreateCounting(UART_TX_QUEUE_LEN, 0);
+    if (submit_lock == NULL || free_slots == NULL || used_slots == NULL) {
+        return false;
+    }
+
+    metrics_register(&submitted, METRIC_COUNTER, "comtoair_uart_tx_requests_total",
+                     "Payloads submitted to the UART TX queue", "result=\"queued\"");
+    metrics_register(&rejected, METRIC_COUNTER, "comtoair_uart_tx_requests_total",
+                     "Payloads submitted to the UART TX queue", "result=\"rejected\"");
+    metrics_register(&tx_bytes, METRIC_COUNTER, "comtoair_uart_tx_bytes_total",
+                     "Bytes written to the serial line", NULL);
+    metrics_register(&timeouts, METRIC_COUNTER, "comtoair_uart_tx_response_timeouts_total",
+                     "Sends whose response did not complete in time", NULL);
+    metrics_register(&queue_depth, METRIC_GAUGE, "comtoair_uart_tx_queue_depth",
+                     "Payloads waiting in the UART TX queue", NULL);
+    metrics_register_histogram(&response_time, "comtoair_uart_tx_response_seconds",
+                               "Time from the start of a send to the end of its response", NULL);
+
+    // Выше задач рассылки: паузы между байтами должны быть точными
+    if (xTaskCreate(uart_tx_task, "uart_tx", TASK_STACK_UART_TX, NULL, TASK_PRIO_UART_TX,
+                    &tx_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create TX task");
+        tx_task = NULL;
+        return false;
+    }
+    metrics_watch_task(tx_task);
+    ESP_LOGI(TAG, "TX queue: %d x %d bytes", UART_TX_QUEUE_LEN, UART_TX_MAX_PAYLOAD);
+    return true;
+}
+
+esp_err_t uart_tx_submit(const uint8_t *data, size_t length, const uart_tx_options_t *options,
+                         TickType_t wait, uart_tx_done_fn done, void *ctx, uint32_t *id)
+{
+    if (tx_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (length == 0 || length > UART_TX_MAX_PAYLOAD) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (options != NULL && (options->char_gap_us > UART_TX_MAX_CHAR_GAP_US ||
+                            options->frame_gap_ms > UART_TX_MAX_FRAME_GAP_MS ||
+                            options->timeout_ms > UART_TX_MAX_TIMEOUT_MS)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (xSemaphoreTake(free_slots, wait) != pdTRUE) {
+        metric_add(&rejected, 1);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    xSemaphoreTake(submit_lock, portMAX_DELAY);
+    tx_slot_t *slot = &slots[slot_head % UART_TX_QUEUE_LEN];
+    slot->id = next_id++;
+    slot->length = (uint32_t)length;
+    if (options != NULL) {
+        slot->options = *options;
+    } else {
+        memset(&slot->options, 0, sizeof(slot->options));
+    }
+    slot->done = done;
+    slot->ctx = ctx;
+    memcpy(slot->data, data, length);
+
+    uart_tx_result_t result = {};
+    result.id = slot->id;
+    result.state = UART_TX_QUEUED;
+    result.length = slot->length;
+    set_result(&result);
+    if (id != NULL) {
+        *id = slot->id;
+    }
+    slot_head++;
+    xSemaphoreGive(submit_lock);
+
+    metric_add(&submitted, 1);
+    metric_set(&queue_depth, depth.fetch_add(1) + 1);
+    xSemaphoreGive(used_slots);
+    return ESP_OK;
+}
+
+size_t uart_tx_write(const uint8_t *data, size_t length, TickType_t wait)
+{
+    size_t queued = 0;
+    while (queued < length) {
+        size_t n = length - queued;
+        if (n > UART_TX_MAX_PAYLOAD) {
+            n = UART_TX_MAX_PAYLOAD;
+        }
+        if (uart_tx_submit(data + queued, n, NULL, wait, NULL, NULL, NULL) != ESP_OK) {
+            break;
+        }
+        queued += n;
+    }
+    return queued;
+}
+
+bool uart_tx_has_room(void)
+{
+    return depth.load() < UART_TX_QUEUE_LEN;
+}
+
+bool uart_tx_get_result(uint32_t id, uart_tx_result_t *result)
+{
+    portENTER_CRITICAL(&results_lock);
+    *result = results[id & (UART_TX_RESULTS - 1)];
+    portEXIT_CRITICAL(&results_lock);
+    return id != 0 && result->id == id;
+}
+
+bool uart_tx_finished(uart_tx_state_t state)
+{
+    return state == UART_TX_DONE || state == UART_TX_TIMEOUT || state == UART_TX_FAILED;
+}
+
+const char *uart_tx_state_name(uart_tx_state_t state)
+{
+    if ((size_t)state >= sizeof(state_names) / sizeof(state_names[0])) {
+        return "unknown";
+    }
+    return state_names[state];
+}
+
+void uart_tx_get_stats(uart_tx_stats_t *stats)
+{
+    stats->depth = depth.load();
+    stats->submitted = metric_get(&submitted);
+    stats->rejected = metric_get(&rejected);
+    stats->tx_bytes = metric_get(&tx_bytes);
+    stats->timeouts = metric_get(&timeouts);
+}
+
+void uart_tx_notify(void)
+{
+    if (awaiting_response.load(std::memory_order_relaxed) && tx_task != NULL) {
+        xTaskNotifyGive(tx_task);
+    }
+}
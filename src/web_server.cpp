@@ -0,0 +1,3246 @@
+/**
+ * @file web_server.cpp
+ * @brief Веб-сервер для доступа к данным RS-232
+ *
+ * Данные от задачи чтения UART складываются в кольцевой буфер без
+ * блокировок (byte_ring). HTTP обработчики читают его по порядковым
+ * номерам, поэтому клиент может продолжать чтение с места остановки.
+ *
+ * Запрос /api/data?wait= без новых данных не занимает задачу сервера:
+ * он передается задаче "http_wait" (асинхронный обработчик httpd) и
+ * ждет данных в слоте fanout, как потоковые клиенты.
+ *
+ * При включенном выделении кадров (framer.h, /api/framer) кольцевой буфер
+ * по-прежнему хранит поток как есть (TCP сервер прозрачен), а кадры со
+ * временем приема пишутся записями журнала. /api/data и WebSocket отдают
+ * данные только до конца последнего выделенного кадра.
+ */
+
+#include "web_server.h"
+#include "byte_ring.h"
+#include "config.h"
+#include "uart_rx.h"
+#include "ws_stream.h"
+#include "sse_stream.h"
+#include "tcp_server.h"
+#include "rs232_handler.h"
+#include "json_writer.h"
+#include "static_assets.h"
+#include "capture_journal.h"
+#include "flash_log.h"
+#include "dlog.h"
+#include "metrics.h"
+#include "fanout.h"
+#include "framer.h"
+#include "batch_policy.h"
+#include "capture_format.h"
+#include "uart_tx.h"
+#include "diagnostics.h"
+#include "wifi_manager.h"
+#include "boot.h"
+#include "serial_port.h"
+#include "decoder.h"
+#include "field_table.h"
+#include "trigger.h"
+#include "buffer_pool.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include "driver/uart.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "WebServer";
+
+// Порция чтения из буфера при формировании ответа /api/data
+#define API_DATA_READ_CHUNK 256
+
+// Кольцевой буфер принятых данных
+static_assert((DATA_BUFFER_SIZE & (DATA_BUFFER_SIZE - 1)) == 0,
+              "DATA_BUFFER_SIZE must be a power of two");
+static __NOINIT_ATTR uint8_t data_storage[DATA_BUFFER_SIZE];
+static byte_ring_t data_ring = BYTE_RING_STATIC_INIT(data_storage);
+
+#define DATA_CARRY_MAGIC    0x59525243u     // "CRRY"
+
+/**
+ * Границы буфера для восстановления после сброса (noinit). Каждую пару
+ * пишет одна задача: head и reserve - задача приема, persisted - задача
+ * записи во флеш; проверочное значение (~) отсекает мусор и оборванную
+ * запись. reserve - конец порции, которая копируется в буфер (как reserve
+ * byte_ring): сброс посреди копирования оставляет испорченными байты до
+ * reserve - DATA_BUFFER_SIZE.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t oldest;                // Самый старый байт после восстановления
+    uint32_t oldest_check;
+    uint32_t head;
+    uint32_t head_check;
+    uint32_t persisted;             // Байты до этого номера записаны во флеш
+    uint32_t persisted_check;
+    uint32_t reserve;               // Конец порции, которая записывается сейчас
+    uint32_t reserve_check;
+} data_carry_t;
+
+static __NOINIT_ATTR data_carry_t data_carry;
+
+static httpd_handle_t server = NULL;
+
+/**
+ * Время приема последних порций (seqlock, как заголовки capture_journal).
+ * Байт seq принят с первой порцией, у которой end_seq больше seq.
+ */
+typedef struct {
+    std::atomic<uint32_t> index;        // Номер порции в слоте
+    std::atomic<uint32_t> end_seq;      // Номер байта после порции
+    std::atomic<uint32_t> time_us;      // Время приема (младшие 32 бита esp_timer)
+} rx_time_slot_t;
+
+static rx_time_slot_t rx_times[DATA_RX_TIME_SLOTS];
+static std::atomic<uint32_t> rx_time_head(0);
+
+// Метрики /api/data: задержка от приема до ответа и потери опрашивающих клиентов
+static metric_histogram_t http_delivery;
+static metric_t http_dropped;
+
+/**
+ * Представление данных в ответе /api/data
+ */
+typedef enum {
+    DATA_ENCODING_STRING = 0,       // JSON, поле data - строка
+    DATA_ENCODING_BASE64,           // JSON, поле data - base64
+    DATA_ENCODING_BINARY,           // application/octet-stream (capture_format.h)
+} data_encoding_t;
+
+/**
+ * Запрос /api/data?wait=, ожидающий данных. Индекс - номер слота fanout.
+ */
+typedef struct {
+    httpd_req_t *req;               // Копия запроса (async handler), NULL - свободен
+    fanout_client_t *cursor;        // Курсор запроса
+    uint32_t max_len;
+    data_encoding_t encoding;
+    int64_t deadline_us;            // Ответить без данных в этот момент
+    int64_t ready_since_us;         // Время появления данных, 0 - данных нет
+    fanout_verdict_t verdict;       // Решение проверки, по которому отвечает задача
+    uint32_t skipped;
+} data_waiter_t;
+
+static data_waiter_t data_waiters[API_DATA_MAX_WAITERS];
+static SemaphoreHandle_t waiters_lock = NULL;
+static std::atomic<int> waiter_count(0);
+static TaskHandle_t wait_task = NULL;
+
+/**
+ * Запрос POST /api/send?timeout=, ждущий ответа устройства
+ */
+typedef struct {
+    httpd_req_t *req;               // Копия запроса (async handler), NULL - свободен
+    uint32_t id;                    // Номер посылки
+    bool base64;
+    int64_t deadline_us;            // Ответить с текущим состоянием в этот момент
+} send_waiter_t;
+
+static send_waiter_t send_waiters[API_SEND_MAX_WAITERS];
+
+// Тело POST /api/send (обработчики выполняет по одному задача HTTP сервера)
+static char send_body[UART_TX_MAX_PAYLOAD * 3];
+static uint8_t send_payload[UART_TX_MAX_PAYLOAD];
+
+/**
+ * Выделение кадров. Фреймер использует только писатель буфера; новые
+ * параметры HTTP обработчик кладет в pending_framer_config и увеличивает
+ * версию, писатель применяет их перед следующей порцией.
+ */
+static framer_t framer;
+static framer_config_t pending_framer_config = {
+    FRAMER_DEFAULT_MODE, FRAMER_DEFAULT_EOL, FRAMER_DEFAULT_FIXED_LENGTH,
+    FRAMER_DEFAULT_LEN_OFFSET, FRAMER_DEFAULT_LEN_SIZE, FRAMER_DEFAULT_LEN_BE,
+    FRAMER_DEFAULT_LEN_ADJUST,
+};
+static portMUX_TYPE framer_lock = portMUX_INITIALIZER_UNLOCKED;
+static std::atomic<uint32_t> framer_version(1);
+static uint32_t framer_applied_version = 0;
+static std::atomic<bool> framing_active(false);
+static std::atomic<uint32_t> frame_boundary(0);     // Номер байта после последнего кадра
+
+static metric_t framer_frames;
+static metric_t framer_partial;
+static metric_t framer_errors;
+
+// Двоичная выгрузка журналов. Обработчики выполняет по одному задача
+// HTTP сервера, поэтому буфер блока и память сжатия общие. Блок сжатия
+// (CAPTURE_FORMAT_BLOCK_SIZE) больше блока пула и остается статическим
+static uint8_t binary_block[CAPTURE_FORMAT_RESERVE + CAPTURE_FORMAT_BLOCK_SIZE];
+static capture_lz_state_t binary_lz;
+
+/**
+ * Закрытие сокета сервером: освобождаем состояние потоковых клиентов
+ */
+static void web_server_close_fn(httpd_handle_t hd, int sockfd)
+{
+    ws_stream_on_close(sockfd);
+    close(sockfd);
+}
+
+/**
+ * Тело запроса целиком: httpd_req_recv отдает его частями (начало приходит
+ * с заголовками, остальное - следующими сегментами TCP). Таймаут сокета
+ * повторяется не больше API_BODY_RECV_RETRIES раз подряд.
+ *
+ * @param size Размер buf; тело длиннее - ошибка (размер проверяет вызывающий)
+ * @return Длина тела или -1, если тело не получено полностью
+ */
+static int read_body(httpd_req_t *req, char *buf, size_t size)
+{
+    if (req->content_len > size) {
+        return -1;
+    }
+    size_t received = 0;
+    int timeouts = 0;
+    while (received < req->content_len) {
+        int n = httpd_req_recv(req, buf + received, req->content_len - received);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts <= API_BODY_RECV_RETRIES) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        received += (size_t)n;
+        timeouts = 0;
+    }
+    return (int)received;
+}
+
+/**
+ * Вывод фрагмента ответа (JSON, метрики) частью chunked-ответа HTTP
+ */
+static bool httpd_chunk_flush(void *ctx, const char *data, size_t length)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, length) == ESP_OK;
+}
+
+static_assert(BUFFER_POOL_BLOCK_SIZE >= JSON_WRITER_CHUNK_SIZE, "JSON writer buffer is a pool block");
+static_assert(BUFFER_POOL_BLOCK_SIZE >= API_DATA_READ_CHUNK, "Read chunk is a pool block");
+static_assert(BUFFER_POOL_BLOCK_SIZE >= CAPTURE_MAX_CHUNK, "History record is a pool block");
+static_assert(BUFFER_POOL_BLOCK_SIZE >= CAPTURE_FORMAT_RESERVE + API_DATA_BINARY_BLOCK,
+              "Binary block is a pool block");
+
+/**
+ * Ответ при исчерпанном пуле буферов (buffer_pool.h)
+ */
+static void send_pool_exhausted(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_type(req, "text/plain");
+    httpd_resp_set_hdr(req, "Retry-After", "1");
+    httpd_resp_send(req, "Response buffers exhausted", HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * Начало JSON ответа. Буфер писателя - блок пула до json_response_end;
+ * пул исчерпан - клиенту уходит 503, вывод писателя отбрасывается
+ */
+static void json_response_begin(httpd_req_t *req, json_writer_t *w)
+{
+    char *buf = (char *)buffer_pool_borrow();
+    if (buf == NULL) {
+        send_pool_exhausted(req);
+    } else {
+        httpd_resp_set_type(req, "application/json");
+    }
+    json_writer_init(w, buf, JSON_WRITER_CHUNK_SIZE, httpd_chunk_flush, req);
+}
+
+static esp_err_t json_response_end(httpd_req_t *req, json_writer_t *w)
+{
+    bool ok = json_writer_finish(w);
+    if (w->buf != w->spare) {
+        buffer_pool_return(w->buf);
+    }
+    return ok ? httpd_resp_send_chunk(req, NULL, 0) : ESP_FAIL;
+}
+
+/**
+ * Начало JSON ответа с порциями данных: блок под порцию и буфер писателя
+ * берутся из пула вместе, до чтения буфера. false - пул исчерпан, клиенту
+ * ушел 503 и ничего не занято (данные не читаются, доставка не учитывается);
+ * порция возвращается вызывающим, буфер писателя - json_response_end
+ */
+static bool json_response_begin_chunk(httpd_req_t *req, json_writer_t *w, uint8_t **chunk)
+{
+    uint8_t *block = (uint8_t *)buffer_pool_borrow();
+    char *buf = (char *)buffer_pool_borrow();
+    if (block == NULL || buf == NULL) {
+        buffer_pool_return(block);
+        buffer_pool_return(buf);
+        send_pool_exhausted(req);
+        return false;
+    }
+    httpd_resp_set_type(req, "application/json");
+    json_writer_init(w, buf, JSON_WRITER_CHUNK_SIZE, httpd_chunk_flush, req);
+    *chunk = block;
+    return true;
+}
+
+typedef esp_err_t (*form_handler_t)(httpd_req_t *req, const char *params);
+
+/**
+ * Обработчик параметров формы: тело запроса (или строка запроса, если тела
+ * нет) читается в блок пула, fn получает строку с нулем в конце, блок
+ * возвращается после fn. Тело длиннее блока - 400, пул исчерпан - 503
+ */
+static esp_err_t with_form_params(httpd_req_t *req, form_handler_t fn)
+{
+    if (req->content_len >= BUFFER_POOL_BLOCK_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Request body too long");
+        return ESP_FAIL;
+    }
+    char *params = (char *)buffer_pool_borrow();
+    if (params == NULL) {
+        send_pool_exhausted(req);
+        return ESP_FAIL;
+    }
+
+    esp_err_t ret = ESP_FAIL;
+    params[0] = '\0';
+    if (req->content_len > 0) {
+        int received = read_body(req, params, BUFFER_POOL_BLOCK_SIZE - 1);
+        if (received > 0) {
+            params[received] = '\0';
+            ret = fn(req, params);
+        }
+    } else {
+        httpd_req_get_url_query_str(req, params, BUFFER_POOL_BLOCK_SIZE);
+        ret = fn(req, params);
+    }
+    buffer_pool_return(params);
+    return ret;
+}
+
+/**
+ * Вывод фрагмента двоичного ответа частью chunked-ответа HTTP
+ */
+static bool httpd_binary_flush(void *ctx, const uint8_t *data, size_t length)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, (const char *)data, length) == ESP_OK;
+}
+
+/**
+ * Клиент просит двоичный формат: format=bin или Accept: application/octet-stream
+ */
+static bool wants_binary(httpd_req_t *req, const char *query)
+{
+    char value[16];
+    if (query != NULL && httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK) {
+        return strcmp(value, "bin") == 0;
+    }
+    char accept[64];
+    esp_err_t ret = httpd_req_get_hdr_value_str(req, "Accept", accept, sizeof(accept));
+    return (ret == ESP_OK || ret == ESP_ERR_HTTPD_RESULT_TRUNC) &&
+           strstr(accept, "application/octet-stream") != NULL;
+}
+
+/**
+ * Разбор compress=: true если параметр допустим (*lz4 - сжимать)
+ */
+static bool parse_compress(const char *query, bool *lz4)
+{
+    char value[16];
+    *lz4 = false;
+    if (query == NULL || httpd_query_key_value(query, "compress", value, sizeof(value)) != ESP_OK) {
+        return true;
+    }
+    *lz4 = strcmp(value, "lz4") == 0;
+    return *lz4 || strcmp(value, "none") == 0;
+}
+
+/**
+ * Время приема (мкс от запуска) по младшим 32 битам из слотов времени
+ */
+static uint64_t rx_time_full(uint32_t rx_time_us)
+{
+    uint64_t now_us = (uint64_t)esp_timer_get_time();
+    return now_us - (uint32_t)((uint32_t)now_us - rx_time_us);
+}
+
+/**
+ * Учет ответа /api/data: отправка, задержка доставки, потери
+ */
+static void data_delivered(uint32_t data_len, uint32_t first_seq, uint32_t lost)
+{
+    uint32_t rx_time_us;
+    if (data_len > 0) {
+        batch_sent(FANOUT_TRANSPORT_HTTP, data_len);
+    }
+    if (data_len > 0 && web_server_data_rx_time(first_seq, &rx_time_us)) {
+        metric_observe_us(&http_delivery, (uint32_t)esp_timer_get_time() - rx_time_us);
+    }
+    if (lost > 0) {
+        metric_add(&http_dropped, lost);
+    }
+}
+
+/**
+ * Двоичный ответ /api/data: записи CAPTURE_KIND_BYTES до API_DATA_READ_CHUNK
+ * байт, время записи - время приема ее первого байта
+ */
+static esp_err_t send_data_binary(httpd_req_t *req, uint32_t seq, uint32_t max_len,
+                                  uint32_t skipped)
+{
+    uint8_t *chunk = (uint8_t *)buffer_pool_borrow();
+    uint8_t *block = (uint8_t *)buffer_pool_borrow();
+    if (chunk == NULL || block == NULL) {
+        buffer_pool_return(chunk);
+        buffer_pool_return(block);
+        send_pool_exhausted(req);
+        return ESP_FAIL;
+    }
+    capture_encoder_t enc;
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    capture_encoder_init(&enc, CAPTURE_KIND_BYTES, block, API_DATA_BINARY_BLOCK, NULL,
+                         httpd_binary_flush, req);
+
+    if (framing_active.load(std::memory_order_relaxed)) {
+        uint32_t ready = web_server_data_ready(seq);
+        if (max_len > ready) {
+            max_len = ready;
+        }
+    }
+    uint32_t data_len = 0;
+    uint32_t lost = skipped;
+    uint32_t first_seq = seq;
+    uint64_t timestamp_us = 0;
+    while (data_len < max_len) {
+        uint32_t chunk_lost = 0;
+        size_t want = max_len - data_len;
+        if (want > API_DATA_READ_CHUNK) {
+            want = API_DATA_READ_CHUNK;
+        }
+        size_t n = web_server_read_since(&seq, chunk, want, &chunk_lost);
+        lost += chunk_lost;
+        if (n == 0) {
+            break;
+        }
+        uint32_t record_seq = seq - n;
+        if (data_len == 0) {
+            first_seq = record_seq;
+        }
+        // Неизвестное время (слот перезаписан) - как у предыдущей записи
+        uint32_t rx_time_us;
+        if (web_server_data_rx_time(record_seq, &rx_time_us)) {
+            timestamp_us = rx_time_full(rx_time_us);
+        }
+        capture_encoder_record(&enc, record_seq, timestamp_us, 0, chunk, n);
+        data_len += n;
+    }
+
+    bool ok = capture_encoder_finish(&enc, seq, web_server_data_seq(), lost,
+                                     (uint64_t)esp_timer_get_time());
+    buffer_pool_return(chunk);
+    buffer_pool_return(block);
+    data_delivered(data_len, first_seq, lost);
+    return ok ? httpd_resp_send_chunk(req, NULL, 0) : ESP_FAIL;
+}
+
+/**
+ * Ответ /api/data: до max_len байт начиная с seq
+ *
+ * @param skipped Байт, пропущенных по бюджету отставания (входят в lost)
+ */
+static esp_err_t send_data_response(httpd_req_t *req, uint32_t seq, uint32_t max_len,
+                                    data_encoding_t encoding, uint32_t skipped)
+{
+    if (encoding == DATA_ENCODING_BINARY) {
+        return send_data_binary(req, seq, max_len, skipped);
+    }
+
+    bool base64 = encoding == DATA_ENCODING_BASE64;
+    json_writer_t w;
+    uint8_t *chunk;
+    if (!json_response_begin_chunk(req, &w, &chunk)) {
+        return ESP_FAIL;
+    }
+
+    // Получаем текущий размер буфера
+    size_t buffered = 0;
+    uart_get_buffered_data_len(UART_NUM, &buffered);
+
+    json_begin_object(&w);
+
+    // Данные читаются из буфера порциями прямо в ответ
+    json_key(&w, "data");
+    if (base64) {
+        json_base64_begin(&w);
+    } else {
+        json_string_begin(&w);
+    }
+    uint32_t data_len = 0;
+    uint32_t lost = skipped;
+    uint32_t first_seq = seq;
+    if (framing_active.load(std::memory_order_relaxed)) {
+        // Только целые кадры: до конца последнего выделенного
+        uint32_t ready = web_server_data_ready(seq);
+        if (max_len > ready) {
+            max_len = ready;
+        }
+    }
+    while (data_len < max_len) {
+        uint32_t chunk_lost = 0;
+        size_t want = max_len - data_len;
+        if (want > API_DATA_READ_CHUNK) {
+            want = API_DATA_READ_CHUNK;
+        }
+        size_t n = web_server_read_since(&seq, chunk, want, &chunk_lost);
+        lost += chunk_lost;
+        if (n == 0) {
+            break;
+        }
+        if (data_len == 0) {
+            first_seq = seq - n;
+        }
+        if (base64) {
+            json_base64_append(&w, chunk, n);
+        } else {
+            json_string_append(&w, chunk, n);
+        }
+        data_len += n;
+    }
+    if (base64) {
+        json_base64_end(&w);
+    } else {
+        json_string_end(&w);
+    }
+
+    json_kv_string(&w, "encoding", base64 ? "base64" : "string");
+    json_kv_uint(&w, "length", data_len);
+    json_kv_uint(&w, "seq", seq);
+    json_kv_uint(&w, "lost", lost);
+    json_kv_uint(&w, "pending", web_server_data_pending(seq));
+    json_kv_uint(&w, "buffered", (uint32_t)buffered);
+    json_kv_uint(&w, "total_received", web_server_data_seq());
+    json_end_object(&w);
+
+    buffer_pool_return(chunk);
+    data_delivered(data_len, first_seq, lost);
+    return json_response_end(req, &w);
+}
+
+/**
+ * Ответ клиенту, отставшему сверх бюджета при политике отключения
+ */
+static esp_err_t send_evicted(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "410 Gone");
+    httpd_resp_set_type(req, "text/plain");
+    httpd_resp_send(req, "Client is too far behind, request without since", HTTPD_RESP_USE_STRLEN);
+    // Ошибка обработчика закрывает соединение
+    return ESP_FAIL;
+}
+
+/**
+ * Передача запроса задаче ожидания; false если все слоты заняты
+ */
+static bool data_wait_begin(httpd_req_t *req, uint32_t seq, uint32_t max_len,
+                            data_encoding_t encoding, uint32_t wait_ms)
+{
+    if (wait_task == NULL) {
+        return false;
+    }
+    fanout_client_t *cursor = fanout_open(FANOUT_TRANSPORT_HTTP, seq);
+    if (cursor == NULL) {
+        return false;
+    }
+    httpd_req_t *async_req = NULL;
+    if (httpd_req_async_handler_begin(req, &async_req) != ESP_OK) {
+        fanout_close(cursor);
+        return false;
+    }
+
+    xSemaphoreTake(waiters_lock, portMAX_DELAY);
+    data_waiter_t *waiter = &data_waiters[cursor->slot];
+    waiter->req = async_req;
+    waiter->cursor = cursor;
+    waiter->max_len = max_len;
+    waiter->encoding = encoding;
+    waiter->deadline_us = esp_timer_get_time() + (int64_t)wait_ms * 1000;
+    waiter->ready_since_us = 0;
+    waiter_count.fetch_add(1);
+    xSemaphoreGive(waiters_lock);
+
+    xTaskNotifyGive(wait_task);
+    return true;
+}
+
+/**
+ * Проверка ожидающего запроса (под waiters_lock); возвращает время (мс) до
+ * следующей проверки или 0 - пора отвечать (answer_waiter)
+ */
+static uint32_t check_waiter(data_waiter_t *waiter, int64_t now_us)
+{
+    uint32_t skipped = 0;
+    fanout_verdict_t verdict = fanout_check(waiter->cursor, &skipped);
+    uint32_t seq = waiter->cursor->seq;
+
+    uint32_t ready = web_server_data_ready(seq);
+    if (verdict == FANOUT_OK && now_us < waiter->deadline_us) {
+        if (ready == 0) {
+            waiter->ready_since_us = 0;
+            return (uint32_t)((waiter->deadline_us - now_us + 999) / 1000);
+        }
+        // Данные есть: ответ может подождать пополнения по политике пакетирования
+        if (waiter->ready_since_us == 0) {
+            waiter->ready_since_us = now_us;
+        }
+        uint32_t wait_us = batch_wait_us(FANOUT_TRANSPORT_HTTP, ready,
+                                         framing_active.load(std::memory_order_relaxed),
+                                         waiter->ready_since_us, now_us);
+        if (wait_us > 0) {
+            int64_t left_us = waiter->deadline_us - now_us;
+            if ((int64_t)wait_us > left_us) {
+                wait_us = (uint32_t)left_us;
+            }
+            return (wait_us + 999) / 1000;
+        }
+    }
+
+    waiter->verdict = verdict;
+    waiter->skipped = skipped;
+    return 0;
+}
+
+/**
+ * Ответ запросу, проверка которого вернула 0. Выполняется без waiters_lock:
+ * слот остается занятым (req не NULL), пока его не освободит задача ожидания
+ */
+static void answer_waiter(data_waiter_t *waiter)
+{
+    if (waiter->verdict == FANOUT_EVICT) {
+        send_evicted(waiter->req);
+        httpd_sess_trigger_close(server, httpd_req_to_sockfd(waiter->req));
+    } else {
+        send_data_response(waiter->req, waiter->cursor->seq, waiter->max_len,
+                           waiter->encoding, waiter->skipped);
+    }
+    httpd_req_async_handler_complete(waiter->req);
+}
+
+static esp_err_t send_result_response(httpd_req_t *req, const uart_tx_result_t *result,
+                                      bool base64);
+
+/**
+ * Проверка запроса, ждущего ответа на посылку (под waiters_lock); возвращает
+ * время (мс) до следующей проверки или 0 - пора отвечать (answer_send_waiter)
+ */
+static uint32_t check_send_waiter(send_waiter_t *waiter, int64_t now_us)
+{
+    uart_tx_result_t result;
+    bool known = uart_tx_get_result(waiter->id, &result);
+    if (known && !uart_tx_finished(result.state) && now_us < waiter->deadline_us) {
+        // Разбудит send_done() или срок ответа
+        return (uint32_t)((waiter->deadline_us - now_us + 999) / 1000);
+    }
+    return 0;
+}
+
+/**
+ * Ответ запросу, проверка которого вернула 0 (без waiters_lock, как answer_waiter)
+ */
+static void answer_send_waiter(send_waiter_t *waiter)
+{
+    uart_tx_result_t result;
+    if (uart_tx_get_result(waiter->id, &result)) {
+        send_result_response(waiter->req, &result, waiter->base64);
+    } else {
+        httpd_resp_send_err(waiter->req, HTTPD_404_NOT_FOUND, "Send result expired");
+    }
+    httpd_req_async_handler_complete(waiter->req);
+}
+
+static_assert(API_DATA_MAX_WAITERS <= 32 && API_SEND_MAX_WAITERS <= 32, "Ready masks are 32 bits");
+
+/**
+ * Задача ответов на ожидающие запросы /api/data?wait= и /api/send?timeout=
+ *
+ * Под waiters_lock только проверка и выбор готовых; ответы (блокирующая
+ * отправка в сокет) - после освобождения, чтобы медленный клиент не
+ * задерживал обработчики HTTP сервера, которые ставят запросы в ожидание.
+ */
+static void data_wait_task(void *pvParameters)
+{
+    TickType_t wait = portMAX_DELAY;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        int64_t now_us = esp_timer_get_time();
+        uint32_t next_ms = UINT32_MAX;
+        uint32_t data_ready = 0;
+        uint32_t send_ready = 0;
+
+        xSemaphoreTake(waiters_lock, portMAX_DELAY);
+        for (int i = 0; i < API_DATA_MAX_WAITERS; i++) {
+            if (data_waiters[i].req == NULL) {
+                continue;
+            }
+            uint32_t ms = check_waiter(&data_waiters[i], now_us);
+            if (ms == 0) {
+                data_ready |= 1u << i;
+            } else if (ms < next_ms) {
+                next_ms = ms;
+            }
+        }
+        for (int i = 0; i < API_SEND_MAX_WAITERS; i++) {
+            if (send_waiters[i].req == NULL) {
+                continue;
+            }
+            uint32_t ms = check_send_waiter(&send_waiters[i], now_us);
+            if (ms == 0) {
+                send_ready |= 1u << i;
+            } else if (ms < next_ms) {
+                next_ms = ms;
+            }
+        }
+        xSemaphoreGive(waiters_lock);
+
+        if (data_ready != 0 || send_ready != 0) {
+            for (int i = 0; i < API_DATA_MAX_WAITERS; i++) {
+                if (data_ready & (1u << i)) {
+                    answer_waiter(&data_waiters[i]);
+                }
+            }
+            for (int i = 0; i < API_SEND_MAX_WAITERS; i++) {
+                if (send_ready & (1u << i)) {
+                    answer_send_waiter(&send_waiters[i]);
+                }
+            }
+
+            // Слоты освобождаются под блокировкой; курсор закрывается после
+            // сброса req - новый запрос может получить тот же слот fanout
+            xSemaphoreTake(waiters_lock, portMAX_DELAY);
+            for (int i = 0; i < API_DATA_MAX_WAITERS; i++) {
+                if (data_ready & (1u << i)) {
+                    fanout_client_t *cursor = data_waiters[i].cursor;
+                    data_waiters[i].req = NULL;
+                    data_waiters[i].cursor = NULL;
+                    fanout_close(cursor);
+                    waiter_count.fetch_sub(1);
+                }
+            }
+            for (int i = 0; i < API_SEND_MAX_WAITERS; i++) {
+                if (send_ready & (1u << i)) {
+                    send_waiters[i].req = NULL;
+                    waiter_count.fetch_sub(1);
+                }
+            }
+            xSemaphoreGive(waiters_lock);
+        }
+
+        if (next_ms == UINT32_MAX) {
+            wait = portMAX_DELAY;
+        } else {
+            wait = pdMS_TO_TICKS(next_ms);
+            if (wait == 0) {
+                wait = 1;
+            }
+        }
+    }
+}
+
+/**
+ * HTTP обработчик для API данных
+ *
+ * GET /api/data              - последние данные
+ * GET /api/data?since=<seq>  - данные начиная с порядкового номера seq
+ * Дополнительно: max=<байт> (по умолчанию API_DATA_DEFAULT_MAX, не больше
+ * размера буфера), encoding=base64 - поле data в base64 вместо строки,
+ * wait=<мс> (вместе с since) - если данных еще нет, ответить при их
+ * появлении, но не позже чем через wait мс (не больше API_DATA_MAX_WAIT_MS).
+ * Курсор since, отставший сверх бюджета FANOUT_HTTP_LAG_BUDGET, переводится
+ * вперед (пропуск входит в lost) или получает 410 - по политике транспорта.
+ * При выделении кадров ответ заканчивается на границе кадра.
+ * format=bin (или Accept: application/octet-stream) - двоичный ответ
+ * (capture_format.h, CAPTURE_KIND_BYTES) вместо JSON.
+ */
+static esp_err_t api_data_get_handler(httpd_req_t *req)
+{
+    uint32_t max_len = API_DATA_DEFAULT_MAX;
+    uint32_t seq = 0;
+    uint32_t wait_ms = 0;
+    bool has_since = false;
+    data_encoding_t encoding = DATA_ENCODING_STRING;
+
+    char query[96] = "";
+    char value[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+            seq = (uint32_t)strtoul(value, NULL, 10);
+            has_since = true;
+        }
+        if (httpd_query_key_value(query, "max", value, sizeof(value)) == ESP_OK) {
+            max_len = (uint32_t)strtoul(value, NULL, 10);
+            if (max_len == 0 || max_len > DATA_BUFFER_SIZE) {
+                max_len = DATA_BUFFER_SIZE;
+            }
+        }
+        if (httpd_query_key_value(query, "encoding", value, sizeof(value)) == ESP_OK &&
+            strcmp(value, "base64") == 0) {
+            encoding = DATA_ENCODING_BASE64;
+        }
+        if (httpd_query_key_value(query, "wait", value, sizeof(value)) == ESP_OK) {
+            wait_ms = (uint32_t)strtoul(value, NULL, 10);
+            if (wait_ms > API_DATA_MAX_WAIT_MS) {
+                wait_ms = API_DATA_MAX_WAIT_MS;
+            }
+        }
+    }
+    if (wants_binary(req, query)) {
+        encoding = DATA_ENCODING_BINARY;
+    }
+
+    if (!has_since) {
+        // Последние max_len байт (или меньше, если столько еще не принято)
+        seq = web_server_data_seq();
+        uint32_t available = seq - web_server_data_oldest();
+        seq -= (available < max_len) ? available : max_len;
+        return send_data_response(req, seq, max_len, encoding, 0);
+    }
+
+    uint32_t skipped = 0;
+    if (fanout_check_seq(FANOUT_TRANSPORT_HTTP, &seq, &skipped) == FANOUT_EVICT) {
+        return send_evicted(req);
+    }
+
+    // Нет данных - ждем их в задаче http_wait; если все слоты заняты,
+    // отвечаем сразу, как на обычный опрос
+    if (wait_ms > 0 && skipped == 0 && web_server_data_ready(seq) == 0 &&
+        data_wait_begin(req, seq, max_len, encoding, wait_ms)) {
+        return ESP_OK;
+    }
+    return send_data_response(req, seq, max_len, encoding, skipped);
+}
+
+/**
+ * Маркер пропуска в ответе /api/history
+ */
+static void history_gap(json_writer_t *w, uint32_t missed, uint32_t next_seq, bool reset)
+{
+    json_begin_object(w);
+    json_kv_uint(w, "gap", missed);
+    json_kv_uint(w, "seq", next_seq);
+    if (reset) {
+        json_kv_bool(w, "reset", true);
+    }
+    json_end_object(w);
+}
+
+/**
+ * Двоичный ответ /api/history: записи журнала (CAPTURE_KIND_RECORDS)
+ *
+ * Пропуски и перезапуск видны по номерам записей, продолжение - next хвоста.
+ */
+static esp_err_t send_history_binary(httpd_req_t *req, uint32_t seq, uint32_t max_len, bool lz4)
+{
+    uint8_t *chunk = (uint8_t *)buffer_pool_borrow();
+    if (chunk == NULL) {
+        send_pool_exhausted(req);
+        return ESP_FAIL;
+    }
+    capture_encoder_t enc;
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    capture_encoder_init(&enc, CAPTURE_KIND_RECORDS, binary_block, CAPTURE_FORMAT_BLOCK_SIZE,
+                         lz4 ? &binary_lz : NULL, httpd_binary_flush, req);
+
+    uint32_t sent = 0;
+    capture_record_t record;
+    while (true) {
+        capture_read_result_t result = capture_journal_read(seq, &record, chunk);
+        if (result == CAPTURE_READ_END) {
+            break;
+        }
+        if (result == CAPTURE_READ_GAP) {
+            uint32_t oldest = capture_journal_oldest();
+            seq = (int32_t)(oldest - seq) > 0 ? oldest : seq + 1;
+            continue;
+        }
+        if (sent > 0 && sent + record.length > max_len) {
+            break;
+        }
+        capture_encoder_record(&enc, record.seq, record.timestamp_us, record.flags,
+                               chunk, record.length);
+        sent += record.length;
+        seq++;
+    }
+
+    buffer_pool_return(chunk);
+    if (!capture_encoder_finish(&enc, seq, capture_journal_head(), 0,
+                                (uint64_t)esp_timer_get_time())) {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * HTTP обработчик истории принятых порций
+ *
+ * GET /api/history?since=<seq>&max=<байт>[&encoding=base64]
+ * Возвращает записи журнала начиная с номера since (без since - с самой
+ * старой). Перезаписанные записи заменяются маркером {"gap":N,"seq":S};
+ * номер "из будущего" (после перезагрузки) - маркером с "reset":true.
+ * Продолжение - запрос с since=next, пока more=true.
+ * При выделении кадров (/api/framer) запись - один кадр, ts - время приема
+ * его первого байта; части длинного кадра помечены "partial":true,
+ * кадры с ошибкой кодирования - "error":true.
+ * format=bin (или Accept: application/octet-stream) - двоичный ответ
+ * (capture_format.h, CAPTURE_KIND_RECORDS); compress=lz4 - он же со
+ * сжатием блоков.
+ */
+static esp_err_t api_history_get_handler(httpd_req_t *req)
+{
+    uint32_t max_len = HISTORY_DEFAULT_MAX;
+    uint32_t seq = 0;
+    bool has_since = false;
+    bool base64 = false;
+    bool lz4 = false;
+
+    char query[96] = "";
+    char value[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+            seq = (uint32_t)strtoul(value, NULL, 10);
+            has_since = true;
+        }
+        if (httpd_query_key_value(query, "max", value, sizeof(value)) == ESP_OK) {
+            max_len = (uint32_t)strtoul(value, NULL, 10);
+            if (max_len == 0 || max_len > CAPTURE_ARENA_SIZE) {
+                max_len = CAPTURE_ARENA_SIZE;
+            }
+        }
+        if (httpd_query_key_value(query, "encoding", value, sizeof(value)) == ESP_OK) {
+            base64 = strcmp(value, "base64") == 0;
+        }
+    }
+    if (!parse_compress(query, &lz4)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "compress must be lz4 or none");
+        return ESP_FAIL;
+    }
+
+    framer_config_t framing;
+    web_server_get_framer(&framing);
+
+    uint32_t head = capture_journal_head();
+    bool reset = false;
+    if (!has_since) {
+        seq = capture_journal_oldest();
+    } else if ((int32_t)(seq - head) > 0) {
+        reset = true;
+    }
+
+    if (lz4 || wants_binary(req, query)) {
+        return send_history_binary(req, reset ? capture_journal_oldest() : seq, max_len, lz4);
+    }
+
+    json_writer_t w;
+    uint8_t *chunk;
+    if (!json_response_begin_chunk(req, &w, &chunk)) {
+        return ESP_FAIL;
+    }
+    json_begin_object(&w);
+    json_key(&w, "chunks");
+    json_begin_array(&w);
+
+    if (reset) {
+        uint32_t oldest = capture_journal_oldest();
+        history_gap(&w, 0, oldest, true);
+        seq = oldest;
+    }
+
+    uint32_t sent = 0;
+    bool more = false;
+    capture_record_t record;
+    while (true) {
+        capture_read_result_t result = capture_journal_read(seq, &record, chunk);
+        if (result == CAPTURE_READ_END) {
+            break;
+        }
+        if (result == CAPTURE_READ_GAP) {
+            uint32_t oldest = capture_journal_oldest();
+            if ((int32_t)(oldest - seq) <= 0) {
+                oldest = seq + 1;       // Перезаписана прямо во время чтения
+            }
+            history_gap(&w, oldest - seq, oldest, false);
+            seq = oldest;
+            continue;
+        }
+
+        // Хотя бы одна запись отдается всегда, даже если она больше max
+        if (sent > 0 && sent + record.length > max_len) {
+            more = true;
+            break;
+        }
+
+        json_begin_object(&w);
+        json_kv_uint(&w, "seq", record.seq);
+        json_kv_uint64(&w, "ts", record.timestamp_us);
+        json_kv_uint(&w, "length", record.length);
+        if (record.flags & FRAMER_FLAG_PARTIAL) {
+            json_kv_bool(&w, "partial", true);
+        }
+        if (record.flags & FRAMER_FLAG_ERROR) {
+            json_kv_bool(&w, "error", true);
+        }
+        json_key(&w, "data");
+        if (base64) {
+            json_base64_begin(&w);
+            json_base64_append(&w, chunk, record.length);
+            json_base64_end(&w);
+        } else {
+            json_string_bytes(&w, chunk, record.length);
+        }
+        json_end_object(&w);
+
+        sent += record.length;
+        seq++;
+    }
+
+    json_end_array(&w);
+    json_kv_string(&w, "encoding", base64 ? "base64" : "string");
+    json_kv_string(&w, "framing", framer_mode_name(framing.mode));
+    json_kv_uint(&w, "next", seq);
+    json_kv_uint(&w, "head", capture_journal_head());
+    json_kv_uint(&w, "bytes", sent);
+    json_kv_bool(&w, "more", more);
+    json_kv_uint64(&w, "now", (uint64_t)esp_timer_get_time());
+    json_end_object(&w);
+
+    buffer_pool_return(chunk);
+    return json_response_end(req, &w);
+}
+
+static bool capture_compress_sink(void *ctx, const uint8_t *data, size_t length)
+{
+    capture_encoder_t *enc = (capture_encoder_t *)ctx;
+    capture_encoder_write(enc, data, length);
+    return !enc->failed;
+}
+
+/**
+ * HTTP обработчик выгрузки журнала из флеш
+ *
+ * GET /api/capture/download[?headers=1][&compress=lz4]
+ * Данные всех сохраненных сегментов от старых к новым одним потоком.
+ * С headers=1 перед данными каждого сегмента идет его 32-байтный
+ * заголовок (номер, запуск, время, длина, CRC) - для разбора по запускам.
+ * С compress=lz4 тот же поток упакован в блоки capture_format.h
+ * (CAPTURE_KIND_RAW, next хвоста - длина несжатого потока).
+ */
+static esp_err_t api_capture_download_handler(httpd_req_t *req)
+{
+    bool with_headers = false;
+    bool lz4 = false;
+    char query[48] = "";
+    char value[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "headers", value, sizeof(value)) == ESP_OK) {
+        with_headers = strcmp(value, "1") == 0;
+    }
+    if (!parse_compress(query, &lz4)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "compress must be lz4 or none");
+        return ESP_FAIL;
+    }
+
+    // Буфер чтения флеш - блок пула на время выгрузки
+    uint8_t *buf = (uint8_t *)buffer_pool_borrow();
+    if (buf == NULL) {
+        send_pool_exhausted(req);
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/octet-stream");
+    bool ok;
+    if (!lz4) {
+        httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"capture.bin\"");
+        ok = flash_log_read_all(httpd_binary_flush, req, with_headers, buf, BUFFER_POOL_BLOCK_SIZE);
+        buffer_pool_return(buf);
+        return ok ? httpd_resp_send_chunk(req, NULL, 0) : ESP_FAIL;
+    }
+
+    capture_encoder_t enc;
+    capture_encoder_init(&enc, CAPTURE_KIND_RAW, binary_block, CAPTURE_FORMAT_BLOCK_SIZE,
+                         &binary_lz, httpd_binary_flush, req);
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"capture.ctab\"");
+    ok = flash_log_read_all(capture_compress_sink, &enc, with_headers, buf, BUFFER_POOL_BLOCK_SIZE);
+    buffer_pool_return(buf);
+    if (!ok) {
+        return ESP_FAIL;
+    }
+    uint32_t total = enc.raw_bytes + (uint32_t)enc.block_len;
+    if (!capture_encoder_finish(&enc, total, 0, 0, (uint64_t)esp_timer_get_time())) {
+        return ESP_FAIL;
+    }
+    ESP_LOGD(TAG, "Capture download: %lu bytes, %lu compressed",
+             (unsigned long)total, (unsigned long)enc.out_bytes);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * HTTP обработчик статуса журнала во флеш
+ */
+static esp_err_t api_capture_status_handler(httpd_req_t *req)
+{
+    flash_log_stats_t stats;
+    flash_log_get_stats(&stats);
+
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_kv_bool(&w, "active", stats.active);
+    json_kv_uint(&w, "partition_size", stats.partition_size);
+    json_kv_uint(&w, "segment_count", stats.segment_count);
+    json_kv_uint(&w, "oldest_segment", stats.oldest_segment);
+    json_kv_uint(&w, "next_segment", stats.next_segment);
+    json_kv_uint(&w, "boot", stats.boot);
+    json_kv_uint(&w, "payload_bytes", stats.payload_bytes);
+    json_kv_uint(&w, "flash_bytes", stats.flash_bytes);
+    // Коэффициент записи (flash_bytes / payload_bytes) в тысячных
+    json_kv_uint(&w, "write_amplification_x1000", stats.payload_bytes > 0 ?
+                 (uint32_t)((uint64_t)stats.flash_bytes * 1000 / stats.payload_bytes) : 0);
+    json_kv_uint(&w, "segments_written", stats.segments_written);
+    json_kv_uint(&w, "partial_segments", stats.partial_segments);
+    json_kv_uint(&w, "dropped_bytes", stats.dropped_bytes);
+    json_kv_uint(&w, "write_errors", stats.write_errors);
+    json_kv_uint(&w, "last_write_us", stats.last_write_us);
+    json_kv_uint(&w, "max_write_us", stats.max_write_us);
+    json_kv_uint64(&w, "total_write_us", stats.total_write_us);
+    json_end_object(&w);
+
+    return json_response_end(req, &w);
+}
+
+/**
+ * HTTP обработчик для статуса UART
+ */
+static esp_err_t api_uart_status_handler(httpd_req_t *req)
+{
+    size_t buffered = 0;
+    uart_get_buffered_data_len(UART_NUM, &buffered);
+
+    uart_rx_stats_t stats;
+    uart_rx_get_stats(&stats);
+
+    rs232_config_t config;
+    rs232_get_config(&config);
+    int stop_x2 = rs232_stop_bits_x2(config.stop_bits);
+    const char *stop_bits = stop_x2 == 2 ? "1" : stop_x2 == 3 ? "1.5" : "2";
+
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_kv_bool(&w, "uart_active", true);
+    json_kv_int(&w, "rx_pin", UART_RX_PIN);
+    json_kv_int(&w, "tx_pin", UART_TX_PIN);
+    json_kv_uint(&w, "baud_rate", config.baud_rate);
+    json_kv_int(&w, "data_bits", rs232_data_bits_count(config.data_bits));
+    json_kv_string(&w, "parity", rs232_parity_name(config.parity));
+    json_key(&w, "stop_bits");
+    json_raw(&w, stop_bits, strlen(stop_bits));
+    json_kv_bool(&w, "dma", rs232_dma_enabled());
+    json_kv_uint(&w, "buffered_bytes", (uint32_t)buffered);
+    json_kv_uint(&w, "total_received", web_server_data_seq());
+    json_kv_uint(&w, "buffer_size", DATA_BUFFER_SIZE);
+    json_kv_uint(&w, "data_events", stats.data_events);
+    json_kv_uint(&w, "timeout_events", stats.timeout_events);
+    json_kv_uint(&w, "fifo_overflows", stats.fifo_overflows);
+    json_kv_uint(&w, "buffer_full", stats.buffer_full);
+    json_kv_uint(&w, "breaks", stats.breaks);
+    json_kv_uint(&w, "frame_errors", stats.frame_errors);
+    json_kv_uint(&w, "parity_errors", stats.parity_errors);
+    json_end_object(&w);
+
+    return json_response_end(req, &w);
+}
+
+/**
+ * Разбор параметров линии: baud, data_bits, parity, stop_bits
+ *
+ * Не указанные параметры не меняются.
+ *
+ * @return false если значение какого-либо параметра неверно
+ */
+static bool parse_uart_params(const char *params, rs232_config_t *config)
+{
+    char value[16];
+    bool ok = true;
+
+    if (httpd_query_key_value(params, "baud", value, sizeof(value)) == ESP_OK) {
+        config->baud_rate = (uint32_t)strtoul(value, NULL, 10);
+    }
+    if (httpd_query_key_value(params, "data_bits", value, sizeof(value)) == ESP_OK) {
+        int bits = atoi(value);
+        ok = ok && bits >= 5 && bits <= 8;
+        config->data_bits = (uart_word_length_t)(UART_DATA_5_BITS + (bits - 5));
+    }
+    if (httpd_query_key_value(params, "parity", value, sizeof(value)) == ESP_OK) {
+        ok = ok && rs232_parse_parity(value, &config->parity);
+    }
+    if (httpd_query_key_value(params, "stop_bits", value, sizeof(value)) == ESP_OK) {
+        if (strcmp(value, "1") == 0) {
+            config->stop_bits = UART_STOP_BITS_1;
+        } else if (strcmp(value, "1.5") == 0) {
+            config->stop_bits = UART_STOP_BITS_1_5;
+        } else if (strcmp(value, "2") == 0) {
+            config->stop_bits = UART_STOP_BITS_2;
+        } else {
+            ok = false;
+        }
+    }
+    return ok && rs232_config_is_valid(config);
+}
+
+/**
+ * HTTP обработчик смены параметров порта
+ *
+ * POST /api/uart/config с параметрами в теле (form) или в строке запроса:
+ * baud=<скорость>&data_bits=<5..8>&parity=<none|odd|even>&stop_bits=<1|1.5|2>
+ * Не указанные параметры не меняются. Принятые данные не сбрасываются.
+ */
+static esp_err_t api_uart_config_apply(httpd_req_t *req, const char *params)
+{
+    rs232_config_t config;
+    rs232_get_config(&config);
+    if (!parse_uart_params(params, &config)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid UART parameters");
+        return ESP_FAIL;
+    }
+    if (!rs232_reconfigure(&config)) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Reconfigure failed");
+        return ESP_FAIL;
+    }
+
+    return api_uart_status_handler(req);
+}
+
+static esp_err_t api_uart_config_handler(httpd_req_t *req)
+{
+    return with_form_params(req, api_uart_config_apply);
+}
+
+/**
+ * Состояние порта в JSON
+ */
+static void write_port_info(json_writer_t *w, int port, const serial_port_info_t *info)
+{
+    int stop_x2 = rs232_stop_bits_x2(info->config.stop_bits);
+    const char *stop_bits = stop_x2 == 2 ? "1" : stop_x2 == 3 ? "1.5" : "2";
+
+    json_begin_object(w);
+    json_kv_int(w, "port", port);
+    json_kv_bool(w, "primary", port == SERIAL_PORT_PRIMARY);
+    json_kv_bool(w, "running", info->running);
+    json_kv_int(w, "uart", (int32_t)info->uart);
+    json_kv_int(w, "rx_pin", info->rx_pin);
+    json_kv_int(w, "tx_pin", info->tx_pin);
+    json_kv_uint(w, "baud_rate", info->config.baud_rate);
+    json_kv_int(w, "data_bits", rs232_data_bits_count(info->config.data_bits));
+    json_kv_string(w, "parity", rs232_parity_name(info->config.parity));
+    json_key(w, "stop_bits");
+    json_raw(w, stop_bits, strlen(stop_bits));
+    json_kv_uint(w, "budget", info->budget);
+    json_kv_uint(w, "buffer_size",
+                 port == SERIAL_PORT_PRIMARY ? DATA_BUFFER_SIZE : SERIAL_PORT_BUFFER_SIZE);
+    json_kv_uint(w, "seq", info->head);
+    json_kv_uint(w, "oldest", info->oldest);
+    json_kv_uint(w, "rx_bytes", info->rx_bytes);
+    json_kv_uint(w, "tx_bytes", info->tx_bytes);
+    json_kv_uint(w, "overruns", info->overruns);
+    json_kv_uint(w, "errors", info->errors);
+    json_kv_uint(w, "throttled", info->throttled);
+    decoder_info_t decoder;
+    decoder_get_info(port, &decoder);
+    json_kv_string(w, "decoder", decoder.name);
+    json_kv_uint(w, "frames", decoder.frames);
+    json_kv_uint(w, "decode_errors", decoder.errors);
+    json_end_object(w);
+}
+
+/**
+ * Номер порта и действие из пути /api/ports/<N>[/<действие>]
+ *
+ * @return false если номер порта неверен
+ */
+static bool parse_port_path(const char *uri, int *port, const char **action)
+{
+    const char *p = uri + strlen("/api/ports/");
+    char *end = NULL;
+    long n = strtol(p, &end, 10);
+    if (end == p || n < 0 || n >= serial_port_count() ||
+        (*end != '\0' && *end != '/' && *end != '?')) {
+        return false;
+    }
+    *port = (int)n;
+    *action = *end == '/' ? end + 1 : "";
+    return true;
+}
+
+static inline bool action_is(const char *action, const char *name)
+{
+    size_t len = strlen(name);
+    return strncmp(action, name, len) == 0 && (action[len] == '\0' || action[len] == '?');
+}
+
+/**
+ * HTTP обработчик списка портов
+ *
+ * GET /api/ports - состояние всех портов (порт 0 - основной)
+ */
+static esp_err_t api_ports_handler(httpd_req_t *req)
+{
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_kv_int(&w, "count", serial_port_count());
+    json_key(&w, "ports");
+    json_begin_array(&w);
+    for (int p = 0; p < serial_port_count(); p++) {
+        serial_port_info_t info;
+        serial_port_get_info(p, &info);
+        write_port_info(&w, p, &info);
+    }
+    json_end_array(&w);
+    json_end_object(&w);
+
+    return json_response_end(req, &w);
+}
+
+/**
+ * Данные дополнительного порта: since, max, encoding как у /api/data
+ * (без ожидания, выделения кадров и двоичного формата)
+ */
+static esp_err_t send_port_data(httpd_req_t *req, int port)
+{
+    uint32_t max_len = API_DATA_DEFAULT_MAX;
+    bool has_since = false;
+    bool base64 = false;
+    uint32_t seq = 0;
+
+    char query[96] = "";
+    char value[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+            seq = (uint32_t)strtoul(value, NULL, 10);
+            has_since = true;
+        }
+        if (httpd_query_key_value(query, "max", value, sizeof(value)) == ESP_OK) {
+            max_len = (uint32_t)strtoul(value, NULL, 10);
+        }
+        base64 = httpd_query_key_value(query, "encoding", value, sizeof(value)) == ESP_OK &&
+                 strcmp(value, "base64") == 0;
+    }
+    if (max_len == 0 || max_len > SERIAL_PORT_BUFFER_SIZE) {
+        max_len = SERIAL_PORT_BUFFER_SIZE;
+    }
+
+    serial_port_info_t info;
+    serial_port_get_info(port, &info);
+    if (!has_since) {
+        uint32_t available = info.head - info.oldest;
+        seq = info.head - ((available < max_len) ? available : max_len);
+    }
+
+    json_writer_t w;
+    uint8_t *chunk;
+    if (!json_response_begin_chunk(req, &w, &chunk)) {
+        return ESP_FAIL;
+    }
+    json_begin_object(&w);
+    json_kv_int(&w, "port", port);
+    json_key(&w, "data");
+    if (base64) {
+        json_base64_begin(&w);
+    } else {
+        json_string_begin(&w);
+    }
+    uint32_t data_len = 0;
+    uint32_t lost = 0;
+    while (data_len < max_len) {
+        uint32_t chunk_lost = 0;
+        size_t want = max_len - data_len;
+        if (want > API_DATA_READ_CHUNK) {
+            want = API_DATA_READ_CHUNK;
+        }
+        size_t n = serial_port_read_since(port, &seq, chunk, want, &chunk_lost);
+        lost += chunk_lost;
+        if (n == 0) {
+            break;
+        }
+        if (base64) {
+            json_base64_append(&w, chunk, n);
+        } else {
+            json_string_append(&w, chunk, n);
+        }
+        data_len += n;
+    }
+    if (base64) {
+        json_base64_end(&w);
+    } else {
+        json_string_end(&w);
+    }
+    serial_port_get_info(port, &info);
+    json_kv_string(&w, "encoding", base64 ? "base64" : "string");
+    json_kv_uint(&w, "length", data_len);
+    json_kv_uint(&w, "seq", seq);
+    json_kv_uint(&w, "lost", lost);
+    json_kv_uint(&w, "pending", info.head - seq);
+    json_kv_uint(&w, "total_received", info.head);
+    json_end_object(&w);
+
+    buffer_pool_return(chunk);
+    return json_response_end(req, &w);
+}
+
+/**
+ * HTTP обработчик чтения порта
+ *
+ * GET /api/ports/<N>       - состояние порта
+ * GET /api/ports/<N>/data  - данные порта (для порта 0 - как /api/data)
+ */
+static esp_err_t api_port_get_handler(httpd_req_t *req)
+{
+    int port;
+    const char *action;
+    if (!parse_port_path(req->uri, &port, &action)) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such port");
+        return ESP_FAIL;
+    }
+
+    if (action_is(action, "")) {
+        serial_port_info_t info;
+        serial_port_get_info(port, &info);
+        json_writer_t w;
+        json_response_begin(req, &w);
+        write_port_info(&w, port, &info);
+        return json_response_end(req, &w);
+    }
+    if (action_is(action, "data")) {
+        return port == SERIAL_PORT_PRIMARY ? api_data_get_handler(req) : send_port_data(req, port);
+    }
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown port resource");
+    return ESP_FAIL;
+}
+
+/**
+ * Параметры порта из POST /api/ports/<N>/config
+ */
+static esp_err_t api_port_config_apply(httpd_req_t *req, const char *params)
+{
+    int port;
+    const char *action;
+    if (!parse_port_path(req->uri, &port, &action)) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such port");
+        return ESP_FAIL;
+    }
+
+    char value[16];
+
+    // Сначала проверяются все параметры, затем применяются вместе: неверный
+    // параметр не оставляет порт настроенным наполовину
+    serial_port_info_t info;
+    serial_port_get_info(port, &info);
+    rs232_config_t config = info.config;
+    if (!parse_uart_params(params, &config)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid UART parameters");
+        return ESP_FAIL;
+    }
+    bool set_budget = httpd_query_key_value(params, "budget", value, sizeof(value)) == ESP_OK;
+    uint32_t budget = set_budget ? (uint32_t)strtoul(value, NULL, 10) : 0;
+    if (set_budget && port == SERIAL_PORT_PRIMARY) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Budget applies to auxiliary ports only");
+        return ESP_FAIL;
+    }
+    char decoder[16];
+    bool set_decoder = httpd_query_key_value(params, "decoder", decoder, sizeof(decoder)) == ESP_OK;
+    if (set_decoder && !decoder_name_valid(decoder)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown decoder");
+        return ESP_FAIL;
+    }
+
+    // Смена линии - единственный шаг, который может не удаться; он первый
+    if (!rs232_config_equal(&config, &info.config) && !serial_port_configure(port, &config)) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Reconfigure failed");
+        return ESP_FAIL;
+    }
+    if (set_budget) {
+        serial_port_set_budget(port, budget);
+    }
+    if (set_decoder) {
+        decoder_set(port, decoder);
+    }
+
+    serial_port_get_info(port, &info);
+    json_writer_t w;
+    json_response_begin(req, &w);
+    write_port_info(&w, port, &info);
+    return json_response_end(req, &w);
+}
+
+/**
+ * HTTP обработчик управления портом
+ *
+ * POST /api/ports/<N>/config - параметры линии как у /api/uart/config,
+ *                              budget=<байт/с> (0 - без ограничения; не для порта 0),
+ *                              decoder=<none|modbus|nmea|tlv>
+ * POST /api/ports/<N>/send   - передача тела запроса как есть
+ */
+static esp_err_t api_port_post_handler(httpd_req_t *req)
+{
+    int port;
+    const char *action;
+    if (!parse_port_path(req->uri, &port, &action)) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such port");
+        return ESP_FAIL;
+    }
+
+    if (action_is(action, "send")) {
+        if (req->content_len > UART_TX_MAX_PAYLOAD) {
+            httpd_resp_set_status(req, "413 Payload Too Large");
+            httpd_resp_set_type(req, "text/plain");
+            httpd_resp_send(req, "Payload exceeds UART_TX_MAX_PAYLOAD", HTTPD_RESP_USE_STRLEN);
+            return ESP_FAIL;
+        }
+        int n = read_body(req, send_body, UART_TX_MAX_PAYLOAD);
+        if (n < 0) {
+            return ESP_FAIL;
+        }
+        size_t received = (size_t)n;
+        size_t queued = serial_port_write(port, (const uint8_t *)send_body, received);
+
+        json_writer_t w;
+        json_response_begin(req, &w);
+        json_begin_object(&w);
+        json_kv_int(&w, "port", port);
+        json_kv_uint(&w, "length", (uint32_t)received);
+        json_kv_uint(&w, "queued", (uint32_t)queued);
+        json_end_object(&w);
+        return json_response_end(req, &w);
+    }
+
+    if (!action_is(action, "config")) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown port resource");
+        return ESP_FAIL;
+    }
+    return with_form_params(req, api_port_config_apply);
+}
+
+/**
+ * HTTP обработчик таблицы полей декодеров
+ *
+ * GET /api/fields[?port=<N>][&detail=1]
+ * {"count":..,"capacity":..,"dropped":..,"ports":{"<N>":{"<поле>":<значение>,..},..}}
+ * С detail=1 значение поля - {"value":..,"updates":..,"age_ms":..}.
+ * Время ответа не зависит от потока данных: обходится вся таблица.
+ */
+static esp_err_t api_fields_handler(httpd_req_t *req)
+{
+    int only_port = -1;
+    bool detail = false;
+    char query[64];
+    char value[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "port", value, sizeof(value)) == ESP_OK) {
+            only_port = atoi(value);
+            if (only_port < 0 || only_port >= serial_port_count()) {
+                httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such port");
+                return ESP_FAIL;
+            }
+        }
+        detail = httpd_query_key_value(query, "detail", value, sizeof(value)) == ESP_OK &&
+                 strcmp(value, "1") == 0;
+    }
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_kv_uint(&w, "count", (uint32_t)field_table_count());
+    json_kv_uint(&w, "capacity", FIELD_TABLE_SIZE);
+    json_kv_uint(&w, "dropped", field_table_dropped());
+    json_key(&w, "ports");
+    json_begin_object(&w);
+    for (int p = 0; p < serial_port_count(); p++) {
+        if (only_port >= 0 && p != only_port) {
+            continue;
+        }
+        char port_key[12];
+        snprintf(port_key, sizeof(port_key), "%d", p);
+        json_key(&w, port_key);
+        json_begin_object(&w);
+        for (size_t i = 0; i < FIELD_TABLE_SIZE; i++) {
+            field_t field;
+            if (!field_table_get(i, &field) || field.port != p) {
+                continue;
+            }
+            json_key(&w, field.key);
+            if (detail) {
+                json_begin_object(&w);
+                json_key(&w, "value");
+            }
+            if (field.type == FIELD_FLOAT) {
+                json_double(&w, field.value.f);
+            } else {
+                json_int64(&w, field.value.i);
+            }
+            if (detail) {
+                json_kv_uint(&w, "updates", field.updates);
+                json_kv_uint(&w, "age_ms", now_ms - field.updated_ms);
+                json_end_object(&w);
+            }
+        }
+        json_end_object(&w);
+    }
+    json_end_object(&w);
+    json_end_object(&w);
+
+    return json_response_end(req, &w);
+}
+
+/**
+ * Ответ с результатом посылки; ответ устройства - из буфера моста
+ */
+static esp_err_t send_result_response(httpd_req_t *req, const uart_tx_result_t *result,
+                                      bool base64)
+{
+    if (!uart_tx_finished(result->state)) {
+        httpd_resp_set_status(req, "202 Accepted");
+    }
+    bool has_response = result->state != UART_TX_QUEUED && result->state != UART_TX_SENDING;
+    json_writer_t w;
+    uint8_t *chunk = NULL;
+    if (!has_response) {
+        json_response_begin(req, &w);
+    } else if (!json_response_begin_chunk(req, &w, &chunk)) {
+        return ESP_FAIL;
+    }
+    json_begin_object(&w);
+    json_kv_uint(&w, "id", result->id);
+    json_kv_string(&w, "state", uart_tx_state_name(result->state));
+    json_kv_uint(&w, "length", result->length);
+    json_kv_uint(&w, "sent", result->sent);
+
+    if (has_response) {
+        uint32_t seq = result->rx_seq;
+        uint32_t end = result->rx_seq + result->rx_length;
+        uint32_t lost = 0;
+        uint32_t length = 0;
+
+        json_key(&w, "response");
+        if (base64) {
+            json_base64_begin(&w);
+        } else {
+            json_string_begin(&w);
+        }
+        while (seq != end) {
+            uint32_t chunk_lost = 0;
+            size_t want = end - seq;
+            if (want > API_DATA_READ_CHUNK) {
+                want = API_DATA_READ_CHUNK;
+            }
+            size_t n = web_server_read_since(&seq, chunk, want, &chunk_lost);
+            if (n == 0 || chunk_lost > 0) {
+                // Ответ перезаписан новыми данными - остаток потерян
+                lost = end - (seq - (uint32_t)n - chunk_lost);
+                break;
+            }
+            if (base64) {
+                json_base64_append(&w, chunk, n);
+            } else {
+                json_string_append(&w, chunk, n);
+            }
+            length += n;
+        }
+        if (base64) {
+            json_base64_end(&w);
+        } else {
+            json_string_end(&w);
+        }
+        json_kv_string(&w, "encoding", base64 ? "base64" : "string");
+        json_kv_uint(&w, "response_length", length);
+        json_kv_uint(&w, "rx_seq", result->rx_seq);
+        json_kv_uint(&w, "lost", lost);
+        json_kv_uint(&w, "elapsed_us", result->elapsed_us);
+    }
+    json_end_object(&w);
+    buffer_pool_return(chunk);
+    return json_response_end(req, &w);
+}
+
+/**
+ * Разбор шестнадцатеричных данных (пробелы и ':' между байтами допускаются)
+ *
+ * @return Длина данных, -1 при ошибке или переполнении
+ */
+static int parse_hex(const char *text, size_t length, uint8_t *out, size_t capacity)
+{
+    size_t n = 0;
+    int high = -1;
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else if ((c == ' ' || c == ':' || c == '\r' || c == '\n' || c == '\t') && high < 0) {
+            continue;
+        } else {
+            return -1;
+        }
+        if (high < 0) {
+            high = digit;
+            continue;
+        }
+        if (n == capacity) {
+            return -1;
+        }
+        out[n++] = (uint8_t)(high << 4 | digit);
+        high = -1;
+    }
+    return high < 0 ? (int)n : -1;
+}
+
+static void send_done(uint32_t id, void *ctx)
+{
+    if (wait_task != NULL) {
+        xTaskNotifyGive(wait_task);
+    }
+}
+
+/**
+ * Передача запроса задаче ожидания; false если все слоты заняты
+ */
+static bool send_wait_begin(httpd_req_t *req, uint32_t id, bool base64)
+{
+    if (wait_task == NULL) {
+        return false;
+    }
+    xSemaphoreTake(waiters_lock, portMAX_DELAY);
+    send_waiter_t *waiter = NULL;
+    for (int i = 0; i < API_SEND_MAX_WAITERS; i++) {
+        if (send_waiters[i].req == NULL) {
+            waiter = &send_waiters[i];
+            break;
+        }
+    }
+    httpd_req_t *async_req = NULL;
+    if (waiter == NULL || httpd_req_async_handler_begin(req, &async_req) != ESP_OK) {
+        xSemaphoreGive(waiters_lock);
+        return false;
+    }
+    waiter->req = async_req;
+    waiter->id = id;
+    waiter->base64 = base64;
+    waiter->deadline_us = esp_timer_get_time() + (int64_t)API_DATA_MAX_WAIT_MS * 1000;
+    waiter_count.fetch_add(1);
+    xSemaphoreGive(waiters_lock);
+
+    // Посылка могла завершиться до регистрации - проверит задача
+    xTaskNotifyGive(wait_task);
+    return true;
+}
+
+/**
+ * HTTP обработчик передачи в порт
+ *
+ * POST /api/send - тело запроса передается в порт как есть (hex=1 - тело
+ * в шестнадцатеричном виде, "01 03 00 00"). Параметры в строке запроса:
+ * char_gap_us=<мкс> - пауза между байтами, frame_gap_ms=<мс> - пауза после
+ * посылки, timeout=<мс> - ждать ответа устройства, encoding=base64 - ответ
+ * в base64. Без timeout ответ 202 с номером посылки сразу после постановки
+ * в очередь, с timeout - ответ устройства (принятое с начала передачи до
+ * конца кадра или паузы) после его завершения или таймаута. Очередь
+ * заполнена - 429 (повторить позже), посылка длиннее UART_TX_MAX_PAYLOAD - 413.
+ */
+static esp_err_t api_send_handler(httpd_req_t *req)
+{
+    char query[128] = "";
+    char value[16];
+    uart_tx_options_t options = {};
+    bool hex = false;
+    bool base64 = false;
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "char_gap_us", value, sizeof(value)) == ESP_OK) {
+            options.char_gap_us = (uint32_t)strtoul(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "frame_gap_ms", value, sizeof(value)) == ESP_OK) {
+            options.frame_gap_ms = (uint32_t)strtoul(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "timeout", value, sizeof(value)) == ESP_OK) {
+            options.timeout_ms = (uint32_t)strtoul(value, NULL, 10);
+        }
+        hex = httpd_query_key_value(query, "hex", value, sizeof(value)) == ESP_OK &&
+              strcmp(value, "1") == 0;
+        base64 = httpd_query_key_value(query, "encoding", value, sizeof(value)) == ESP_OK &&
+                 strcmp(value, "base64") == 0;
+    }
+
+    size_t limit = hex ? sizeof(send_body) : UART_TX_MAX_PAYLOAD;
+    if (req->content_len > limit) {
+        httpd_resp_set_status(req, "413 Payload Too Large");
+        httpd_resp_set_type(req, "text/plain");
+        httpd_resp_send(req, "Payload exceeds UART_TX_MAX_PAYLOAD", HTTPD_RESP_USE_STRLEN);
+        return ESP_FAIL;
+    }
+    int body_len = read_body(req, send_body, limit);
+    if (body_len < 0) {
+        return ESP_FAIL;
+    }
+    size_t received = (size_t)body_len;
+
+    const uint8_t *payload = (const uint8_t *)send_body;
+    size_t length = received;
+    if (hex) {
+        int n = parse_hex(send_body, received, send_payload, sizeof(send_payload));
+        if (n < 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid hex payload");
+            return ESP_FAIL;
+        }
+        payload = send_payload;
+        length = (size_t)n;
+    }
+
+    uint32_t id = 0;
+    esp_err_t ret = uart_tx_submit(payload, length, &options, 0,
+                                   options.timeout_ms > 0 ? send_done : NULL, NULL, &id);
+    if (ret == ESP_ERR_TIMEOUT) {
+        httpd_resp_set_status(req, "429 Too Many Requests");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        httpd_resp_set_type(req, "text/plain");
+        httpd_resp_send(req, "TX queue is full", HTTPD_RESP_USE_STRLEN);
+        return ESP_OK;
+    }
+    if (ret == ESP_ERR_INVALID_STATE) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "TX queue is not running");
+        return ESP_FAIL;
+    }
+    if (ret != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Empty payload or invalid send options");
+        return ESP_FAIL;
+    }
+
+    // Ответ устройства ждет задача http_wait; если ее слоты заняты,
+    // клиент получает номер посылки и спрашивает результат сам
+    if (options.timeout_ms > 0 && send_wait_begin(req, id, base64)) {
+        return ESP_OK;
+    }
+    uart_tx_result_t result;
+    if (!uart_tx_get_result(id, &result)) {
+        result.id = id;
+        result.state = UART_TX_QUEUED;
+        result.length = (uint32_t)length;
+        result.sent = 0;
+    }
+    return send_result_response(req, &result, base64);
+}
+
+/**
+ * HTTP обработчик состояния передачи
+ *
+ * GET /api/send          - очередь передачи и счетчики
+ * GET /api/send?id=<N>   - состояние и ответ посылки N (последние UART_TX_RESULTS)
+ */
+static esp_err_t api_send_status_handler(httpd_req_t *req)
+{
+    char query[64] = "";
+    char value[16];
+    bool base64 = false;
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        base64 = httpd_query_key_value(query, "encoding", value, sizeof(value)) == ESP_OK &&
+                 strcmp(value, "base64") == 0;
+        if (httpd_query_key_value(query, "id", value, sizeof(value)) == ESP_OK) {
+            uart_tx_result_t result;
+            if (!uart_tx_get_result((uint32_t)strtoul(value, NULL, 10), &result)) {
+                httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown or expired send id");
+                return ESP_FAIL;
+            }
+            return send_result_response(req, &result, base64);
+        }
+    }
+
+    uart_tx_stats_t stats;
+    uart_tx_get_stats(&stats);
+
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_kv_uint(&w, "depth", stats.depth);
+    json_kv_uint(&w, "capacity", UART_TX_QUEUE_LEN);
+    json_kv_uint(&w, "max_payload", UART_TX_MAX_PAYLOAD);
+    json_kv_uint(&w, "submitted", stats.submitted);
+    json_kv_uint(&w, "rejected", stats.rejected);
+    json_kv_uint(&w, "tx_bytes", stats.tx_bytes);
+    json_kv_uint(&w, "timeouts", stats.timeouts);
+    json_end_object(&w);
+    return json_response_end(req, &w);
+}
+
+/**
+ * HTTP обработчик уровней вывода журнала
+ */
+static esp_err_t api_log_get_handler(httpd_req_t *req)
+{
+    dlog_stats_t stats;
+    dlog_get_stats(&stats);
+
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_key(&w, "levels");
+    json_begin_object(&w);
+    for (int tag = 0; tag < DLOG_TAG_COUNT; tag++) {
+        json_kv_string(&w, dlog_tag_name((dlog_tag_t)tag),
+                       dlog_level_name(dlog_get_level((dlog_tag_t)tag)));
+    }
+    json_end_object(&w);
+    json_kv_uint(&w, "ring_size", DLOG_RING_SIZE);
+    json_kv_uint(&w, "rate_per_sec", DLOG_RATE_PER_SEC);
+    json_kv_uint(&w, "recorded", stats.recorded);
+    json_kv_uint(&w, "dropped", stats.dropped);
+    json_kv_uint(&w, "suppressed", stats.suppressed);
+    json_kv_uint(&w, "emitted", stats.emitted);
+    json_end_object(&w);
+
+    return json_response_end(req, &w);
+}
+
+/**
+ * HTTP обработчик смены уровня вывода журнала
+ *
+ * POST /api/log с параметрами в теле (form) или в строке запроса:
+ * tag=<тег модуля|*>&level=<none|error|warn|info|debug|verbose>
+ * Без tag уровень меняется для всех тегов.
+ */
+static esp_err_t api_log_set_apply(httpd_req_t *req, const char *params)
+{
+    char tag[24] = "*";
+    char value[16];
+
+    esp_log_level_t level;
+    if (httpd_query_key_value(params, "level", value, sizeof(value)) != ESP_OK ||
+        !dlog_parse_level(value, &level)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid log level");
+        return ESP_FAIL;
+    }
+    httpd_query_key_value(params, "tag", tag, sizeof(tag));
+    if (tag[0] == '\0') {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid tag");
+        return ESP_FAIL;
+    }
+    dlog_set_level(tag, level);
+
+    return api_log_get_handler(req);
+}
+
+static esp_err_t api_log_set_handler(httpd_req_t *req)
+{
+    return with_form_params(req, api_log_set_apply);
+}
+
+/**
+ * HTTP обработчик состояния потоковых клиентов
+ *
+ * Для каждого транспорта: бюджет отставания, политика, число отключений
+ * и занятые слоты с текущим отставанием и пропусками.
+ */
+static esp_err_t api_clients_get_handler(httpd_req_t *req)
+{
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_kv_uint(&w, "seq", web_server_data_seq());
+    json_kv_uint(&w, "buffer_size", DATA_BUFFER_SIZE);
+    json_key(&w, "transports");
+    json_begin_object(&w);
+    for (int t = 0; t < FANOUT_TRANSPORT_COUNT; t++) {
+        fanout_transport_t transport = (fanout_transport_t)t;
+        uint32_t budget;
+        fanout_policy_t policy;
+        fanout_get_policy(transport, &budget, &policy);
+
+        json_key(&w, fanout_transport_name(transport));
+        json_begin_object(&w);
+        json_kv_uint(&w, "budget", budget);
+        json_kv_string(&w, "policy", fanout_policy_name(policy));
+        json_kv_uint(&w, "evictions", fanout_evictions(transport));
+        json_key(&w, "clients");
+        json_begin_array(&w);
+        for (int i = 0; i < fanout_slot_count(transport); i++) {
+            fanout_client_t *client = fanout_slot(transport, i);
+            if (!client->active.load(std::memory_order_acquire)) {
+                continue;
+            }
+            json_begin_object(&w);
+            json_kv_int(&w, "slot", i);
+            json_kv_uint(&w, "lag", metric_get(&client->lag));
+            json_kv_uint(&w, "dropped", metric_get(&client->dropped));
+            json_kv_uint(&w, "gaps", metric_get(&client->gaps));
+            json_end_object(&w);
+        }
+        json_end_array(&w);
+        json_end_object(&w);
+    }
+    json_end_object(&w);
+    json_end_object(&w);
+
+    return json_response_end(req, &w);
+}
+
+/**
+ * HTTP обработчик смены бюджета отставания транспорта
+ *
+ * POST /api/clients с параметрами в теле (form) или в строке запроса:
+ * transport=<http|ws|tcp|sse>&budget=<байт>&policy=<gap|disconnect>
+ * Не указанные параметры не меняются. Действует и на подключенных клиентов.
+ */
+static esp_err_t api_clients_set_apply(httpd_req_t *req, const char *params)
+{
+    char value[16];
+
+    fanout_transport_t transport;
+    if (httpd_query_key_value(params, "transport", value, sizeof(value)) != ESP_OK ||
+        !fanout_parse_transport(value, &transport)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid transport");
+        return ESP_FAIL;
+    }
+
+    uint32_t budget;
+    fanout_policy_t policy;
+    fanout_get_policy(transport, &budget, &policy);
+    if (httpd_query_key_value(params, "budget", value, sizeof(value)) == ESP_OK) {
+        char *end = NULL;
+        budget = (uint32_t)strtoul(value, &end, 10);
+        if (end == value || *end != '\0') {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid budget");
+            return ESP_FAIL;
+        }
+    }
+    if (httpd_query_key_value(params, "policy", value, sizeof(value)) == ESP_OK &&
+        !fanout_parse_policy(value, &policy)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid policy");
+        return ESP_FAIL;
+    }
+    fanout_set_policy(transport, budget, policy);
+
+    return api_clients_get_handler(req);
+}
+
+static esp_err_t api_clients_set_handler(httpd_req_t *req)
+{
+    return with_form_params(req, api_clients_set_apply);
+}
+
+/**
+ * HTTP обработчик параметров выделения кадров
+ */
+static esp_err_t api_framer_get_handler(httpd_req_t *req)
+{
+    framer_config_t config;
+    web_server_get_framer(&config);
+
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_kv_string(&w, "mode", framer_mode_name(config.mode));
+    json_kv_string(&w, "eol", framer_eol_name(config.eol));
+    json_kv_uint(&w, "length", config.fixed_length);
+    json_kv_uint(&w, "len_offset", config.len_offset);
+    json_kv_uint(&w, "len_size", config.len_size);
+    json_kv_string(&w, "len_endian", config.len_big_endian ? "big" : "little");
+    json_kv_int(&w, "len_adjust", config.len_adjust);
+    json_kv_uint(&w, "max_frame", FRAMER_MAX_FRAME);
+    json_kv_uint(&w, "frames", metric_get(&framer_frames));
+    json_kv_uint(&w, "partial", metric_get(&framer_partial));
+    json_kv_uint(&w, "errors", metric_get(&framer_errors));
+    json_kv_bool(&w, "active", framing_active.load(std::memory_order_relaxed));
+    json_kv_uint(&w, "boundary", frame_boundary.load(std::memory_order_acquire));
+    json_kv_uint(&w, "seq", web_server_data_seq());
+    json_end_object(&w);
+
+    return json_response_end(req, &w);
+}
+
+/**
+ * HTTP обработчик смены режима выделения кадров
+ *
+ * POST /api/framer с параметрами в теле (form) или в строке запроса:
+ * mode=<none|line|fixed|length|slip|cobs|idle>, eol=<lf|cr|any>,
+ * length=<байт> (fixed), len_offset=<байт>, len_size=<1|2>,
+ * len_endian=<big|little>, len_adjust=<поправка> (length).
+ * Не указанные параметры не меняются. Начатый кадр при смене сбрасывается.
+ */
+static esp_err_t api_framer_set_apply(httpd_req_t *req, const char *params)
+{
+    char value[16];
+
+    framer_config_t config;
+    web_server_get_framer(&config);
+
+    bool valid = true;
+    if (httpd_query_key_value(params, "mode", value, sizeof(value)) == ESP_OK) {
+        valid = valid && framer_parse_mode(value, &config.mode);
+    }
+    if (httpd_query_key_value(params, "eol", value, sizeof(value)) == ESP_OK) {
+        valid = valid && framer_parse_eol(value, &config.eol);
+    }
+    if (httpd_query_key_value(params, "length", value, sizeof(value)) == ESP_OK) {
+        long n = strtol(value, NULL, 10);
+        valid = valid && n > 0 && n <= UINT16_MAX;
+        config.fixed_length = (uint16_t)n;
+    }
+    if (httpd_query_key_value(params, "len_offset", value, sizeof(value)) == ESP_OK) {
+        long n = strtol(value, NULL, 10);
+        valid = valid && n >= 0 && n <= UINT8_MAX;
+        config.len_offset = (uint8_t)n;
+    }
+    if (httpd_query_key_value(params, "len_size", value, sizeof(value)) == ESP_OK) {
+        config.len_size = (uint8_t)strtol(value, NULL, 10);
+    }
+    if (httpd_query_key_value(params, "len_endian", value, sizeof(value)) == ESP_OK) {
+        valid = valid && (strcmp(value, "big") == 0 || strcmp(value, "little") == 0);
+        config.len_big_endian = strcmp(value, "big") == 0;
+    }
+    if (httpd_query_key_value(params, "len_adjust", value, sizeof(value)) == ESP_OK) {
+        long n = strtol(value, NULL, 10);
+        valid = valid && n >= INT16_MIN && n <= INT16_MAX;
+        config.len_adjust = (int16_t)n;
+    }
+    if (!valid || !web_server_set_framer(&config)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid framer parameters");
+        return ESP_FAIL;
+    }
+
+    return api_framer_get_handler(req);
+}
+
+static esp_err_t api_framer_set_handler(httpd_req_t *req)
+{
+    return with_form_params(req, api_framer_set_apply);
+}
+
+/**
+ * HTTP обработчик политики пакетирования
+ */
+static esp_err_t api_batch_get_handler(httpd_req_t *req)
+{
+    batch_rate_t rate;
+    batch_get_rate(&rate);
+
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_key(&w, "rate");
+    json_begin_object(&w);
+    json_kv_uint(&w, "interval_us", rate.interval_us);
+    json_kv_uint(&w, "chunk_bytes", rate.chunk_bytes);
+    json_end_object(&w);
+    for (int t = 0; t < FANOUT_TRANSPORT_COUNT; t++) {
+        batch_config_t config;
+        batch_stats_t stats;
+        batch_get_config((fanout_transport_t)t, &config);
+        batch_get_stats((fanout_transport_t)t, &stats);
+        json_key(&w, fanout_transport_name((fanout_transport_t)t));
+        json_begin_object(&w);
+        json_kv_string(&w, "mode", batch_mode_name(config.mode));
+        json_kv_uint(&w, "max_bytes", config.max_bytes);
+        json_kv_uint(&w, "max_delay_us", config.max_delay_us);
+        json_kv_bool(&w, "flush_on_frame", config.flush_on_frame);
+        json_kv_uint(&w, "packets", stats.packets);
+        json_kv_uint(&w, "bytes", stats.bytes);
+        json_end_object(&w);
+    }
+    json_end_object(&w);
+
+    return json_response_end(req, &w);
+}
+
+/**
+ * HTTP обработчик смены политики пакетирования
+ *
+ * POST /api/batch с параметрами в теле (form) или в строке запроса:
+ * transport=<http|ws|tcp|sse>, mode=<immediate|fixed|adaptive|nagle>,
+ * max_bytes=<байт>, max_delay_us=<мкс>, flush_on_frame=<0|1>.
+ * Не указанные параметры не меняются. TCP_NODELAY и буфер сокета
+ * подключенных клиентов перенастраиваются при следующей отправке.
+ */
+static esp_err_t api_batch_set_apply(httpd_req_t *req, const char *params)
+{
+    char value[16];
+
+    fanout_transport_t transport;
+    if (httpd_query_key_value(params, "transport", value, sizeof(value)) != ESP_OK ||
+        !fanout_parse_transport(value, &transport)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid transport");
+        return ESP_FAIL;
+    }
+
+    batch_config_t config;
+    batch_get_config(transport, &config);
+
+    bool valid = true;
+    if (httpd_query_key_value(params, "mode", value, sizeof(value)) == ESP_OK) {
+        valid = valid && batch_parse_mode(value, &config.mode);
+    }
+    if (httpd_query_key_value(params, "max_bytes", value, sizeof(value)) == ESP_OK) {
+        config.max_bytes = (uint32_t)strtoul(value, NULL, 10);
+    }
+    if (httpd_query_key_value(params, "max_delay_us", value, sizeof(value)) == ESP_OK) {
+        config.max_delay_us = (uint32_t)strtoul(value, NULL, 10);
+    }
+    if (httpd_query_key_value(params, "flush_on_frame", value, sizeof(value)) == ESP_OK) {
+        valid = valid && (strcmp(value, "0") == 0 || strcmp(value, "1") == 0);
+        config.flush_on_frame = strcmp(value, "1") == 0;
+    }
+    if (!valid || !batch_set_config(transport, &config)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid batch parameters");
+        return ESP_FAIL;
+    }
+
+    return api_batch_get_handler(req);
+}
+
+static esp_err_t api_batch_set_handler(httpd_req_t *req)
+{
+    return with_form_params(req, api_batch_set_apply);
+}
+
+/**
+ * Значение параметра формы с раскодированием %XX и '+' (SSID и пароли
+ * могут содержать пробелы и любые символы). Раскодируется прямо из params,
+ * без промежуточной копии закодированного значения.
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND (нет параметра; out не меняется) или
+ *         ESP_ERR_INVALID_SIZE (не помещается в буфер)
+ */
+static esp_err_t form_value(const char *params, const char *key, char *out, size_t size)
+{
+    size_t key_len = strlen(key);
+    const char *raw = NULL;
+    const char *raw_end = NULL;
+    for (const char *p = params; *p != '\0' && raw == NULL; ) {
+        const char *end = strchr(p, '&');
+        if (end == NULL) {
+            end = p + strlen(p);
+        }
+        if ((size_t)(end - p) > key_len && strncmp(p, key, key_len) == 0 && p[key_len] == '=') {
+            raw = p + key_len + 1;
+            raw_end = end;
+        }
+        p = *end == '&' ? end + 1 : end;
+    }
+    if (raw == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    size_t n = 0;
+    for (const char *p = raw; p < raw_end; p++) {
+        char c = *p;
+        if (c == '+') {
+            c = ' ';
+        } else if (c == '%' && isxdigit((unsigned char)p[1]) && isxdigit((unsigned char)p[2])) {
+            char hex[3] = { p[1], p[2], '\0' };
+            c = (char)strtoul(hex, NULL, 16);
+            p += 2;
+        }
+        if (n + 1 >= size) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        out[n++] = c;
+    }
+    out[n] = '\0';
+    return ESP_OK;
+}
+
+/**
+ * HTTP обработчик состояния WiFi
+ *
+ * Пароли не выдаются: только признак, что они заданы.
+ */
+static esp_err_t api_wifi_get_handler(httpd_req_t *req)
+{
+    wifi_manager_config_t config;
+    wifi_manager_info_t info;
+    wifi_manager_get_config(&config);
+    wifi_manager_get_info(&info);
+
+    char bssid[18];
+    snprintf(bssid, sizeof(bssid), "%02x:%02x:%02x:%02x:%02x:%02x", info.bssid[0],
+             info.bssid[1], info.bssid[2], info.bssid[3], info.bssid[4], info.bssid[5]);
+
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_kv_string(&w, "mode", wifi_manager_mode_name(config.mode));
+    json_kv_string(&w, "power_save", wifi_manager_ps_name(config.power_save));
+    json_kv_uint(&w, "tx_power", config.tx_power_dbm);
+    json_key(&w, "station");
+    json_begin_object(&w);
+    json_kv_string(&w, "ssid", config.ssid);
+    json_kv_bool(&w, "has_password", config.password[0] != '\0');
+    json_kv_string(&w, "status", wifi_status_name(info.status));
+    json_kv_string(&w, "ip", info.ip);
+    json_kv_string(&w, "bssid", bssid);
+    json_kv_uint(&w, "channel", info.channel);
+    json_kv_int(&w, "rssi", info.rssi);
+    json_kv_bool(&w, "fast_reconnect", info.fast_reconnect);
+    json_kv_uint(&w, "connects", info.connects);
+    json_kv_uint(&w, "disconnects", info.disconnects);
+    json_kv_uint(&w, "attempt", info.attempt);
+    json_kv_uint(&w, "retry_delay_ms", info.retry_delay_ms);
+    json_kv_uint(&w, "last_reason", info.last_reason);
+    json_kv_uint(&w, "last_connect_ms", info.last_connect_ms);
+    json_kv_uint(&w, "last_outage_ms", info.last_outage_ms);
+    json_end_object(&w);
+    json_key(&w, "ap");
+    json_begin_object(&w);
+    json_kv_string(&w, "ssid", config.ap_ssid);
+    json_kv_bool(&w, "has_password", config.ap_password[0] != '\0');
+    json_kv_uint(&w, "channel", config.ap_channel);
+    json_kv_uint(&w, "clients", info.ap_clients);
+    json_end_object(&w);
+    json_end_object(&w);
+
+    return json_response_end(req, &w);
+}
+
+/**
+ * HTTP обработчик смены конфигурации WiFi
+ *
+ * POST /api/wifi с параметрами в теле (form) или в строке запроса:
+ * mode=<sta|ap|apsta>, ssid=<сеть>, password=<пароль>, ap_ssid=<SSID>,
+ * ap_password=<пароль>, ap_channel=<1..13>, power_save=<none|min|max>,
+ * tx_power=<дБм, 0 - по умолчанию>. Значения в кодировке формы (%XX, '+').
+ * Не указанные параметры не меняются. Конфигурация сохраняется в NVS;
+ * станция переподключается, только если изменились сеть или пароль.
+ */
+static esp_err_t api_wifi_set_apply(httpd_req_t *req, const char *params)
+{
+    char value[16];
+
+    wifi_manager_config_t config;
+    wifi_manager_get_config(&config);
+
+    bool valid = true;
+    if (form_value(params, "mode", value, sizeof(value)) == ESP_OK) {
+        valid = valid && wifi_manager_parse_mode(value, &config.mode);
+    }
+    valid = valid &&
+            form_value(params, "ssid", config.ssid, sizeof(config.ssid)) != ESP_ERR_INVALID_SIZE &&
+            form_value(params, "password", config.password, sizeof(config.password)) !=
+                ESP_ERR_INVALID_SIZE &&
+            form_value(params, "ap_ssid", config.ap_ssid, sizeof(config.ap_ssid)) !=
+                ESP_ERR_INVALID_SIZE &&
+            form_value(params, "ap_password", config.ap_password, sizeof(config.ap_password)) !=
+                ESP_ERR_INVALID_SIZE;
+    if (form_value(params, "ap_channel", value, sizeof(value)) == ESP_OK) {
+        long n = strtol(value, NULL, 10);
+        valid = valid && n >= 1 && n <= 13;
+        config.ap_channel = (uint8_t)n;
+    }
+    if (form_value(params, "power_save", value, sizeof(value)) == ESP_OK) {
+        valid = valid && wifi_manager_parse_ps(value, &config.power_save);
+    }
+    if (form_value(params, "tx_power", value, sizeof(value)) == ESP_OK) {
+        long n = strtol(value, NULL, 10);
+        valid = valid && n >= 0 && n <= UINT8_MAX;
+        config.tx_power_dbm = (uint8_t)n;
+    }
+    if (!valid || !wifi_manager_config_valid(&config)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid WiFi parameters");
+        return ESP_FAIL;
+    }
+    if (!wifi_reconfigure(&config)) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Reconfigure failed");
+        return ESP_FAIL;
+    }
+
+    return api_wifi_get_handler(req);
+}
+
+static esp_err_t api_wifi_set_handler(httpd_req_t *req)
+{
+    return with_form_params(req, api_wifi_set_apply);
+}
+
+/**
+ * Этапы записи загрузки: время от старта, мкс (не достигнутые пропускаются)
+ */
+static void write_boot_record(json_writer_t *w, const boot_record_t *record)
+{
+    json_begin_object(w);
+    json_kv_uint(w, "boot_count", record->boot_count);
+    json_kv_string(w, "reset_reason", boot_reset_reason_name(record->reset_reason));
+    json_kv_uint(w, "carried_bytes", record->carried_bytes);
+    json_key(w, "stages_us");
+    json_begin_object(w);
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        if (record->stage_us[i] != 0) {
+            json_kv_uint(w, boot_stage_name((boot_stage_t)i), record->stage_us[i]);
+        }
+    }
+    json_end_object(w);
+    json_end_object(w);
+}
+
+/**
+ * HTTP обработчик отметок загрузки: текущий запуск и предыдущий, если
+ * его запись пережила программный сброс
+ */
+static esp_err_t api_boot_handler(httpd_req_t *req)
+{
+    boot_record_t current;
+    boot_record_t previous;
+    bool has_previous = boot_get_records(&current, &previous);
+
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_kv_uint64(&w, "uptime_us", (uint64_t)esp_timer_get_time());
+    json_key(&w, "current");
+    write_boot_record(&w, &current);
+    json_key(&w, "previous");
+    if (has_previous) {
+        write_boot_record(&w, &previous);
+    } else {
+        json_null(&w);
+    }
+    json_end_object(&w);
+
+    return json_response_end(req, &w);
+}
+
+/**
+ * HTTP обработчик метрик в текстовом формате Prometheus
+ */
+static esp_err_t api_metrics_handler(httpd_req_t *req)
+{
+    // Запас стека задачи HTTP сервера виден только из нее самой
+    metrics_watch_task(xTaskGetCurrentTaskHandle());
+
+    char *buf = (char *)buffer_pool_borrow();
+    if (buf == NULL) {
+        send_pool_exhausted(req);
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    bool ok = metrics_write(httpd_chunk_flush, req, buf, BUFFER_POOL_BLOCK_SIZE);
+    buffer_pool_return(buf);
+    return ok ? httpd_resp_send_chunk(req, NULL, 0) : ESP_FAIL;
+}
+
+/**
+ * HTTP обработчик снимка задач FreeRTOS
+ *
+ * GET /api/tasks: задачи по убыванию приоритета с долей процессора за
+ * окно (время с предыдущего запроса), пробуждения простоя и дрожание
+ * приема за то же окно. Для замера - два запроса с паузой между ними.
+ */
+static esp_err_t api_tasks_handler(httpd_req_t *req)
+{
+    static diag_task_t tasks[DIAG_MAX_TASKS];
+    diag_summary_t summary;
+    size_t count = diag_get_tasks(tasks, DIAG_MAX_TASKS, &summary);
+    uint64_t window_ms = summary.window_us / 1000;
+
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_kv_bool(&w, "diagnostics", COMTOAIR_DIAGNOSTICS != 0);
+    json_kv_bool(&w, "run_time_stats", summary.run_time_stats);
+    json_kv_uint64(&w, "run_time_us", summary.run_time_us);
+    json_kv_uint64(&w, "window_us", summary.window_us);
+    json_kv_uint(&w, "task_count", summary.task_count);
+    json_kv_uint(&w, "idle_permille", summary.idle_permille);
+    json_kv_uint(&w, "idle_wakeups", summary.idle_wakeups);
+    json_kv_uint(&w, "idle_wakeups_per_sec",
+                 window_ms > 0 ? (uint32_t)(summary.window_wakeups * 1000ULL / window_ms) : 0);
+    json_key(&w, "rx_jitter");
+    json_begin_object(&w);
+    json_kv_uint(&w, "samples", summary.rx_jitter_samples);
+    json_kv_uint(&w, "mean_us", summary.rx_jitter_mean_us);
+    json_kv_uint(&w, "max_us", summary.rx_jitter_max_us);
+    json_end_object(&w);
+#if COMTOAIR_DIAGNOSTICS
+    json_kv_uint(&w, "rx_pin_edges", summary.rx_pin_edges);
+#endif
+    json_key(&w, "tasks");
+    json_begin_array(&w);
+    for (size_t i = 0; i < count; i++) {
+        json_begin_object(&w);
+        json_kv_string(&w, "name", tasks[i].name);
+        json_kv_uint(&w, "number", tasks[i].number);
+        json_kv_string(&w, "state", tasks[i].state);
+        json_kv_uint(&w, "priority", tasks[i].priority);
+        json_kv_uint(&w, "base_priority", tasks[i].base_priority);
+        json_kv_uint(&w, "stack_free", tasks[i].stack_free);
+        json_kv_uint64(&w, "run_time_us", tasks[i].run_time_us);
+        json_kv_uint(&w, "cpu_permille", tasks[i].cpu_permille);
+        json_end_object(&w);
+    }
+    json_end_array(&w);
+    json_end_object(&w);
+
+    return json_response_end(req, &w);
+}
+
+/**
+ * HTTP обработчик запаса памяти
+ *
+ * GET /api/memory: пул буферов ответов (занято, наибольшее занятое с
+ * запуска, отказы), куча (свободно, минимум с запуска, наибольший
+ * свободный блок - признак фрагментации) и запас стека каждой задачи с
+ * запуска, от меньшего к большему; stack_size - размер из config.h
+ * (null у системных задач).
+ */
+static esp_err_t api_memory_handler(httpd_req_t *req)
+{
+    static diag_stack_t stacks[DIAG_MAX_TASKS];
+    // Запас стека задачи HTTP сервера виден только из нее самой
+    metrics_watch_task(xTaskGetCurrentTaskHandle());
+    size_t count = diag_get_stacks(stacks, DIAG_MAX_TASKS);
+    buffer_pool_stats_t pool;
+    buffer_pool_get_stats(&pool);
+
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_key(&w, "pool");
+    json_begin_object(&w);
+    json_kv_uint(&w, "block_size", pool.block_size);
+    json_kv_uint(&w, "blocks", pool.blocks);
+    json_kv_uint(&w, "in_use", pool.in_use);
+    json_kv_uint(&w, "peak", pool.peak);
+    json_kv_uint(&w, "borrows", pool.borrows);
+    json_kv_uint(&w, "exhausted", pool.exhausted);
+    json_end_object(&w);
+    json_key(&w, "heap");
+    json_begin_object(&w);
+    json_kv_uint(&w, "free", esp_get_free_heap_size());
+    json_kv_uint(&w, "min_free", esp_get_minimum_free_heap_size());
+    json_kv_uint(&w, "largest_free_block",
+                 (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT));
+    json_end_object(&w);
+    json_key(&w, "tasks");
+    json_begin_array(&w);
+    for (size_t i = 0; i < count; i++) {
+        json_begin_object(&w);
+        json_kv_string(&w, "name", stacks[i].name);
+        json_key(&w, "stack_size");
+        if (stacks[i].stack_size != 0) {
+            json_uint(&w, stacks[i].stack_size);
+        } else {
+            json_null(&w);
+        }
+        json_kv_uint(&w, "stack_free", stacks[i].stack_free);
+        json_end_object(&w);
+    }
+    json_end_array(&w);
+    json_end_object(&w);
+
+    return json_response_end(req, &w);
+}
+
+/**
+ * Образец как JSON: текст (байты вне UTF-8 - \u00XX) и hex
+ */
+static void write_trigger_def(json_writer_t *w, int index, const trigger_def_t *def,
+                              uint32_t now_ms)
+{
+    char hex[TRIGGER_PATTERN_MAX * 2 + 1];
+    for (int i = 0; i < def->length; i++) {
+        snprintf(hex + i * 2, 3, "%02x", def->pattern[i]);
+    }
+    hex[def->length * 2] = '\0';
+
+    trigger_stats_t stats;
+    trigger_get_stats(index, &stats);
+
+    json_begin_object(w);
+    json_kv_int(w, "id", index);
+    json_kv_string(w, "name", def->name);
+    json_key(w, "pattern");
+    json_string_bytes(w, def->pattern, def->length);
+    json_kv_string(w, "hex", hex);
+    json_key(w, "port");
+    if (def->port == TRIGGER_ANY_PORT) {
+        json_null(w);
+    } else {
+        json_int(w, def->port);
+    }
+    json_kv_uint(w, "matches", stats.matches);
+    json_kv_uint(w, "events", stats.events);
+    json_kv_uint(w, "last_seq", stats.last_seq);
+    json_key(w, "age_ms");
+    if (stats.matches != 0) {
+        json_uint(w, now_ms - stats.last_ms);
+    } else {
+        json_null(w);
+    }
+    json_end_object(w);
+}
+
+/**
+ * HTTP обработчик списка триггеров
+ *
+ * GET /api/triggers
+ * {"states":..,"max_states":..,"classes":..,"max_classes":..,"event_head":..,
+ *  "triggers":[{"id":..,"name":..,"pattern":..,"hex":..,"port":<N|null>,
+ *               "matches":..,"events":..,"last_seq":..,"age_ms":..},..]}
+ */
+static esp_err_t api_triggers_get_handler(httpd_req_t *req)
+{
+    static trigger_config_t config;
+    trigger_get_config(&config);
+    uint32_t states;
+    uint32_t classes;
+    trigger_get_usage(&states, &classes);
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_kv_uint(&w, "states", states);
+    json_kv_uint(&w, "max_states", TRIGGER_MAX_STATES);
+    json_kv_uint(&w, "classes", classes);
+    json_kv_uint(&w, "max_classes", TRIGGER_MAX_CLASSES);
+    json_kv_uint(&w, "holdoff_ms", TRIGGER_HOLDOFF_MS);
+    json_kv_uint(&w, "event_head", trigger_event_head());
+    json_key(&w, "triggers");
+    json_begin_array(&w);
+    for (int k = 0; k < TRIGGER_MAX_PATTERNS; k++) {
+        if (config.defs[k].length != 0) {
+            write_trigger_def(&w, k, &config.defs[k], now_ms);
+        }
+    }
+    json_end_array(&w);
+    json_end_object(&w);
+
+    return json_response_end(req, &w);
+}
+
+/**
+ * HTTP обработчик изменения триггеров (набор сохраняется в NVS)
+ *
+ * POST /api/triggers
+ *   pattern=<текст> или hex=<байты> [&name=..][&port=<N>][&id=<слот>]
+ *       - задать образец (без id - первый свободный слот; без port - все порты)
+ *   id=<слот>&delete=1 - удалить образец
+ *   clear=1            - удалить все
+ */
+static esp_err_t api_triggers_set_apply(httpd_req_t *req, const char *params)
+{
+    static trigger_config_t config;
+    char value[TRIGGER_PATTERN_MAX * 3 + 1];
+
+    trigger_get_config(&config);
+
+    int index = -1;
+    if (httpd_query_key_value(params, "id", value, sizeof(value)) == ESP_OK) {
+        char *end;
+        long n = strtol(value, &end, 10);
+        if (*end != '\0' || n < 0 || n >= TRIGGER_MAX_PATTERNS) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid trigger id");
+            return ESP_FAIL;
+        }
+        index = (int)n;
+    }
+
+    if (httpd_query_key_value(params, "clear", value, sizeof(value)) == ESP_OK &&
+        strcmp(value, "1") == 0) {
+        memset(&config, 0, sizeof(config));
+    } else if (httpd_query_key_value(params, "delete", value, sizeof(value)) == ESP_OK &&
+               strcmp(value, "1") == 0) {
+        if (index < 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "delete requires id");
+            return ESP_FAIL;
+        }
+        memset(&config.defs[index], 0, sizeof(config.defs[index]));
+    } else {
+        trigger_def_t def;
+        memset(&def, 0, sizeof(def));
+        def.port = TRIGGER_ANY_PORT;
+
+        int length = -1;
+        esp_err_t ret = form_value(params, "pattern", value, sizeof(value));
+        if (ret != ESP_ERR_NOT_FOUND) {
+            size_t n = ret == ESP_OK ? strlen(value) : sizeof(value);
+            if (n <= TRIGGER_PATTERN_MAX) {
+                memcpy(def.pattern, value, n);
+                length = (int)n;
+            }
+        } else if (httpd_query_key_value(params, "hex", value, sizeof(value)) == ESP_OK) {
+            length = parse_hex(value, strlen(value), def.pattern, sizeof(def.pattern));
+        } else {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "pattern or hex required");
+            return ESP_FAIL;
+        }
+        if (length <= 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Pattern empty, invalid or too long");
+            return ESP_FAIL;
+        }
+        def.length = (uint8_t)length;
+
+        if (form_value(params, "name", def.name, sizeof(def.name)) == ESP_ERR_INVALID_SIZE) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Name too long");
+            return ESP_FAIL;
+        }
+        if (httpd_query_key_value(params, "port", value, sizeof(value)) == ESP_OK &&
+            strcmp(value, "any") != 0) {
+            char *end;
+            long n = strtol(value, &end, 10);
+            if (*end != '\0' || n < 0 || n >= serial_port_count()) {
+                httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such port");
+                return ESP_FAIL;
+            }
+            def.port = (int8_t)n;
+        }
+
+        for (int k = 0; index < 0 && k < TRIGGER_MAX_PATTERNS; k++) {
+            if (config.defs[k].length == 0) {
+                index = k;
+            }
+        }
+        if (index < 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "All trigger slots in use");
+            return ESP_FAIL;
+        }
+        config.defs[index] = def;
+    }
+
+    const char *error = NULL;
+    if (!trigger_set_config(&config, true, &error)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error);
+        return ESP_FAIL;
+    }
+    if (error != NULL) {
+        ESP_LOGW(TAG, "%s", error);
+    }
+
+    return api_triggers_get_handler(req);
+}
+
+static esp_err_t api_triggers_set_handler(httpd_req_t *req)
+{
+    return with_form_params(req, api_triggers_set_apply);
+}
+
+/**
+ * HTTP обработчик событий триггеров
+ *
+ * GET /api/triggers/events[?since=<id>][&encoding=base64]
+ * {"head":..,"events":[{"id":..,"trigger":..,"name":..,"port":..,"seq":..,
+ *  "age_ms":..,"before":..,"after":..,"complete":..,"context":..},..]}
+ * context - TRIGGER_CONTEXT_BEFORE байт до конца совпадения и собранные
+ * байты после него. Без since - все события, оставшиеся в кольце.
+ */
+static esp_err_t api_trigger_events_handler(httpd_req_t *req)
+{
+    static trigger_config_t config;
+    uint32_t head = trigger_event_head();
+    uint32_t since = head > TRIGGER_EVENTS ? head - TRIGGER_EVENTS : 0;
+    bool base64 = false;
+    char query[64];
+    char value[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+            uint32_t requested = (uint32_t)strtoul(value, NULL, 10);
+            if (requested > since) {
+                since = requested;
+            }
+        }
+        base64 = httpd_query_key_value(query, "encoding", value, sizeof(value)) == ESP_OK &&
+                 strcmp(value, "base64") == 0;
+    }
+    trigger_get_config(&config);
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    json_writer_t w;
+    json_response_begin(req, &w);
+    json_begin_object(&w);
+    json_kv_uint(&w, "head", head);
+    json_key(&w, "events");
+    json_begin_array(&w);
+    for (uint32_t id = since; id < head; id++) {
+        trigger_event_t event;
+        if (!trigger_get_event(id, &event)) {
+            continue;
+        }
+        json_begin_object(&w);
+        json_kv_uint(&w, "id", event.id);
+        json_kv_uint(&w, "trigger", event.trigger);
+        json_kv_string(&w, "name", config.defs[event.trigger].name);
+        json_kv_uint(&w, "port", event.port);
+        json_kv_uint(&w, "seq", event.seq);
+        json_kv_uint(&w, "age_ms", now_ms - event.time_ms);
+        json_kv_uint(&w, "before", event.before);
+        json_kv_uint(&w, "after", event.after);
+        json_kv_bool(&w, "complete", event.complete);
+        json_key(&w, "context");
+        if (base64) {
+            json_base64_begin(&w);
+            json_base64_append(&w, event.context, event.before + event.after);
+            json_base64_end(&w);
+        } else {
+            json_string_bytes(&w, event.context, event.before + event.after);
+        }
+        json_end_object(&w);
+    }
+    json_end_array(&w);
+    json_end_object(&w);
+
+    return json_response_end(req, &w);
+}
+
+/**
+ * Обработчик API с учетом запросов и длительности обработки
+ */
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *req);
+    char labels[64];                    // handler="<uri>",method="<метод>"
+    metric_t requests;
+    metric_t errors;
+    metric_histogram_t duration;
+} api_route_t;
+
+static api_route_t api_routes[] = {
+    { "/api/data",              HTTP_GET,  api_data_get_handler },
+    { "/api/history",           HTTP_GET,  api_history_get_handler },
+    { "/api/capture/download",  HTTP_GET,  api_capture_download_handler },
+    { "/api/capture/status",    HTTP_GET,  api_capture_status_handler },
+    { "/api/uart/status",       HTTP_GET,  api_uart_status_handler },
+    { "/api/uart/config",       HTTP_POST, api_uart_config_handler },
+    { "/api/send",              HTTP_GET,  api_send_status_handler },
+    { "/api/send",              HTTP_POST, api_send_handler },
+    { "/api/log",               HTTP_GET,  api_log_get_handler },
+    { "/api/log",               HTTP_POST, api_log_set_handler },
+    { "/api/clients",           HTTP_GET,  api_clients_get_handler },
+    { "/api/clients",           HTTP_POST, api_clients_set_handler },
+    { "/api/framer",            HTTP_GET,  api_framer_get_handler },
+    { "/api/framer",            HTTP_POST, api_framer_set_handler },
+    { "/api/batch",             HTTP_GET,  api_batch_get_handler },
+    { "/api/batch",             HTTP_POST, api_batch_set_handler },
+    { "/api/wifi",              HTTP_GET,  api_wifi_get_handler },
+    { "/api/wifi",              HTTP_POST, api_wifi_set_handler },
+    { "/api/metrics",           HTTP_GET,  api_metrics_handler },
+    { "/api/tasks",             HTTP_GET,  api_tasks_handler },
+    { "/api/memory",            HTTP_GET,  api_memory_handler },
+    { "/api/boot",              HTTP_GET,  api_boot_handler },
+    { "/api/ports",             HTTP_GET,  api_ports_handler },
+    { "/api/ports/*",           HTTP_GET,  api_port_get_handler },
+    { "/api/ports/*",           HTTP_POST, api_port_post_handler },
+    { "/api/fields",            HTTP_GET,  api_fields_handler },
+    { "/api/triggers",          HTTP_GET,  api_triggers_get_handler },
+    { "/api/triggers",          HTTP_POST, api_triggers_set_handler },
+    { "/api/triggers/events",   HTTP_GET,  api_trigger_events_handler },
+};
+
+static esp_err_t api_route_handler(httpd_req_t *req)
+{
+    api_route_t *route = (api_route_t *)req->user_ctx;
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = route->handler(req);
+    metric_observe_us(&route->duration, (uint32_t)(esp_timer_get_time() - start_us));
+    metric_add(&route->requests, 1);
+    if (ret != ESP_OK) {
+        metric_add(&route->errors, 1);
+    }
+    return ret;
+}
+
+static void register_api_routes(void)
+{
+    for (size_t i = 0; i < sizeof(api_routes) / sizeof(api_routes[0]); i++) {
+        api_route_t *route = &api_routes[i];
+        snprintf(route->labels, sizeof(route->labels), "handler=\"%s\",method=\"%s\"",
+                 route->uri, route->method == HTTP_POST ? "POST" : "GET");
+        metrics_register(&route->requests, METRIC_COUNTER, "comtoair_http_requests_total",
+                         "HTTP API requests", route->labels);
+        metrics_register(&route->errors, METRIC_COUNTER, "comtoair_http_request_errors_total",
+                         "HTTP API requests that failed", route->labels);
+        metrics_register_histogram(&route->duration, "comtoair_http_request_duration_seconds",
+                                   "HTTP API handler time", route->labels);
+
+        httpd_uri_t uri = {
+            .uri       = route->uri,
+            .method    = route->method,
+            .handler   = api_route_handler,
+            .user_ctx  = route
+        };
+        httpd_register_uri_handler(server, &uri);
+    }
+}
+
+bool web_server_start(uint16_t port)
+{
+    if (server != NULL) {
+        return true;
+    }
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = port;
+    config.lru_purge_enable = true;
+    config.max_uri_handlers = WEB_SERVER_MAX_URI_HANDLERS;
+    config.task_priority = TASK_PRIO_HTTPD;
+    config.stack_size = TASK_STACK_HTTPD;
+    config.close_fn = web_server_close_fn;
+    // /api/ports/<N>/...: шаблоны с '*', остальные URI сравниваются целиком
+    config.uri_match_fn = httpd_uri_match_wildcard;
+
+    ESP_LOGI(TAG, "Starting web server on port: '%d'", config.server_port);
+    if (httpd_start(&server, &config) != ESP_OK) {
+        ESP_LOGE(TAG, "Error starting server!");
+        server = NULL;
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Registering URI handlers");
+
+    // Веб-интерфейс: "/" и файлы из data/ (сжаты при сборке)
+    if (!static_assets_register(server)) {
+        ESP_LOGE(TAG, "Failed to register static assets");
+    }
+
+    // HTTP API (учет запросов и длительности - api_route_handler)
+    register_api_routes();
+    metrics_register_histogram(&http_delivery, "comtoair_uart_to_client_seconds",
+                               "Time from UART receive to delivery to a client",
+                               "transport=\"http\"");
+    metrics_register(&http_dropped, METRIC_COUNTER, "comtoair_client_dropped_bytes_total",
+                     "Bytes a client skipped (overwritten or over the lag budget)",
+                     "transport=\"http\",slot=\"poll\"");
+    metrics_register(&framer_frames, METRIC_COUNTER, "comtoair_framer_frames_total",
+                     "Frames (or parts of long frames) extracted from the serial stream", NULL);
+    metrics_register(&framer_partial, METRIC_COUNTER, "comtoair_framer_partial_total",
+                     "Parts of frames longer than FRAMER_MAX_FRAME", NULL);
+    metrics_register(&framer_errors, METRIC_COUNTER, "comtoair_framer_errors_total",
+                     "Frames with SLIP/COBS encoding errors or invalid length fields", NULL);
+
+    // Ожидающие запросы /api/data?wait=
+    fanout_init();
+    batch_init();
+    if (waiters_lock == NULL) {
+        waiters_lock = xSemaphoreCreateMutex();
+    }
+    if (waiters_lock != NULL && wait_task == NULL &&
+        xTaskCreate(data_wait_task, "http_wait", TASK_STACK_HTTP_WAIT, NULL, TASK_PRIO_HTTP_WAIT,
+                    &wait_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create long-poll task");
+        wait_task = NULL;
+    }
+    metrics_watch_task(wait_task);
+
+    if (!ws_stream_register(server)) {
+        ESP_LOGE(TAG, "Failed to register WebSocket stream");
+    }
+    if (!sse_stream_register(server)) {
+        ESP_LOGE(TAG, "Failed to register event stream");
+    }
+
+    return true;
+}
+
+void web_server_stop(void)
+{
+    if (server != NULL) {
+        httpd_stop(server);
+        server = NULL;
+    }
+}
+
+bool web_server_is_running(void)
+{
+    return server != NULL;
+}
+
+size_t web_server_get_data(uint8_t *buffer, size_t length)
+{
+    // Последние length байт (или меньше, если столько еще не принято)
+    uint32_t seq = byte_ring_head(&data_ring);
+    uint32_t available = seq - byte_ring_oldest(&data_ring);
+    seq -= (available < length) ? available : (uint32_t)length;
+    return byte_ring_read(&data_ring, &seq, buffer, length, NULL);
+}
+
+/**
+ * Вывод кадра фреймером: запись журнала и новая граница целых кадров
+ */
+static void framer_emit(void *ctx, const uint8_t *frame, size_t length, uint32_t flags,
+                        uint64_t timestamp_us, uint32_t end_seq)
+{
+    capture_journal_append_frame(frame, length, timestamp_us, flags);
+    // Часть длинного кадра тоже отдается: иначе клиенты ждали бы его конца
+    frame_boundary.store(end_seq, std::memory_order_release);
+    metric_add(&framer_frames, 1);
+    if (flags & FRAMER_FLAG_PARTIAL) {
+        metric_add(&framer_partial, 1);
+    }
+    if (flags & FRAMER_FLAG_ERROR) {
+        metric_add(&framer_errors, 1);
+    }
+}
+
+/**
+ * Применение новых параметров фреймера (только в контексте писателя)
+ */
+static void framer_apply_pending(void)
+{
+    uint32_t version = framer_version.load(std::memory_order_acquire);
+    if (version == framer_applied_version) {
+        return;
+    }
+    framer_config_t config;
+    portENTER_CRITICAL(&framer_lock);
+    config = pending_framer_config;
+    portEXIT_CRITICAL(&framer_lock);
+
+    uint32_t head = byte_ring_head(&data_ring);
+    framer_init(&framer, &config, framer_emit, NULL, head);
+    frame_boundary.store(head, std::memory_order_release);
+    framing_active.store(config.mode != FRAMER_NONE, std::memory_order_release);
+    framer_applied_version = version;
+}
+
+void web_server_set_data(const uint8_t *data, size_t length)
+{
+    uint64_t now_us = (uint64_t)esp_timer_get_time();
+    framer_apply_pending();
+    uint32_t reserve = byte_ring_head(&data_ring) + (uint32_t)length;
+    data_carry.reserve = reserve;
+    data_carry.reserve_check = ~reserve;
+    // Граница записана до изменения буфера (сброс - в любой момент)
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    byte_ring_write(&data_ring, data, length);
+    uint32_t head = byte_ring_head(&data_ring);
+    data_carry.head = head;
+    data_carry.head_check = ~head;
+    boot_mark(BOOT_STAGE_FIRST_RX);
+    batch_observe(length, (int64_t)now_us);
+    if (framer.config.mode == FRAMER_NONE) {
+        capture_journal_append(data, length, now_us);
+    } else {
+        framer_feed(&framer, data, length, now_us);
+    }
+    decoder_feed(SERIAL_PORT_PRIMARY, data, length, now_us);
+    trigger_feed(SERIAL_PORT_PRIMARY, data, length, head, now_us);
+
+    uint32_t index = rx_time_head.load(std::memory_order_relaxed);
+    rx_time_slot_t *slot = &rx_times[index % DATA_RX_TIME_SLOTS];
+    slot->index.store(index - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->end_seq.store(head, std::memory_order_relaxed);
+    slot->time_us.store((uint32_t)now_us, std::memory_order_relaxed);
+    slot->index.store(index, std::memory_order_release);
+    rx_time_head.store(index + 1, std::memory_order_release);
+
+    if (waiter_count.load(std::memory_order_relaxed) > 0 && wait_task != NULL) {
+        xTaskNotifyGive(wait_task);
+    }
+    ws_stream_notify();
+    sse_stream_notify();
+    tcp_server_notify();
+    flash_log_notify();
+    uart_tx_notify();
+}
+
+void web_server_data_idle(void)
+{
+    framer_apply_pending();
+    if (!framer_pending(&framer)) {
+        return;
+    }
+    uint32_t boundary = frame_boundary.load(std::memory_order_relaxed);
+    framer_idle(&framer);
+    if (frame_boundary.load(std::memory_order_relaxed) == boundary) {
+        return;
+    }
+    // Пауза завершила кадр - его ждут клиенты, уже знающие о байтах
+    if (waiter_count.load(std::memory_order_relaxed) > 0 && wait_task != NULL) {
+        xTaskNotifyGive(wait_task);
+    }
+    ws_stream_notify();
+    sse_stream_notify();
+    tcp_server_notify();
+    uart_tx_notify();
+}
+
+bool web_server_framing_pending(void)
+{
+    return framer.config.mode == FRAMER_IDLE && framer_pending(&framer);
+}
+
+bool web_server_framing_active(void)
+{
+    return framing_active.load(std::memory_order_acquire);
+}
+
+bool web_server_set_framer(const framer_config_t *config)
+{
+    if (!framer_config_is_valid(config)) {
+        return false;
+    }
+    portENTER_CRITICAL(&framer_lock);
+    pending_framer_config = *config;
+    portEXIT_CRITICAL(&framer_lock);
+    framer_version.fetch_add(1, std::memory_order_release);
+    ESP_LOGI(TAG, "Framing: %s", framer_mode_name(config->mode));
+    return true;
+}
+
+void web_server_get_framer(framer_config_t *config)
+{
+    portENTER_CRITICAL(&framer_lock);
+    *config = pending_framer_config;
+    portEXIT_CRITICAL(&framer_lock);
+}
+
+uint32_t web_server_restore_data(void)
+{
+    const data_carry_t &c = data_carry;
+    bool valid = c.magic == DATA_CARRY_MAGIC && c.oldest_check == ~c.oldest &&
+                 c.head_check == ~c.head && c.persisted_check == ~c.persisted;
+    uint32_t oldest = 0;
+    uint32_t head = 0;
+    uint32_t persisted = 0;
+    if (valid) {
+        head = c.head;
+        oldest = head - c.oldest > DATA_BUFFER_SIZE ? head - DATA_BUFFER_SIZE : c.oldest;
+        // Сброс посреди записи порции [head, reserve): ее начало уже затерло
+        // самые старые байты. Оборванная пара reserve - запись не началась
+        if (c.reserve_check == ~c.reserve && (int32_t)(c.reserve - head) > 0) {
+            uint32_t floor = c.reserve - DATA_BUFFER_SIZE;
+            if ((int32_t)(floor - head) >= 0) {
+                oldest = head;
+            } else if ((int32_t)(floor - oldest) > 0) {
+                oldest = floor;
+            }
+        }
+        // Записанное во флеш до самого старого байта - не раньше него
+        persisted = (int32_t)(c.persisted - oldest) >= 0 && (int32_t)(head - c.persisted) >= 0
+                        ? c.persisted : oldest;
+        valid = byte_ring_restore(&data_ring, oldest, head);
+    }
+    if (!valid) {
+        oldest = head = persisted = 0;
+    }
+    frame_boundary.store(head, std::memory_order_relaxed);
+
+    data_carry.oldest = oldest;
+    data_carry.oldest_check = ~oldest;
+    data_carry.head = head;
+    data_carry.head_check = ~head;
+    data_carry.persisted = persisted;
+    data_carry.persisted_check = ~persisted;
+    data_carry.reserve = head;
+    data_carry.reserve_check = ~head;
+    data_carry.magic = DATA_CARRY_MAGIC;
+
+    uint32_t carried = head - oldest;
+    if (carried > 0) {
+        ESP_LOGI(TAG, "Restored %lu bytes received before reset (seq %lu..%lu, %lu not in flash)",
+                 (unsigned long)carried, (unsigned long)oldest, (unsigned long)head,
+                 (unsigned long)(head - persisted));
+    }
+    return carried;
+}
+
+void web_server_data_persisted(uint32_t seq)
+{
+    data_carry.persisted = seq;
+    data_carry.persisted_check = ~seq;
+}
+
+uint32_t web_server_data_unpersisted(void)
+{
+    uint32_t seq = data_carry.persisted;
+    uint32_t oldest = byte_ring_oldest(&data_ring);
+    return (int32_t)(seq - oldest) >= 0 ? seq : oldest;
+}
+
+size_t web_server_read_since(uint32_t *seq, uint8_t *buffer, size_t length, uint32_t *lost)
+{
+    return byte_ring_read(&data_ring, seq, buffer, length, lost);
+}
+
+uint32_t web_server_data_seq(void)
+{
+    return byte_ring_head(&data_ring);
+}
+
+uint32_t web_server_data_oldest(void)
+{
+    return byte_ring_oldest(&data_ring);
+}
+
+uint32_t web_server_data_pending(uint32_t seq)
+{
+    return byte_ring_pending(&data_ring, seq);
+}
+
+uint32_t web_server_data_ready(uint32_t seq)
+{
+    uint32_t pending = byte_ring_pending(&data_ring, seq);
+    if (!framing_active.load(std::memory_order_acquire)) {
+        return pending;
+    }
+    int32_t framed = (int32_t)(frame_boundary.load(std::memory_order_acquire) - seq);
+    if (framed <= 0) {
+        return 0;
+    }
+    return (uint32_t)framed < pending ? (uint32_t)framed : pending;
+}
+
+bool web_server_data_rx_time(uint32_t seq, uint32_t *time_us)
+{
+    uint32_t head = rx_time_head.load(std::memory_order_acquire);
+    bool found = false;
+
+    // От новых порций к старым, пока порция заканчивается после seq
+    for (uint32_t n = 1; n <= DATA_RX_TIME_SLOTS; n++) {
+        if (n > head) {
+            // Дошли до первой порции с запуска
+            return found;
+        }
+        uint32_t index = head - n;
+        rx_time_slot_t *slot = &rx_times[index % DATA_RX_TIME_SLOTS];
+        if (slot->index.load(std::memory_order_acquire) != index) {
+            return false;
+        }
+        uint32_t end_seq = slot->end_seq.load(std::memory_order_relaxed);
+        uint32_t time = slot->time_us.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->index.load(std::memory_order_relaxed) != index) {
+            return false;
+        }
+        if ((int32_t)(end_seq - seq) <= 0) {
+            return found;
+        }
+        *time_us = time;
+        found = true;
+    }
+    // Порция seq старше отслеживаемых
+    return false;
+}
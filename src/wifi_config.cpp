@@ -0,0 +1,127 @@
+/**
+ * @file wifi_config.cpp
+ * @brief Проверка и названия параметров WiFi
+ *
+ * Не зависит от драйвера WiFi и собирается как в прошивке, так и
+ * в сборке для Linux (host/).
+ */
+
+#include "wifi_manager.h"
+#include "config.h"
+
+#include <string.h>
+
+void wifi_manager_default_config(wifi_manager_config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    config->mode = WIFI_MODE_DEFAULT;
+    strncpy(config->ssid, WIFI_STA_SSID_DEFAULT, sizeof(config->ssid) - 1);
+    strncpy(config->password, WIFI_STA_PASS_DEFAULT, sizeof(config->password) - 1);
+    strncpy(config->ap_ssid, WIFI_SSID_DEFAULT, sizeof(config->ap_ssid) - 1);
+    strncpy(config->ap_password, WIFI_PASS_DEFAULT, sizeof(config->ap_password) - 1);
+    config->ap_channel = WIFI_CHANNEL;
+    config->power_save = WIFI_PS_DEFAULT;
+    config->tx_power_dbm = WIFI_TX_POWER_DEFAULT;
+}
+
+bool wifi_manager_config_valid(const wifi_manager_config_t *config)
+{
+    if (config == NULL) {
+        return false;
+    }
+    // Строки должны быть завершены нулем в пределах полей
+    if (memchr(config->ssid, '\0', sizeof(config->ssid)) == NULL ||
+        memchr(config->password, '\0', sizeof(config->password)) == NULL ||
+        memchr(config->ap_ssid, '\0', sizeof(config->ap_ssid)) == NULL ||
+        memchr(config->ap_password, '\0', sizeof(config->ap_password)) == NULL) {
+        return false;
+    }
+    if (config->mode != WIFI_MANAGER_STA && config->mode != WIFI_MANAGER_AP &&
+        config->mode != WIFI_MANAGER_APSTA) {
+        return false;
+    }
+    if (config->mode != WIFI_MANAGER_AP) {
+        // WPA2: пароль от 8 символов (64 - ключ в шестнадцатеричном виде)
+        size_t len = strlen(config->password);
+        if (config->ssid[0] == '\0' || (len > 0 && len < 8)) {
+            return false;
+        }
+    }
+    if (config->mode != WIFI_MANAGER_STA) {
+        size_t len = strlen(config->ap_password);
+        if (config->ap_ssid[0] == '\0' || (len > 0 && len < 8) || len > 63) {
+            return false;
+        }
+    }
+    if (config->ap_channel < 1 || config->ap_channel > 13) {
+        return false;
+    }
+    if (config->power_save != WIFI_MANAGER_PS_NONE && config->power_save != WIFI_MANAGER_PS_MIN &&
+        config->power_save != WIFI_MANAGER_PS_MAX) {
+        return false;
+    }
+    // esp_wifi_set_max_tx_power(): 8..84 в единицах 0.25 дБм
+    if (config->tx_power_dbm != 0 && (config->tx_power_dbm < 2 || config->tx_power_dbm > 20)) {
+        return false;
+    }
+    return true;
+}
+
+const char *wifi_manager_mode_name(wifi_manager_mode_t mode)
+{
+    switch (mode) {
+    case WIFI_MANAGER_STA:   return "sta";
+    case WIFI_MANAGER_AP:    return "ap";
+    case WIFI_MANAGER_APSTA: return "apsta";
+    default:                 return "unknown";
+    }
+}
+
+bool wifi_manager_parse_mode(const char *name, wifi_manager_mode_t *mode)
+{
+    static const wifi_manager_mode_t modes[] = {
+        WIFI_MANAGER_STA, WIFI_MANAGER_AP, WIFI_MANAGER_APSTA,
+    };
+    for (wifi_manager_mode_t m : modes) {
+        if (strcmp(name, wifi_manager_mode_name(m)) == 0) {
+            *mode = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *wifi_manager_ps_name(wifi_manager_ps_t ps)
+{
+    switch (ps) {
+    case WIFI_MANAGER_PS_NONE: return "none";
+    case WIFI_MANAGER_PS_MIN:  return "min";
+    case WIFI_MANAGER_PS_MAX:  return "max";
+    default:                   return "unknown";
+    }
+}
+
+bool wifi_manager_parse_ps(const char *name, wifi_manager_ps_t *ps)
+{
+    static const wifi_manager_ps_t modes[] = {
+        WIFI_MANAGER_PS_NONE, WIFI_MANAGER_PS_MIN, WIFI_MANAGER_PS_MAX,
+    };
+    for (wifi_manager_ps_t m : modes) {
+        if (strcmp(name, wifi_manager_ps_name(m)) == 0) {
+            *ps = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *wifi_status_name(wifi_status_t status)
+{
+    switch (status) {
+    case WIFI_STATUS_DISCONNECTED: return "disconnected";
+    case WIFI_STATUS_CONNECTING:   return "connecting";
+    case WIFI_STATUS_CONNECTED:    return "connected";
+    case WIFI_STATUS_ERROR:        return "error";
+    default:                       return "unknown";
+    }
+}
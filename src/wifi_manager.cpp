@@ -0,0 +1,647 @@
+/**
+ * @file wifi_manager.cpp
+ * @brief Управление WiFi: точка доступа, станция, быстрое переподключение
+ *
+ * Все изменения состояния станции идут в задаче цикла событий по
+ * умолчанию: события драйвера и IP, а также собственные события
+ * WIFI_MANAGER_EVENT (применить конфигурацию, повторить попытку,
+ * остановить станцию). Вызовы из других задач только сохраняют
+ * конфигурацию и отправляют событие, поэтому обработчик не делит
+ * состояние попыток ни с кем, а сводка для API копируется под state_lock.
+ *
+ * Быстрое переподключение: BSSID и канал последнего подключения хранятся
+ * в NVS (ключ "fast"), попытка к ним - WIFI_FAST_SCAN на одном канале с
+ * bssid_set вместо сканирования всех каналов. Адрес после переподключения
+ * DHCP подтверждает без поиска сервера (CONFIG_LWIP_DHCP_RESTORE_LAST_IP),
+ * проверка адреса ARP отключена в sdkconfig.
+ */
+
+#include "wifi_manager.h"
+#include "config.h"
+#include "metrics.h"
+#include "boot.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "esp_event.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+static const char *TAG = "WiFiMgr";
+
+ESP_EVENT_DEFINE_BASE(WIFI_MANAGER_EVENT);
+
+typedef enum {
+    WIFI_MANAGER_EVENT_APPLY = 0,   // Применить config
+    WIFI_MANAGER_EVENT_RETRY,       // Пауза перед попыткой истекла
+    WIFI_MANAGER_EVENT_STOP,        // wifi_disconnect()
+} wifi_manager_event_t;
+
+#define CONNECTED_BIT   (1 << 0)
+
+/**
+ * Точка доступа последнего подключения
+ */
+typedef struct {
+    char ssid[33];                  // Сеть, к которой относится запись
+    uint8_t bssid[6];
+    uint8_t channel;
+} wifi_fast_cache_t;
+
+// Сохраненная конфигурация и сводка для API (под state_lock)
+static portMUX_TYPE state_lock = portMUX_INITIALIZER_UNLOCKED;
+static wifi_manager_config_t config;
+static wifi_manager_info_t info;
+
+// Состояние попыток: только задача цикла событий
+static wifi_manager_config_t applied;
+static wifi_fast_cache_t cache;
+static bool cache_valid = false;
+static bool sta_enabled = false;
+static bool sta_connected = false;
+static bool connecting = false;
+static uint32_t attempt = 0;        // Неудачных попыток с последнего подключения
+static int64_t attempt_started_us = 0;
+static int64_t outage_started_us = 0;
+static uint8_t link_bssid[6];
+static uint8_t link_channel = 0;
+
+static esp_netif_t *sta_netif = NULL;
+static esp_netif_t *ap_netif = NULL;
+static esp_timer_handle_t retry_timer = NULL;
+static EventGroupHandle_t wifi_events = NULL;
+static SemaphoreHandle_t config_lock = NULL;
+
+static metric_t wifi_connects;
+static metric_t wifi_disconnects;
+static metric_histogram_t wifi_connect_time;
+static metric_histogram_t wifi_outage_time;
+
+static void load_config(void)
+{
+    wifi_manager_default_config(&config);
+
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        ESP_LOGI(TAG, "No stored WiFi config, using defaults");
+        return;
+    }
+    wifi_manager_config_t stored;
+    size_t length = sizeof(stored);
+    if (nvs_get_blob(nvs, "config", &stored, &length) == ESP_OK && length == sizeof(stored) &&
+        wifi_manager_config_valid(&stored)) {
+        config = stored;
+    } else {
+        ESP_LOGW(TAG, "Stored WiFi config missing or invalid, using defaults");
+    }
+    length = sizeof(cache);
+    cache_valid = nvs_get_blob(nvs, "fast", &cache, &length) == ESP_OK &&
+                  length == sizeof(cache) && cache.channel != 0;
+    nvs_close(nvs);
+}
+
+static bool save_blob(const char *key, const void *data, size_t length)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(nvs, key, data, length);
+        if (ret == ESP_OK) {
+            ret = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save '%s' to NVS: %s", key, esp_err_to_name(ret));
+        return false;
+    }
+    return true;
+}
+
+static wifi_mode_t idf_mode(wifi_manager_mode_t mode)
+{
+    switch (mode) {
+    case WIFI_MANAGER_STA:   return WIFI_MODE_STA;
+    case WIFI_MANAGER_APSTA: return WIFI_MODE_APSTA;
+    default:                 return WIFI_MODE_AP;
+    }
+}
+
+static wifi_ps_type_t idf_ps(wifi_manager_ps_t ps)
+{
+    switch (ps) {
+    case WIFI_MANAGER_PS_MIN: return WIFI_PS_MIN_MODEM;
+    case WIFI_MANAGER_PS_MAX: return WIFI_PS_MAX_MODEM;
+    default:                  return WIFI_PS_NONE;
+    }
+}
+
+/**
+ * Режим и точка доступа (станция настраивается перед каждой попыткой)
+ */
+static esp_err_t configure_interfaces(const wifi_manager_config_t *cfg)
+{
+    esp_err_t ret = esp_wifi_set_mode(idf_mode(cfg->mode));
+    if (ret != ESP_OK || cfg->mode == WIFI_MANAGER_STA) {
+        return ret;
+    }
+
+    wifi_config_t ap = {};
+    strncpy((char *)ap.ap.ssid, cfg->ap_ssid, sizeof(ap.ap.ssid));
+    ap.ap.ssid_len = (uint8_t)strlen(cfg->ap_ssid);
+    strncpy((char *)ap.ap.password, cfg->ap_password, sizeof(ap.ap.password) - 1);
+    ap.ap.channel = cfg->ap_channel;
+    ap.ap.max_connection = WIFI_MAX_CONN;
+    ap.ap.authmode = cfg->ap_password[0] != '\0' ? WIFI_AUTH_WPA2_PSK : WIFI_AUTH_OPEN;
+    return esp_wifi_set_config(WIFI_IF_AP, &ap);
+}
+
+/**
+ * Энергосбережение, мощность и таймаут маяков (после esp_wifi_start)
+ */
+static void apply_radio(const wifi_manager_config_t *cfg)
+{
+    esp_err_t ret = esp_wifi_set_ps(idf_ps(cfg->power_save));
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "esp_wifi_set_ps failed: %s", esp_err_to_name(ret));
+    }
+    if (cfg->tx_power_dbm != 0) {
+        ret = esp_wifi_set_max_tx_power((int8_t)(cfg->tx_power_dbm * 4));
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "esp_wifi_set_max_tx_power failed: %s", esp_err_to_name(ret));
+        }
+    }
+    if (cfg->mode != WIFI_MANAGER_AP) {
+        esp_wifi_set_inactive_time(WIFI_IF_STA, WIFI_BEACON_TIMEOUT_S);
+    }
+}
+
+/**
+ * Очередная попытка подключения: к точке из кэша без сканирования, кроме
+ * каждой WIFI_FULL_SCAN_EVERY-й неудачной попытки
+ */
+static void start_attempt(void)
+{
+    if (!sta_enabled || connecting || sta_connected) {
+        return;
+    }
+    bool fast = cache_valid && strcmp(cache.ssid, applied.ssid) == 0 &&
+                (attempt == 0 || attempt % WIFI_FULL_SCAN_EVERY != 0);
+
+    wifi_config_t sta = {};
+    strncpy((char *)sta.sta.ssid, applied.ssid, sizeof(sta.sta.ssid));
+    strncpy((char *)sta.sta.password, applied.password, sizeof(sta.sta.password));
+    sta.sta.threshold.authmode = applied.password[0] != '\0' ? WIFI_AUTH_WPA2_PSK
+                                                             : WIFI_AUTH_OPEN;
+    if (fast) {
+        sta.sta.scan_method = WIFI_FAST_SCAN;
+        sta.sta.bssid_set = true;
+        memcpy(sta.sta.bssid, cache.bssid, sizeof(sta.sta.bssid));
+        sta.sta.channel = cache.channel;
+    } else {
+        sta.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        sta.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+    }
+    esp_err_t ret = esp_wifi_set_config(WIFI_IF_STA, &sta);
+    if (ret == ESP_OK) {
+        ret = esp_wifi_connect();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Connect attempt failed to start: %s", esp_err_to_name(ret));
+        return;
+    }
+    connecting = true;
+    attempt_started_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&state_lock);
+    info.status = info.status == WIFI_STATUS_ERROR ? WIFI_STATUS_ERROR : WIFI_STATUS_CONNECTING;
+    info.attempt = attempt + 1;
+    info.fast_reconnect = fast;
+    portEXIT_CRITICAL(&state_lock);
+}
+
+static void retry_timer_cb(void *arg)
+{
+    esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_EVENT_RETRY, NULL, 0, 0);
+}
+
+/**
+ * Пауза перед попыткой: первая сразу, далее вдвое больше с разбросом +-20%
+ */
+static uint32_t backoff_ms(uint32_t failures, bool ap_absent)
+{
+    if (failures <= 1) {
+        return 0;
+    }
+    uint32_t limit = ap_absent ? WIFI_BACKOFF_ABSENT_MAX_MS : WIFI_BACKOFF_MAX_MS;
+    uint32_t delay = failures - 2 >= 16 ? limit : WIFI_BACKOFF_MIN_MS << (failures - 2);
+    if (delay > limit) {
+        delay = limit;
+    }
+    return delay * (80 + esp_random() % 41) / 100;
+}
+
+static void schedule_attempt(uint32_t delay_ms)
+{
+    portENTER_CRITICAL(&state_lock);
+    info.retry_delay_ms = delay_ms;
+    portEXIT_CRITICAL(&state_lock);
+
+    esp_timer_stop(retry_timer);
+    if (delay_ms == 0) {
+        start_attempt();
+    } else {
+        esp_timer_start_once(retry_timer, (uint64_t)delay_ms * 1000);
+    }
+}
+
+/**
+ * Точка доступа не видна: попытка к ней стоит одного запроса на канале
+ */
+static bool reason_ap_absent(uint8_t reason)
+{
+    return reason == WIFI_REASON_NO_AP_FOUND || reason == WIFI_REASON_BEACON_TIMEOUT ||
+           reason == WIFI_REASON_NO_AP_FOUND_IN_RSSI_THRESHOLD ||
+           reason == WIFI_REASON_AUTH_EXPIRE || reason == WIFI_REASON_ASSOC_EXPIRE;
+}
+
+/**
+ * Точка доступа отказала в подключении: пароль или защита
+ */
+static bool reason_auth_failure(uint8_t reason)
+{
+    return reason == WIFI_REASON_AUTH_FAIL || reason == WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT ||
+           reason == WIFI_REASON_HANDSHAKE_TIMEOUT ||
+           reason == WIFI_REASON_NO_AP_FOUND_W_COMPATIBLE_SECURITY ||
+           reason == WIFI_REASON_NO_AP_FOUND_IN_AUTHMODE_THRESHOLD;
+}
+
+static void on_disconnected(const wifi_event_sta_disconnected_t *event)
+{
+    connecting = false;
+    if (sta_connected) {
+        sta_connected = false;
+        outage_started_us = esp_timer_get_time();
+        metric_add(&wifi_disconnects, 1);
+        xEventGroupClearBits(wifi_events, CONNECTED_BIT);
+        ESP_LOGW(TAG, "Disconnected from '%s' (reason %d)", applied.ssid, event->reason);
+    }
+
+    wifi_status_t status = WIFI_STATUS_DISCONNECTED;
+    uint32_t delay = 0;
+    if (sta_enabled) {
+        attempt++;
+        status = reason_auth_failure(event->reason) ? WIFI_STATUS_ERROR
+                                                    : WIFI_STATUS_CONNECTING;
+        delay = backoff_ms(attempt, reason_ap_absent(event->reason));
+        if (attempt > 1) {
+            ESP_LOGD(TAG, "Attempt %lu failed (reason %d), retry in %lu ms",
+                     (unsigned long)attempt, event->reason, (unsigned long)delay);
+        }
+    }
+
+    portENTER_CRITICAL(&state_lock);
+    info.status = status;
+    info.ip[0] = '\0';
+    info.rssi = 0;
+    info.last_reason = event->reason;
+    info.disconnects = metric_get(&wifi_disconnects);
+    portEXIT_CRITICAL(&state_lock);
+
+    if (sta_enabled) {
+        schedule_attempt(delay);
+    }
+}
+
+static void on_got_ip(const ip_event_got_ip_t *event)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t connect_ms = (uint32_t)((now - attempt_started_us) / 1000);
+    uint32_t outage_ms = 0;
+
+    connecting = false;
+    sta_connected = true;
+    attempt = 0;
+    metric_add(&wifi_connects, 1);
+    metric_observe_us(&wifi_connect_time, (uint32_t)(now - attempt_started_us));
+    if (outage_started_us != 0) {
+        outage_ms = (uint32_t)((now - outage_started_us) / 1000);
+        metric_observe_us(&wifi_outage_time, (uint32_t)(now - outage_started_us));
+        outage_started_us = 0;
+    }
+    xEventGroupSetBits(wifi_events, CONNECTED_BIT);
+    boot_mark(BOOT_STAGE_NETWORK_UP);
+
+    // Кэш обновляется, только если точка или канал сменились (запись во флеш)
+    if (!cache_valid || strcmp(cache.ssid, applied.ssid) != 0 ||
+        memcmp(cache.bssid, link_bssid, sizeof(cache.bssid)) != 0 ||
+        cache.channel != link_channel) {
+        memset(&cache, 0, sizeof(cache));
+        strncpy(cache.ssid, applied.ssid, sizeof(cache.ssid) - 1);
+        memcpy(cache.bssid, link_bssid, sizeof(cache.bssid));
+        cache.channel = link_channel;
+        cache_valid = save_blob("fast", &cache, sizeof(cache));
+    }
+
+    portENTER_CRITICAL(&state_lock);
+    info.status = WIFI_STATUS_CONNECTED;
+    snprintf(info.ip, sizeof(info.ip), IPSTR, IP2STR(&event->ip_info.ip));
+    memcpy(info.bssid, link_bssid, sizeof(info.bssid));
+    info.channel = link_channel;
+    info.connects = metric_get(&wifi_connects);
+    info.attempt = 0;
+    info.retry_delay_ms = 0;
+    info.last_connect_ms = connect_ms;
+    if (outage_ms != 0) {
+        info.last_outage_ms = outage_ms;
+    }
+    portEXIT_CRITICAL(&state_lock);
+
+    ESP_LOGI(TAG, "Connected to '%s' on channel %d, IP " IPSTR " (%lu ms%s)", applied.ssid,
+             link_channel, IP2STR(&event->ip_info.ip), (unsigned long)connect_ms,
+             info.fast_reconnect ? ", fast" : "");
+}
+
+/**
+ * Применение новой конфигурации без перезапуска WiFi
+ */
+static void apply_config(void)
+{
+    wifi_manager_config_t next;
+    portENTER_CRITICAL(&state_lock);
+    next = config;
+    portEXIT_CRITICAL(&state_lock);
+
+    bool credentials_changed = strcmp(next.ssid, applied.ssid) != 0 ||
+                               strcmp(next.password, applied.password) != 0;
+    esp_err_t ret = configure_interfaces(&next);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to apply WiFi config: %s", esp_err_to_name(ret));
+    }
+    applied = next;
+    apply_radio(&applied);
+
+    bool was_enabled = sta_enabled;
+    sta_enabled = applied.mode != WIFI_MANAGER_AP;
+    ESP_LOGI(TAG, "Mode %s, station '%s', AP '%s', power save %s",
+             wifi_manager_mode_name(applied.mode), sta_enabled ? applied.ssid : "-",
+             applied.mode != WIFI_MANAGER_STA ? applied.ap_ssid : "-",
+             wifi_manager_ps_name(applied.power_save));
+
+    if (!sta_enabled) {
+        esp_timer_stop(retry_timer);
+        if (was_enabled) {
+            esp_wifi_disconnect();
+        }
+        sta_connected = false;
+        connecting = false;
+        xEventGroupClearBits(wifi_events, CONNECTED_BIT);
+        portENTER_CRITICAL(&state_lock);
+        info.status = WIFI_STATUS_DISCONNECTED;
+        info.ip[0] = '\0';
+        info.attempt = 0;
+        portEXIT_CRITICAL(&state_lock);
+        return;
+    }
+    if (credentials_changed || !was_enabled) {
+        attempt = 0;
+        esp_timer_stop(retry_timer);
+        if (sta_connected || connecting) {
+            // Попытка с новой сетью - из обработчика отключения
+            esp_wifi_disconnect();
+        } else {
+            start_attempt();
+        }
+    }
+}
+
+static void event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (base == WIFI_EVENT) {
+        switch (id) {
+        case WIFI_EVENT_STA_START:
+            start_attempt();
+            break;
+        case WIFI_EVENT_STA_CONNECTED: {
+            const wifi_event_sta_connected_t *event = (const wifi_event_sta_connected_t *)data;
+            memcpy(link_bssid, event->bssid, sizeof(link_bssid));
+            link_channel = event->channel;
+            break;
+        }
+        case WIFI_EVENT_STA_DISCONNECTED:
+            on_disconnected((const wifi_event_sta_disconnected_t *)data);
+            break;
+        case WIFI_EVENT_AP_STACONNECTED:
+        case WIFI_EVENT_AP_STADISCONNECTED:
+            portENTER_CRITICAL(&state_lock);
+            if (id == WIFI_EVENT_AP_STACONNECTED) {
+                boot_mark(BOOT_STAGE_NETWORK_UP);
+                info.ap_clients++;
+            } else if (info.ap_clients > 0) {
+                info.ap_clients--;
+            }
+            portEXIT_CRITICAL(&state_lock);
+            break;
+        default:
+            break;
+        }
+    } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        on_got_ip((const ip_event_got_ip_t *)data);
+    } else if (base == WIFI_MANAGER_EVENT) {
+        switch (id) {
+        case WIFI_MANAGER_EVENT_APPLY:
+            apply_config();
+            break;
+        case WIFI_MANAGER_EVENT_RETRY:
+            start_attempt();
+            break;
+        case WIFI_MANAGER_EVENT_STOP:
+            sta_enabled = false;
+            esp_timer_stop(retry_timer);
+            esp_wifi_disconnect();
+            portENTER_CRITICAL(&state_lock);
+            info.status = WIFI_STATUS_DISCONNECTED;
+            info.attempt = 0;
+            portEXIT_CRITICAL(&state_lock);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+bool wifi_manager_init(void)
+{
+    if (wifi_events != NULL) {
+        return true;
+    }
+    wifi_events = xEventGroupCreate();
+    config_lock = xSemaphoreCreateMutex();
+    if (wifi_events == NULL || config_lock == NULL) {
+        return false;
+    }
+
+    metrics_register(&wifi_connects, METRIC_COUNTER, "comtoair_wifi_connects_total",
+                     "Station connections that obtained an IP address", NULL);
+    metrics_register(&wifi_disconnects, METRIC_COUNTER, "comtoair_wifi_disconnects_total",
+                     "Station connections lost", NULL);
+    metrics_register_histogram(&wifi_connect_time, "comtoair_wifi_connect_seconds",
+                               "Time from a connect attempt to an IP address", NULL);
+    metrics_register_histogram(&wifi_outage_time, "comtoair_wifi_outage_seconds",
+                               "Time from losing the station connection to an IP address", NULL);
+
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    sta_netif = esp_netif_create_default_wifi_sta();
+    ap_netif = esp_netif_create_default_wifi_ap();
+
+    wifi_init_config_t init = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&init));
+    // Конфигурацию хранит менеджер: драйвер не пишет ее во флеш при каждой смене
+    esp_wifi_set_storage(WIFI_STORAGE_RAM);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = retry_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "wifi_retry",
+        .skip_unhandled_events = true,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &retry_timer));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID,
+                                                        event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP,
+                                                        event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_MANAGER_EVENT, ESP_EVENT_ANY_ID,
+                                                        event_handler, NULL, NULL));
+
+    load_config();
+    applied = config;
+    sta_enabled = applied.mode != WIFI_MANAGER_AP;
+    ESP_ERROR_CHECK(configure_interfaces(&applied));
+    ESP_ERROR_CHECK(esp_wifi_start());
+    apply_radio(&applied);
+
+    ESP_LOGI(TAG, "WiFi started: mode %s, AP '%s', station '%s'%s",
+             wifi_manager_mode_name(applied.mode),
+             applied.mode != WIFI_MANAGER_STA ? applied.ap_ssid : "-",
+             sta_enabled ? applied.ssid : "-",
+             cache_valid ? " (cached BSSID)" : "");
+    return true;
+}
+
+bool wifi_reconfigure(const wifi_manager_config_t *new_config)
+{
+    if (!wifi_manager_config_valid(new_config) || config_lock == NULL) {
+        return false;
+    }
+    xSemaphoreTake(config_lock, portMAX_DELAY);
+    bool saved = save_blob("config", new_config, sizeof(*new_config));
+    portENTER_CRITICAL(&state_lock);
+    bool reconnect = strcmp(config.ssid, new_config->ssid) != 0 ||
+                     strcmp(config.password, new_config->password) != 0;
+    config = *new_config;
+    portEXIT_CRITICAL(&state_lock);
+    if (reconnect) {
+        xEventGroupClearBits(wifi_events, CONNECTED_BIT);
+    }
+    esp_err_t ret = esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_EVENT_APPLY, NULL, 0,
+                                   pdMS_TO_TICKS(1000));
+    xSemaphoreGive(config_lock);
+    return saved && ret == ESP_OK;
+}
+
+bool wifi_setup_ap(const char *ssid, const char *password)
+{
+    wifi_manager_config_t cfg;
+    wifi_manager_get_config(&cfg);
+    if (strlen(ssid) >= sizeof(cfg.ap_ssid) || strlen(password) >= sizeof(cfg.ap_password)) {
+        return false;
+    }
+    strcpy(cfg.ap_ssid, ssid);
+    strcpy(cfg.ap_password, password);
+    if (cfg.mode == WIFI_MANAGER_STA) {
+        cfg.mode = WIFI_MANAGER_APSTA;
+    }
+    return wifi_reconfigure(&cfg);
+}
+
+bool wifi_connect_station(const char *ssid, const char *password)
+{
+    wifi_manager_config_t cfg;
+    wifi_manager_get_config(&cfg);
+    if (strlen(ssid) >= sizeof(cfg.ssid) || strlen(password) >= sizeof(cfg.password)) {
+        return false;
+    }
+    strcpy(cfg.ssid, ssid);
+    strcpy(cfg.password, password);
+    if (cfg.mode == WIFI_MANAGER_AP) {
+        cfg.mode = WIFI_MANAGER_APSTA;
+    }
+    if (!wifi_reconfigure(&cfg)) {
+        return false;
+    }
+    EventBits_t bits = xEventGroupWaitBits(wifi_events, CONNECTED_BIT, pdFALSE, pdTRUE,
+                                           pdMS_TO_TICKS(WIFI_CONNECT_TIMEOUT_MS));
+    return (bits & CONNECTED_BIT) != 0;
+}
+
+wifi_status_t wifi_get_status(void)
+{
+    portENTER_CRITICAL(&state_lock);
+    wifi_status_t status = info.status;
+    portEXIT_CRITICAL(&state_lock);
+    return status;
+}
+
+bool wifi_get_ip_address(char *ip_str)
+{
+    portENTER_CRITICAL(&state_lock);
+    bool connected = info.status == WIFI_STATUS_CONNECTED;
+    if (connected) {
+        strcpy(ip_str, info.ip);
+    }
+    bool ap = config.mode != WIFI_MANAGER_STA;
+    portEXIT_CRITICAL(&state_lock);
+    if (connected) {
+        return true;
+    }
+
+    esp_netif_ip_info_t ip_info;
+    if (ap && ap_netif != NULL && esp_netif_get_ip_info(ap_netif, &ip_info) == ESP_OK) {
+        snprintf(ip_str, 16, IPSTR, IP2STR(&ip_info.ip));
+        return true;
+    }
+    return false;
+}
+
+void wifi_disconnect(void)
+{
+    esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_EVENT_STOP, NULL, 0, pdMS_TO_TICKS(1000));
+}
+
+void wifi_manager_get_config(wifi_manager_config_t *out)
+{
+    portENTER_CRITICAL(&state_lock);
+    *out = config;
+    portEXIT_CRITICAL(&state_lock);
+}
+
+void wifi_manager_get_info(wifi_manager_info_t *out)
+{
+    portENTER_CRITICAL(&state_lock);
+    *out = info;
+    portEXIT_CRITICAL(&state_lock);
+
+    wifi_ap_record_t ap;
+    if (out->status == WIFI_STATUS_CONNECTED && esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+        out->rssi = ap.rssi;
+    }
+}
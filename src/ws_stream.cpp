@@ -0,0 +1,560 @@
+/**
+ * @file ws_stream.cpp
+ * @brief Потоковая передача данных RS-232 через WebSocket (/ws/stream)
+ *
+ * Задача рассылки просыпается по уведомлению от писателя буфера или по
+ * окончании окна накопления. Отправка кадров выполняется асинхронно в
+ * контексте HTTP сервера (httpd_ws_send_data_async); пока кадр клиента
+ * не доставлен, новый ему не ставится в очередь. Перед отправкой сокет
+ * проверяется на готовность к записи, поэтому задача сервера не блокируется
+ * на клиенте с заполненным TCP окном.
+ *
+ * Данные кадра копируются из кольцевого буфера (web_server_read_since) в
+ * буфер клиента, который принадлежит отправке до ws_send_done(): писатель
+ * буфера может перезаписать исходные байты, не повреждая уже поставленный
+ * кадр. Байты, перезаписанные до копирования, сообщаются клиенту текстовым
+ * кадром {"gap":<байт>,"seq":<номер>}, соединение при этом не закрывается.
+ *
+ * Клиент в режиме кадров (?frames=1) читает не буфер, а журнал принятых
+ * кадров (capture_journal): записи копируются в буфер клиента с заголовком
+ * и отправляются пачкой в одном бинарном кадре WebSocket.
+ */
+
+#include "ws_stream.h"
+#include "web_server.h"
+#include "config.h"
+#include "metrics.h"
+#include "fanout.h"
+#include "capture_journal.h"
+#include "batch_policy.h"
+#include "uart_tx.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <sys/select.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "WsStream";
+
+// Повторная проверка готовности сокета медленного клиента
+#define WS_RETRY_MS     50
+
+// Заголовок записи в пачке кадров: seq u32, ts u64, length u16, flags u8, 0
+#define WS_FRAME_HEADER_SIZE    16
+
+static_assert(WS_FRAME_MAX_SIZE >= WS_FRAME_HEADER_SIZE + CAPTURE_MAX_CHUNK,
+              "WS_FRAME_MAX_SIZE must fit one journal record");
+
+/**
+ * @brief Состояние WebSocket клиента
+ */
+typedef struct {
+    int fd;                         // Сокет клиента, -1 если слот свободен
+    fanout_client_t *cursor;        // Курсор в буфере данных
+    int64_t pending_since_us;       // Время появления неотправленных данных
+    uint32_t gap_pending;           // Потерянные байты, о которых клиент еще не знает
+    uint32_t dropped;               // Всего потеряно байт для этого клиента
+    uint32_t batch_version;         // Версия политики пакетирования, примененная к сокету
+    std::atomic<bool> in_flight;    // Кадр передан серверу и еще не отправлен
+    std::atomic<bool> failed;       // Ошибка отправки, сокет нужно закрыть
+    bool closing;                   // Закрытие сокета уже запрошено
+    bool frame_timed;               // Известно время приема первого байта кадра
+    uint32_t frame_rx_us;           // Время приема первого байта кадра
+    char notice[48];
+    std::atomic<uint32_t> tx_rejected; // Байт от клиента, не принятых очередью передачи
+    bool frames;                    // Режим кадров: записи журнала пачками
+    uint32_t record_seq;            // Режим кадров: номер следующей записи
+    uint8_t batch[WS_FRAME_MAX_SIZE];   // Отправляемый кадр данных или пачка записей
+} ws_client_t;
+
+static ws_client_t clients[WS_STREAM_MAX_CLIENTS];
+static std::atomic<int> client_count(0);
+static SemaphoreHandle_t clients_lock = NULL;
+static httpd_handle_t ws_server = NULL;
+static TaskHandle_t stream_task = NULL;
+
+// Входящий кадр клиента (читает только задача HTTP сервера)
+static uint8_t ws_rx_buf[UART_TX_MAX_PAYLOAD];
+
+// Задержка от приема байта до отправки кадра с ним клиенту
+static metric_histogram_t delivery;
+
+static void ws_send_done(esp_err_t err, int socket, void *arg)
+{
+    ws_client_t *client = (ws_client_t *)arg;
+    if (err != ESP_OK) {
+        client->failed.store(true);
+    } else if (client->frame_timed) {
+        metric_observe_us(&delivery, (uint32_t)esp_timer_get_time() - client->frame_rx_us);
+    }
+    client->frame_timed = false;
+    client->in_flight.store(false);
+    if (stream_task != NULL) {
+        xTaskNotifyGive(stream_task);
+    }
+}
+
+// Знаковая разность порядковых номеров (корректна при переполнении 2^32)
+static inline int32_t seq_diff(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b);
+}
+
+static inline void put_le(uint8_t *p, uint64_t value, int size)
+{
+    for (int i = 0; i < size; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static bool socket_writable(int fd)
+{
+    fd_set wfds;
+    FD_ZERO(&wfds);
+    FD_SET(fd, &wfds);
+    struct timeval tv = { 0, 0 };
+    return select(fd + 1, NULL, &wfds, NULL, &tv) > 0;
+}
+
+static bool send_frame(ws_client_t *client, httpd_ws_type_t type, const uint8_t *payload, size_t len)
+{
+    httpd_ws_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.final = true;
+    frame.type = type;
+    frame.payload = (uint8_t *)payload;
+    frame.len = len;
+
+    client->in_flight.store(true);
+    if (httpd_ws_send_data_async(ws_server, client->fd, &frame, ws_send_done, client) != ESP_OK) {
+        client->in_flight.store(false);
+        client->failed.store(true);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Обслуживание клиента в режиме кадров; возвращает время (мс) до следующей проверки
+ *
+ * Пачка - записи журнала подряд, каждая с заголовком WS_FRAME_HEADER_SIZE
+ * байт. Пропущенные (перезаписанные) записи сообщаются текстовым кадром
+ * {"gap":<записей>,"seq":<номер следующей записи>}.
+ */
+static uint32_t service_frames(ws_client_t *client, int64_t now_us)
+{
+    // Курсор буфера не используется: слот нужен для учета клиентов
+    client->cursor->seq = web_server_data_seq();
+
+    uint32_t head = capture_journal_head();
+    if (seq_diff(client->record_seq, head) > 0) {
+        client->record_seq = capture_journal_oldest();
+    }
+    uint32_t pending = head - client->record_seq;
+    if (pending == 0) {
+        client->pending_since_us = 0;
+        return UINT32_MAX;
+    }
+
+    if (client->pending_since_us == 0) {
+        client->pending_since_us = now_us;
+    }
+    // Каждая запись - завершенный кадр; объем считается в записях
+    if (pending < WS_BATCH_FRAMES) {
+        uint32_t wait_us = batch_wait_us(FANOUT_TRANSPORT_WS, 0, true,
+                                         client->pending_since_us, now_us);
+        if (wait_us > 0) {
+            return (wait_us + 999) / 1000;
+        }
+    }
+
+    if (!socket_writable(client->fd)) {
+        return WS_RETRY_MS;
+    }
+
+    size_t used = 0;
+    capture_record_t record;
+    while (used + WS_FRAME_HEADER_SIZE + CAPTURE_MAX_CHUNK <= sizeof(client->batch)) {
+        uint8_t *p = client->batch + used;
+        capture_read_result_t result =
+            capture_journal_read(client->record_seq, &record, p + WS_FRAME_HEADER_SIZE);
+        if (result == CAPTURE_READ_END) {
+            break;
+        }
+        if (result == CAPTURE_READ_GAP) {
+            if (used > 0) {
+                // Сначала уже собранная пачка, пропуск - следующим кадром
+                break;
+            }
+            uint32_t oldest = capture_journal_oldest();
+            if (seq_diff(oldest, client->record_seq) <= 0) {
+                oldest = client->record_seq + 1;
+            }
+            uint32_t missed = oldest - client->record_seq;
+            client->record_seq = oldest;
+            client->dropped += missed;
+            int len = snprintf(client->notice, sizeof(client->notice),
+                               "{\"gap\":%lu,\"seq\":%lu}",
+                               (unsigned long)missed, (unsigned long)oldest);
+            send_frame(client, HTTPD_WS_TYPE_TEXT, (const uint8_t *)client->notice, len);
+            return UINT32_MAX;
+        }
+
+        if (used == 0) {
+            client->frame_timed = true;
+            client->frame_rx_us = (uint32_t)record.timestamp_us;
+        }
+        put_le(p, record.seq, 4);
+        put_le(p + 4, record.timestamp_us, 8);
+        put_le(p + 12, record.length, 2);
+        p[14] = (uint8_t)record.flags;
+        p[15] = 0;
+        used += WS_FRAME_HEADER_SIZE + record.length;
+        client->record_seq++;
+    }
+
+    client->pending_since_us = 0;
+    if (used == 0) {
+        return 0;
+    }
+    send_frame(client, HTTPD_WS_TYPE_BINARY, client->batch, used);
+    batch_sent(FANOUT_TRANSPORT_WS, (uint32_t)used);
+    return client->record_seq != capture_journal_head() ? 0 : UINT32_MAX;
+}
+
+/**
+ * Обслуживание одного клиента; возвращает время (мс) до следующей проверки
+ */
+static uint32_t service_client(ws_client_t *client, int64_t now_us)
+{
+    if (client->in_flight.load()) {
+        // Продолжим после ws_send_done()
+        return UINT32_MAX;
+    }
+
+    if (client->closing) {
+        // Ждем ws_stream_on_close()
+        return UINT32_MAX;
+    }
+
+    uint32_t batch_version = batch_config_version();
+    if (client->batch_version != batch_version) {
+        client->batch_version = batch_version;
+        batch_apply_socket(FANOUT_TRANSPORT_WS, client->fd);
+    }
+
+    uint32_t rejected = client->tx_rejected.load();
+    if (rejected > 0 && !client->failed.load()) {
+        if (!socket_writable(client->fd)) {
+            return WS_RETRY_MS;
+        }
+        client->tx_rejected.fetch_sub(rejected);
+        int len = snprintf(client->notice, sizeof(client->notice), "{\"tx_rejected\":%lu}",
+                           (unsigned long)rejected);
+        send_frame(client, HTTPD_WS_TYPE_TEXT, (const uint8_t *)client->notice, len);
+        return UINT32_MAX;
+    }
+
+    if (client->frames) {
+        if (client->failed.load()) {
+            client->closing = true;
+            httpd_sess_trigger_close(ws_server, client->fd);
+            return UINT32_MAX;
+        }
+        return service_frames(client, now_us);
+    }
+
+    // Отставание сверх бюджета: пропуск с уведомлением или отключение
+    uint32_t skipped = 0;
+    if (!client->failed.load() && fanout_check(client->cursor, &skipped) == FANOUT_EVICT) {
+        client->failed.store(true);
+    }
+    if (client->failed.load()) {
+        client->closing = true;
+        httpd_sess_trigger_close(ws_server, client->fd);
+        return UINT32_MAX;
+    }
+    client->gap_pending += skipped;
+
+    uint32_t seq = client->cursor->seq;
+    uint32_t pending = web_server_data_ready(seq);
+    if (pending == 0 && client->gap_pending == 0) {
+        client->pending_since_us = 0;
+        return UINT32_MAX;
+    }
+
+    if (client->gap_pending == 0) {
+        if (client->pending_since_us == 0) {
+            client->pending_since_us = now_us;
+        }
+        bool frame_ready = web_server_framing_active();
+        uint32_t wait_us = batch_wait_us(FANOUT_TRANSPORT_WS, pending, frame_ready,
+                                         client->pending_since_us, now_us);
+        if (wait_us > 0) {
+            return (wait_us + 999) / 1000;
+        }
+    }
+
+    if (!socket_writable(client->fd)) {
+        return WS_RETRY_MS;
+    }
+
+    if (client->gap_pending > 0) {
+        int len = snprintf(client->notice, sizeof(client->notice),
+                           "{\"gap\":%lu,\"seq\":%lu}",
+                           (unsigned long)client->gap_pending, (unsigned long)seq);
+        client->dropped += client->gap_pending;
+        client->gap_pending = 0;
+        send_frame(client, HTTPD_WS_TYPE_TEXT, (const uint8_t *)client->notice, len);
+        return UINT32_MAX;
+    }
+
+    // Копия в буфер клиента: отправка не зависит от перезаписи буфера данных
+    size_t want = pending < sizeof(client->batch) ? pending : sizeof(client->batch);
+    uint32_t lost = 0;
+    size_t n = web_server_read_since(&seq, client->batch, want, &lost);
+    if (lost > 0) {
+        // Перезаписано до копирования: сначала сообщение о пропуске,
+        // прочитанное после него - следующим кадром
+        client->cursor->seq = seq - (uint32_t)n;
+        client->gap_pending += lost;
+        return 0;
+    }
+    client->pending_since_us = 0;
+    if (n == 0) {
+        return 0;
+    }
+    client->cursor->seq = seq;
+    client->frame_timed = web_server_data_rx_time(seq - (uint32_t)n, &client->frame_rx_us);
+    send_frame(client, HTTPD_WS_TYPE_BINARY, client->batch, n);
+    batch_sent(FANOUT_TRANSPORT_WS, (uint32_t)n);
+    return n < pending ? 0 : UINT32_MAX;
+}
+
+/**
+ * Задача рассылки данных WebSocket клиентам
+ */
+static void ws_stream_task(void *pvParameters)
+{
+    TickType_t wait = portMAX_DELAY;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        int64_t now_us = esp_timer_get_time();
+        uint32_t next_ms = UINT32_MAX;
+
+        xSemaphoreTake(clients_lock, portMAX_DELAY);
+        for (int i = 0; i < WS_STREAM_MAX_CLIENTS; i++) {
+            if (clients[i].fd < 0) {
+                continue;
+            }
+            uint32_t ms = service_client(&clients[i], now_us);
+            if (ms < next_ms) {
+                next_ms = ms;
+            }
+        }
+        xSemaphoreGive(clients_lock);
+
+        if (next_ms == UINT32_MAX) {
+            wait = portMAX_DELAY;
+        } else {
+            wait = pdMS_TO_TICKS(next_ms);
+            if (wait == 0 && next_ms > 0) {
+                wait = 1;
+            }
+        }
+    }
+}
+
+static bool add_client(int fd, uint32_t seq, bool frames)
+{
+    bool added = false;
+    xSemaphoreTake(clients_lock, portMAX_DELAY);
+    for (int i = 0; i < WS_STREAM_MAX_CLIENTS; i++) {
+        ws_client_t *client = &clients[i];
+        if (client->fd < 0 && !client->in_flight.load()) {
+            client->cursor = fanout_open(FANOUT_TRANSPORT_WS,
+                                         frames ? web_server_data_seq() : seq);
+            if (client->cursor == NULL) {
+                break;
+            }
+            client->fd = fd;
+            client->batch_version = batch_config_version();
+            batch_apply_socket(FANOUT_TRANSPORT_WS, fd);
+            client->pending_since_us = 0;
+            client->gap_pending = 0;
+            client->dropped = 0;
+            client->frame_timed = false;
+            client->closing = false;
+            client->frames = frames;
+            client->record_seq = seq;
+            client->tx_rejected.store(0);
+            client->failed.store(false);
+            client_count.fetch_add(1);
+            added = true;
+            break;
+        }
+    }
+    xSemaphoreGive(clients_lock);
+    return added;
+}
+
+/**
+ * Сообщение клиенту о байтах, не принятых очередью передачи
+ */
+static void notify_rejected(int fd, uint32_t bytes)
+{
+    xSemaphoreTake(clients_lock, portMAX_DELAY);
+    for (int i = 0; i < WS_STREAM_MAX_CLIENTS; i++) {
+        if (clients[i].fd == fd) {
+            clients[i].tx_rejected.fetch_add(bytes);
+            break;
+        }
+    }
+    xSemaphoreGive(clients_lock);
+    xTaskNotifyGive(stream_task);
+}
+
+/**
+ * HTTP обработчик /ws/stream
+ *
+ * GET /ws/stream              - поток с текущего момента
+ * GET /ws/stream?since=<seq>  - поток начиная с порядкового номера seq
+ * GET /ws/stream?frames=1[&since=<номер записи>] - кадры из журнала пачками
+ */
+static esp_err_t ws_stream_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        // Рукопожатие завершено - регистрируем клиента
+        bool frames = false;
+        bool has_since = false;
+        uint32_t seq = 0;
+        char query[64];
+        char value[16];
+        if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+            if (httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+                seq = (uint32_t)strtoul(value, NULL, 10);
+                has_since = true;
+            }
+            if (httpd_query_key_value(query, "frames", value, sizeof(value)) == ESP_OK) {
+                frames = strcmp(value, "1") == 0;
+            }
+        }
+        if (!has_since) {
+            seq = frames ? capture_journal_head() : web_server_data_seq();
+        }
+
+        int fd = httpd_req_to_sockfd(req);
+        if (!add_client(fd, seq, frames)) {
+            ESP_LOGW(TAG, "Too many WebSocket clients, rejecting fd=%d", fd);
+            return ESP_FAIL;
+        }
+        ESP_LOGI(TAG, "Client connected: fd=%d, seq=%lu%s", fd, (unsigned long)seq,
+                 frames ? ", frames" : "");
+        xTaskNotifyGive(stream_task);
+        return ESP_OK;
+    }
+
+    // Входящие кадры (текстовые и бинарные) - данные для передачи в порт.
+    // Очередь не ждем: задача сервера обслуживает всех клиентов
+    httpd_ws_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (frame.len == 0) {
+        return ESP_OK;
+    }
+    if (frame.len > sizeof(ws_rx_buf)) {
+        ESP_LOGW(TAG, "Frame of %u bytes exceeds UART_TX_MAX_PAYLOAD, closing fd=%d",
+                 (unsigned)frame.len, httpd_req_to_sockfd(req));
+        return ESP_FAIL;
+    }
+    frame.payload = ws_rx_buf;
+    ret = httpd_ws_recv_frame(req, &frame, frame.len);
+    if (ret != ESP_OK || (frame.type != HTTPD_WS_TYPE_TEXT && frame.type != HTTPD_WS_TYPE_BINARY)) {
+        return ret;
+    }
+    size_t queued = uart_tx_write(ws_rx_buf, frame.len, 0);
+    if (queued < frame.len) {
+        notify_rejected(httpd_req_to_sockfd(req), (uint32_t)(frame.len - queued));
+    }
+    return ESP_OK;
+}
+
+bool ws_stream_register(httpd_handle_t server)
+{
+    if (clients_lock == NULL) {
+        clients_lock = xSemaphoreCreateMutex();
+        if (clients_lock == NULL) {
+            return false;
+        }
+        for (int i = 0; i < WS_STREAM_MAX_CLIENTS; i++) {
+            clients[i].fd = -1;
+        }
+        fanout_init();
+        batch_init();
+        metrics_register_histogram(&delivery, "comtoair_uart_to_client_seconds",
+                                   "Time from UART receive to delivery to a client",
+                                   "transport=\"ws\"");
+    }
+
+    if (stream_task == NULL &&
+        xTaskCreate(ws_stream_task, "ws_stream", TASK_STACK_WS_STREAM, NULL, TASK_PRIO_WS_STREAM,
+                    &stream_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create WebSocket stream task");
+        return false;
+    }
+    metrics_watch_task(stream_task);
+
+    ws_server = server;
+
+    httpd_uri_t ws_uri;
+    memset(&ws_uri, 0, sizeof(ws_uri));
+    ws_uri.uri = "/ws/stream";
+    ws_uri.method = HTTP_GET;
+    ws_uri.handler = ws_stream_handler;
+    ws_uri.user_ctx = NULL;
+    ws_uri.is_websocket = true;
+    return httpd_register_uri_handler(server, &ws_uri) == ESP_OK;
+}
+
+void ws_stream_notify(void)
+{
+    if (client_count.load(std::memory_order_relaxed) > 0 && stream_task != NULL) {
+        xTaskNotifyGive(stream_task);
+    }
+}
+
+void ws_stream_on_close(int sockfd)
+{
+    if (clients_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(clients_lock, portMAX_DELAY);
+    for (int i = 0; i < WS_STREAM_MAX_CLIENTS; i++) {
+        if (clients[i].fd == sockfd) {
+            ESP_LOGI(TAG, "Client disconnected: fd=%d, dropped=%lu",
+                     sockfd, (unsigned long)clients[i].dropped);
+            clients[i].fd = -1;
+            fanout_close(clients[i].cursor);
+            clients[i].cursor = NULL;
+            client_count.fetch_sub(1);
+            break;
+        }
+    }
+    xSemaphoreGive(clients_lock);
+}
+
+int ws_stream_client_count(void)
+{
+    return client_count.load();
+}
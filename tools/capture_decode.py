@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""
+Эталонный декодер двоичного формата выгрузки (include/capture_format.h).
+
+Читает ответ /api/data?format=bin, /api/history?format=bin[&compress=lz4]
+или /api/capture/download?compress=lz4 из файла или stdin и выводит:
+  - по умолчанию: запись на строку "seq ts_us length flags данные"
+    (данные - строка с экранированием, как repr байт);
+  - с --jsonl: объект JSON на запись (data в base64);
+  - с --raw: только данные записей (или поток CAPTURE_KIND_RAW) подряд.
+Пропуски (номер больше ожидаемого) отмечаются строкой "gap" в stderr,
+хвост ответа (next, head, lost, now_us) и объем - в stderr.
+
+Пример:
+  curl -s 'http://comtoair.local/api/history?format=bin&compress=lz4&max=32768' \\
+      | tools/capture_decode.py
+
+Использование: capture_decode.py [--jsonl | --raw] [файл]
+"""
+
+import base64
+import json
+import sys
+
+MAGIC = b"CTAB"
+VERSION = 1
+KIND_RECORDS, KIND_BYTES, KIND_RAW = 0, 1, 2
+CODEC_STORED, CODEC_LZ4 = 0, 1
+
+
+class FormatError(Exception):
+    pass
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def byte(self):
+        if self.pos >= len(self.data):
+            raise FormatError("unexpected end of stream")
+        b = self.data[self.pos]
+        self.pos += 1
+        return b
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            b = self.byte()
+            value |= (b & 0x7F) << shift
+            if b < 0x80:
+                return value
+            shift += 7
+            if shift > 63:
+                raise FormatError("varint too long")
+
+    def take(self, n):
+        if self.pos + n > len(self.data):
+            raise FormatError("unexpected end of stream")
+        chunk = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return chunk
+
+
+def lz4_decompress(src, size):
+    """Распаковка блока LZ4 (формат блока, без кадра)."""
+    out = bytearray()
+    r = Reader(src)
+    while r.pos < len(src):
+        token = r.byte()
+        literals = token >> 4
+        if literals == 15:
+            while True:
+                b = r.byte()
+                literals += b
+                if b != 255:
+                    break
+        out += r.take(literals)
+        if r.pos == len(src):
+            break
+        lo, hi = r.take(2)
+        offset = lo | (hi << 8)
+        if offset == 0 or offset > len(out):
+            raise FormatError("bad match offset")
+        match_len = token & 15
+        if match_len == 15:
+            while True:
+                b = r.byte()
+                match_len += b
+                if b != 255:
+                    break
+        match_len += 4
+        start = len(out) - offset
+        for i in range(match_len):
+            out.append(out[start + i])
+    if len(out) != size:
+        raise FormatError("block size mismatch")
+    return bytes(out)
+
+
+def decode(data):
+    """Разбор потока: (вид, содержимое блоков подряд, хвост)."""
+    r = Reader(data)
+    if r.take(4) != MAGIC:
+        raise FormatError("not a capture stream")
+    version = r.byte()
+    if version != VERSION:
+        raise FormatError("unsupported version %d" % version)
+    kind = r.byte()
+
+    payload = bytearray()
+    while True:
+        codec = r.byte()
+        raw_len = r.varint()
+        if codec == CODEC_STORED and raw_len == 0:
+            break
+        if codec == CODEC_STORED:
+            payload += r.take(raw_len)
+        elif codec == CODEC_LZ4:
+            packed_len = r.varint()
+            payload += lz4_decompress(r.take(packed_len), raw_len)
+        else:
+            raise FormatError("unknown codec %d" % codec)
+
+    tail = {
+        "next": r.varint(),
+        "head": r.varint(),
+        "lost": r.varint(),
+        "now_us": r.varint(),
+    }
+    return kind, bytes(payload), tail
+
+
+def records(kind, payload):
+    """Записи (seq, ts_us, flags, данные) и пропуски (None, пропущено, seq)."""
+    r = Reader(payload)
+    expected = 0
+    ts = 0
+    first = True
+    while r.pos < len(payload):
+        seq = (expected + r.varint()) & 0xFFFFFFFF
+        delta = r.varint()
+        ts += (delta >> 1) ^ -(delta & 1)
+        word = r.varint()
+        length, flags = word >> 2, word & 3
+        data = r.take(length)
+        if not first and seq != expected:
+            yield None, (seq - expected) & 0xFFFFFFFF, seq
+        first = False
+        yield seq, ts, flags, data
+        expected = (seq + (1 if kind == KIND_RECORDS else length)) & 0xFFFFFFFF
+
+
+def main():
+    args = [a for a in sys.argv[1:] if not a.startswith("--")]
+    mode = "text"
+    for a in sys.argv[1:]:
+        if a in ("--jsonl", "--raw"):
+            mode = a[2:]
+        elif a.startswith("--"):
+            sys.stderr.write(__doc__)
+            return 2
+    if len(args) > 1:
+        sys.stderr.write(__doc__)
+        return 2
+
+    if args:
+        with open(args[0], "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    try:
+        kind, payload, tail = decode(data)
+    except FormatError as e:
+        sys.stderr.write("capture_decode: %s\n" % e)
+        return 1
+
+    out = sys.stdout.buffer
+    if kind == KIND_RAW:
+        out.write(payload)
+    else:
+        for item in records(kind, payload):
+            if item[0] is None:
+                sys.stderr.write("gap %d, seq %d\n" % (item[1], item[2]))
+                continue
+            seq, ts, flags, chunk = item
+            if mode == "raw":
+                out.write(chunk)
+            elif mode == "jsonl":
+                line = json.dumps({"seq": seq, "ts": ts, "length": len(chunk), "flags": flags,
+                                   "data": base64.b64encode(chunk).decode()})
+                out.write(line.encode() + b"\n")
+            else:
+                out.write(b"%d %d %d %d %s\n" % (seq, ts, len(chunk), flags,
+                                                 repr(chunk)[2:-1].encode()))
+
+    sys.stderr.write("next %(next)d, head %(head)d, lost %(lost)d, now_us %(now_us)d\n" % tail)
+    sys.stderr.write("%d bytes on the wire, %d decoded\n" % (len(data), len(payload)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
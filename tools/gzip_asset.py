@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+"""
+Подготовка статического файла веб-интерфейса для встраивания в прошивку.
+
+Подставляет в файл хеши соседних файлов ({{hash:app.js}} -> 12 hex
+символов SHA-256 содержимого), чтобы ссылки на css/js менялись вместе
+с их содержимым и их можно было кешировать как immutable, и сжимает
+результат gzip без имени и времени файла (сборка воспроизводима).
+
+Использование: gzip_asset.py <каталог data> <имя файла> <выходной .gz>
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+HASH_RE = re.compile(rb"\{\{hash:([A-Za-z0-9_.\-]+)\}\}")
+
+
+def content_hash(path):
+    with open(path, "rb") as f:
+        return hashlib.sha256(f.read()).hexdigest()[:12]
+
+
+def main():
+    if len(sys.argv) != 4:
+        sys.stderr.write(__doc__)
+        return 2
+
+    src_dir, name, out_path = sys.argv[1:]
+    with open(os.path.join(src_dir, name), "rb") as f:
+        data = f.read()
+
+    def substitute(match):
+        ref = match.group(1).decode()
+        return content_hash(os.path.join(src_dir, ref)).encode()
+
+    data = HASH_RE.sub(substitute, data)
+
+    os.makedirs(os.path.dirname(os.path.abspath(out_path)), exist_ok=True)
+    with open(out_path, "wb") as raw:
+        with gzip.GzipFile(filename="", mode="wb", fileobj=raw, compresslevel=9, mtime=0) as gz:
+            gz.write(data)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())